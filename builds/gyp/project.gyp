@@ -82,7 +82,6 @@
         '../../src/curve_client.hpp',
         '../../src/curve_server.cpp',
         '../../src/curve_server.hpp',
-        '../../src/dbuffer.hpp',
         '../../src/dealer.cpp',
         '../../src/dealer.hpp',
         '../../src/decoder.hpp',
@@ -219,6 +218,7 @@
         '../../src/stream_engine.hpp',
         '../../src/sub.cpp',
         '../../src/sub.hpp',
+        '../../src/tbuffer.hpp',
         '../../src/tcp.cpp',
         '../../src/tcp.hpp',
         '../../src/tcp_address.cpp',
@@ -105,6 +105,9 @@ extern "C" {
 #   ifndef uint32_t
         typedef unsigned __int32 uint32_t;
 #   endif
+#   ifndef uint64_t
+        typedef unsigned __int64 uint64_t;
+#   endif
 #   ifndef uint16_t
         typedef unsigned __int16 uint16_t;
 #   endif
@@ -566,6 +569,20 @@ ZMQ_EXPORT void zmq_threadclose (void* thread);
 
 /*  DRAFT Socket options.                                                     */
 #define ZMQ_BINDTODEVICE 90
+#define ZMQ_COMPRESSION_LEVEL 92
+#define ZMQ_COMPRESSION_THRESHOLD 93
+#define ZMQ_SOCKET_STATS 94
+#define ZMQ_CONFLATE_TOPIC 95
+#define ZMQ_XPUB_LAST_VALUE_CACHE 96
+#define ZMQ_SNDHWM_BYTES 97
+#define ZMQ_RCVHWM_BYTES 98
+#define ZMQ_OUT_BATCH_SIZE 99
+#define ZMQ_IN_BATCH_SIZE 100
+#define ZMQ_ADAPTIVE_BATCH 101
+#define ZMQ_MSG_TIMESTAMPS 102
+#define ZMQ_KERNEL_TIMESTAMPS 103
+#define ZMQ_TCP_AUTOTUNE 104
+#define ZMQ_TCP_NOTSENT_LOWAT 105
 
 /*  DRAFT 0MQ socket events and monitoring                                    */
 #define ZMQ_EVENT_HANDSHAKE_FAILED_NO_DETAIL   0x0800
@@ -576,6 +593,8 @@ ZMQ_EXPORT void zmq_threadclose (void* thread);
 
 /*  DRAFT Context options                                                     */
 #define ZMQ_MSG_T_SIZE 6
+#define ZMQ_DNS_CACHE_TTL 7
+#define ZMQ_MEMORY_BUDGET 8
 
 /*  DRAFT Socket methods.                                                     */
 ZMQ_EXPORT int zmq_join (void *s, const char *group);
@@ -592,6 +611,42 @@ ZMQ_EXPORT const char *zmq_msg_group(zmq_msg_t *msg);
 #define ZMQ_MSG_PROPERTY_SOCKET_TYPE   "Socket-Type"
 #define ZMQ_MSG_PROPERTY_USER_ID       "User-Id"
 #define ZMQ_MSG_PROPERTY_PEER_ADDRESS  "Peer-Address"
+#define ZMQ_MSG_PROPERTY_TIME_SENT     "Time-Sent"
+#define ZMQ_MSG_PROPERTY_TIME_WRITTEN  "Time-Written"
+#define ZMQ_MSG_PROPERTY_TIME_ARRIVED  "Time-Arrived"
+#define ZMQ_MSG_PROPERTY_TIME_DECODED  "Time-Decoded"
+#define ZMQ_MSG_PROPERTY_TIME_RECEIVED "Time-Received"
+#define ZMQ_MSG_PROPERTY_TIME_KERNEL   "Time-Kernel"
+
+/*  DRAFT Socket statistics, read with the ZMQ_SOCKET_STATS option.           */
+typedef struct zmq_socket_stats_t
+{
+    uint64_t msgs_in;               /*  Messages received, multipart as one  */
+    uint64_t bytes_in;              /*  Bytes received                       */
+    uint64_t msgs_out;              /*  Messages sent, multipart as one      */
+    uint64_t bytes_out;             /*  Bytes sent                           */
+    uint64_t hwm_drops;             /*  Messages dropped at a full pipe      */
+    uint64_t hwm_blocks;            /*  Sends that could not queue at once   */
+    uint64_t unroutable_drops;      /*  Messages dropped for unknown peers   */
+    uint64_t reconnects;            /*  Reconnection attempts scheduled      */
+    uint64_t handshake_failures;    /*  Failed security/ZMTP handshakes      */
+} zmq_socket_stats_t;
+
+/*  DRAFT Socket monitoring into a ring of binary records.                    */
+typedef struct zmq_monitor_record_t
+{
+    uint64_t timestamp;     /*  Monotonic clock, in microseconds              */
+    int64_t value;          /*  As in zmq_socket_monitor: fd, errno, interval */
+    uint32_t event;         /*  ZMQ_EVENT_* code                              */
+    uint32_t sampled;       /*  Number of events this record stands for       */
+    char address [64];      /*  Endpoint, truncated and null-terminated       */
+} zmq_monitor_record_t;
+
+ZMQ_EXPORT int zmq_socket_monitor_ring (void *s, int events, int capacity, int sample_rate);
+ZMQ_EXPORT int zmq_socket_monitor_drain (void *s, zmq_monitor_record_t *records, int count, uint64_t *dropped);
+
+/*  DRAFT Message proxying.                                                   */
+ZMQ_EXPORT int zmq_proxy_threaded (void *frontend, void *backend, void *capture, void *control);
 
 /******************************************************************************/
 /*  Poller polling on sockets,fd and thread-safe sockets                      */
@@ -629,6 +684,16 @@ ZMQ_EXPORT int zmq_poller_modify_fd (void *poller, int fd, short events);
 ZMQ_EXPORT int zmq_poller_remove_fd (void *poller, int fd);
 #endif
 
+/******************************************************************************/
+/*  Thread groups: sockets used by one thread sharing a single wake-up fd     */
+/******************************************************************************/
+
+#define ZMQ_HAVE_THREAD_GROUP
+
+ZMQ_EXPORT void *zmq_thread_group_new (void);
+ZMQ_EXPORT int   zmq_thread_group_destroy (void **group_p);
+ZMQ_EXPORT int   zmq_thread_group_add (void *group, void *socket);
+
 /******************************************************************************/
 /*  Scheduling timers                                                         */
 /******************************************************************************/
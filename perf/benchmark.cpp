@@ -0,0 +1,827 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <vector>
+
+#include "latency.hpp"
+
+//  Runs a matrix of socket patterns, transports, message sizes and thread
+//  counts in a single process and reports throughput and latency
+//  percentiles for each combination, optionally as JSON for regression
+//  tracking.
+//
+//  Patterns:
+//    push_pull      N PUSH senders feeding one PULL collector (one-way).
+//    pub_sub        one PUB fanning out to N SUB subscribers (one-way).
+//    router_dealer  N DEALER clients talking through a ROUTER/DEALER
+//                   broker to N REP workers (round trip).
+//    radio_dish     one RADIO fanning out to N DISH subscribers (one-way,
+//                   lossy over UDP; losses are reported).
+//    client_server  N CLIENT clients talking to one SERVER (round trip).
+//
+//  One-way latency is measured under full load, so it includes queueing.
+//  Round-trip clients keep up to 'window' requests in flight.
+
+#define MAX_RUN_THREADS 256
+
+//  Each message carries the time it was sent in its first bytes. Messages
+//  with fewer bytes are control messages: an empty one is a probe sent
+//  while subscribers join, a single byte marks the end of a run.
+#define TIMESTAMP_SIZE 8
+
+static void check (int rc_, const char *what_)
+{
+    if (rc_ == -1) {
+        printf ("error in %s: %s\n", what_, zmq_strerror (errno));
+        exit (1);
+    }
+}
+
+static void *check_socket (void *socket_)
+{
+    if (!socket_) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    return socket_;
+}
+
+//  Settings of the whole matrix.
+
+struct config_t
+{
+    std::vector <const char*> patterns;
+    std::vector <const char*> transports;
+    std::vector <int> sizes;
+    std::vector <int> threads;
+    int count;
+    int window;
+    int io_threads;
+    const char *json;
+};
+
+//  State of one run, shared with its threads.
+
+struct run_t
+{
+    const char *pattern;
+    const char *transport;
+    size_t size;
+    int threads;
+    int count;
+    int window;
+    void *ctx;
+
+    //  Endpoint the threads connect to or, for UDP, bind to.
+    char endpoint [MAX_RUN_THREADS][256];
+
+    //  Endpoint of the inproc socket threads report progress to.
+    char sync_endpoint [64];
+
+    //  Results, filled in by the threads.
+    histogram_t *histograms [MAX_RUN_THREADS];
+    uint64_t received [MAX_RUN_THREADS];
+    uint64_t first_ns [MAX_RUN_THREADS];
+    uint64_t last_ns [MAX_RUN_THREADS];
+};
+
+struct worker_t
+{
+    run_t *run;
+    int index;
+};
+
+static int endpoint_seq = 0;
+
+//  Binds the socket to a fresh endpoint of the run's transport and
+//  returns the endpoint to connect to, or -1 if binding failed.
+static int bind_endpoint (void *socket_, const char *transport_,
+    char *endpoint_)
+{
+    if (strcmp (transport_, "inproc") == 0)
+        sprintf (endpoint_, "inproc://bench-%d", endpoint_seq++);
+    else
+    if (strcmp (transport_, "ipc") == 0)
+        strcpy (endpoint_, "ipc://*");
+    else
+    if (strcmp (transport_, "tcp") == 0)
+        strcpy (endpoint_, "tcp://127.0.0.1:*");
+    else
+        sprintf (endpoint_, "udp://127.0.0.1:%d", 45000 + endpoint_seq++);
+
+    int rc = zmq_bind (socket_, endpoint_);
+    if (rc == -1)
+        return -1;
+
+    if (strcmp (transport_, "udp") != 0) {
+        size_t size = 256;
+        rc = zmq_getsockopt (socket_, ZMQ_LAST_ENDPOINT, endpoint_, &size);
+        check (rc, "zmq_getsockopt");
+    }
+    return 0;
+}
+
+static void set_int (void *socket_, int option_, int value_)
+{
+    int rc = zmq_setsockopt (socket_, option_, &value_, sizeof (value_));
+    check (rc, "zmq_setsockopt");
+}
+
+static void send_data (void *socket_, size_t size_, const char *group_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init_size (&msg, size_);
+    check (rc, "zmq_msg_init_size");
+    uint64_t now = now_ns ();
+    memcpy (zmq_msg_data (&msg), &now, TIMESTAMP_SIZE);
+#if defined ZMQ_BUILD_DRAFT_API
+    if (group_) {
+        rc = zmq_msg_set_group (&msg, group_);
+        check (rc, "zmq_msg_set_group");
+    }
+#else
+    (void) group_;
+#endif
+    rc = zmq_msg_send (&msg, socket_, 0);
+    check (rc, "zmq_msg_send");
+}
+
+static void send_control (void *socket_, size_t size_, const char *group_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init_size (&msg, size_);
+    check (rc, "zmq_msg_init_size");
+    memset (zmq_msg_data (&msg), 0, size_);
+#if defined ZMQ_BUILD_DRAFT_API
+    if (group_) {
+        rc = zmq_msg_set_group (&msg, group_);
+        check (rc, "zmq_msg_set_group");
+    }
+#else
+    (void) group_;
+#endif
+    rc = zmq_msg_send (&msg, socket_, ZMQ_DONTWAIT);
+    if (rc == -1 && errno != EAGAIN)
+        check (rc, "zmq_msg_send");
+    zmq_msg_close (&msg);
+}
+
+//  Records a received timestamped message for the given worker.
+static void record (run_t *run_, int index_, zmq_msg_t *msg_)
+{
+    uint64_t now = now_ns ();
+    uint64_t sent;
+    memcpy (&sent, zmq_msg_data (msg_), TIMESTAMP_SIZE);
+    run_->histograms [index_]->record (now - sent);
+    if (run_->received [index_]++ == 0)
+        run_->first_ns [index_] = now;
+    run_->last_ns [index_] = now;
+}
+
+static void report_to_sync (void *sync_)
+{
+    int rc = zmq_send (sync_, "", 0, 0);
+    check (rc, "zmq_send");
+}
+
+//  push_pull: each sender pushes 'count' messages.
+
+static void push_worker (void *arg_)
+{
+    worker_t *worker = (worker_t *) arg_;
+    run_t *run = worker->run;
+
+    void *push = check_socket (zmq_socket (run->ctx, ZMQ_PUSH));
+    int rc = zmq_connect (push, run->endpoint [0]);
+    check (rc, "zmq_connect");
+
+    for (int i = 0; i != run->count; i++)
+        send_data (push, run->size, NULL);
+
+    rc = zmq_close (push);
+    check (rc, "zmq_close");
+}
+
+static int run_push_pull (run_t *run_, std::vector <worker_t> &workers_)
+{
+    void *pull = check_socket (zmq_socket (run_->ctx, ZMQ_PULL));
+    if (bind_endpoint (pull, run_->transport, run_->endpoint [0]) == -1) {
+        zmq_close (pull);
+        return -1;
+    }
+
+    std::vector <void*> handles;
+    for (int i = 0; i != run_->threads; i++)
+        handles.push_back (zmq_threadstart (push_worker, &workers_ [i]));
+
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    check (rc, "zmq_msg_init");
+    for (int i = 0; i != run_->count * run_->threads; i++) {
+        rc = zmq_msg_recv (&msg, pull, 0);
+        check (rc, "zmq_msg_recv");
+        record (run_, 0, &msg);
+    }
+    zmq_msg_close (&msg);
+
+    for (size_t i = 0; i != handles.size (); i++)
+        zmq_threadclose (handles [i]);
+    rc = zmq_close (pull);
+    check (rc, "zmq_close");
+    return 0;
+}
+
+//  pub_sub and radio_dish: subscribers acknowledge the first probe, read
+//  data until the end marker arrives and then report they are done.
+
+static void subscriber_worker (void *arg_)
+{
+    worker_t *worker = (worker_t *) arg_;
+    run_t *run = worker->run;
+    const bool dish = strcmp (run->pattern, "radio_dish") == 0;
+
+    void *sync = check_socket (zmq_socket (run->ctx, ZMQ_PUSH));
+    int rc = zmq_connect (sync, run->sync_endpoint);
+    check (rc, "zmq_connect");
+
+    void *sub;
+#if defined ZMQ_BUILD_DRAFT_API
+    if (dish) {
+        sub = check_socket (zmq_socket (run->ctx, ZMQ_DISH));
+        set_int (sub, ZMQ_RCVHWM, 0);
+        rc = zmq_join (sub, "bench");
+        check (rc, "zmq_join");
+    }
+    else
+#endif
+    {
+        sub = check_socket (zmq_socket (run->ctx, ZMQ_SUB));
+        rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "", 0);
+        check (rc, "zmq_setsockopt");
+    }
+
+    //  UDP dishes bind, everything else connects to the publisher.
+    if (dish && strcmp (run->transport, "udp") == 0)
+        rc = zmq_bind (sub, run->endpoint [worker->index]);
+    else
+        rc = zmq_connect (sub, run->endpoint [0]);
+    check (rc, dish ? "zmq_bind" : "zmq_connect");
+
+    //  Reports the bind, then waits for the first probe.
+    report_to_sync (sync);
+
+    bool joined = false;
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    check (rc, "zmq_msg_init");
+    while (true) {
+        rc = zmq_msg_recv (&msg, sub, 0);
+        check (rc, "zmq_msg_recv");
+        const size_t size = zmq_msg_size (&msg);
+        if (size == 0) {
+            if (!joined)
+                report_to_sync (sync);
+            joined = true;
+        }
+        else
+        if (size < TIMESTAMP_SIZE)
+            break;
+        else
+            record (run, worker->index, &msg);
+    }
+    zmq_msg_close (&msg);
+
+    report_to_sync (sync);
+    rc = zmq_close (sub);
+    check (rc, "zmq_close");
+    rc = zmq_close (sync);
+    check (rc, "zmq_close");
+}
+
+//  Waits for the given number of reports, sending a control message of
+//  the given size every millisecond meanwhile.
+static void await_reports (void *sync_, int reports_, void *publisher_,
+    size_t control_size_, const char *group_)
+{
+    zmq_pollitem_t item = {sync_, 0, ZMQ_POLLIN, 0};
+    while (reports_ > 0) {
+        if (publisher_)
+            send_control (publisher_, control_size_, group_);
+        int rc = zmq_poll (&item, 1, 1);
+        check (rc, "zmq_poll");
+        while (zmq_recv (sync_, NULL, 0, ZMQ_DONTWAIT) == 0)
+            reports_--;
+    }
+}
+
+static int run_fan_out (run_t *run_, std::vector <worker_t> &workers_)
+{
+    const bool radio = strcmp (run_->pattern, "radio_dish") == 0;
+    const bool udp = strcmp (run_->transport, "udp") == 0;
+    const char *group = radio ? "bench" : NULL;
+
+    void *sync = check_socket (zmq_socket (run_->ctx, ZMQ_PULL));
+    sprintf (run_->sync_endpoint, "inproc://bench-sync-%d", endpoint_seq++);
+    int rc = zmq_bind (sync, run_->sync_endpoint);
+    check (rc, "zmq_bind");
+
+    void *publisher;
+#if defined ZMQ_BUILD_DRAFT_API
+    if (radio) {
+        publisher = check_socket (zmq_socket (run_->ctx, ZMQ_RADIO));
+        set_int (publisher, ZMQ_SNDHWM, 0);
+    }
+    else
+#endif
+    {
+        //  Block rather than drop when a subscriber falls behind.
+        publisher = check_socket (zmq_socket (run_->ctx, ZMQ_PUB));
+        set_int (publisher, ZMQ_XPUB_NODROP, 1);
+    }
+
+    if (udp) {
+        for (int i = 0; i != run_->threads; i++)
+            sprintf (run_->endpoint [i], "udp://127.0.0.1:%d",
+                45000 + endpoint_seq++);
+    }
+    else
+    if (bind_endpoint (publisher, run_->transport, run_->endpoint [0]) == -1) {
+        zmq_close (publisher);
+        zmq_close (sync);
+        return -1;
+    }
+
+    std::vector <void*> handles;
+    for (int i = 0; i != run_->threads; i++)
+        handles.push_back (zmq_threadstart (subscriber_worker, &workers_ [i]));
+
+    //  Subscribers have bound or connected; UDP publishers connect now.
+    await_reports (sync, run_->threads, NULL, 0, NULL);
+    if (udp)
+        for (int i = 0; i != run_->threads; i++) {
+            rc = zmq_connect (publisher, run_->endpoint [i]);
+            check (rc, "zmq_connect");
+        }
+
+    //  Probe until every subscriber has joined, send the data and then
+    //  the end marker until every subscriber is done.
+    await_reports (sync, run_->threads, publisher, 0, group);
+    for (int i = 0; i != run_->count; i++)
+        send_data (publisher, run_->size, group);
+    await_reports (sync, run_->threads, publisher, 1, group);
+
+    for (size_t i = 0; i != handles.size (); i++)
+        zmq_threadclose (handles [i]);
+    rc = zmq_close (publisher);
+    check (rc, "zmq_close");
+    rc = zmq_close (sync);
+    check (rc, "zmq_close");
+    return 0;
+}
+
+//  router_dealer and client_server: clients keep up to 'window' requests
+//  in flight and measure the round trip.
+
+static void client_worker (void *arg_)
+{
+    worker_t *worker = (worker_t *) arg_;
+    run_t *run = worker->run;
+    const bool dealer = strcmp (run->pattern, "router_dealer") == 0;
+
+    void *client;
+#if defined ZMQ_BUILD_DRAFT_API
+    if (!dealer)
+        client = check_socket (zmq_socket (run->ctx, ZMQ_CLIENT));
+    else
+#endif
+        client = check_socket (zmq_socket (run->ctx, ZMQ_DEALER));
+    int rc = zmq_connect (client, run->endpoint [0]);
+    check (rc, "zmq_connect");
+
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    check (rc, "zmq_msg_init");
+
+    int sent = 0;
+    int received = 0;
+    while (received != run->count) {
+        while (sent != run->count && sent - received < run->window) {
+            //  REP workers expect an empty delimiter frame.
+            if (dealer) {
+                rc = zmq_send (client, "", 0, ZMQ_SNDMORE);
+                check (rc, "zmq_send");
+            }
+            send_data (client, run->size, NULL);
+            sent++;
+        }
+        if (dealer) {
+            rc = zmq_msg_recv (&msg, client, 0);
+            check (rc, "zmq_msg_recv");
+        }
+        rc = zmq_msg_recv (&msg, client, 0);
+        check (rc, "zmq_msg_recv");
+        record (run, worker->index, &msg);
+        received++;
+    }
+    zmq_msg_close (&msg);
+
+    rc = zmq_close (client);
+    check (rc, "zmq_close");
+}
+
+//  Echo loops; they end when the context is shut down.
+
+static void rep_worker (void *arg_)
+{
+    run_t *run = (run_t *) arg_;
+    void *rep = check_socket (zmq_socket (run->ctx, ZMQ_REP));
+    int rc = zmq_connect (rep, run->endpoint [1]);
+    check (rc, "zmq_connect");
+
+    zmq_msg_t msg;
+    zmq_msg_init (&msg);
+    while (zmq_msg_recv (&msg, rep, 0) != -1 &&
+           zmq_msg_send (&msg, rep, 0) != -1)
+        ;
+    zmq_msg_close (&msg);
+    zmq_close (rep);
+}
+
+#if defined ZMQ_BUILD_DRAFT_API
+static void server_worker (void *arg_)
+{
+    void *server = arg_;
+    zmq_msg_t msg;
+    zmq_msg_init (&msg);
+    while (zmq_msg_recv (&msg, server, 0) != -1 &&
+           zmq_msg_send (&msg, server, 0) != -1)
+        ;
+    zmq_msg_close (&msg);
+    zmq_close (server);
+}
+#endif
+
+struct broker_t
+{
+    void *frontend;
+    void *backend;
+    void *control;
+};
+
+static void broker_worker (void *arg_)
+{
+    broker_t *broker = (broker_t *) arg_;
+    zmq_proxy_steerable (broker->frontend, broker->backend, NULL,
+        broker->control);
+    zmq_close (broker->frontend);
+    zmq_close (broker->backend);
+    zmq_close (broker->control);
+}
+
+static int run_round_trip (run_t *run_, std::vector <worker_t> &workers_)
+{
+    std::vector <void*> servers;
+    void *control = NULL;
+
+    if (strcmp (run_->pattern, "router_dealer") == 0) {
+        broker_t *broker = new broker_t;
+        broker->frontend = check_socket (zmq_socket (run_->ctx, ZMQ_ROUTER));
+        if (bind_endpoint (broker->frontend, run_->transport,
+              run_->endpoint [0]) == -1) {
+            zmq_close (broker->frontend);
+            delete broker;
+            return -1;
+        }
+        broker->backend = check_socket (zmq_socket (run_->ctx, ZMQ_DEALER));
+        int rc = bind_endpoint (broker->backend, "inproc", run_->endpoint [1]);
+        check (rc, "zmq_bind");
+        broker->control = check_socket (zmq_socket (run_->ctx, ZMQ_PAIR));
+        char control_endpoint [64];
+        rc = bind_endpoint (broker->control, "inproc", control_endpoint);
+        check (rc, "zmq_bind");
+        control = check_socket (zmq_socket (run_->ctx, ZMQ_PAIR));
+        rc = zmq_connect (control, control_endpoint);
+        check (rc, "zmq_connect");
+
+        servers.push_back (zmq_threadstart (broker_worker, broker));
+        for (int i = 0; i != run_->threads; i++)
+            servers.push_back (zmq_threadstart (rep_worker, run_));
+
+        std::vector <void*> clients;
+        for (int i = 0; i != run_->threads; i++)
+            clients.push_back (zmq_threadstart (client_worker, &workers_ [i]));
+        for (size_t i = 0; i != clients.size (); i++)
+            zmq_threadclose (clients [i]);
+
+        rc = zmq_send (control, "TERMINATE", 9, 0);
+        check (rc, "zmq_send");
+        zmq_threadclose (servers [0]);
+        servers.erase (servers.begin ());
+        delete broker;
+    }
+#if defined ZMQ_BUILD_DRAFT_API
+    else {
+        void *server = check_socket (zmq_socket (run_->ctx, ZMQ_SERVER));
+        if (bind_endpoint (server, run_->transport, run_->endpoint [0]) == -1) {
+            zmq_close (server);
+            return -1;
+        }
+        servers.push_back (zmq_threadstart (server_worker, server));
+
+        std::vector <void*> clients;
+        for (int i = 0; i != run_->threads; i++)
+            clients.push_back (zmq_threadstart (client_worker, &workers_ [i]));
+        for (size_t i = 0; i != clients.size (); i++)
+            zmq_threadclose (clients [i]);
+    }
+#endif
+
+    //  Unblock the echo loops.
+    if (control)
+        zmq_close (control);
+    int rc = zmq_ctx_shutdown (run_->ctx);
+    check (rc, "zmq_ctx_shutdown");
+    for (size_t i = 0; i != servers.size (); i++)
+        zmq_threadclose (servers [i]);
+    return 0;
+}
+
+static bool pattern_available (const char *pattern_)
+{
+#if defined ZMQ_BUILD_DRAFT_API
+    if (strcmp (pattern_, "radio_dish") == 0 ||
+          strcmp (pattern_, "client_server") == 0)
+        return true;
+#endif
+    return strcmp (pattern_, "push_pull") == 0 ||
+        strcmp (pattern_, "pub_sub") == 0 ||
+        strcmp (pattern_, "router_dealer") == 0;
+}
+
+//  Returns why the combination cannot run, or NULL if it can.
+static const char *unsupported (const char *pattern_, const char *transport_,
+    int size_, int threads_)
+{
+    if (!pattern_available (pattern_))
+        return "pattern unknown or needs the draft API";
+    const bool radio = strcmp (pattern_, "radio_dish") == 0;
+    if (strcmp (transport_, "udp") == 0 && !radio)
+        return "UDP supports RADIO/DISH only";
+    if (strcmp (transport_, "udp") == 0 && size_ > 8000)
+        return "too large for a UDP datagram";
+    if (threads_ < 1 || threads_ > MAX_RUN_THREADS)
+        return "thread count out of range";
+    return NULL;
+}
+
+static void split_list (char *list_, std::vector <const char*> &items_)
+{
+    items_.clear ();
+    for (char *item = strtok (list_, ","); item; item = strtok (NULL, ","))
+        items_.push_back (item);
+}
+
+static void split_int_list (char *list_, std::vector <int> &items_)
+{
+    items_.clear ();
+    for (char *item = strtok (list_, ","); item; item = strtok (NULL, ","))
+        items_.push_back (atoi (item));
+}
+
+static void usage ()
+{
+    printf ("usage: benchmark [options]\n"
+        "  --patterns LIST    push_pull,pub_sub,router_dealer,"
+        "radio_dish,client_server\n"
+        "  --transports LIST  inproc,ipc,tcp,udp\n"
+        "  --sizes LIST       message sizes in bytes (default 64,1024,65536)\n"
+        "  --threads LIST     clients or subscribers per run (default 1,4)\n"
+        "  --count N          messages per client or sender (default 10000)\n"
+        "  --window N         requests in flight per client (default 8)\n"
+        "  --io-threads N     I/O threads per context (default 1)\n"
+        "  --json FILE        write results as JSON to FILE\n");
+}
+
+int main (int argc, char *argv [])
+{
+    char default_patterns [] =
+        "push_pull,pub_sub,router_dealer,radio_dish,client_server";
+    char default_transports [] = "inproc,ipc,tcp,udp";
+    char default_sizes [] = "64,1024,65536";
+    char default_threads [] = "1,4";
+
+    config_t config;
+    split_list (default_patterns, config.patterns);
+    split_list (default_transports, config.transports);
+    split_int_list (default_sizes, config.sizes);
+    split_int_list (default_threads, config.threads);
+    config.count = 10000;
+    config.window = 8;
+    config.io_threads = 1;
+    config.json = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc) {
+            usage ();
+            return 1;
+        }
+        if (strcmp (argv [i], "--patterns") == 0)
+            split_list (argv [++i], config.patterns);
+        else
+        if (strcmp (argv [i], "--transports") == 0)
+            split_list (argv [++i], config.transports);
+        else
+        if (strcmp (argv [i], "--sizes") == 0)
+            split_int_list (argv [++i], config.sizes);
+        else
+        if (strcmp (argv [i], "--threads") == 0)
+            split_int_list (argv [++i], config.threads);
+        else
+        if (strcmp (argv [i], "--count") == 0)
+            config.count = atoi (argv [++i]);
+        else
+        if (strcmp (argv [i], "--window") == 0)
+            config.window = atoi (argv [++i]);
+        else
+        if (strcmp (argv [i], "--io-threads") == 0)
+            config.io_threads = atoi (argv [++i]);
+        else
+        if (strcmp (argv [i], "--json") == 0)
+            config.json = argv [++i];
+        else {
+            usage ();
+            return 1;
+        }
+    }
+    if (config.count < 1 || config.window < 1) {
+        usage ();
+        return 1;
+    }
+
+    FILE *json = NULL;
+    if (config.json) {
+        json = fopen (config.json, "w");
+        if (!json) {
+            printf ("error in fopen: %s\n", strerror (errno));
+            return -1;
+        }
+        int major, minor, patch;
+        zmq_version (&major, &minor, &patch);
+        fprintf (json, "{\n  \"version\": \"%d.%d.%d\",\n"
+            "  \"count\": %d,\n  \"window\": %d,\n  \"io_threads\": %d,\n"
+            "  \"runs\": [", major, minor, patch, config.count, config.window,
+            config.io_threads);
+    }
+    bool first_run = true;
+
+    printf ("%-14s %-7s %8s %4s %12s %10s %9s %9s %9s %9s %9s %8s\n",
+        "pattern", "trans", "size", "thr", "msg/s", "Mb/s", "p50 us",
+        "p90 us", "p99 us", "p99.9 us", "max us", "lost");
+
+    for (size_t p = 0; p != config.patterns.size (); p++)
+    for (size_t t = 0; t != config.transports.size (); t++)
+    for (size_t s = 0; s != config.sizes.size (); s++)
+    for (size_t n = 0; n != config.threads.size (); n++) {
+        const char *pattern = config.patterns [p];
+        const char *transport = config.transports [t];
+        int size = config.sizes [s];
+        const int threads = config.threads [n];
+
+        const char *reason = unsupported (pattern, transport, size, threads);
+        if (reason) {
+            printf ("%-14s %-7s %8d %4d skipped: %s\n", pattern, transport,
+                size, threads, reason);
+            continue;
+        }
+        if (size < TIMESTAMP_SIZE)
+            size = TIMESTAMP_SIZE;
+
+        run_t *run = new run_t;
+        memset (run, 0, sizeof (run_t));
+        run->pattern = pattern;
+        run->transport = transport;
+        run->size = size;
+        run->threads = threads;
+        run->count = config.count;
+        run->window = config.window;
+        run->ctx = zmq_ctx_new ();
+        if (!run->ctx) {
+            printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        int rc = zmq_ctx_set (run->ctx, ZMQ_IO_THREADS, config.io_threads);
+        check (rc, "zmq_ctx_set");
+
+        std::vector <worker_t> workers (threads);
+        for (int i = 0; i != threads; i++) {
+            workers [i].run = run;
+            workers [i].index = i;
+            run->histograms [i] = new histogram_t;
+        }
+
+        if (strcmp (pattern, "push_pull") == 0)
+            rc = run_push_pull (run, workers);
+        else
+        if (strcmp (pattern, "pub_sub") == 0 ||
+              strcmp (pattern, "radio_dish") == 0)
+            rc = run_fan_out (run, workers);
+        else
+            rc = run_round_trip (run, workers);
+
+        if (rc == -1)
+            printf ("%-14s %-7s %8d %4d skipped: %s\n", pattern, transport,
+                size, threads, zmq_strerror (errno));
+
+        zmq_ctx_term (run->ctx);
+
+        //  Merge the results of all threads.
+        histogram_t total;
+        uint64_t received = 0;
+        uint64_t first_ns = 0;
+        uint64_t last_ns = 0;
+        for (int i = 0; i != threads; i++) {
+            total.add (*run->histograms [i]);
+            received += run->received [i];
+            if (run->received [i] && (!first_ns || run->first_ns [i] < first_ns))
+                first_ns = run->first_ns [i];
+            if (run->last_ns [i] > last_ns)
+                last_ns = run->last_ns [i];
+            delete run->histograms [i];
+        }
+
+        if (rc == 0) {
+            //  Messages that every receiver was meant to get.
+            uint64_t expected = (uint64_t) config.count * threads;
+            uint64_t lost = expected - received;
+            double seconds = (double) (last_ns - first_ns) / 1e9;
+            if (seconds <= 0)
+                seconds = 1e-9;
+            double rate = (double) received / seconds;
+            double megabits = rate * size * 8 / 1e6;
+
+            printf ("%-14s %-7s %8d %4d %12.0f %10.1f %9.1f %9.1f %9.1f "
+                "%9.1f %9.1f %8llu\n", pattern, transport, size, threads,
+                rate, megabits, total.percentile (50) / 1e3,
+                total.percentile (90) / 1e3, total.percentile (99) / 1e3,
+                total.percentile (99.9) / 1e3, total.max / 1e3,
+                (unsigned long long) lost);
+
+            if (json) {
+                fprintf (json, "%s\n    {\"pattern\": \"%s\", "
+                    "\"transport\": \"%s\", \"size\": %d, \"threads\": %d, "
+                    "\"messages\": %llu, \"lost\": %llu, "
+                    "\"seconds\": %.6f, \"msgs_per_sec\": %.1f, "
+                    "\"mbits_per_sec\": %.3f, \"latency_us\": {"
+                    "\"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, "
+                    "\"p999\": %.3f, \"p9999\": %.3f, \"max\": %.3f}}",
+                    first_run ? "" : ",", pattern, transport, size, threads,
+                    (unsigned long long) received, (unsigned long long) lost,
+                    seconds, rate, megabits, total.percentile (50) / 1e3,
+                    total.percentile (90) / 1e3, total.percentile (99) / 1e3,
+                    total.percentile (99.9) / 1e3,
+                    total.percentile (99.99) / 1e3, total.max / 1e3);
+                first_run = false;
+            }
+        }
+        fflush (stdout);
+        delete run;
+    }
+
+    if (json) {
+        fprintf (json, "\n  ]\n}\n");
+        fclose (json);
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_PERF_LATENCY_HPP_INCLUDED__
+#define __ZMQ_PERF_LATENCY_HPP_INCLUDED__
+
+#include "../include/zmq.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#if defined ZMQ_HAVE_LINUX
+#include <sched.h>
+#endif
+
+//  Helpers shared by the latency measuring perf tools.
+
+inline uint64_t now_ns ()
+{
+#if defined ZMQ_HAVE_WINDOWS
+    LARGE_INTEGER ticks;
+    LARGE_INTEGER frequency;
+    QueryPerformanceCounter (&ticks);
+    QueryPerformanceFrequency (&frequency);
+    return (uint64_t) ((double) ticks.QuadPart * 1000000000.0 /
+        (double) frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+//  CPU affinity of a thread, as saved by pin_thread.
+struct thread_affinity_t
+{
+#if defined ZMQ_HAVE_WINDOWS
+    DWORD_PTR mask;
+#elif defined ZMQ_HAVE_LINUX
+    cpu_set_t set;
+#endif
+};
+
+//  Pins the calling thread to the given CPU. Threads it starts afterwards,
+//  including the I/O threads of a context, inherit the setting. If saved_
+//  is not NULL, the previous affinity is stored there for restore_thread.
+//  Returns -1 if pinning failed or is not supported on this platform.
+inline int pin_thread (int cpu_, thread_affinity_t *saved_ = NULL)
+{
+#if defined ZMQ_HAVE_WINDOWS
+    if (cpu_ < 0 || cpu_ >= (int) (sizeof (DWORD_PTR) * 8))
+        return -1;
+    const DWORD_PTR previous = SetThreadAffinityMask (GetCurrentThread (),
+        (DWORD_PTR) 1 << cpu_);
+    if (!previous)
+        return -1;
+    if (saved_)
+        saved_->mask = previous;
+    return 0;
+#elif defined ZMQ_HAVE_LINUX
+    if (cpu_ < 0 || cpu_ >= CPU_SETSIZE)
+        return -1;
+    if (saved_ && sched_getaffinity (0, sizeof (saved_->set),
+          &saved_->set) != 0)
+        return -1;
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    CPU_SET (cpu_, &set);
+    return sched_setaffinity (0, sizeof (set), &set);
+#else
+    (void) cpu_;
+    (void) saved_;
+    return -1;
+#endif
+}
+
+//  Gives the calling thread back the affinity pin_thread saved.
+inline int restore_thread (const thread_affinity_t *saved_)
+{
+#if defined ZMQ_HAVE_WINDOWS
+    return SetThreadAffinityMask (GetCurrentThread (),
+        saved_->mask) ? 0 : -1;
+#elif defined ZMQ_HAVE_LINUX
+    return sched_setaffinity (0, sizeof (saved_->set), &saved_->set);
+#else
+    (void) saved_;
+    return -1;
+#endif
+}
+
+//  Log-linear histogram in the spirit of HdrHistogram. Values below 64 are
+//  counted exactly; above, each power of two is split into 32 linear
+//  sub-buckets, which bounds the relative error to about 3%.
+
+struct histogram_t
+{
+    enum { sub_buckets = 64, buckets = 59 };
+
+    uint64_t counts [buckets][sub_buckets];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max;
+
+    histogram_t ()
+    {
+        memset (counts, 0, sizeof (counts));
+        total = 0;
+        sum = 0;
+        max = 0;
+    }
+
+    void record (uint64_t value_)
+    {
+        int shift = 0;
+        while ((value_ >> shift) >= sub_buckets)
+            shift++;
+        counts [shift][value_ >> shift]++;
+        total++;
+        sum += value_;
+        if (value_ > max)
+            max = value_;
+    }
+
+    void add (const histogram_t &other_)
+    {
+        for (int i = 0; i != buckets; i++)
+            for (int j = 0; j != sub_buckets; j++)
+                counts [i][j] += other_.counts [i][j];
+        total += other_.total;
+        sum += other_.sum;
+        if (other_.max > max)
+            max = other_.max;
+    }
+
+    double mean () const
+    {
+        return total ? (double) sum / (double) total : 0;
+    }
+
+    //  Returns the upper bound of the bucket holding the given percentile.
+    uint64_t percentile (double percentile_) const
+    {
+        if (total == 0)
+            return 0;
+        uint64_t rank = (uint64_t) (percentile_ / 100 * (double) total);
+        if (rank >= total)
+            rank = total - 1;
+        uint64_t seen = 0;
+        for (int i = 0; i != buckets; i++)
+            for (int j = 0; j != sub_buckets; j++) {
+                seen += counts [i][j];
+                if (seen > rank) {
+                    uint64_t value = (((uint64_t) j + 1) << i) - 1;
+                    return value < max ? value : max;
+                }
+            }
+        return max;
+    }
+};
+
+#endif
@@ -30,6 +30,9 @@
 #include "../include/zmq.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "latency.hpp"
 
 int main (int argc, char *argv [])
 {
@@ -41,15 +44,37 @@ int main (int argc, char *argv [])
     int rc;
     int i;
     zmq_msg_t msg;
+    int cpu = -1;
+    int io_cpu = -1;
 
-    if (argc != 4) {
+    if (argc < 4 || argc % 2) {
         printf ("usage: local_lat <bind-to> <message-size> "
-            "<roundtrip-count>\n");
+            "<roundtrip-count> [--cpu <n>] [--io-cpu <n>]\n");
         return 1;
     }
     bind_to = argv [1];
     message_size = atoi (argv [2]);
     roundtrip_count = atoi (argv [3]);
+    for (i = 4; i < argc; i += 2) {
+        if (strcmp (argv [i], "--cpu") == 0)
+            cpu = atoi (argv [i + 1]);
+        else
+        if (strcmp (argv [i], "--io-cpu") == 0)
+            io_cpu = atoi (argv [i + 1]);
+        else {
+            printf ("usage: local_lat <bind-to> <message-size> "
+                "<roundtrip-count> [--cpu <n>] [--io-cpu <n>]\n");
+            return 1;
+        }
+    }
+
+    //  The context starts its I/O thread along with the first socket, so
+    //  the thread inherits whatever CPU this thread is pinned to then.
+    thread_affinity_t affinity;
+    if (io_cpu >= 0 && pin_thread (io_cpu, &affinity) != 0) {
+        printf ("error pinning to CPU %d\n", io_cpu);
+        return -1;
+    }
 
     ctx = zmq_init (1);
     if (!ctx) {
@@ -63,6 +88,20 @@ int main (int argc, char *argv [])
         return -1;
     }
 
+    //  Without --cpu, this thread goes back to wherever it ran before
+    //  rather than sharing the I/O thread's CPU.
+    if (cpu >= 0) {
+        if (pin_thread (cpu) != 0) {
+            printf ("error pinning to CPU %d\n", cpu);
+            return -1;
+        }
+    }
+    else
+    if (io_cpu >= 0 && restore_thread (&affinity) != 0) {
+        printf ("error restoring CPU affinity\n");
+        return -1;
+    }
+
     rc = zmq_bind (s, bind_to);
     if (rc != 0) {
         printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
@@ -32,28 +32,182 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "latency.hpp"
+
+//  Every round trip is timed on its own and the distribution is reported
+//  along with the average.
+//
+//  By default a request is only sent once the previous reply has arrived,
+//  so a stall delays the requests that would have been sent meanwhile and
+//  is counted only once. With --rate requests are sent on a fixed schedule
+//  whether replies keep up or not, and each round trip is measured from
+//  the time its request was due. That corrects for the coordinated
+//  omission of the closed loop, which hides exactly the tail latencies
+//  that matter.
+
+static void usage ()
+{
+    printf ("usage: remote_lat <connect-to> <message-size> "
+        "<roundtrip-count> [--rate <msgs/s>] [--cpu <n>] [--io-cpu <n>]\n");
+}
+
+static int closed_loop (void *s_, size_t message_size_, int roundtrip_count_,
+    histogram_t &histogram_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init_size (&msg, message_size_);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    memset (zmq_msg_data (&msg), 0, message_size_);
+
+    for (int i = 0; i != roundtrip_count_; i++) {
+        uint64_t start = now_ns ();
+        rc = zmq_sendmsg (s_, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_sendmsg: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        rc = zmq_recvmsg (s_, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        histogram_.record (now_ns () - start);
+        if (zmq_msg_size (&msg) != message_size_) {
+            printf ("message of incorrect size received\n");
+            return -1;
+        }
+    }
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    return 0;
+}
+
+//  Sends requests from a DEALER on a fixed schedule. local_lat answers
+//  them in order, so the n-th reply belongs to the n-th request.
+static int open_loop (void *s_, size_t message_size_, int roundtrip_count_,
+    int rate_, histogram_t &histogram_)
+{
+    const uint64_t interval = 1000000000 / rate_;
+    char *buffer = (char *) malloc (message_size_ + 1);
+    if (!buffer) {
+        printf ("out of memory\n");
+        return -1;
+    }
+    memset (buffer, 0, message_size_ + 1);
+
+    int sent = 0;
+    int received = 0;
+    int rc;
+    const uint64_t start = now_ns ();
+    while (received != roundtrip_count_) {
+
+        //  Send every request that is due. If the pipe is full the rest
+        //  stay due and their wait is counted in their latency.
+        while (sent != roundtrip_count_ &&
+              start + sent * interval <= now_ns ()) {
+            rc = zmq_send (s_, NULL, 0, ZMQ_SNDMORE | ZMQ_DONTWAIT);
+            if (rc < 0 && errno == EAGAIN)
+                break;
+            if (rc >= 0)
+                rc = zmq_send (s_, buffer, message_size_, 0);
+            if (rc < 0) {
+                printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+                free (buffer);
+                return -1;
+            }
+            sent++;
+        }
+
+        //  Wait for replies until the next request is due.
+        long timeout = -1;
+        if (sent != roundtrip_count_) {
+            uint64_t due = start + sent * interval;
+            uint64_t now = now_ns ();
+            timeout = due > now ? (long) ((due - now) / 1000000) : 0;
+        }
+        zmq_pollitem_t item = {s_, 0, ZMQ_POLLIN, 0};
+        rc = zmq_poll (&item, 1, timeout);
+        if (rc < 0) {
+            printf ("error in zmq_poll: %s\n", zmq_strerror (errno));
+            free (buffer);
+            return -1;
+        }
+
+        while (received != roundtrip_count_) {
+            rc = zmq_recv (s_, NULL, 0, ZMQ_DONTWAIT);
+            if (rc < 0 && errno == EAGAIN)
+                break;
+            if (rc >= 0)
+                rc = zmq_recv (s_, buffer, message_size_ + 1, 0);
+            if (rc < 0) {
+                printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+                free (buffer);
+                return -1;
+            }
+            histogram_.record (now_ns () - (start + received * interval));
+            if ((size_t) rc != message_size_) {
+                printf ("message of incorrect size received\n");
+                free (buffer);
+                return -1;
+            }
+            received++;
+        }
+    }
+
+    free (buffer);
+    return 0;
+}
+
 int main (int argc, char *argv [])
 {
     const char *connect_to;
     int roundtrip_count;
     size_t message_size;
+    int rate = 0;
+    int cpu = -1;
+    int io_cpu = -1;
     void *ctx;
     void *s;
     int rc;
     int i;
-    zmq_msg_t msg;
-    void *watch;
-    unsigned long elapsed;
-    double latency;
+    histogram_t histogram;
 
-    if (argc != 4) {
-        printf ("usage: remote_lat <connect-to> <message-size> "
-            "<roundtrip-count>\n");
+    if (argc < 4 || argc % 2) {
+        usage ();
         return 1;
     }
     connect_to = argv [1];
     message_size = atoi (argv [2]);
     roundtrip_count = atoi (argv [3]);
+    for (i = 4; i < argc; i += 2) {
+        if (strcmp (argv [i], "--rate") == 0)
+            rate = atoi (argv [i + 1]);
+        else
+        if (strcmp (argv [i], "--cpu") == 0)
+            cpu = atoi (argv [i + 1]);
+        else
+        if (strcmp (argv [i], "--io-cpu") == 0)
+            io_cpu = atoi (argv [i + 1]);
+        else {
+            usage ();
+            return 1;
+        }
+    }
+
+    //  The context starts its I/O thread along with the first socket, so
+    //  the thread inherits whatever CPU this thread is pinned to then.
+    thread_affinity_t affinity;
+    if (io_cpu >= 0 && pin_thread (io_cpu, &affinity) != 0) {
+        printf ("error pinning to CPU %d\n", io_cpu);
+        return -1;
+    }
 
     ctx = zmq_init (1);
     if (!ctx) {
@@ -61,57 +215,50 @@ int main (int argc, char *argv [])
         return -1;
     }
 
-    s = zmq_socket (ctx, ZMQ_REQ);
+    s = zmq_socket (ctx, rate > 0 ? ZMQ_DEALER : ZMQ_REQ);
     if (!s) {
         printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
         return -1;
     }
 
-    rc = zmq_connect (s, connect_to);
-    if (rc != 0) {
-        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
-        return -1;
-    }
-
-    rc = zmq_msg_init_size (&msg, message_size);
-    if (rc != 0) {
-        printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
-        return -1;
-    }
-    memset (zmq_msg_data (&msg), 0, message_size);
-
-    watch = zmq_stopwatch_start ();
-
-    for (i = 0; i != roundtrip_count; i++) {
-        rc = zmq_sendmsg (s, &msg, 0);
-        if (rc < 0) {
-            printf ("error in zmq_sendmsg: %s\n", zmq_strerror (errno));
-            return -1;
-        }
-        rc = zmq_recvmsg (s, &msg, 0);
-        if (rc < 0) {
-            printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
-            return -1;
-        }
-        if (zmq_msg_size (&msg) != message_size) {
-            printf ("message of incorrect size received\n");
+    //  Without --cpu, this thread goes back to wherever it ran before
+    //  rather than sharing the I/O thread's CPU.
+    if (cpu >= 0) {
+        if (pin_thread (cpu) != 0) {
+            printf ("error pinning to CPU %d\n", cpu);
             return -1;
         }
     }
+    else
+    if (io_cpu >= 0 && restore_thread (&affinity) != 0) {
+        printf ("error restoring CPU affinity\n");
+        return -1;
+    }
 
-    elapsed = zmq_stopwatch_stop (watch);
-
-    rc = zmq_msg_close (&msg);
+    rc = zmq_connect (s, connect_to);
     if (rc != 0) {
-        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
         return -1;
     }
 
-    latency = (double) elapsed / (roundtrip_count * 2);
+    if (rate > 0)
+        rc = open_loop (s, message_size, roundtrip_count, rate, histogram);
+    else
+        rc = closed_loop (s, message_size, roundtrip_count, histogram);
+    if (rc != 0)
+        return -1;
 
     printf ("message size: %d [B]\n", (int) message_size);
     printf ("roundtrip count: %d\n", (int) roundtrip_count);
-    printf ("average latency: %.3f [us]\n", (double) latency);
+    if (rate > 0)
+        printf ("send rate: %d [msg/s]\n", rate);
+    printf ("average latency: %.3f [us]\n", histogram.mean () / 2 / 1e3);
+    printf ("roundtrip p50: %.3f [us]\n", histogram.percentile (50) / 1e3);
+    printf ("roundtrip p90: %.3f [us]\n", histogram.percentile (90) / 1e3);
+    printf ("roundtrip p99: %.3f [us]\n", histogram.percentile (99) / 1e3);
+    printf ("roundtrip p99.9: %.3f [us]\n",
+        histogram.percentile (99.9) / 1e3);
+    printf ("roundtrip max: %.3f [us]\n", histogram.max / 1e3);
 
     rc = zmq_close (s);
     if (rc != 0) {
@@ -0,0 +1,127 @@
+/*
+    Copyright (c) 2007-2012 iMatix Corporation
+    Copyright (c) 2009-2011 250bpm s.r.o.
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+//  Measures how fast short-lived sockets can be created and closed, either
+//  bare or connected to an endpoint, as done by clients that open a socket
+//  per request.
+
+int main (int argc, char *argv [])
+{
+    const char *endpoint = NULL;
+    void *ctx;
+    void *s;
+    int socket_count;
+    int linger = 0;
+    int rc;
+    int i;
+    void *watch;
+    unsigned long elapsed;
+    unsigned long rate;
+
+    if (argc != 2 && argc != 3) {
+        printf ("usage: socket_churn <socket-count> [connect-to]\n");
+        return 1;
+    }
+    socket_count = atoi (argv [1]);
+    if (argc == 3)
+        endpoint = argv [2];
+
+    ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    printf ("socket count: %d\n", socket_count);
+    printf ("connect to: %s\n", endpoint ? endpoint : "none");
+
+    watch = zmq_stopwatch_start ();
+
+    for (i = 0; i != socket_count; i++) {
+        //  Connected sockets are still deallocated by the reaper thread, so
+        //  the loop may briefly run out of socket slots; retry until the
+        //  reaper catches up.
+        do {
+            s = zmq_socket (ctx, ZMQ_DEALER);
+        } while (!s && errno == EMFILE);
+        if (!s) {
+            printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+
+        rc = zmq_setsockopt (s, ZMQ_LINGER, &linger, sizeof (linger));
+        if (rc != 0) {
+            printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+
+        if (endpoint) {
+            rc = zmq_connect (s, endpoint);
+            if (rc != 0) {
+                printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+                return -1;
+            }
+        }
+
+        rc = zmq_close (s);
+        if (rc != 0) {
+            printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    //  Context termination waits for all the sockets to be deallocated.
+    elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    rate = (unsigned long)
+        ((double) socket_count / (double) elapsed * 1000000);
+
+    printf ("mean create/close rate: %d [sockets/s]\n", (int) rate);
+    printf ("mean create/close time: %.3f [us]\n",
+        (double) elapsed / socket_count);
+
+    return 0;
+}
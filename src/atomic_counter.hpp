@@ -205,6 +205,51 @@ namespace zmq
 #endif
         }
 
+        //  Atomic exchange. Sets the counter to the new value and returns
+        //  the old one.
+        inline integer_t xchg (integer_t value_)
+        {
+            integer_t old_value;
+
+#if defined ZMQ_ATOMIC_COUNTER_WINDOWS
+            old_value = InterlockedExchange ((LONG*) &value, value_);
+#elif defined ZMQ_ATOMIC_COUNTER_INTRINSIC
+            old_value = __atomic_exchange_n (&value, value_, __ATOMIC_ACQ_REL);
+#elif defined ZMQ_ATOMIC_COUNTER_CXX11
+            old_value = value.exchange (value_, std::memory_order_acq_rel);
+#elif defined ZMQ_ATOMIC_COUNTER_ATOMIC_H
+            old_value = atomic_swap_32 (&value, value_);
+#elif defined ZMQ_ATOMIC_COUNTER_TILE
+            old_value = arch_atomic_exchange (&value, value_);
+#elif defined ZMQ_ATOMIC_COUNTER_X86
+            __asm__ volatile (
+                "lock; xchg %0, %2"
+                : "=r" (old_value), "=m" (value)
+                : "m" (value), "0" (value_)
+                : "memory");
+#elif defined ZMQ_ATOMIC_COUNTER_ARM
+            integer_t flag;
+            __asm__ volatile (
+                "       dmb     sy\n\t"
+                "1:     ldrex   %1, [%3]\n\t"
+                "       strex   %0, %4, [%3]\n\t"
+                "       teq     %0, #0\n\t"
+                "       bne     1b\n\t"
+                "       dmb     sy\n\t"
+                : "=&r"(flag), "=&r"(old_value), "+Qo"(value)
+                : "r"(&value), "r"(value_)
+                : "cc");
+#elif defined ZMQ_ATOMIC_COUNTER_MUTEX
+            sync.lock ();
+            old_value = value;
+            value = value_;
+            sync.unlock ();
+#else
+#error atomic_counter is not implemented for this platform
+#endif
+            return old_value;
+        }
+
         inline integer_t get () const
         {
             return value;
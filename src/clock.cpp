@@ -188,6 +188,35 @@ uint64_t zmq::clock_t::now_us ()
 #endif
 }
 
+uint64_t zmq::clock_t::wall_ns ()
+{
+#if defined ZMQ_HAVE_WINDOWS
+
+    //  File time counts 100ns intervals since 1601.
+    FILETIME ft;
+    GetSystemTimeAsFileTime (&ft);
+    const uint64_t intervals =
+        ((uint64_t) ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return (intervals - 116444736000000000ULL) * 100;
+
+#elif defined HAVE_CLOCK_GETTIME && defined CLOCK_REALTIME \
+    && !(defined ZMQ_HAVE_OSX && __MAC_OS_X_VERSION_MIN_REQUIRED < 101200)
+
+    struct timespec tv;
+    int rc = clock_gettime (CLOCK_REALTIME, &tv);
+    errno_assert (rc == 0);
+    return tv.tv_sec * (uint64_t) 1000000000 + tv.tv_nsec;
+
+#else
+
+    struct timeval tv;
+    int rc = gettimeofday (&tv, NULL);
+    errno_assert (rc == 0);
+    return tv.tv_sec * (uint64_t) 1000000000 + tv.tv_usec * 1000;
+
+#endif
+}
+
 uint64_t zmq::clock_t::now_ms ()
 {
     uint64_t tsc = rdtsc ();
@@ -62,6 +62,11 @@ namespace zmq
         //  High precision timestamp.
         static uint64_t now_us ();
 
+        //  Wall clock time in nanoseconds since the epoch. Unlike the
+        //  timestamps above it is comparable across processes and, with
+        //  synchronised clocks, across hosts.
+        static uint64_t wall_ns ();
+
         //  Low precision timestamp. In tight loops generating it can be
         //  10 to 100 times faster than the high precision timestamp.
         uint64_t now_ms ();
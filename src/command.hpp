@@ -40,6 +40,7 @@ namespace zmq
     struct i_engine;
     class pipe_t;
     class socket_base_t;
+    class tcp_address_t;
 
     //  This structure defines the commands that can be sent between threads.
 
@@ -72,6 +73,7 @@ namespace zmq
             reap,
             reaped,
             inproc_connected,
+            resolved,
             done
         } type;
 
@@ -113,6 +115,7 @@ namespace zmq
             //  messages it has read so far.
             struct {
                 uint64_t msgs_read;
+                uint64_t bytes_read;
             } activate_write;
 
             //  Sent by pipe reader to writer after creating a new inpipe.
@@ -163,6 +166,15 @@ namespace zmq
             struct {
             } reaped;
 
+            //  Sent by the context's resolver to a connecter with the
+            //  outcome of a host name lookup. 'address' is NULL if the
+            //  lookup failed, 'error' then holds the errno value.
+            //  Caller have used inc_seqnum beforehand sending the command.
+            struct {
+                zmq::tcp_address_t *address;
+                int error;
+            } resolved;
+
             //  Sent by reaper thread to the term thread when all the sockets
             //  are successfully deallocated.
             struct {
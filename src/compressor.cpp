@@ -0,0 +1,187 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "precompiled.hpp"
+
+#ifdef ZMQ_HAVE_ZLIB
+
+#include <limits.h>
+#include <string.h>
+
+#include "compressor.hpp"
+#include "msg.hpp"
+#include "err.hpp"
+
+//  Trailer emitted by every Z_SYNC_FLUSH. It is stripped on the wire
+//  and appended again before inflating.
+static const unsigned char sync_flush_trailer [] = {0x00, 0x00, 0xff, 0xff};
+
+zmq::compressor_t::compressor_t (int level_, size_t threshold_,
+                                 int64_t maxmsgsize_) :
+    threshold (threshold_),
+    maxmsgsize (maxmsgsize_)
+{
+    memset (&deflater, 0, sizeof deflater);
+    int rc = deflateInit2 (&deflater, level_, Z_DEFLATED, -MAX_WBITS,
+        8, Z_DEFAULT_STRATEGY);
+    zmq_assert (rc == Z_OK);
+
+    memset (&inflater, 0, sizeof inflater);
+    rc = inflateInit2 (&inflater, -MAX_WBITS);
+    zmq_assert (rc == Z_OK);
+}
+
+zmq::compressor_t::~compressor_t ()
+{
+    deflateEnd (&deflater);
+    inflateEnd (&inflater);
+}
+
+int zmq::compressor_t::compress (msg_t *msg_)
+{
+    const size_t size = msg_->size ();
+    const unsigned char flags =
+        msg_->flags () & (msg_t::more | msg_t::command);
+
+    //  Small messages, and messages too large for a single zlib call,
+    //  are sent as they are. They do not enter the compression context.
+    if (size < threshold || size > UINT_MAX) {
+        msg_t stored_msg;
+        int rc = stored_msg.init_size (size + 1);
+        errno_assert (rc == 0);
+        unsigned char *data = static_cast <unsigned char *> (stored_msg.data ());
+        data [0] = stored;
+        memcpy (data + 1, msg_->data (), size);
+        rc = msg_->move (stored_msg);
+        errno_assert (rc == 0);
+        msg_->set_flags (flags);
+        return 0;
+    }
+
+    if (buffer.size () < 1 + deflateBound (&deflater, size) + 16)
+        buffer.resize (1 + deflateBound (&deflater, size) + 16);
+    buffer [0] = deflated;
+
+    deflater.next_in = static_cast <Bytef *> (msg_->data ());
+    deflater.avail_in = static_cast <uInt> (size);
+    size_t out = 1;
+    do {
+        if (out == buffer.size ())
+            buffer.resize (buffer.size () * 2);
+        deflater.next_out = &buffer [out];
+        deflater.avail_out = static_cast <uInt> (buffer.size () - out);
+        const int rc = deflate (&deflater, Z_SYNC_FLUSH);
+        zmq_assert (rc == Z_OK || rc == Z_BUF_ERROR);
+        out = buffer.size () - deflater.avail_out;
+    } while (deflater.avail_out == 0);
+    zmq_assert (deflater.avail_in == 0);
+
+    zmq_assert (out >= 1 + sizeof sync_flush_trailer);
+    out -= sizeof sync_flush_trailer;
+    zmq_assert (memcmp (&buffer [out], sync_flush_trailer,
+        sizeof sync_flush_trailer) == 0);
+
+    int rc = msg_->close ();
+    errno_assert (rc == 0);
+    rc = msg_->init_size (out);
+    errno_assert (rc == 0);
+    memcpy (msg_->data (), &buffer [0], out);
+    msg_->set_flags (flags);
+    return 0;
+}
+
+int zmq::compressor_t::decompress (msg_t *msg_)
+{
+    const size_t size = msg_->size ();
+    const unsigned char flags =
+        msg_->flags () & (msg_t::more | msg_t::command);
+    const unsigned char *data = static_cast <unsigned char *> (msg_->data ());
+
+    if (size == 0 || (data [0] != stored && data [0] != deflated)) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    if (data [0] == stored) {
+        msg_t stored_msg;
+        int rc = stored_msg.init_size (size - 1);
+        errno_assert (rc == 0);
+        memcpy (stored_msg.data (), data + 1, size - 1);
+        rc = msg_->move (stored_msg);
+        errno_assert (rc == 0);
+        msg_->set_flags (flags);
+        return 0;
+    }
+
+    if (size - 1 > UINT_MAX) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    if (buffer.size () < 4 * size)
+        buffer.resize (4 * size);
+
+    size_t out = 0;
+    for (int pass = 0; pass != 2; pass++) {
+        if (pass == 0) {
+            inflater.next_in = const_cast <Bytef *> (data + 1);
+            inflater.avail_in = static_cast <uInt> (size - 1);
+        }
+        else {
+            inflater.next_in = const_cast <Bytef *> (sync_flush_trailer);
+            inflater.avail_in = sizeof sync_flush_trailer;
+        }
+        do {
+            if (out == buffer.size ())
+                buffer.resize (buffer.size () * 2);
+            inflater.next_out = &buffer [out];
+            inflater.avail_out = static_cast <uInt> (buffer.size () - out);
+            const int rc = inflate (&inflater, Z_SYNC_FLUSH);
+            if (rc != Z_OK && rc != Z_BUF_ERROR) {
+                errno = EPROTO;
+                return -1;
+            }
+            out = buffer.size () - inflater.avail_out;
+            if (maxmsgsize >= 0 && out > static_cast <uint64_t> (maxmsgsize)) {
+                errno = EMSGSIZE;
+                return -1;
+            }
+        } while (inflater.avail_in > 0 || inflater.avail_out == 0);
+    }
+
+    int rc = msg_->close ();
+    errno_assert (rc == 0);
+    rc = msg_->init_size (out);
+    errno_assert (rc == 0);
+    memcpy (msg_->data (), &buffer [0], out);
+    msg_->set_flags (flags);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,108 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_COMPRESSOR_HPP_INCLUDED__
+#define __ZMQ_COMPRESSOR_HPP_INCLUDED__
+
+#include <stddef.h>
+
+#include "stdint.hpp"
+
+namespace zmq
+{
+    //  ZMTP metadata property used to negotiate compression, and the
+    //  only algorithm understood so far.
+    static const char compression_property [] = "Compression";
+    static const char compression_algorithm [] = "deflate";
+}
+
+#ifdef ZMQ_HAVE_ZLIB
+
+#include <vector>
+#include <zlib.h>
+
+namespace zmq
+{
+
+    class msg_t;
+
+    //  Per-connection message compressor used by stream_engine_t once
+    //  both peers have advertised the "Compression" property in their
+    //  READY (or INITIATE) command. Each message body is prefixed by a
+    //  single byte telling whether the rest of the body is stored as-is
+    //  or deflated. Deflated bodies share one compression context for
+    //  the lifetime of the connection, so repetitive payloads compress
+    //  well even when individual messages are small. Command frames are
+    //  never compressed.
+
+    class compressor_t
+    {
+    public:
+
+        compressor_t (int level_, size_t threshold_, int64_t maxmsgsize_);
+        ~compressor_t ();
+
+        //  Replaces the message body by its compressed form. Returns 0
+        //  on success and -1 on error, in which case errno is set.
+        int compress (msg_t *msg_);
+
+        //  Reverse of compress. Fails with EPROTO if the body cannot be
+        //  inflated and with EMSGSIZE if the inflated body would exceed
+        //  the maximum message size.
+        int decompress (msg_t *msg_);
+
+    private:
+
+        //  Body prefixes.
+        enum {
+            stored = 0,
+            deflated = 1
+        };
+
+        //  Messages smaller than this are sent uncompressed.
+        const size_t threshold;
+
+        //  Maximum size of an inflated message, -1 if unlimited.
+        const int64_t maxmsgsize;
+
+        z_stream deflater;
+        z_stream inflater;
+
+        //  Scratch buffer reused across messages.
+        std::vector <unsigned char> buffer;
+
+        compressor_t (const compressor_t&);
+        const compressor_t &operator = (const compressor_t&);
+    };
+
+}
+
+#endif
+
+#endif
@@ -42,6 +42,11 @@ namespace zmq
         //  memory allocation by approximately 99.6%
         message_pipe_granularity = 256,
 
+        //  Number of topics a pipe conflating by topic keeps before it first
+        //  drops the ones whose last message has been delivered. Topics are
+        //  swept again whenever their number has doubled since.
+        conflate_topic_sweep = 64,
+
         //  Commands in pipe per allocation event.
         command_pipe_granularity = 16,
 
@@ -65,6 +70,60 @@ namespace zmq
         //  unnecessary network stack traversals.
         out_batch_size = 8192,
 
+        //  Smallest outbound batch adaptive batching shrinks to when
+        //  the pipe runs nearly empty.
+        adaptive_batch_min = 1024,
+
+        //  Largest value ZMQ_OUT_BATCH_SIZE and ZMQ_IN_BATCH_SIZE accept.
+        //  Each engine allocates buffers of these sizes up front.
+        max_batch_size = 1048576,
+
+        //  Default size of each of the two rings in a shared memory
+        //  connection. Overridden by ZMQ_SNDBUF/ZMQ_RCVBUF on the
+        //  binding side.
+        shm_ring_size = 4194304,
+
+        //  Maximum number of messages a proxy forwards in one direction
+        //  before polling again.
+        proxy_burst_size = 1000,
+
+        //  Default lifetime of a cached host name lookup, in milliseconds.
+        //  Overridden by the ZMQ_DNS_CACHE_TTL context option.
+        dns_cache_ttl = 60000,
+
+        //  Number of host name lookups the context keeps cached.
+        dns_cache_size = 1024,
+
+        //  Time in milliseconds a TCP connect to one address of a host is
+        //  given before the next address is tried in parallel. The value
+        //  recommended by RFC 8305.
+        connect_attempt_delay = 250,
+
+        //  Width in milliseconds of the buckets heartbeat deadlines of an
+        //  I/O thread are grouped in. Heartbeats may fire this much late.
+        heartbeat_granularity = 10,
+
+        //  Number of mailboxes of closed sockets a context keeps for reuse
+        //  by new sockets.
+        mailbox_pool_size = 64,
+
+        //  Number of items from which zmq_poller keeps them registered
+        //  with epoll rather than polling all of them on each wait.
+        socket_poller_epoll_threshold = 64,
+
+        //  Size in bytes of the units the context memory budget is
+        //  accounted in. A pipe charges the budget for each full unit
+        //  queued in it and a reader reports its progress at least this
+        //  often when a budget is set.
+        memory_budget_granularity = 65536,
+
+        //  Interval in milliseconds at which TCP socket buffers are resized
+        //  with ZMQ_TCP_AUTOTUNE, and the range of sizes, in bytes, they
+        //  are resized within.
+        tcp_autotune_interval = 1000,
+        tcp_autotune_min_buffer = 65536,
+        tcp_autotune_max_buffer = 16777216,
+
         //  Maximal delta between high and low watermark.
         max_wm_delta = 1024,
 
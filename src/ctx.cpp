@@ -42,6 +42,7 @@
 #include "socket_base.hpp"
 #include "io_thread.hpp"
 #include "reaper.hpp"
+#include "dns_resolver.hpp"
 #include "pipe.hpp"
 #include "err.hpp"
 #include "msg.hpp"
@@ -68,6 +69,7 @@ zmq::ctx_t::ctx_t () :
     starting (true),
     terminating (false),
     reaper (NULL),
+    resolver (NULL),
     slot_count (0),
     slots (NULL),
     max_sockets (clipped_maxsocket (ZMQ_MAX_SOCKETS_DFLT)),
@@ -86,6 +88,9 @@ zmq::ctx_t::ctx_t () :
     vmci_family = -1;
 #endif
 
+    resolver = new (std::nothrow) dns_resolver_t (this);
+    alloc_assert (resolver);
+
     //  Initialise crypto library, if needed.
     zmq::random_open ();
 }
@@ -114,11 +119,18 @@ zmq::ctx_t::~ctx_t ()
     //  Deallocate the reaper thread object.
     LIBZMQ_DELETE(reaper);
 
+    //  No connecter is left to wait for a lookup, stop the resolver.
+    LIBZMQ_DELETE(resolver);
+
     //  Deallocate the array of mailboxes. No special work is
     //  needed as mailboxes themselves were deallocated with their
     //  corresponding io_thread/socket objects.
     free (slots);
 
+    //  Deallocate the mailboxes kept for reuse.
+    for (mailbox_pool_t::size_type i = 0; i != mailbox_pool.size (); i++)
+        LIBZMQ_DELETE (mailbox_pool [i]);
+
     //  De-initialise crypto library, if needed.
     zmq::random_close ();
 
@@ -152,6 +164,8 @@ int zmq::ctx_t::terminate ()
             // inherited from the parent.
             for (sockets_t::size_type i = 0; i != sockets.size (); i++)
                 sockets [i]->get_mailbox ()->forked ();
+            for (mailbox_pool_t::size_type i = 0; i != mailbox_pool.size (); i++)
+                mailbox_pool [i]->forked ();
 
             term_mailbox.forked ();
         }
@@ -259,6 +273,13 @@ int zmq::ctx_t::set (int option_, int optval_)
         scoped_lock_t locker(opt_sync);
         max_msgsz = optval_ < INT_MAX? optval_: INT_MAX;
     }
+    else
+    if (option_ == ZMQ_DNS_CACHE_TTL && optval_ >= 0)
+        resolver->set_ttl (optval_);
+    else
+    if (option_ == ZMQ_MEMORY_BUDGET && optval_ >= 0 &&
+          optval_ <= int (UINT32_MAX / (1048576 / memory_budget_granularity)))
+        memory_budget.xchg (optval_ * (1048576 / memory_budget_granularity));
     else {
         errno = EINVAL;
         rc = -1;
@@ -289,6 +310,12 @@ int zmq::ctx_t::get (int option_)
     else
     if (option_ == ZMQ_MSG_T_SIZE)
         rc = sizeof (zmq_msg_t);
+    else
+    if (option_ == ZMQ_DNS_CACHE_TTL)
+        rc = resolver->get_ttl ();
+    else
+    if (option_ == ZMQ_MEMORY_BUDGET)
+        rc = memory_budget.get () / (1048576 / memory_budget_granularity);
     else {
         errno = EINVAL;
         rc = -1;
@@ -388,11 +415,67 @@ void zmq::ctx_t::destroy_socket (class socket_base_t *socket_)
         reaper->stop ();
 }
 
+zmq::mailbox_t *zmq::ctx_t::alloc_mailbox ()
+{
+    {
+        scoped_lock_t locker (slot_sync);
+        if (!mailbox_pool.empty ()) {
+            mailbox_t *mailbox = mailbox_pool.back ();
+            mailbox_pool.pop_back ();
+            return mailbox;
+        }
+    }
+
+    mailbox_t *mailbox = new (std::nothrow) mailbox_t ();
+    alloc_assert (mailbox);
+    return mailbox;
+}
+
+void zmq::ctx_t::release_mailbox (mailbox_t *mailbox_)
+{
+    //  Only a mailbox without pending commands can be handed to another
+    //  socket. Draining it this way leaves it in the same passive state as
+    //  a new one. A mailbox whose signaler failed is of no use either.
+    command_t cmd;
+    if (mailbox_->get_fd () != retired_fd
+    &&  mailbox_->recv (&cmd, 0) == -1 && errno == EAGAIN) {
+        scoped_lock_t locker (slot_sync);
+        if (mailbox_pool.size () < mailbox_pool_size) {
+            mailbox_pool.push_back (mailbox_);
+            return;
+        }
+    }
+
+    LIBZMQ_DELETE (mailbox_);
+}
+
 zmq::object_t *zmq::ctx_t::get_reaper ()
 {
     return reaper;
 }
 
+uint32_t zmq::ctx_t::get_memory_budget () const
+{
+    return memory_budget.get ();
+}
+
+void zmq::ctx_t::charge_memory (uint32_t units_)
+{
+    memory_used.add (units_);
+}
+
+void zmq::ctx_t::release_memory (uint32_t units_)
+{
+    memory_used.sub (units_);
+}
+
+bool zmq::ctx_t::memory_exhausted () const
+{
+    //  The counter may dip below zero while a pipepair is torn down.
+    const uint32_t budget = memory_budget.get ();
+    return budget > 0 && int32_t (memory_used.get ()) >= int32_t (budget);
+}
+
 void zmq::ctx_t::start_thread (thread_t &thread_, thread_fn *tfn_, void *arg_) const
 {
     thread_.start(tfn_, arg_);
@@ -407,6 +490,11 @@ void zmq::ctx_t::send_command (uint32_t tid_, const command_t &command_)
     slots [tid_]->send (command_);
 }
 
+zmq::dns_resolver_t *zmq::ctx_t::get_resolver ()
+{
+    return resolver;
+}
+
 zmq::io_thread_t *zmq::ctx_t::choose_io_thread (uint64_t affinity_)
 {
     if (io_threads.empty ())
@@ -550,6 +638,17 @@ void zmq::ctx_t::connect_inproc_sockets (zmq::socket_base_t *bind_socket_,
 
         pending_connection_.connect_pipe->set_hwms(pending_connection_.endpoint.options.rcvhwm, pending_connection_.endpoint.options.sndhwm);
         pending_connection_.bind_pipe->set_hwms(bind_options.rcvhwm, bind_options.sndhwm);
+
+        const int64_t sndhwm_bytes = pipe_t::combine_hwms_bytes (
+            pending_connection_.endpoint.options.sndhwm_bytes,
+            bind_options.rcvhwm_bytes);
+        const int64_t rcvhwm_bytes = pipe_t::combine_hwms_bytes (
+            pending_connection_.endpoint.options.rcvhwm_bytes,
+            bind_options.sndhwm_bytes);
+        pending_connection_.connect_pipe->set_hwms_bytes (rcvhwm_bytes,
+            sndhwm_bytes);
+        pending_connection_.bind_pipe->set_hwms_bytes (sndhwm_bytes,
+            rcvhwm_bytes);
     }
     else {
         pending_connection_.connect_pipe->set_hwms(-1, -1);
@@ -52,6 +52,7 @@ namespace zmq
     class socket_base_t;
     class reaper_t;
     class pipe_t;
+    class dns_resolver_t;
 
     //  Information associated with inproc endpoint. Note that endpoint options
     //  are registered as well so that the peer can access them without a need
@@ -98,6 +99,20 @@ namespace zmq
         zmq::socket_base_t *create_socket (int type_);
         void destroy_socket (zmq::socket_base_t *socket_);
 
+        //  Get a mailbox for a new socket and give it back once the socket
+        //  is closed. Mailboxes are recycled, saving the creation of
+        //  a signaler for each socket.
+        mailbox_t *alloc_mailbox ();
+        void release_mailbox (mailbox_t *mailbox_);
+
+        //  Context-wide budget for messages queued in pipes, in units of
+        //  memory_budget_granularity bytes; zero means no budget. Pipes
+        //  charge the budget for the units they hold.
+        uint32_t get_memory_budget () const;
+        void charge_memory (uint32_t units_);
+        void release_memory (uint32_t units_);
+        bool memory_exhausted () const;
+
         //  Start a new thread with proper scheduling parameters.
         void start_thread (thread_t &thread_, thread_fn *tfn_, void *arg_) const;
 
@@ -112,6 +127,9 @@ namespace zmq
         //  Returns reaper thread object.
         zmq::object_t *get_reaper ();
 
+        //  Returns the host name resolver shared by the context.
+        zmq::dns_resolver_t *get_resolver ();
+
         //  Management of inproc endpoints.
         int register_endpoint (const char *addr_, const endpoint_t &endpoint_);
         int unregister_endpoint (const std::string &addr_, socket_base_t *socket_);
@@ -171,6 +189,9 @@ namespace zmq
         //  The reaper thread.
         zmq::reaper_t *reaper;
 
+        //  Resolver for the host names of TCP connecters.
+        zmq::dns_resolver_t *resolver;
+
         //  I/O threads.
         typedef std::vector <zmq::io_thread_t*> io_threads_t;
         io_threads_t io_threads;
@@ -182,6 +203,11 @@ namespace zmq
         //  Mailbox for zmq_ctx_term thread.
         mailbox_t term_mailbox;
 
+        //  Mailboxes of closed sockets, ready for reuse. Synchronised
+        //  by slot_sync.
+        typedef std::vector <mailbox_t *> mailbox_pool_t;
+        mailbox_pool_t mailbox_pool;
+
         //  List of inproc endpoints within this context.
         typedef std::map <std::string, endpoint_t> endpoints_t;
         endpoints_t endpoints;
@@ -202,6 +228,11 @@ namespace zmq
         //  Maximum allowed message size
         int max_msgsz;
 
+        //  Memory budget and the part of it pipes hold at the moment,
+        //  both in units of memory_budget_granularity bytes.
+        atomic_counter_t memory_budget;
+        atomic_counter_t memory_used;
+
         //  Number of I/O threads to launch.
         int io_thread_count;
 
@@ -127,6 +127,12 @@ namespace zmq
                 return 0;
             }
 
+            //  Let the derived class decode a whole message straight from
+            //  the buffer if it can, bypassing the per-step dispatch.
+            if (static_cast <T *> (this)->fast_decode (data_, size_,
+                  bytes_used_))
+                return 1;
+
             while (bytes_used_ < size_) {
                 //  Copy the data from buffer to the message.
                 const size_t to_copy = std::min (to_read, size_ - bytes_used_);
@@ -164,6 +170,20 @@ namespace zmq
         //  it is unable to push the data to the system.
         typedef int (T:: *step_t) (unsigned char const *);
 
+        //  Fast path hook, called at the start of each decode with the whole
+        //  input. Derived classes may shadow it to consume one complete
+        //  message and return 1; returning 0 runs the state machine.
+        int fast_decode (const unsigned char *, std::size_t, std::size_t &)
+        {
+            return 0;
+        }
+
+        //  Returns true if the given action is the next one to be taken.
+        bool is_next_step (step_t next_) const
+        {
+            return next == next_;
+        }
+
         //  This function should be called from derived class to read data
         //  from the buffer and schedule next state machine action.
         void next_step (void *read_pos_, std::size_t to_read_, step_t next_)
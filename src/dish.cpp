@@ -262,6 +262,10 @@ zmq::dish_session_t::dish_session_t (io_thread_t *io_thread_, bool connect_,
 
 zmq::dish_session_t::~dish_session_t ()
 {
+    if (state == body) {
+        int rc = group_msg.close ();
+        errno_assert (rc == 0);
+    }
 }
 
 int zmq::dish_session_t::push_msg (msg_t *msg_)
@@ -285,27 +289,28 @@ int zmq::dish_session_t::push_msg (msg_t *msg_)
         return 0;
     }
     else {
-        //  Set the message group
-        int rc = msg_->set_group ((char*)group_msg.data (), group_msg. size());
-        errno_assert (rc == 0);
-
-        //  We set the group, so we don't need the group_msg anymore
-        rc = group_msg.close ();
-        errno_assert (rc == 0);
-
         //  Thread safe socket doesn't support multipart messages
         if ((msg_->flags() & msg_t::more) == msg_t::more) {
             errno = EFAULT;
             return -1;
         }
 
-        //  Push message to dish socket
+        //  Set the message group
+        int rc = msg_->set_group ((char*)group_msg.data (), group_msg. size());
+        errno_assert (rc == 0);
+
+        //  Push message to dish socket. If the pipe is full, the engine
+        //  pushes the same body again later, so keep the group until then.
         rc = session_base_t::push_msg (msg_);
+        if (rc != 0)
+            return rc;
 
-        if (rc == 0)
-            state = group;
+        //  We set the group, so we don't need the group_msg anymore
+        rc = group_msg.close ();
+        errno_assert (rc == 0);
+        state = group;
 
-        return rc;
+        return 0;
     }
 }
 
@@ -356,5 +361,9 @@ int zmq::dish_session_t::pull_msg (msg_t *msg_)
 void zmq::dish_session_t::reset ()
 {
     session_base_t::reset ();
+    if (state == body) {
+        int rc = group_msg.close ();
+        errno_assert (rc == 0);
+    }
     state = group;
 }
@@ -38,6 +38,7 @@ zmq::dist_t::dist_t () :
     matching (0),
     active (0),
     eligible (0),
+    dropped (0),
     more (false)
 {
 }
@@ -210,6 +211,7 @@ bool zmq::dist_t::has_out ()
 bool zmq::dist_t::write (pipe_t *pipe_, msg_t *msg_)
 {
     if (!pipe_->write (msg_)) {
+        dropped++;
         pipes.swap (pipes.index (pipe_), matching - 1);
         matching--;
         pipes.swap (pipes.index (pipe_), active - 1);
@@ -223,6 +225,16 @@ bool zmq::dist_t::write (pipe_t *pipe_, msg_t *msg_)
     return true;
 }
 
+bool zmq::dist_t::is_active (pipe_t *pipe_)
+{
+    return pipes.index (pipe_) < active;
+}
+
+uint64_t zmq::dist_t::get_dropped () const
+{
+    return dropped;
+}
+
 bool zmq::dist_t::check_hwm ()
 {
     for (pipes_t::size_type i = 0; i < matching; ++i)
@@ -80,6 +80,12 @@ namespace zmq
         // check HWM of all pipes matching
         bool check_hwm ();
 
+        //  Returns true if a message can be sent to the pipe at the moment.
+        bool is_active (zmq::pipe_t *pipe_);
+
+        //  Number of message copies dropped because a pipe was full.
+        uint64_t get_dropped () const;
+
     private:
 
         //  Write the message to the pipe. Make the pipe inactive if writing
@@ -108,6 +114,9 @@ namespace zmq
         //  with initial parts missing.
         pipes_t::size_type eligible;
 
+        //  Number of failed writes to a pipe, see get_dropped.
+        uint64_t dropped;
+
         //  True if last we are in the middle of a multipart message.
         bool more;
 
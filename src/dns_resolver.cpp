@@ -0,0 +1,251 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "precompiled.hpp"
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dns_resolver.hpp"
+#include "tcp_address.hpp"
+#include "ctx.hpp"
+#include "own.hpp"
+#include "config.hpp"
+#include "macros.hpp"
+#include "err.hpp"
+
+zmq::dns_resolver_t::dns_resolver_t (ctx_t *ctx_) :
+    object_t (ctx_, ctx_t::term_tid),
+    current (NULL),
+    ttl (dns_cache_ttl),
+    started (false),
+    stopping (false)
+{
+}
+
+zmq::dns_resolver_t::~dns_resolver_t ()
+{
+    sync.lock ();
+    zmq_assert (requests.empty ());
+    stopping = true;
+    cond.broadcast ();
+    sync.unlock ();
+
+    //  A lookup whose requester is gone may still be running; it has
+    //  to complete before the thread can be joined.
+    if (started)
+        worker.stop ();
+
+    for (cache_t::iterator it = cache.begin (); it != cache.end (); ++it)
+        LIBZMQ_DELETE (it->second.address);
+}
+
+int zmq::dns_resolver_t::resolve (own_t *requester_, const std::string &name_,
+    bool ipv6_, tcp_address_t **address_)
+{
+    const std::string key = (ipv6_ ? "6 " : "4 ") + name_;
+
+    scoped_lock_t locker (sync);
+
+    const cache_t::iterator it = cache.find (key);
+    if (it != cache.end ()) {
+        if (it->second.expiry > clock.now_ms ()) {
+            *address_ = new (std::nothrow) tcp_address_t (
+                *it->second.address);
+            alloc_assert (*address_);
+            return 0;
+        }
+        LIBZMQ_DELETE (it->second.address);
+        cache.erase (it);
+    }
+
+    if (!started) {
+        get_ctx ()->start_thread (worker, worker_routine, this);
+        started = true;
+    }
+
+    request_t request = {requester_, name_, ipv6_};
+    requests.push_back (request);
+    cond.broadcast ();
+
+    errno = EAGAIN;
+    return -1;
+}
+
+void zmq::dns_resolver_t::cancel (own_t *requester_)
+{
+    scoped_lock_t locker (sync);
+
+    if (current == requester_)
+        current = NULL;
+
+    for (requests_t::iterator it = requests.begin (); it != requests.end ();
+          ++it)
+        if (it->requester == requester_) {
+            requests.erase (it);
+            break;
+        }
+}
+
+void zmq::dns_resolver_t::set_ttl (int ttl_)
+{
+    scoped_lock_t locker (sync);
+    ttl = ttl_;
+
+    //  Answers cached under a longer lifetime would outlive the new one.
+    for (cache_t::iterator it = cache.begin (); it != cache.end (); ++it)
+        LIBZMQ_DELETE (it->second.address);
+    cache.clear ();
+}
+
+int zmq::dns_resolver_t::get_ttl ()
+{
+    scoped_lock_t locker (sync);
+    return ttl;
+}
+
+//  Test hook: if the ZMQ_DNS_STUB_FILE environment variable names a file,
+//  a host listed in it on a "name address [delay]" line is looked up as
+//  'address' instead, after 'delay' milliseconds. The file is read on
+//  each lookup, so that tests can change the answers as they go.
+static void apply_stub (std::string &name_, int &delay_)
+{
+    const char *path = getenv ("ZMQ_DNS_STUB_FILE");
+    if (!path)
+        return;
+    FILE *file = fopen (path, "r");
+    if (!file)
+        return;
+
+    //  The host is what follows the source address, if any, and precedes
+    //  the port.
+    const size_t colon = name_.rfind (':');
+    const size_t semicolon = name_.rfind (';', colon);
+    const size_t start = semicolon == std::string::npos ? 0 : semicolon + 1;
+    if (colon == std::string::npos || colon < start) {
+        fclose (file);
+        return;
+    }
+    const std::string host = name_.substr (start, colon - start);
+
+    char line [256];
+    while (fgets (line, sizeof line, file)) {
+        char name [128];
+        char address [128];
+        int delay = 0;
+        if (sscanf (line, "%127s %127s %d", name, address, &delay) >= 2
+        &&  host == name) {
+            name_.replace (start, colon - start, address);
+            delay_ = delay;
+            break;
+        }
+    }
+    fclose (file);
+}
+
+void zmq::dns_resolver_t::worker_routine (void *arg_)
+{
+    ((dns_resolver_t*) arg_)->loop ();
+}
+
+void zmq::dns_resolver_t::loop ()
+{
+    sync.lock ();
+    while (true) {
+        while (requests.empty () && !stopping)
+            cond.wait (&sync, -1);
+        if (stopping)
+            break;
+
+        const request_t request = requests.front ();
+        requests.pop_front ();
+        current = request.requester;
+
+        std::string name = request.name;
+        int delay = 0;
+        apply_stub (name, delay);
+        if (delay > 0) {
+            //  Cut short when the context shuts down.
+            const uint64_t end = clock.now_ms () + delay;
+            for (uint64_t now = clock.now_ms (); now < end && !stopping;
+                  now = clock.now_ms ())
+                cond.wait (&sync, (int) (end - now));
+        }
+        sync.unlock ();
+
+        tcp_address_t *address = new (std::nothrow) tcp_address_t ();
+        alloc_assert (address);
+        const int rc = address->resolve_all (name.c_str (), request.ipv6);
+        const int err = rc == 0 ? 0 : errno;
+
+        sync.lock ();
+        if (rc == 0 && ttl > 0)
+            store ((request.ipv6 ? "6 " : "4 ") + request.name, *address);
+        if (rc != 0)
+            LIBZMQ_DELETE (address);
+
+        //  The command is sent under the lock so that a requester
+        //  cancelling the lookup either gets it or never will.
+        if (current)
+            send_resolved (current, address, err);
+        else
+            LIBZMQ_DELETE (address);
+        current = NULL;
+    }
+    sync.unlock ();
+}
+
+void zmq::dns_resolver_t::store (const std::string &key_,
+    const tcp_address_t &address_)
+{
+    const uint64_t now = clock.now_ms ();
+
+    if (cache.size () >= dns_cache_size) {
+        cache_t::iterator it = cache.begin ();
+        while (it != cache.end ())
+            if (it->second.expiry <= now) {
+                LIBZMQ_DELETE (it->second.address);
+                cache.erase (it++);
+            }
+            else
+                ++it;
+
+        //  Still full of live answers; drop one to make room.
+        if (cache.size () >= dns_cache_size) {
+            LIBZMQ_DELETE (cache.begin ()->second.address);
+            cache.erase (cache.begin ());
+        }
+    }
+
+    entry_t &entry = cache [key_];
+    delete entry.address;
+    entry.address = new (std::nothrow) tcp_address_t (address_);
+    alloc_assert (entry.address);
+    entry.expiry = now + ttl;
+}
@@ -0,0 +1,130 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_DNS_RESOLVER_HPP_INCLUDED__
+#define __ZMQ_DNS_RESOLVER_HPP_INCLUDED__
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include "object.hpp"
+#include "mutex.hpp"
+#include "condition_variable.hpp"
+#include "thread.hpp"
+#include "clock.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    class ctx_t;
+    class own_t;
+    class tcp_address_t;
+
+    //  Resolves TCP host names for the connecters of a context. Lookups
+    //  run on a dedicated thread, started on first use, so that a slow
+    //  name server does not stall the I/O threads. Answers are handed back
+    //  as 'resolved' commands and kept in a cache shared by the context.
+
+    class dns_resolver_t : public object_t
+    {
+    public:
+
+        dns_resolver_t (zmq::ctx_t *ctx_);
+        ~dns_resolver_t ();
+
+        //  Resolves 'name_' as tcp_address_t::resolve_all would. A cached
+        //  answer is returned in 'address_' straight away. Otherwise the
+        //  lookup is queued on behalf of 'requester_', -1 is returned with
+        //  errno set to EAGAIN and the answer arrives later as a 'resolved'
+        //  command.
+        int resolve (zmq::own_t *requester_, const std::string &name_,
+            bool ipv6_, tcp_address_t **address_);
+
+        //  Drops the queued or running lookup of 'requester_', if any.
+        //  A 'resolved' command already sent is still delivered.
+        void cancel (zmq::own_t *requester_);
+
+        //  Lifetime of cached answers in milliseconds, 0 disables caching.
+        void set_ttl (int ttl_);
+        int get_ttl ();
+
+    private:
+
+        struct request_t
+        {
+            zmq::own_t *requester;
+            std::string name;
+            bool ipv6;
+        };
+
+        struct entry_t
+        {
+            tcp_address_t *address;
+            uint64_t expiry;
+        };
+
+        //  Main routine of the worker thread.
+        static void worker_routine (void *arg_);
+        void loop ();
+
+        //  Adds an answer to the cache, evicting stale entries as needed.
+        void store (const std::string &key_, const tcp_address_t &address_);
+
+        //  Lookups waiting for the worker thread.
+        typedef std::deque <request_t> requests_t;
+        requests_t requests;
+
+        //  Requester of the lookup being run by the worker thread, NULL if
+        //  there is none or it was cancelled.
+        zmq::own_t *current;
+
+        //  Cached answers, keyed by address family and name.
+        typedef std::map <std::string, entry_t> cache_t;
+        cache_t cache;
+        int ttl;
+
+        //  Synchronisation of all of the above and of the worker's state.
+        mutex_t sync;
+        condition_variable_t cond;
+
+        thread_t worker;
+        bool started;
+        bool stopping;
+
+        zmq::clock_t clock;
+
+        dns_resolver_t (const dns_resolver_t&);
+        const dns_resolver_t &operator = (const dns_resolver_t&);
+    };
+
+}
+
+#endif
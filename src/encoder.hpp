@@ -77,11 +77,12 @@ namespace zmq
 
         //  The function returns a batch of binary data. The data
         //  are filled to a supplied buffer. If no buffer is supplied (data_
-        //  points to NULL) decoder object will provide buffer of its own.
+        //  points to NULL) decoder object will provide buffer of its own,
+        //  of which at most size_ bytes are filled.
         inline size_t encode (unsigned char **data_, size_t size_)
         {
             unsigned char *buffer = !*data_ ? buf : *data_;
-            size_t buffersize = !*data_ ? bufsize : size_;
+            size_t buffersize = !*data_ ? std::min (bufsize, size_) : size_;
 
             if (in_progress == NULL)
                 return 0;
@@ -141,8 +142,37 @@ namespace zmq
             (static_cast <T*> (this)->*next) ();
         }
 
+        size_t encode_msg (msg_t *msg_, unsigned char **data_, size_t size_)
+        {
+            zmq_assert (in_progress == NULL);
+            unsigned char *buffer = !*data_ ? buf : *data_;
+            size_t buffersize = !*data_ ? std::min (bufsize, size_) : size_;
+
+            const size_t n = static_cast <T*> (this)->fast_encode (msg_,
+                buffer, buffersize);
+            if (n > 0) {
+                int rc = msg_->close ();
+                errno_assert (rc == 0);
+                rc = msg_->init ();
+                errno_assert (rc == 0);
+                *data_ = buffer;
+                return n;
+            }
+
+            load_msg (msg_);
+            return encode (data_, size_);
+        }
+
     protected:
 
+        //  Fast path hook for encode_msg. Derived classes may shadow it to
+        //  write the whole message into the buffer and return the number of
+        //  bytes written; returning 0 runs the state machine instead.
+        size_t fast_encode (msg_t *, unsigned char *, size_t)
+        {
+            return 0;
+        }
+
         //  Prototype of state machine action.
         typedef void (T::*step_t) ();
 
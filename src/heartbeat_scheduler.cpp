@@ -0,0 +1,117 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "precompiled.hpp"
+#include "heartbeat_scheduler.hpp"
+#include "i_poll_events.hpp"
+#include "config.hpp"
+#include "err.hpp"
+
+zmq::heartbeat_scheduler_t::heartbeat_scheduler_t () :
+    swept (0)
+{
+}
+
+zmq::heartbeat_scheduler_t::~heartbeat_scheduler_t ()
+{
+    //  Engines disarm their entries before they are unplugged.
+    zmq_assert (buckets.empty ());
+}
+
+void zmq::heartbeat_scheduler_t::arm (entry_t *entry_, uint64_t expiration_)
+{
+    //  Round up, so that the entry never expires early, and make sure
+    //  the entry lands in a bucket that is yet to be swept.
+    uint64_t tick = (expiration_ + heartbeat_granularity - 1) /
+        heartbeat_granularity;
+    if (tick <= swept)
+        tick = swept + 1;
+
+    if (entry_->tick == tick)
+        return;
+    disarm (entry_);
+
+    //  Push the entry to the front of its bucket.
+    entry_t *&head = buckets [tick];
+    entry_->tick = tick;
+    entry_->prev = NULL;
+    entry_->next = head;
+    if (head)
+        head->prev = entry_;
+    head = entry_;
+}
+
+void zmq::heartbeat_scheduler_t::disarm (entry_t *entry_)
+{
+    if (!entry_->armed ())
+        return;
+
+    if (entry_->next)
+        entry_->next->prev = entry_->prev;
+    if (entry_->prev)
+        entry_->prev->next = entry_->next;
+    else {
+        //  The entry is the head of its bucket.
+        buckets_t::iterator it = buckets.find (entry_->tick);
+        zmq_assert (it != buckets.end () && it->second == entry_);
+        if (entry_->next)
+            it->second = entry_->next;
+        else
+            buckets.erase (it);
+    }
+
+    entry_->tick = 0;
+    entry_->prev = NULL;
+    entry_->next = NULL;
+}
+
+void zmq::heartbeat_scheduler_t::execute (uint64_t current_)
+{
+    const uint64_t tick = current_ / heartbeat_granularity;
+
+    //  Entries are taken one by one, as sinks may arm or disarm other
+    //  entries in the bucket being swept.
+    while (!buckets.empty () && buckets.begin ()->first <= tick) {
+        entry_t *entry = buckets.begin ()->second;
+        swept = entry->tick;
+        disarm (entry);
+        entry->sink->timer_event (entry->id);
+    }
+    if (swept < tick)
+        swept = tick;
+}
+
+uint64_t zmq::heartbeat_scheduler_t::wait (uint64_t current_) const
+{
+    if (buckets.empty ())
+        return 0;
+
+    const uint64_t expiration = buckets.begin ()->first * heartbeat_granularity;
+    return expiration > current_ ? expiration - current_ : 1;
+}
@@ -0,0 +1,134 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_HEARTBEAT_SCHEDULER_HPP_INCLUDED__
+#define __ZMQ_HEARTBEAT_SCHEDULER_HPP_INCLUDED__
+
+#include <map>
+
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    struct i_poll_events;
+
+    //  Coarse timers for connection heartbeats, shared by all the engines
+    //  of an I/O thread.
+    //
+    //  Each engine owns a single entry, armed for the nearest of its
+    //  heartbeat deadlines. Traffic never touches the scheduler: engines
+    //  just note that something arrived and check it once the entry
+    //  expires. Entries are kept in intrusive lists, one per bucket of
+    //  heartbeat_granularity milliseconds, so arming and disarming are
+    //  cheap and a sweep only visits the entries that are due.
+
+    class heartbeat_scheduler_t
+    {
+    public:
+
+        class entry_t
+        {
+        public:
+
+            inline entry_t (i_poll_events *sink_, int id_) :
+                sink (sink_),
+                id (id_),
+                tick (0),
+                prev (NULL),
+                next (NULL)
+            {
+            }
+
+            inline bool armed () const
+            {
+                return tick != 0;
+            }
+
+        private:
+
+            friend class heartbeat_scheduler_t;
+
+            //  Object to invoke timer_event on and the timer ID to pass.
+            i_poll_events *sink;
+            int id;
+
+            //  Bucket the entry is in, zero if it is not armed.
+            uint64_t tick;
+
+            //  Neighbours within the bucket.
+            entry_t *prev;
+            entry_t *next;
+
+            entry_t (const entry_t&);
+            const entry_t &operator = (const entry_t&);
+        };
+
+        heartbeat_scheduler_t ();
+        ~heartbeat_scheduler_t ();
+
+        //  Arms the entry to expire at expiration_ (in milliseconds of
+        //  clock_t), replacing its previous expiration if any. The entry
+        //  may expire up to heartbeat_granularity milliseconds late, but
+        //  never early.
+        void arm (entry_t *entry_, uint64_t expiration_);
+
+        //  Disarms the entry if it is armed.
+        void disarm (entry_t *entry_);
+
+        //  Invokes timer_event on the sinks of the entries due at current_.
+        //  The entries are disarmed beforehand, so sinks can re-arm them.
+        void execute (uint64_t current_);
+
+        //  Returns true if no entries are armed.
+        inline bool empty () const
+        {
+            return buckets.empty ();
+        }
+
+        //  Returns number of milliseconds to wait from current_ till the
+        //  next entry is due or 0 meaning "no entries".
+        uint64_t wait (uint64_t current_) const;
+
+    private:
+
+        //  Heads of the buckets, keyed by tick.
+        typedef std::map <uint64_t, entry_t *> buckets_t;
+        buckets_t buckets;
+
+        //  Last tick that was swept.
+        uint64_t swept;
+
+        heartbeat_scheduler_t (const heartbeat_scheduler_t&);
+        const heartbeat_scheduler_t &operator = (const heartbeat_scheduler_t&);
+    };
+
+}
+
+#endif
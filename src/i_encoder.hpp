@@ -46,13 +46,25 @@ namespace zmq
 
         //  The function returns a batch of binary data. The data
         //  are filled to a supplied buffer. If no buffer is supplied (data_
-        //  is NULL) encoder will provide buffer of its own.
+        //  is NULL) encoder will provide buffer of its own. Either way, at
+        //  most size bytes are filled.
         //  Function returns 0 when a new message is required.
         virtual size_t encode (unsigned char **data_, size_t size) = 0;
 
         //  Load a new message into encoder.
         virtual void load_msg (msg_t *msg_) = 0;
 
+        //  Loads a new message and encodes it into the supplied buffer,
+        //  like load_msg followed by encode, which is what it does unless
+        //  overridden. Encoders may override it to write messages that fit
+        //  into the buffer as a whole in one go.
+        virtual size_t encode_msg (msg_t *msg_, unsigned char **data_,
+            size_t size)
+        {
+            load_msg (msg_);
+            return encode (data_, size);
+        }
+
     };
 
 }
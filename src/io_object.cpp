@@ -101,6 +101,17 @@ void zmq::io_object_t::cancel_timer (int id_)
     poller->cancel_timer (this, id_);
 }
 
+void zmq::io_object_t::arm_heartbeat (heartbeat_scheduler_t::entry_t *entry_,
+    int timeout_)
+{
+    poller->arm_heartbeat (entry_, timeout_);
+}
+
+void zmq::io_object_t::disarm_heartbeat (heartbeat_scheduler_t::entry_t *entry_)
+{
+    poller->disarm_heartbeat (entry_);
+}
+
 void zmq::io_object_t::in_event ()
 {
     zmq_assert (false);
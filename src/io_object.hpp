@@ -70,6 +70,9 @@ namespace zmq
         void reset_pollout (handle_t handle_);
         void add_timer (int timout_, int id_);
         void cancel_timer (int id_);
+        void arm_heartbeat (heartbeat_scheduler_t::entry_t *entry_,
+            int timeout_);
+        void disarm_heartbeat (heartbeat_scheduler_t::entry_t *entry_);
 
         //  i_poll_events interface implementation.
         void in_event ();
@@ -45,6 +45,11 @@
 #include <ioctl.h>
 #endif
 
+#if defined ZMQ_HAVE_LINUX
+#include <string.h>
+#include <linux/net_tstamp.h>
+#endif
+
 zmq::fd_t zmq::open_socket (int domain_, int type_, int protocol_)
 {
     int rc;
@@ -230,3 +235,69 @@ void zmq::bind_to_device (fd_t s_, std::string &bound_device_)
 #endif
 #endif
 }
+
+int zmq::enable_rx_timestamps (fd_t s_)
+{
+#if defined ZMQ_HAVE_LINUX && defined SO_TIMESTAMPING
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE
+        | SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    return setsockopt (s_, SOL_SOCKET, SO_TIMESTAMPING, &flags,
+        sizeof (flags));
+#else
+    LIBZMQ_UNUSED (s_);
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+#if defined ZMQ_HAVE_LINUX
+int zmq::recv_timestamped (fd_t s_, void *data_, size_t size_,
+    void *addr_, socklen_t *addrlen_, uint64_t *timestamp_)
+{
+    struct iovec iov;
+    iov.iov_base = data_;
+    iov.iov_len = size_;
+
+    //  Room for the timestamps and then some, should the kernel pass
+    //  other control messages along.
+    union {
+        struct cmsghdr align;
+        char buf [CMSG_SPACE (3 * sizeof (struct timespec)) + 64];
+    } control;
+
+    struct msghdr hdr;
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.msg_name = addr_;
+    hdr.msg_namelen = addrlen_ ? *addrlen_ : 0;
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control.buf;
+    hdr.msg_controllen = sizeof (control.buf);
+
+    *timestamp_ = 0;
+    const ssize_t rc = recvmsg (s_, &hdr, 0);
+    if (rc == -1)
+        return -1;
+    if (addrlen_)
+        *addrlen_ = hdr.msg_namelen;
+
+#if defined SO_TIMESTAMPING
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR (&hdr); cmsg;
+          cmsg = CMSG_NXTHDR (&hdr, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET ||
+              cmsg->cmsg_type != SCM_TIMESTAMPING)
+            continue;
+
+        //  The software timestamp comes first, the raw hardware one last.
+        //  Prefer the hardware timestamp if the card provided one.
+        struct timespec ts [3];
+        memcpy (ts, CMSG_DATA (cmsg), sizeof (ts));
+        const struct timespec &t =
+            ts [2].tv_sec || ts [2].tv_nsec ? ts [2] : ts [0];
+        *timestamp_ = t.tv_sec * (uint64_t) 1000000000 + t.tv_nsec;
+    }
+#endif
+
+    return static_cast <int> (rc);
+}
+#endif
@@ -33,6 +33,11 @@
 #include <string>
 #include "fd.hpp"
 
+#if defined ZMQ_HAVE_LINUX
+#include <sys/socket.h>
+#include "stdint.hpp"
+#endif
+
 namespace zmq
 {
 
@@ -59,6 +64,19 @@ namespace zmq
     // Binds the underlying socket to the given device, eg. VRF or interface
     void bind_to_device (fd_t s_, std::string &bound_device_);
 
+    //  Asks the kernel to timestamp the data received on the socket, in
+    //  hardware where the network card is set up for it. Returns -1 if
+    //  SO_TIMESTAMPING is not available.
+    int enable_rx_timestamps (fd_t s_);
+
+#if defined ZMQ_HAVE_LINUX
+    //  Same as recvfrom(2), but also stores in 'timestamp_' when the last
+    //  of the data was received, in nanoseconds since the epoch, or zero
+    //  if it was not timestamped. 'addr_' and 'addrlen_' may be NULL.
+    int recv_timestamped (fd_t s_, void *data_, size_t size_,
+        void *addr_, socklen_t *addrlen_, uint64_t *timestamp_);
+#endif
+
 }
 
 #endif
@@ -30,8 +30,12 @@
 #include "precompiled.hpp"
 #include "mailbox.hpp"
 #include "err.hpp"
+#include "trace.hpp"
 
-zmq::mailbox_t::mailbox_t ()
+zmq::mailbox_t::mailbox_t () :
+    group (NULL),
+    pending (0),
+    waiting (false)
 {
     //  Get the pipe into passive state. That way, if the users starts by
     //  polling on the associated file descriptor it will get woken up when
@@ -58,14 +62,49 @@ zmq::fd_t zmq::mailbox_t::get_fd () const
 
 void zmq::mailbox_t::send (const command_t &cmd_)
 {
+    zmq_trace2 (mailbox_send, this, (int) cmd_.type);
     sync.lock ();
     cpipe.write (cmd_, false);
     const bool ok = cpipe.flush ();
+    if (!ok && group) {
+        //  The reader is asleep. Leave it a token and queue it on its
+        //  thread group. The signaler is only needed if the reader is
+        //  blocked in recv.
+        pending.set (1);
+        thread_group_t::push (group);
+        if (waiting)
+            signaler.send ();
+        sync.unlock ();
+        return;
+    }
     sync.unlock ();
     if (!ok)
         signaler.send ();
 }
 
+void zmq::mailbox_t::set_group (thread_group_t::entry_t *group_)
+{
+    sync.lock ();
+    if (group_) {
+        zmq_assert (!group);
+        group = group_;
+
+        //  Move a wake-up that has been signalled already to the group.
+        if (!active && signaler.recv_failable () == 0) {
+            pending.set (1);
+            thread_group_t::push (group);
+        }
+    }
+    else
+    if (group) {
+        //  Hand an unclaimed wake-up back to the signaler.
+        if (pending.xchg (0))
+            signaler.send ();
+        group = NULL;
+    }
+    sync.unlock ();
+}
+
 int zmq::mailbox_t::recv (command_t *cmd_, int timeout_)
 {
     //  Try to get the command straight away.
@@ -77,6 +116,9 @@ int zmq::mailbox_t::recv (command_t *cmd_, int timeout_)
         active = false;
     }
 
+    if (group)
+        return recv_grouped (cmd_, timeout_);
+
     //  Wait for signal from the command sender.
     int rc = signaler.wait (timeout_);
     if (rc == -1) {
@@ -99,3 +141,46 @@ int zmq::mailbox_t::recv (command_t *cmd_, int timeout_)
     zmq_assert (ok);
     return 0;
 }
+
+int zmq::mailbox_t::recv_grouped (command_t *cmd_, int timeout_)
+{
+    if (!pending.xchg (0)) {
+        if (timeout_ == 0) {
+            errno = EAGAIN;
+            return -1;
+        }
+
+        //  Ask the senders to use the signaler as well and check the token
+        //  once more, as it may have been left before the flag was set.
+        sync.lock ();
+        waiting = pending.get () == 0;
+        sync.unlock ();
+
+        int err = EAGAIN;
+        if (waiting) {
+            if (signaler.wait (timeout_) == -1) {
+                err = errno;
+                errno_assert (err == EAGAIN || err == EINTR);
+            }
+            sync.lock ();
+            waiting = false;
+            sync.unlock ();
+
+            //  The token carries the wake-up; drop the signal, if any.
+            signaler.recv_failable ();
+        }
+
+        if (!pending.xchg (0)) {
+            errno = err;
+            return -1;
+        }
+    }
+
+    //  Switch into active state.
+    active = true;
+
+    //  Get a command.
+    const bool ok = cpipe.read (cmd_);
+    zmq_assert (ok);
+    return 0;
+}
@@ -39,6 +39,8 @@
 #include "ypipe.hpp"
 #include "mutex.hpp"
 #include "i_mailbox.hpp"
+#include "atomic_counter.hpp"
+#include "thread_group.hpp"
 
 namespace zmq
 {
@@ -54,6 +56,11 @@ namespace zmq
         void send (const command_t &cmd_);
         int recv (command_t *cmd_, int timeout_);
 
+        //  Routes wake-ups to the thread group entry rather than to the
+        //  signaler; NULL switches back to the signaler. To be called by
+        //  the thread reading from the mailbox.
+        void set_group (thread_group_t::entry_t *group_);
+
 #ifdef HAVE_FORK
         // close the file descriptors in the signaller. This is used in a forked
         // child process to close the file descriptors so that they do not interfere
@@ -63,6 +70,8 @@ namespace zmq
 
     private:
 
+        int recv_grouped (command_t *cmd_, int timeout_);
+
         //  The pipe to store actual commands.
         typedef ypipe_t <command_t, command_pipe_granularity> cpipe_t;
         cpipe_t cpipe;
@@ -80,6 +89,17 @@ namespace zmq
         //  read commands from it.
         bool active;
 
+        //  Thread group entry to wake the reader through, if any.
+        thread_group_t::entry_t *group;
+
+        //  With a thread group, set to 1 instead of signalling when the
+        //  reader has to be woken up.
+        atomic_counter_t pending;
+
+        //  True while a grouped reader blocks on the signaler. Protected
+        //  by sync.
+        bool waiting;
+
         //  Disable copying of mailbox_t object.
         mailbox_t (const mailbox_t&);
         const mailbox_t &operator = (const mailbox_t&);
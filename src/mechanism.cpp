@@ -35,6 +35,8 @@
 #include "msg.hpp"
 #include "err.hpp"
 #include "wire.hpp"
+#include "compressor.hpp"
+#include "timestamps.hpp"
 
 zmq::mechanism_t::mechanism_t (const options_t &options_) :
     options (options_)
@@ -138,6 +140,18 @@ size_t zmq::mechanism_t::add_basic_properties (unsigned char *buf,
                              ZMQ_MSG_PROPERTY_IDENTITY, options.identity,
                              options.identity_size);
 
+    //  Offer transport compression
+    if (options.compression_level > 0)
+        ptr += add_property (ptr, buf_capacity - (ptr - buf),
+                             compression_property, compression_algorithm,
+                             strlen (compression_algorithm));
+
+    //  Ask for the timestamps of the messages we receive
+    if (options.msg_timestamps)
+        ptr += add_property (ptr, buf_capacity - (ptr - buf),
+                             timestamps_property, timestamps_clock,
+                             strlen (timestamps_clock));
+
     return ptr - buf;
 }
 
@@ -149,6 +163,14 @@ size_t zmq::mechanism_t::basic_properties_len() const
                || options.type == ZMQ_ROUTER)
                 ? property_len (ZMQ_MSG_PROPERTY_IDENTITY,
                                 options.identity_size)
+                : 0)
+           + (options.compression_level > 0
+                ? property_len (compression_property,
+                                strlen (compression_algorithm))
+                : 0)
+           + (options.msg_timestamps
+                ? property_len (timestamps_property,
+                                strlen (timestamps_clock))
                 : 0);
 }
 
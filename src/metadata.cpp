@@ -28,16 +28,44 @@
 */
 
 #include "precompiled.hpp"
+#include <stdio.h>
+#include <string.h>
+
 #include "metadata.hpp"
+#include "likely.hpp"
+#include "macros.hpp"
+#include "err.hpp"
 
 zmq::metadata_t::metadata_t (const dict_t &dict) :
     ref_cnt (1),
-    dict (dict)
+    dict (dict),
+    stamped (false),
+    base_metadata (NULL)
+{
+}
+
+zmq::metadata_t::metadata_t () :
+    ref_cnt (1),
+    stamped (true),
+    base_metadata (NULL)
+{
+    memset (times, 0, sizeof times);
+}
+
+zmq::metadata_t::~metadata_t ()
 {
+    reset (NULL);
 }
 
 const char *zmq::metadata_t::get (const std::string &property) const
 {
+    if (unlikely (stamped)) {
+        for (int i = 0; i != timestamp_count; i++)
+            if (times [i] && property == timestamp_properties [i])
+                return values [i];
+        return base_metadata ? base_metadata->get (property) : NULL;
+    }
+
     dict_t::const_iterator it = dict.find (property);
     if (it == dict.end ())
         return NULL;
@@ -45,6 +73,40 @@ const char *zmq::metadata_t::get (const std::string &property) const
         return it->second.c_str ();
 }
 
+void zmq::metadata_t::reset (metadata_t *base_)
+{
+    if (base_)
+        base_->add_ref ();
+    if (base_metadata && base_metadata->drop_ref ())
+        LIBZMQ_DELETE (base_metadata);
+    base_metadata = base_;
+    memset (times, 0, sizeof times);
+}
+
+bool zmq::metadata_t::is_stamped () const
+{
+    return stamped;
+}
+
+zmq::metadata_t *zmq::metadata_t::base () const
+{
+    return base_metadata;
+}
+
+void zmq::metadata_t::set_time (timestamp_t which_, uint64_t time_)
+{
+    zmq_assert (stamped);
+    times [which_] = time_;
+    if (time_)
+        snprintf (values [which_], sizeof values [which_], "%llu",
+            (unsigned long long) time_);
+}
+
+uint64_t zmq::metadata_t::get_time (timestamp_t which_) const
+{
+    return stamped ? times [which_] : 0;
+}
+
 void zmq::metadata_t::add_ref ()
 {
     ref_cnt.add (1);
@@ -54,3 +116,8 @@ bool zmq::metadata_t::drop_ref ()
 {
     return !ref_cnt.sub (1);
 }
+
+bool zmq::metadata_t::has_single_ref ()
+{
+    return ref_cnt.add (0) == 1;
+}
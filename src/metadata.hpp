@@ -34,6 +34,8 @@
 #include <string>
 
 #include "atomic_counter.hpp"
+#include "stdint.hpp"
+#include "timestamps.hpp"
 
 namespace zmq
 {
@@ -44,16 +46,39 @@ namespace zmq
 
             metadata_t (const dict_t &dict);
 
+            //  Creates the metadata of a stamped message. It holds the
+            //  properties of a base metadata, see reset, plus the times
+            //  set with set_time, in a fixed slot rather than the
+            //  dictionary, so that it can be reused without allocating.
+            metadata_t ();
+
+            ~metadata_t ();
+
             //  Returns pointer to property value or NULL if
             //  property is not found.
             const char *get (const std::string &property) const;
 
+            //  Stamped metadata only. Makes it refer to base_, which may be
+            //  NULL, and clears its times.
+            void reset (metadata_t *base_);
+
+            bool is_stamped () const;
+            metadata_t *base () const;
+
+            //  Sets or returns one of the times of a stamped message. Zero
+            //  means unknown; such a time is not exposed as a property.
+            void set_time (timestamp_t which_, uint64_t time_);
+            uint64_t get_time (timestamp_t which_) const;
+
             void add_ref ();
 
             //  Drop reference. Returns true iff the reference
             //  counter drops to zero.
             bool drop_ref ();
 
+            //  Returns true iff exactly one reference is left.
+            bool has_single_ref ();
+
         private:
             metadata_t(const metadata_t&);
             metadata_t & operator=(const metadata_t&);
@@ -63,6 +88,16 @@ namespace zmq
 
             //  Dictionary holding metadata.
             dict_t dict;
+
+            //  True for the metadata of a stamped message, whose properties
+            //  are those of base plus the times below.
+            bool stamped;
+            metadata_t *base_metadata;
+
+            //  The times and, for those that are known, their values as
+            //  decimal strings.
+            uint64_t times [timestamp_count];
+            char values [timestamp_count][24];
     };
 
 }
@@ -0,0 +1,131 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "precompiled.hpp"
+#include <new>
+#include <string.h>
+
+#include "monitor_ring.hpp"
+#include "clock.hpp"
+#include "err.hpp"
+#include "likely.hpp"
+
+zmq::monitor_ring_t::monitor_ring_t (uint32_t capacity_, int sample_rate_) :
+    capacity (1),
+    head (0),
+    sample_rate (sample_rate_ > 1 ? sample_rate_ : 1)
+{
+    while (capacity < capacity_)
+        capacity <<= 1;
+    slots = new (std::nothrow) slot_t [capacity];
+    alloc_assert (slots);
+    for (uint32_t i = 0; i != capacity; i++)
+        slots [i].sequence.set (i);
+}
+
+zmq::monitor_ring_t::~monitor_ring_t ()
+{
+    delete [] slots;
+}
+
+uint32_t zmq::monitor_ring_t::get_capacity () const
+{
+    return capacity;
+}
+
+void zmq::monitor_ring_t::set_sample_rate (int sample_rate_)
+{
+    //  There is a single writer, so moving the value by the difference
+    //  is the same as an atomic store.
+    const uint32_t rate = sample_rate_ > 1 ? sample_rate_ : 1;
+    sample_rate.add (rate - sample_rate.get ());
+}
+
+void zmq::monitor_ring_t::push (int event_, intptr_t value_,
+    const std::string &addr_)
+{
+    //  Sample each event type separately, so that rare events are not
+    //  drowned by frequent ones.
+    const uint32_t rate = sample_rate.get ();
+    if (rate > 1) {
+        int type = 0;
+        while (type < 31 && !(event_ & (1 << type)))
+            type++;
+        if (seen [type].add (1) % rate != 0)
+            return;
+    }
+
+    if (unlikely (used.add (1) >= capacity)) {
+        used.sub (1);
+        dropped.add (1);
+        return;
+    }
+    const uint32_t ticket = tail.add (1);
+    slot_t &slot = slots [ticket & (capacity - 1)];
+    zmq_assert (slot.sequence.get () == ticket);
+
+    zmq_monitor_record_t &record = slot.record;
+    record.timestamp = clock_t::now_us ();
+    record.value = value_;
+    record.event = event_;
+    record.sampled = rate;
+    const size_t size = addr_.size () < sizeof record.address ?
+        addr_.size () : sizeof record.address - 1;
+    memcpy (record.address, addr_.c_str (), size);
+    record.address [size] = 0;
+
+    //  Publish the record.
+    slot.sequence.add (1);
+}
+
+int zmq::monitor_ring_t::drain (zmq_monitor_record_t *records_, int count_,
+    uint64_t *dropped_)
+{
+    int n = 0;
+    while (n < count_) {
+        slot_t &slot = slots [head & (capacity - 1)];
+
+        //  The read-modify-write gives the load acquire semantics.
+        if (slot.sequence.add (0) != head + 1)
+            break;
+        records_ [n++] = slot.record;
+
+        //  Free the slot for the record one lap ahead, then release it.
+        slot.sequence.add (capacity - 1);
+        head++;
+        used.sub (1);
+    }
+
+    if (dropped_) {
+        const uint32_t lost = dropped.add (0);
+        dropped.sub (lost);
+        *dropped_ = lost;
+    }
+    return n;
+}
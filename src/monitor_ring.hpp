@@ -0,0 +1,105 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_MONITOR_RING_HPP_INCLUDED__
+#define __ZMQ_MONITOR_RING_HPP_INCLUDED__
+
+#include <string>
+
+#include "stdint.hpp"
+#include "atomic_counter.hpp"
+
+namespace zmq
+{
+
+    //  Bounded ring of binary monitor event records. Any number of threads
+    //  may append records concurrently without locking; a single thread at
+    //  a time drains them in batches. When the ring is full new records are
+    //  dropped and counted rather than blocking the thread raising the event.
+
+    class monitor_ring_t
+    {
+    public:
+
+        //  'capacity_' is rounded up to a power of two.
+        monitor_ring_t (uint32_t capacity_, int sample_rate_);
+        ~monitor_ring_t ();
+
+        uint32_t get_capacity () const;
+
+        //  Keep only one in every 'sample_rate_' events of each type. May
+        //  only be called by the thread owning the socket.
+        void set_sample_rate (int sample_rate_);
+
+        //  Appends a record for the event. Thread safe and lock-free.
+        void push (int event_, intptr_t value_, const std::string &addr_);
+
+        //  Moves up to 'count_' records into 'records_' and returns their
+        //  number. If 'dropped_' is not NULL it receives the number of
+        //  records lost since the previous call. Single consumer only.
+        int drain (zmq_monitor_record_t *records_, int count_,
+            uint64_t *dropped_);
+
+    private:
+
+        //  A slot is free for the record with ticket 't' when its sequence
+        //  equals 't' and holds that record once its sequence is 't + 1'.
+        struct slot_t
+        {
+            atomic_counter_t sequence;
+            zmq_monitor_record_t record;
+        };
+
+        slot_t *slots;
+        uint32_t capacity;
+
+        //  Number of slots reserved by producers and not yet drained.
+        //  Reserving before taking a ticket guarantees the slot is free.
+        atomic_counter_t used;
+
+        //  Next ticket handed out to a producer.
+        atomic_counter_t tail;
+
+        //  Next ticket to drain. Only touched by the consumer.
+        uint32_t head;
+
+        //  Records lost because the ring was full.
+        atomic_counter_t dropped;
+
+        //  Sampling rate and per event type counters of seen events.
+        atomic_counter_t sample_rate;
+        atomic_counter_t seen [32];
+
+        monitor_ring_t (const monitor_ring_t&);
+        const monitor_ring_t &operator = (const monitor_ring_t&);
+    };
+
+}
+
+#endif
@@ -375,6 +375,13 @@ size_t zmq::msg_t::size () const
     }
 }
 
+size_t zmq::msg_t::payload_size () const
+{
+    if (is_delimiter () || is_join () || is_leave ())
+        return 0;
+    return size ();
+}
+
 unsigned char zmq::msg_t::flags () const
 {
     return u.base.flags;
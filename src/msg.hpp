@@ -78,6 +78,7 @@ namespace zmq
         {
             more = 1,           //  Followed by more parts
             command = 2,        //  Command frame (see ZMTP spec)
+            packed = 4,         //  Several frames in one (pipe only)
             credential = 32,
             identity = 64,
             shared = 128
@@ -103,6 +104,8 @@ namespace zmq
         int copy (msg_t &src_);
         void *data ();
         size_t size () const;
+        //  Size of the body, zero for delimiters, joins and leaves.
+        size_t payload_size () const;
         unsigned char flags () const;
         void set_flags (unsigned char flags_);
         void reset_flags (unsigned char flags_);
@@ -79,7 +79,8 @@ void zmq::object_t::process_command (command_t &cmd_)
         break;
 
     case command_t::activate_write:
-        process_activate_write (cmd_.args.activate_write.msgs_read);
+        process_activate_write (cmd_.args.activate_write.msgs_read,
+            cmd_.args.activate_write.bytes_read);
         break;
 
     case command_t::stop:
@@ -146,6 +147,12 @@ void zmq::object_t::process_command (command_t &cmd_)
         process_seqnum ();
         break;
 
+    case command_t::resolved:
+        process_resolved (cmd_.args.resolved.address,
+            cmd_.args.resolved.error);
+        process_seqnum ();
+        break;
+
     case command_t::done:
     default:
         zmq_assert (false);
@@ -261,12 +268,13 @@ void zmq::object_t::send_activate_read (pipe_t *destination_)
 }
 
 void zmq::object_t::send_activate_write (pipe_t *destination_,
-    uint64_t msgs_read_)
+    uint64_t msgs_read_, uint64_t bytes_read_)
 {
     command_t cmd;
     cmd.destination = destination_;
     cmd.type = command_t::activate_write;
     cmd.args.activate_write.msgs_read = msgs_read_;
+    cmd.args.activate_write.bytes_read = bytes_read_;
     send_command (cmd);
 }
 
@@ -349,6 +357,19 @@ void zmq::object_t::send_reaped ()
     send_command (cmd);
 }
 
+void zmq::object_t::send_resolved (own_t *destination_,
+    tcp_address_t *address_, int error_)
+{
+    destination_->inc_seqnum ();
+
+    command_t cmd;
+    cmd.destination = destination_;
+    cmd.type = command_t::resolved;
+    cmd.args.resolved.address = address_;
+    cmd.args.resolved.error = error_;
+    send_command (cmd);
+}
+
 void zmq::object_t::send_inproc_connected (zmq::socket_base_t *socket_)
 {
     command_t cmd;
@@ -395,7 +416,7 @@ void zmq::object_t::process_activate_read ()
     zmq_assert (false);
 }
 
-void zmq::object_t::process_activate_write (uint64_t)
+void zmq::object_t::process_activate_write (uint64_t, uint64_t)
 {
     zmq_assert (false);
 }
@@ -445,6 +466,11 @@ void zmq::object_t::process_reaped ()
     zmq_assert (false);
 }
 
+void zmq::object_t::process_resolved (tcp_address_t *, int)
+{
+    zmq_assert (false);
+}
+
 void zmq::object_t::process_seqnum ()
 {
     zmq_assert (false);
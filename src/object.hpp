@@ -46,6 +46,7 @@ namespace zmq
     class session_base_t;
     class io_thread_t;
     class own_t;
+    class tcp_address_t;
 
     //  Base class for all objects that participate in inter-thread
     //  communication.
@@ -98,7 +99,7 @@ namespace zmq
              zmq::i_engine *engine_, bool inc_seqnum_ = true);
         void send_activate_read (zmq::pipe_t *destination_);
         void send_activate_write (zmq::pipe_t *destination_,
-             uint64_t msgs_read_);
+             uint64_t msgs_read_, uint64_t bytes_read_);
         void send_hiccup (zmq::pipe_t *destination_, void *pipe_);
         void send_pipe_term (zmq::pipe_t *destination_);
         void send_pipe_term_ack (zmq::pipe_t *destination_);
@@ -109,6 +110,8 @@ namespace zmq
         void send_term_ack (zmq::own_t *destination_);
         void send_reap (zmq::socket_base_t *socket_);
         void send_reaped ();
+        void send_resolved (zmq::own_t *destination_,
+            zmq::tcp_address_t *address_, int error_);
         void send_done ();
 
         //  These handlers can be overridden by the derived objects. They are
@@ -119,7 +122,8 @@ namespace zmq
         virtual void process_attach (zmq::i_engine *engine_);
         virtual void process_bind (zmq::pipe_t *pipe_);
         virtual void process_activate_read ();
-        virtual void process_activate_write (uint64_t msgs_read_);
+        virtual void process_activate_write (uint64_t msgs_read_,
+            uint64_t bytes_read_);
         virtual void process_hiccup (void *pipe_);
         virtual void process_pipe_term ();
         virtual void process_pipe_term_ack ();
@@ -129,6 +133,8 @@ namespace zmq
         virtual void process_term_ack ();
         virtual void process_reap (zmq::socket_base_t *socket_);
         virtual void process_reaped ();
+        virtual void process_resolved (zmq::tcp_address_t *address_,
+            int error_);
 
         //  Special handler called after a command that requires a seqnum
         //  was processed. The implementation should catch up with its counter
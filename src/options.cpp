@@ -31,6 +31,7 @@
 #include <string.h>
 
 #include "options.hpp"
+#include "config.hpp"
 #include "err.hpp"
 #include "macros.hpp"
 
@@ -47,6 +48,8 @@
 zmq::options_t::options_t () :
     sndhwm (1000),
     rcvhwm (1000),
+    sndhwm_bytes (0),
+    rcvhwm_bytes (0),
     affinity (0),
     identity_size (0),
     rate (100),
@@ -84,12 +87,22 @@ zmq::options_t::options_t () :
     gss_plaintext (false),
     socket_id (0),
     conflate (false),
+    conflate_topic (false),
     handshake_ivl (30000),
     connected (false),
     heartbeat_ttl (0),
     heartbeat_interval (0),
     heartbeat_timeout (-1),
-    use_fd (-1)
+    use_fd (-1),
+    compression_level (0),
+    compression_threshold (128),
+    out_batch_size (zmq::out_batch_size),
+    in_batch_size (zmq::in_batch_size),
+    adaptive_batch (false),
+    msg_timestamps (false),
+    kernel_timestamps (false),
+    tcp_autotune (false),
+    tcp_notsent_lowat (-1)
 {
     memset (curve_public_key, 0, CURVE_KEYSIZE);
     memset (curve_secret_key, 0, CURVE_KEYSIZE);
@@ -159,6 +172,22 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
             }
             break;
 
+        case ZMQ_SNDHWM_BYTES:
+            if (optvallen_ == sizeof (int64_t) &&
+                  *((int64_t *) optval_) >= 0) {
+                sndhwm_bytes = *((int64_t *) optval_);
+                return 0;
+            }
+            break;
+
+        case ZMQ_RCVHWM_BYTES:
+            if (optvallen_ == sizeof (int64_t) &&
+                  *((int64_t *) optval_) >= 0) {
+                rcvhwm_bytes = *((int64_t *) optval_);
+                return 0;
+            }
+            break;
+
         case ZMQ_AFFINITY:
             if (optvallen_ == sizeof (uint64_t)) {
                 affinity = *((uint64_t*) optval_);
@@ -488,6 +517,13 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
             }
             break;
 
+        case ZMQ_CONFLATE_TOPIC:
+            if (is_int && (value == 0 || value == 1)) {
+                conflate_topic = (value != 0);
+                return 0;
+            }
+            break;
+
         //  If libgssapi isn't installed, these options provoke EINVAL
 #ifdef HAVE_LIBGSSAPI_KRB5
         case ZMQ_GSSAPI_SERVER:
@@ -628,6 +664,71 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
             }
             break;
 
+#ifdef ZMQ_HAVE_ZLIB
+        case ZMQ_COMPRESSION_LEVEL:
+            if (is_int && value >= 0 && value <= 9) {
+                compression_level = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COMPRESSION_THRESHOLD:
+            if (is_int && value >= 0) {
+                compression_threshold = value;
+                return 0;
+            }
+            break;
+#endif
+
+        case ZMQ_OUT_BATCH_SIZE:
+            if (is_int && value > 0 && value <= max_batch_size) {
+                out_batch_size = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_IN_BATCH_SIZE:
+            if (is_int && value > 0 && value <= max_batch_size) {
+                in_batch_size = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_ADAPTIVE_BATCH:
+            if (is_int && (value == 0 || value == 1)) {
+                adaptive_batch = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_MSG_TIMESTAMPS:
+            if (is_int && (value == 0 || value == 1)) {
+                msg_timestamps = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_KERNEL_TIMESTAMPS:
+            if (is_int && (value == 0 || value == 1)) {
+                kernel_timestamps = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_TCP_AUTOTUNE:
+            if (is_int && (value == 0 || value == 1)) {
+                tcp_autotune = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_TCP_NOTSENT_LOWAT:
+            if (is_int && value >= -1) {
+                tcp_notsent_lowat = value;
+                return 0;
+            }
+            break;
+
         default:
 #if defined (ZMQ_ACT_MILITANT)
             //  There are valid scenarios for probing with unknown socket option
@@ -672,6 +773,20 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
             }
             break;
 
+        case ZMQ_SNDHWM_BYTES:
+            if (*optvallen_ == sizeof (int64_t)) {
+                *((int64_t *) optval_) = sndhwm_bytes;
+                return 0;
+            }
+            break;
+
+        case ZMQ_RCVHWM_BYTES:
+            if (*optvallen_ == sizeof (int64_t)) {
+                *((int64_t *) optval_) = rcvhwm_bytes;
+                return 0;
+            }
+            break;
+
         case ZMQ_AFFINITY:
             if (*optvallen_ == sizeof (uint64_t)) {
                 *((uint64_t *) optval_) = affinity;
@@ -955,6 +1070,13 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
             }
             break;
 
+        case ZMQ_CONFLATE_TOPIC:
+            if (is_int) {
+                *value = conflate_topic;
+                return 0;
+            }
+            break;
+
         //  If libgssapi isn't installed, these options provoke EINVAL
 #ifdef HAVE_LIBGSSAPI_KRB5
         case ZMQ_GSSAPI_SERVER:
@@ -1052,6 +1174,71 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
             }
             break;
 
+#ifdef ZMQ_HAVE_ZLIB
+        case ZMQ_COMPRESSION_LEVEL:
+            if (is_int) {
+                *value = compression_level;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COMPRESSION_THRESHOLD:
+            if (is_int) {
+                *value = compression_threshold;
+                return 0;
+            }
+            break;
+#endif
+
+        case ZMQ_OUT_BATCH_SIZE:
+            if (is_int) {
+                *value = out_batch_size;
+                return 0;
+            }
+            break;
+
+        case ZMQ_IN_BATCH_SIZE:
+            if (is_int) {
+                *value = in_batch_size;
+                return 0;
+            }
+            break;
+
+        case ZMQ_ADAPTIVE_BATCH:
+            if (is_int) {
+                *value = adaptive_batch;
+                return 0;
+            }
+            break;
+
+        case ZMQ_MSG_TIMESTAMPS:
+            if (is_int) {
+                *value = msg_timestamps;
+                return 0;
+            }
+            break;
+
+        case ZMQ_KERNEL_TIMESTAMPS:
+            if (is_int) {
+                *value = kernel_timestamps;
+                return 0;
+            }
+            break;
+
+        case ZMQ_TCP_AUTOTUNE:
+            if (is_int) {
+                *value = tcp_autotune;
+                return 0;
+            }
+            break;
+
+        case ZMQ_TCP_NOTSENT_LOWAT:
+            if (is_int) {
+                *value = tcp_notsent_lowat;
+                return 0;
+            }
+            break;
+
         default:
 #if defined (ZMQ_ACT_MILITANT)
             malformed = false;
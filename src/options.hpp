@@ -67,6 +67,10 @@ namespace zmq
         int sndhwm;
         int rcvhwm;
 
+        //  High-water marks for message pipes in bytes, 0 if unlimited.
+        int64_t sndhwm_bytes;
+        int64_t rcvhwm_bytes;
+
         //  I/O thread affinity.
         uint64_t affinity;
 
@@ -211,10 +215,14 @@ namespace zmq
 
         //  If true, socket conflates outgoing/incoming messages.
         //  Applicable to dealer, push/pull, pub/sub socket types.
-        //  Cannot receive multi-part messages.
+        //  Multi-part messages are conflated as a whole.
         //  Ignores hwm
         bool conflate;
 
+        //  If true, conflation keeps the last message of each topic, the
+        //  topic being the first frame of the message.
+        bool conflate_topic;
+
         //  If connection handshake is not done after this many milliseconds,
         //  close socket.  Default is 30 secs.  0 means no handshake timeout.
         int handshake_ivl;
@@ -243,6 +251,34 @@ namespace zmq
 
         // Device to bind the underlying socket to, eg. VRF or interface
         std::string bound_device;
+
+        //  Transport compression level (1-9), 0 if compression is disabled.
+        //  Compression is used only if the peer enables it as well.
+        int compression_level;
+
+        //  Messages smaller than this many bytes are sent uncompressed.
+        int compression_threshold;
+
+        //  Batching sizes of stream engines in bytes. With adaptive
+        //  batching the outbound size is the upper bound.
+        int out_batch_size;
+        int in_batch_size;
+        bool adaptive_batch;
+
+        //  If true, messages are stamped with the times they pass through
+        //  the library, see ZMQ_MSG_TIMESTAMPS.
+        bool msg_timestamps;
+
+        //  If true, TCP and UDP sockets have the kernel timestamp received
+        //  data, see ZMQ_KERNEL_TIMESTAMPS.
+        bool kernel_timestamps;
+
+        //  If true, TCP socket buffers are sized to the measured
+        //  bandwidth-delay product, see ZMQ_TCP_AUTOTUNE.
+        bool tcp_autotune;
+
+        //  TCP_NOTSENT_LOWAT for TCP sockets, -1 to leave the OS default.
+        int tcp_notsent_lowat;
     };
 }
 
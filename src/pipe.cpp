@@ -30,16 +30,19 @@
 #include "precompiled.hpp"
 #include <new>
 #include <stddef.h>
+#include <string.h>
 
 #include "macros.hpp"
 #include "pipe.hpp"
+#include "ctx.hpp"
 #include "err.hpp"
+#include "trace.hpp"
 
 #include "ypipe.hpp"
 #include "ypipe_conflate.hpp"
 
 int zmq::pipepair (class object_t *parents_ [2], class pipe_t* pipes_ [2],
-    int hwms_ [2], bool conflate_ [2])
+    int hwms_ [2], bool conflate_ [2], bool conflate_topic_)
 {
     //   Creates two pipe objects. These objects are connected by two ypipes,
     //   each to pass messages in one direction.
@@ -49,23 +52,31 @@ int zmq::pipepair (class object_t *parents_ [2], class pipe_t* pipes_ [2],
 
     pipe_t::upipe_t *upipe1;
     if(conflate_ [0])
-        upipe1 = new (std::nothrow) upipe_conflate_t ();
+        upipe1 = new (std::nothrow) upipe_conflate_t (conflate_topic_);
     else
         upipe1 = new (std::nothrow) upipe_normal_t ();
     alloc_assert (upipe1);
 
     pipe_t::upipe_t *upipe2;
     if(conflate_ [1])
-        upipe2 = new (std::nothrow) upipe_conflate_t ();
+        upipe2 = new (std::nothrow) upipe_conflate_t (conflate_topic_);
     else
         upipe2 = new (std::nothrow) upipe_normal_t ();
     alloc_assert (upipe2);
 
+    //  Conflating pipes hold a single message at most and are therefore
+    //  exempted from the memory budget. Both ends must agree on whether
+    //  the pipepair is budgeted, so the decision is made once here.
+    ctx_t *budget_ctx = NULL;
+    if (!conflate_ [0] && !conflate_ [1] &&
+          parents_ [0]->get_ctx ()->get_memory_budget () > 0)
+        budget_ctx = parents_ [0]->get_ctx ();
+
     pipes_ [0] = new (std::nothrow) pipe_t (parents_ [0], upipe1, upipe2,
-        hwms_ [1], hwms_ [0], conflate_ [0]);
+        hwms_ [1], hwms_ [0], conflate_ [0], conflate_topic_, budget_ctx);
     alloc_assert (pipes_ [0]);
     pipes_ [1] = new (std::nothrow) pipe_t (parents_ [1], upipe2, upipe1,
-        hwms_ [0], hwms_ [1], conflate_ [1]);
+        hwms_ [0], hwms_ [1], conflate_ [1], conflate_topic_, budget_ctx);
     alloc_assert (pipes_ [1]);
 
     pipes_ [0]->set_peer (pipes_ [1]);
@@ -75,7 +86,8 @@ int zmq::pipepair (class object_t *parents_ [2], class pipe_t* pipes_ [2],
 }
 
 zmq::pipe_t::pipe_t (object_t *parent_, upipe_t *inpipe_, upipe_t *outpipe_,
-      int inhwm_, int outhwm_, bool conflate_) :
+      int inhwm_, int outhwm_, bool conflate_, bool conflate_topic_,
+      ctx_t *budget_ctx_) :
     object_t (parent_),
     inpipe (inpipe_),
     outpipe (outpipe_),
@@ -88,17 +100,40 @@ zmq::pipe_t::pipe_t (object_t *parent_, upipe_t *inpipe_, upipe_t *outpipe_,
     msgs_read (0),
     msgs_written (0),
     peers_msgs_read (0),
+    hwm_bytes (0),
+    lwm_bytes (0),
+    bytes_read (0),
+    bytes_written (0),
+    peers_bytes_read (0),
+    bytes_read_reported (0),
+    out_more (false),
+    out_packed_size (0),
+    out_packed_count (0),
+    in_packed_pos (0),
+    in_unpacking (false),
+    budget_ctx (budget_ctx_),
+    charged_units (0),
+    released_units (0),
     peer (NULL),
     sink (NULL),
     state (active),
     delay (true),
     routing_id(0),
-    conflate (conflate_)
+    conflate (conflate_),
+    conflate_topic (conflate_topic_)
 {
+    compute_lwm_bytes (0);
 }
 
 zmq::pipe_t::~pipe_t ()
 {
+    //  Undo whatever this end contributed to the budget; the peer does
+    //  the same for its end. Truncation is harmless as the context's
+    //  counter wraps around the same way.
+    if (budget_ctx) {
+        budget_ctx->release_memory (uint32_t (charged_units));
+        budget_ctx->charge_memory (uint32_t (released_units));
+    }
 }
 
 void zmq::pipe_t::set_peer (pipe_t *peer_)
@@ -147,6 +182,10 @@ bool zmq::pipe_t::check_read ()
     if (unlikely (state != active && state != waiting_for_delimiter))
         return false;
 
+    //  The rest of a packed entry is still to be read.
+    if (unlikely (in_unpacking))
+        return true;
+
     //  Check if there's an item in the pipe.
     if (!inpipe->check_read ()) {
         in_active = false;
@@ -174,10 +213,32 @@ bool zmq::pipe_t::read (msg_t *msg_)
         return false;
 
 read_message:
-    if (!inpipe->read (msg_)) {
-        in_active = false;
-        return false;
+    if (unlikely (in_unpacking))
+        read_packed (msg_);
+    else {
+        if (!inpipe->read (msg_)) {
+            in_active = false;
+            return false;
+        }
+
+        //  Bytes are accounted by pipe entry, as the writer does.
+        bytes_read += msg_->payload_size ();
+        if (budget_ctx &&
+              bytes_read / memory_budget_granularity > released_units) {
+            const uint64_t units = bytes_read / memory_budget_granularity;
+            budget_ctx->release_memory (uint32_t (units - released_units));
+            released_units = units;
+        }
+
+        if (unlikely (msg_->flags () & msg_t::packed)) {
+            in_packed = *msg_;
+            in_packed_pos = 0;
+            in_unpacking = true;
+            read_packed (msg_);
+        }
     }
+    zmq_trace3 (pipe_read, this, msg_->payload_size (),
+        msg_->flags () & msg_t::more);
 
     //  If this is a credential, save a copy and receive next message.
     if (unlikely (msg_->is_credential ())) {
@@ -197,8 +258,12 @@ read_message:
     if (!(msg_->flags () & msg_t::more) && !msg_->is_identity ())
         msgs_read++;
 
-    if (lwm > 0 && msgs_read % lwm == 0)
-        send_activate_write (peer, msgs_read);
+    if ((lwm > 0 && msgs_read % lwm == 0) ||
+          (lwm_bytes > 0 &&
+           bytes_read - bytes_read_reported >= uint64_t (lwm_bytes))) {
+        send_activate_write (peer, msgs_read, bytes_read);
+        bytes_read_reported = bytes_read;
+    }
 
     return true;
 }
@@ -225,9 +290,32 @@ bool zmq::pipe_t::write (msg_t *msg_)
 
     bool more = msg_->flags () & msg_t::more ? true : false;
     const bool is_identity = msg_->is_identity ();
+    zmq_trace3 (pipe_write, this, msg_->payload_size (), more);
+    out_more = more;
+
+    //  Hold back frames that can be packed. Only frames without any
+    //  properties attached qualify, so that nothing is lost by copying
+    //  their data alone, and the frame owns no resources to release.
+    if (more && !conflate && msg_->flags () == msg_t::more
+    &&  msg_->is_vsm () && msg_->size () < (size_t) msg_t::max_vsm_size
+    &&  msg_->metadata () == NULL && msg_->get_routing_id () == 0) {
+        if (out_packed_size + 1 + msg_->size () > sizeof out_packed)
+            write_packed ();
+        out_packed [out_packed_size++] = (unsigned char) msg_->size ();
+        memcpy (out_packed + out_packed_size, msg_->data (), msg_->size ());
+        out_packed_size += msg_->size ();
+        out_packed_count++;
+
+        return true;
+    }
+    write_packed ();
+
+    bytes_written += msg_->payload_size ();
     outpipe->write (*msg_, more);
     if (!more && !is_identity)
         msgs_written++;
+    if (budget_ctx)
+        update_charge ();
 
     return true;
 }
@@ -239,9 +327,55 @@ void zmq::pipe_t::rollback ()
     if (outpipe) {
         while (outpipe->unwrite (&msg)) {
             zmq_assert (msg.flags () & msg_t::more);
+            bytes_written -= msg.payload_size ();
             int rc = msg.close ();
             errno_assert (rc == 0);
         }
+        out_more = false;
+        out_packed_size = 0;
+        out_packed_count = 0;
+        if (budget_ctx)
+            update_charge ();
+    }
+}
+
+void zmq::pipe_t::write_packed ()
+{
+    if (!out_packed_count)
+        return;
+
+    //  A single frame is written as it was.
+    const bool packed = out_packed_count > 1;
+    const unsigned char *data = packed ? out_packed : out_packed + 1;
+    const size_t size = packed ? out_packed_size : out_packed_size - 1;
+
+    msg_t msg;
+    const int rc = msg.init_size (size);
+    errno_assert (rc == 0);
+    memcpy (msg.data (), data, size);
+    msg.set_flags (packed ? msg_t::more | msg_t::packed : msg_t::more);
+    bytes_written += msg.payload_size ();
+    outpipe->write (msg, true);
+
+    out_packed_size = 0;
+    out_packed_count = 0;
+}
+
+void zmq::pipe_t::read_packed (msg_t *msg_)
+{
+    const unsigned char *data =
+        static_cast <const unsigned char *> (in_packed.data ());
+    const size_t size = data [in_packed_pos];
+    const int rc = msg_->init_size (size);
+    errno_assert (rc == 0);
+    memcpy (msg_->data (), data + in_packed_pos + 1, size);
+    msg_->set_flags (msg_t::more);
+
+    in_packed_pos += 1 + size;
+    if (in_packed_pos == in_packed.size ()) {
+        const int rc = in_packed.close ();
+        errno_assert (rc == 0);
+        in_unpacking = false;
     }
 }
 
@@ -263,10 +397,12 @@ void zmq::pipe_t::process_activate_read ()
     }
 }
 
-void zmq::pipe_t::process_activate_write (uint64_t msgs_read_)
+void zmq::pipe_t::process_activate_write (uint64_t msgs_read_,
+    uint64_t bytes_read_)
 {
-    //  Remember the peer's message sequence number.
+    //  Remember the peer's message sequence number and byte count.
     peers_msgs_read = msgs_read_;
+    peers_bytes_read = bytes_read_;
 
     if (!out_active && state == active) {
         out_active = true;
@@ -284,10 +420,15 @@ void zmq::pipe_t::process_hiccup (void *pipe_)
     while (outpipe->read (&msg)) {
        if (!(msg.flags () & msg_t::more))
             msgs_written--;
+       bytes_written -= msg.payload_size ();
        int rc = msg.close ();
        errno_assert (rc == 0);
     }
     LIBZMQ_DELETE(outpipe);
+    out_packed_size = 0;
+    out_packed_count = 0;
+    if (budget_ctx)
+        update_charge ();
 
     //  Plug in the new outpipe.
     zmq_assert (pipe_);
@@ -363,6 +504,12 @@ void zmq::pipe_t::process_pipe_term_ack ()
     //  hand because msg_t doesn't have automatic destructor. Then deallocate
     //  the ypipe itself.
 
+    if (in_unpacking) {
+        const int rc = in_packed.close ();
+        errno_assert (rc == 0);
+        in_unpacking = false;
+    }
+
     if (!conflate) {
         msg_t msg;
         while (inpipe->read (&msg)) {
@@ -500,9 +647,16 @@ void zmq::pipe_t::hiccup ()
     //  responsible for deallocating it.
     inpipe = NULL;
 
+    //  The rest of a packed entry goes away with the old inpipe.
+    if (in_unpacking) {
+        const int rc = in_packed.close ();
+        errno_assert (rc == 0);
+        in_unpacking = false;
+    }
+
     //  Create new inpipe.
     if (conflate)
-        inpipe = new (std::nothrow)ypipe_conflate_t <msg_t>();
+        inpipe = new (std::nothrow)ypipe_conflate_t <msg_t>(conflate_topic);
     else
         inpipe = new (std::nothrow)ypipe_t <msg_t, message_pipe_granularity>();
 
@@ -538,9 +692,55 @@ void zmq::pipe_t::set_hwms_boost(int inhwmboost_, int outhwmboost_)
 bool zmq::pipe_t::check_hwm () const
 {
     bool full = hwm > 0 && msgs_written - peers_msgs_read >= uint64_t (hwm);
+
+    //  A pipe holding less than one budget unit is never blocked by the
+    //  budget. That way the reader is guaranteed to report back once it
+    //  drains the pipe.
+    if (!full && !out_more && (hwm_bytes > 0 || budget_ctx)) {
+        const uint64_t queued = bytes_written - peers_bytes_read;
+        full = (hwm_bytes > 0 && queued >= uint64_t (hwm_bytes)) ||
+            (budget_ctx && queued >= memory_budget_granularity &&
+             budget_ctx->memory_exhausted ());
+    }
     return( !full );
 }
 
+void zmq::pipe_t::set_hwms_bytes (int64_t inhwm_, int64_t outhwm_)
+{
+    hwm_bytes = outhwm_ > 0 ? outhwm_ : 0;
+    compute_lwm_bytes (inhwm_);
+}
+
+int64_t zmq::pipe_t::combine_hwms_bytes (int64_t first_, int64_t second_)
+{
+    if (first_ <= 0)
+        return second_ > 0 ? second_ : 0;
+    if (second_ <= 0)
+        return first_;
+    return first_ + second_;
+}
+
+void zmq::pipe_t::compute_lwm_bytes (int64_t hwm_)
+{
+    //  Same reasoning as for compute_lwm. With a memory budget the writer
+    //  must in addition learn about every budget unit drained.
+    lwm_bytes = hwm_ > 0 ? (hwm_ + 1) / 2 : 0;
+    if (budget_ctx &&
+          (lwm_bytes == 0 || lwm_bytes > memory_budget_granularity))
+        lwm_bytes = memory_budget_granularity;
+}
+
+void zmq::pipe_t::update_charge ()
+{
+    const uint64_t units = bytes_written / memory_budget_granularity;
+    if (units > charged_units)
+        budget_ctx->charge_memory (uint32_t (units - charged_units));
+    else
+    if (units < charged_units)
+        budget_ctx->release_memory (uint32_t (charged_units - units));
+    charged_units = units;
+}
+
 void zmq::pipe_t::send_hwms_to_peer(int inhwm_, int outhwm_)
 {
     send_pipe_hwm(peer, inhwm_, outhwm_);
@@ -51,9 +51,10 @@ namespace zmq
     //  pipe receives all the pending messages before terminating, otherwise it
     //  terminates straight away.
     //  If conflate is true, only the most recently arrived message could be
-    //  read (older messages are discarded)
+    //  read (older messages are discarded). If conflate_topic is true as well,
+    //  the most recently arrived message is kept for each topic.
     int pipepair (zmq::object_t *parents_ [2], zmq::pipe_t* pipes_ [2],
-        int hwms_ [2], bool conflate_ [2]);
+        int hwms_ [2], bool conflate_ [2], bool conflate_topic_ = false);
 
     struct i_pipe_events
     {
@@ -77,7 +78,7 @@ namespace zmq
     {
         //  This allows pipepair to create pipe objects.
         friend int pipepair (zmq::object_t *parents_ [2], zmq::pipe_t* pipes_ [2],
-            int hwms_ [2], bool conflate_ [2]);
+            int hwms_ [2], bool conflate_ [2], bool conflate_topic_);
 
     public:
 
@@ -139,6 +140,15 @@ namespace zmq
         // send command to peer for notify the change of hwm
         void send_hwms_to_peer(int inhwm_, int outhwm_);
 
+        //  Set the high water marks in bytes (0 means no limit). Both ends
+        //  of a pipepair must be set, each with the other end's values
+        //  swapped, as the reader decides when to report its progress.
+        void set_hwms_bytes (int64_t inhwm_, int64_t outhwm_);
+
+        //  Combines the byte limits of the two sides of a pipe. A limit
+        //  set on one side only applies on its own.
+        static int64_t combine_hwms_bytes (int64_t first_, int64_t second_);
+
         //  Returns true if HWM is not reached
         bool check_hwm () const;
     private:
@@ -148,7 +158,8 @@ namespace zmq
 
         //  Command handlers.
         void process_activate_read ();
-        void process_activate_write (uint64_t msgs_read_);
+        void process_activate_write (uint64_t msgs_read_,
+            uint64_t bytes_read_);
         void process_hiccup (void *pipe_);
         void process_pipe_term ();
         void process_pipe_term_ack ();
@@ -157,10 +168,17 @@ namespace zmq
         //  Handler for delimiter read from the pipe.
         void process_delimiter ();
 
+        //  Writes the frames held back for packing, if any.
+        void write_packed ();
+
+        //  Hands out the next frame of the packed entry being read.
+        void read_packed (msg_t *msg_);
+
         //  Constructor is private. Pipe can only be created using
         //  pipepair function.
         pipe_t (object_t *parent_, upipe_t *inpipe_, upipe_t *outpipe_,
-            int inhwm_, int outhwm_, bool conflate_);
+            int inhwm_, int outhwm_, bool conflate_, bool conflate_topic_,
+            ctx_t *budget_ctx_);
 
         //  Pipepair uses this function to let us know about
         //  the peer pipe object.
@@ -195,6 +213,54 @@ namespace zmq
         //  can be higher at the moment.
         uint64_t peers_msgs_read;
 
+        //  High watermark for the outbound pipe and low watermark for
+        //  the inbound pipe, in bytes.
+        int64_t hwm_bytes;
+        int64_t lwm_bytes;
+
+        //  Number of bytes read and written so far, and the peer's
+        //  bytes_read as last received.
+        uint64_t bytes_read;
+        uint64_t bytes_written;
+        uint64_t peers_bytes_read;
+
+        //  Value of bytes_read last reported to the peer.
+        uint64_t bytes_read_reported;
+
+        //  True while an outbound message is partly written. Like the
+        //  message count, the byte limits are only checked before the
+        //  first frame of a message.
+        bool out_more;
+
+        //  Small plain frames followed by more frames, such as the routing
+        //  ids and the delimiter of an envelope, are packed into a single
+        //  pipe entry flagged msg_t::packed, each preceded by its size
+        //  byte. The writer collects them in out_packed until another kind
+        //  of frame comes along; the reader hands them out one by one from
+        //  in_packed. Conflating pipes don't pack.
+        unsigned char out_packed [msg_t::max_vsm_size];
+        size_t out_packed_size;
+        int out_packed_count;
+        msg_t in_packed;
+        size_t in_packed_pos;
+        bool in_unpacking;
+
+        //  Context whose memory budget the messages in the pipe count
+        //  against, NULL if the pipe is not budgeted. The writer charges
+        //  the budget for each full unit of bytes written and the reader
+        //  releases it for each full unit read, so that drained memory is
+        //  available at once, even to other pipes.
+        ctx_t *budget_ctx;
+        uint64_t charged_units;
+        uint64_t released_units;
+
+        //  Charges or releases budget units as bytes_written changed.
+        void update_charge ();
+
+        //  Computes the byte count after which the reader reports its
+        //  progress to the writer.
+        void compute_lwm_bytes (int64_t hwm_);
+
         //  The pipe object on the other side of the pipepair.
         pipe_t *peer;
 
@@ -242,6 +308,7 @@ namespace zmq
         static int compute_lwm (int hwm_);
 
         const bool conflate;
+        const bool conflate_topic;
 
         //  Disable copying.
         pipe_t (const pipe_t&);
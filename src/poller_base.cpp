@@ -76,25 +76,44 @@ void zmq::poller_base_t::cancel_timer (i_poll_events *sink_, int id_)
     zmq_assert (false);
 }
 
+void zmq::poller_base_t::arm_heartbeat (
+    heartbeat_scheduler_t::entry_t *entry_, int timeout_)
+{
+    heartbeats.arm (entry_, clock.now_ms () + timeout_);
+}
+
+void zmq::poller_base_t::disarm_heartbeat (
+    heartbeat_scheduler_t::entry_t *entry_)
+{
+    heartbeats.disarm (entry_);
+}
+
 uint64_t zmq::poller_base_t::execute_timers ()
 {
     //  Fast track.
-    if (timers.empty ())
+    if (timers.empty () && heartbeats.empty ())
         return 0;
 
     //  Get the current time.
     uint64_t current = clock.now_ms ();
 
+    //  Sweep the heartbeats that are due. This may add timers, so do it
+    //  before executing them.
+    heartbeats.execute (current);
+
     //   Execute the timers that are already due.
+    uint64_t res = 0;
     timers_t::iterator it = timers.begin ();
     while (it != timers.end ()) {
 
         //  If we have to wait to execute the item, same will be true about
         //  all the following items (multimap is sorted). Thus we can stop
-        //  checking the subsequent timers and return the time to wait for
+        //  checking the subsequent timers and compute the time to wait for
         //  the next timer (at least 1ms).
-        if (it->first > current)
-            return it->first - current;
+        if (it->first > current) {
+            res = it->first - current;
+            break;
+        }
 
         //  Trigger the timer.
         it->second.sink->timer_event (it->second.id);
@@ -105,6 +124,10 @@ uint64_t zmq::poller_base_t::execute_timers ()
         timers.erase (o);
     }
 
-    //  There are no more timers.
-    return 0;
+    //  Wake up in time for the next heartbeat as well.
+    const uint64_t heartbeats_wait = heartbeats.wait (current);
+    if (heartbeats_wait != 0 && (res == 0 || heartbeats_wait < res))
+        res = heartbeats_wait;
+
+    return res;
 }
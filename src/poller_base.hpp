@@ -34,6 +34,7 @@
 
 #include "clock.hpp"
 #include "atomic_counter.hpp"
+#include "heartbeat_scheduler.hpp"
 
 namespace zmq
 {
@@ -59,6 +60,14 @@ namespace zmq
         //  Cancel the timer created by sink_ object with ID equal to id_.
         void cancel_timer (zmq::i_poll_events *sink_, int id_);
 
+        //  Arm the heartbeat entry to expire in timeout_ milliseconds,
+        //  replacing its previous expiration, see heartbeat_scheduler_t.
+        void arm_heartbeat (heartbeat_scheduler_t::entry_t *entry_,
+            int timeout_);
+
+        //  Disarm the heartbeat entry if it is armed.
+        void disarm_heartbeat (heartbeat_scheduler_t::entry_t *entry_);
+
     protected:
 
         //  Called by individual poller implementations to manage the load.
@@ -82,6 +91,9 @@ namespace zmq
         typedef std::multimap <uint64_t, timer_info_t> timers_t;
         timers_t timers;
 
+        //  Heartbeat deadlines of the engines living in this thread.
+        heartbeat_scheduler_t heartbeats;
+
         //  Load of the poller. Currently the number of file descriptors
         //  registered.
         atomic_counter_t load;
@@ -39,6 +39,7 @@
 
 #include "precompiled.hpp"
 #include <stddef.h>
+#include <deque>
 #include "poller.hpp"
 #include "proxy.hpp"
 #include "likely.hpp"
@@ -50,6 +51,10 @@
 // These headers end up pulling in zmq.h somewhere in their include
 // dependency chain
 #include "socket_base.hpp"
+#include "ctx.hpp"
+#include "config.hpp"
+#include "thread.hpp"
+#include "clock.hpp"
 #include "err.hpp"
 
 #ifdef ZMQ_HAVE_POLLER
@@ -82,6 +87,65 @@
 
 #endif //  ZMQ_HAVE_POLLER
 
+//  Message and byte counters of one proxied socket, reported by the
+//  STATISTICS command. A multipart message counts as one message.
+struct proxy_socket_stats_t
+{
+    uint64_t msg_in;
+    uint64_t bytes_in;
+    uint64_t msg_out;
+    uint64_t bytes_out;
+};
+
+//  Number of buckets in a proxy histogram. Bucket 0 counts zero values and
+//  bucket i counts values in [2^(i-1), 2^i); the last one is open ended.
+static const int proxy_histogram_buckets = 32;
+
+//  Distributions sampled for one direction, reported by the HISTOGRAMS
+//  command.
+struct proxy_histograms_t
+{
+    //  Time from receiving the first part of a message to having sent its
+    //  last part, in microseconds.
+    uint64_t latency [proxy_histogram_buckets];
+
+    //  Number of messages found queued on the source socket per wake-up.
+    uint64_t depth [proxy_histogram_buckets];
+};
+
+struct proxy_stats_t
+{
+    proxy_socket_stats_t frontend;
+    proxy_socket_stats_t backend;
+
+    //  Histograms are only collected after a SAMPLE command.
+    bool sampling;
+    proxy_histograms_t requests;    //  frontend -> backend
+    proxy_histograms_t replies;     //  backend -> frontend
+};
+
+//  A STATISTICS or HISTOGRAMS command the frontend half of a threaded proxy
+//  has relayed to the other half and not answered yet. The local counters
+//  are taken when the command arrives, so that the reply reflects that
+//  moment rather than the moment the other half gets round to answering.
+struct proxy_pending_reply_t
+{
+    bool histograms;
+    proxy_stats_t stats;
+};
+
+typedef std::deque <proxy_pending_reply_t> proxy_pending_replies_t;
+
+static void histogram_add (uint64_t *histogram_, uint64_t value_)
+{
+    int bucket = 0;
+    while (value_ && bucket < proxy_histogram_buckets - 1) {
+        value_ >>= 1;
+        bucket++;
+    }
+    histogram_ [bucket]++;
+}
+
 int capture (
         class zmq::socket_base_t *capture_,
         zmq::msg_t& msg_,
@@ -103,18 +167,34 @@ int capture (
     return 0;
 }
 
-int forward (
+//  Forwards a single, possibly multipart, message. Returns 1 if
+//  'dontwait_' is set and there is nothing to forward.
+int forward_one (
         class zmq::socket_base_t *from_,
+        proxy_socket_stats_t *from_stats_,
         class zmq::socket_base_t *to_,
+        proxy_socket_stats_t *to_stats_,
         class zmq::socket_base_t *capture_,
-        zmq::msg_t& msg_)
+        zmq::msg_t& msg_,
+        proxy_histograms_t *histograms_,
+        bool dontwait_)
 {
     int more;
     size_t moresz;
+    size_t complete_msg_size = 0;
+    uint64_t start = 0;
     while (true) {
-        int rc = from_->recv (&msg_, 0);
-        if (unlikely (rc < 0))
+        //  Parts of a multipart message are always available together,
+        //  so only the first one may find nothing to receive.
+        int rc = from_->recv (&msg_, dontwait_ ? ZMQ_DONTWAIT : 0);
+        if (unlikely (rc < 0)) {
+            if (dontwait_ && errno == EAGAIN)
+                return 1;
             return -1;
+        }
+        if (histograms_ && start == 0)
+            start = zmq::clock_t::now_us ();
+        complete_msg_size += msg_.size ();
 
         moresz = sizeof more;
         rc = from_->getsockopt (ZMQ_RCVMORE, &more, &moresz);
@@ -132,16 +212,208 @@ int forward (
         if (more == 0)
             break;
     }
+
+    from_stats_->msg_in++;
+    from_stats_->bytes_in += complete_msg_size;
+    to_stats_->msg_out++;
+    to_stats_->bytes_out += complete_msg_size;
+    if (histograms_)
+        histogram_add (histograms_->latency, zmq::clock_t::now_us () - start);
+    return 0;
+}
+
+int forward (
+        class zmq::socket_base_t *from_,
+        proxy_socket_stats_t *from_stats_,
+        class zmq::socket_base_t *to_,
+        proxy_socket_stats_t *to_stats_,
+        class zmq::socket_base_t *capture_,
+        zmq::msg_t& msg_,
+        proxy_histograms_t *histograms_)
+{
+    //  Forward a burst of messages per wake-up, for as long as there is
+    //  queued input and the destination accepts it. The first message
+    //  was announced by the poller.
+    int i;
+    for (i = 0; i < zmq::proxy_burst_size; i++) {
+        if (i > 0 && from_ != to_ && !to_->has_out ())
+            break;
+
+        int rc = forward_one (from_, from_stats_, to_, to_stats_, capture_,
+            msg_, histograms_, i > 0);
+        if (unlikely (rc < 0))
+            return -1;
+        if (rc > 0)
+            break;
+    }
+    if (histograms_)
+        histogram_add (histograms_->depth, i);
     return 0;
 }
 
+//  Sends 'frames_' frames of 'frame_size_' bytes each, taken from 'data_'.
+static int send_frames (
+        class zmq::socket_base_t *to_,
+        const void *data_,
+        size_t frame_size_,
+        int frames_)
+{
+    const unsigned char *data = static_cast <const unsigned char *> (data_);
+    for (int i = 0; i != frames_; i++) {
+        zmq::msg_t msg;
+        int rc = msg.init_size (frame_size_);
+        if (unlikely (rc < 0))
+            return -1;
+        memcpy (msg.data (), data + i * frame_size_, frame_size_);
+        rc = to_->send (&msg, i < frames_ - 1 ? ZMQ_SNDMORE : 0);
+        if (unlikely (rc < 0))
+            return close_and_return (&msg, -1);
+    }
+    return 0;
+}
+
+//  Receives the reply sent by send_frames on the other end of 'from_'.
+static int recv_frames (
+        class zmq::socket_base_t *from_,
+        void *data_,
+        size_t frame_size_,
+        int frames_)
+{
+    unsigned char *data = static_cast <unsigned char *> (data_);
+    zmq::msg_t msg;
+    int rc = msg.init ();
+    if (unlikely (rc < 0))
+        return -1;
+    for (int i = 0; i != frames_; i++) {
+        rc = from_->recv (&msg, 0);
+        if (unlikely (rc < 0))
+            return close_and_return (&msg, -1);
+
+        //  The other half stopped on an error before replying.
+        if (i == 0 && msg.size () == 0) {
+            errno = EFAULT;
+            return close_and_return (&msg, -1);
+        }
+        zmq_assert (msg.size () == frame_size_);
+        memcpy (data + i * frame_size_, msg.data (), frame_size_);
+    }
+    return close_and_return (&msg, 0);
+}
+
+//  Replies to STATISTICS with eight 64-bit frames: messages in, bytes in,
+//  messages out and bytes out of the frontend, then of the backend. If the
+//  proxy is the frontend half of a threaded proxy, the backend counters are
+//  taken from the reply of the other half, read from 'control_relay_'.
+int reply_statistics (
+        class zmq::socket_base_t *control_,
+        class zmq::socket_base_t *control_relay_,
+        const proxy_stats_t &stats_)
+{
+    uint64_t counters [8] = {
+        stats_.frontend.msg_in, stats_.frontend.bytes_in,
+        stats_.frontend.msg_out, stats_.frontend.bytes_out,
+        stats_.backend.msg_in, stats_.backend.bytes_in,
+        stats_.backend.msg_out, stats_.backend.bytes_out
+    };
+    if (control_relay_) {
+        uint64_t relayed [8];
+        int rc = recv_frames (control_relay_, relayed, sizeof (uint64_t), 8);
+        if (unlikely (rc < 0))
+            return -1;
+        memcpy (counters + 4, relayed + 4, 4 * sizeof (uint64_t));
+    }
+    return send_frames (control_, counters, sizeof (uint64_t), 8);
+}
+
+//  Replies to HISTOGRAMS with four frames of proxy_histogram_buckets 64-bit
+//  counters: request latency, request queue depth, reply latency and reply
+//  queue depth. The halves of a threaded proxy sample one direction each.
+int reply_histograms (
+        class zmq::socket_base_t *control_,
+        class zmq::socket_base_t *control_relay_,
+        const proxy_stats_t &stats_)
+{
+    uint64_t histograms [4][proxy_histogram_buckets];
+    memcpy (histograms [0], stats_.requests.latency, sizeof histograms [0]);
+    memcpy (histograms [1], stats_.requests.depth, sizeof histograms [1]);
+    memcpy (histograms [2], stats_.replies.latency, sizeof histograms [2]);
+    memcpy (histograms [3], stats_.replies.depth, sizeof histograms [3]);
+    if (control_relay_) {
+        uint64_t relayed [4][proxy_histogram_buckets];
+        int rc = recv_frames (control_relay_, relayed, sizeof relayed [0], 4);
+        if (unlikely (rc < 0))
+            return -1;
+        memcpy (histograms [2], relayed [2], 2 * sizeof relayed [0]);
+    }
+    return send_frames (control_, histograms, sizeof histograms [0], 4);
+}
+
+//  Answers a STATISTICS or HISTOGRAMS command. The frontend half of a
+//  threaded proxy cannot answer before the other half has, so it queues
+//  the command and keeps proxying; reply_relayed answers it later.
+static int reply_command (
+        class zmq::socket_base_t *control_,
+        class zmq::socket_base_t *control_relay_,
+        proxy_pending_replies_t &pending_,
+        bool histograms_,
+        const proxy_stats_t &stats_)
+{
+    if (control_relay_) {
+        proxy_pending_reply_t reply;
+        reply.histograms = histograms_;
+        reply.stats = stats_;
+        pending_.push_back (reply);
+        return 0;
+    }
+    return histograms_ ? reply_histograms (control_, NULL, stats_) :
+        reply_statistics (control_, NULL, stats_);
+}
+
+//  Answers the oldest queued command once the other half of a threaded
+//  proxy has replied to it. Replies come back in the order the commands
+//  were relayed in. An empty message instead means that the other half
+//  has stopped on an error; proxy_threaded reports that error.
+static int reply_relayed (
+        class zmq::socket_base_t *control_,
+        class zmq::socket_base_t *control_relay_,
+        proxy_pending_replies_t &pending_)
+{
+    if (pending_.empty ()) {
+        zmq::msg_t msg;
+        int rc = msg.init ();
+        if (unlikely (rc < 0))
+            return -1;
+        rc = control_relay_->recv (&msg, 0);
+        if (unlikely (rc < 0))
+            return close_and_return (&msg, -1);
+        zmq_assert (msg.size () == 0);
+        errno = EFAULT;
+        return close_and_return (&msg, -1);
+    }
+    const proxy_pending_reply_t &reply = pending_.front ();
+    const int rc = reply.histograms ?
+        reply_histograms (control_, control_relay_, reply.stats) :
+        reply_statistics (control_, control_relay_, reply.stats);
+    pending_.pop_front ();
+    return rc;
+}
+
+//  Starts (or restarts) sampling the histograms.
+void start_sampling (proxy_stats_t &stats_)
+{
+    memset (&stats_.requests, 0, sizeof stats_.requests);
+    memset (&stats_.replies, 0, sizeof stats_.replies);
+    stats_.sampling = true;
+}
+
 #ifdef ZMQ_HAVE_POLLER
 
 int zmq::proxy (
     class socket_base_t *frontend_,
     class socket_base_t *backend_,
     class socket_base_t *capture_,
-    class socket_base_t *control_)
+    class socket_base_t *control_,
+    class socket_base_t *control_relay_)
 {
     msg_t msg;
     int rc = msg.init ();
@@ -151,6 +423,10 @@ int zmq::proxy (
     //  The algorithm below assumes ratio of requests and replies processed
     //  under full load to be 1:1.
 
+    proxy_stats_t stats;
+    memset (&stats, 0, sizeof stats);
+    proxy_pending_replies_t pending;
+
     int more;
     size_t moresz = sizeof (more);
 
@@ -167,7 +443,8 @@ int zmq::proxy (
     bool backend_in = false;
     bool backend_out = false;
     bool control_in = false;
-    zmq::socket_poller_t::event_t events [3];
+    bool relay_in = false;
+    zmq::socket_poller_t::event_t events [4];
 
     //  Don't allocate these pollers from stack because they will take more than 900 kB of stack!
     //  On Windows this blows up default stack of 1 MB and aborts the program.
@@ -260,6 +537,30 @@ int zmq::proxy (
         }
     }
 
+    //  Register 'control_relay_' with pollers, so that replies of the other
+    //  half are forwarded, and its stopping noticed, whatever state the
+    //  proxy is in.
+    if (control_relay_ != NULL) {
+        rc = poller_all->add (control_relay_, NULL, ZMQ_POLLIN);
+        CHECK_RC_EXIT_ON_FAILURE ();
+        rc = poller_in->add (control_relay_, NULL, ZMQ_POLLIN);
+        CHECK_RC_EXIT_ON_FAILURE ();
+        rc = poller_control->add (control_relay_, NULL, ZMQ_POLLIN);
+        CHECK_RC_EXIT_ON_FAILURE ();
+        rc = poller_receive_blocked->add (control_relay_, NULL, ZMQ_POLLIN);
+        CHECK_RC_EXIT_ON_FAILURE ();
+        if (!frontend_equal_to_backend) {
+            rc = poller_send_blocked->add (control_relay_, NULL, ZMQ_POLLIN);
+            CHECK_RC_EXIT_ON_FAILURE ();
+            rc = poller_both_blocked->add (control_relay_, NULL, ZMQ_POLLIN);
+            CHECK_RC_EXIT_ON_FAILURE ();
+            rc = poller_frontend_only->add (control_relay_, NULL, ZMQ_POLLIN);
+            CHECK_RC_EXIT_ON_FAILURE ();
+            rc = poller_backend_only->add (control_relay_, NULL, ZMQ_POLLIN);
+            CHECK_RC_EXIT_ON_FAILURE ();
+        }
+    }
+
 
     int i;
     bool request_processed, reply_processed;
@@ -270,13 +571,13 @@ int zmq::proxy (
         //  Blocking wait initially only for 'ZMQ_POLLIN' - 'poller_wait' points to 'poller_in'.
         //  If one of receiving end's queue is full ('ZMQ_POLLOUT' not available),
         //  'poller_wait' is pointed to 'poller_receive_blocked', 'poller_send_blocked' or 'poller_both_blocked'.
-        rc = poller_wait->wait (events, 3, -1);
+        rc = poller_wait->wait (events, 4, -1);
         if (rc < 0 && errno == ETIMEDOUT)
             rc = 0;
         CHECK_RC_EXIT_ON_FAILURE ();
 
         //  Some of events waited for by 'poller_wait' have arrived, now poll for everything without blocking.
-        rc = poller_all->wait (events, 3, 0);
+        rc = poller_all->wait (events, 4, 0);
         if (rc < 0 && errno == ETIMEDOUT)
             rc = 0;
         CHECK_RC_EXIT_ON_FAILURE ();
@@ -295,6 +596,16 @@ int zmq::proxy (
                 } else
                     if (events [i].socket == control_)
                         control_in = (events [i].events & ZMQ_POLLIN) != 0;
+                    else
+                        if (events [i].socket == control_relay_)
+                            relay_in = (events [i].events & ZMQ_POLLIN) != 0;
+        }
+
+        //  Forward a reply of the other half of a threaded proxy if any.
+        if (relay_in) {
+            rc = reply_relayed (control_, control_relay_, pending);
+            CHECK_RC_EXIT_ON_FAILURE ();
+            relay_in = false;
         }
 
 
@@ -312,6 +623,10 @@ int zmq::proxy (
             rc = capture (capture_, msg);
             CHECK_RC_EXIT_ON_FAILURE ();
 
+            //  Pass the command on to the other half of a threaded proxy.
+            rc = capture (control_relay_, msg);
+            CHECK_RC_EXIT_ON_FAILURE ();
+
             if (msg.size () == 5 && memcmp (msg.data (), "PAUSE", 5) == 0) {
                 state = paused;
                 poller_wait = poller_control;
@@ -322,6 +637,19 @@ int zmq::proxy (
                 } else {
                     if (msg.size () == 9 && memcmp (msg.data (), "TERMINATE", 9) == 0)
                         state = terminated;
+                    else
+                    if (msg.size () == 10 && memcmp (msg.data (), "STATISTICS", 10) == 0) {
+                        rc = reply_command (control_, control_relay_,
+                            pending, false, stats);
+                        CHECK_RC_EXIT_ON_FAILURE ();
+                    } else
+                    if (msg.size () == 10 && memcmp (msg.data (), "HISTOGRAMS", 10) == 0) {
+                        rc = reply_command (control_, control_relay_,
+                            pending, true, stats);
+                        CHECK_RC_EXIT_ON_FAILURE ();
+                    } else
+                    if (msg.size () == 6 && memcmp (msg.data (), "SAMPLE", 6) == 0)
+                        start_sampling (stats);
                     else {
                         //  This is an API error, we assert
                         puts ("E: invalid command sent to proxy");
@@ -336,7 +664,8 @@ int zmq::proxy (
             //  Process a request, 'ZMQ_POLLIN' on 'frontend_' and 'ZMQ_POLLOUT' on 'backend_'.
             //  In case of frontend_==backend_ there's no 'ZMQ_POLLOUT' event.
             if (frontend_in && (backend_out || frontend_equal_to_backend)) {
-                rc = forward (frontend_, backend_, capture_, msg);
+                rc = forward (frontend_, &stats.frontend, backend_, &stats.backend,
+                    capture_, msg, stats.sampling ? &stats.requests : NULL);
                 CHECK_RC_EXIT_ON_FAILURE ();
                 request_processed = true;
                 frontend_in = backend_out = false;
@@ -347,7 +676,8 @@ int zmq::proxy (
             //  covers all of the cases. 'backend_in' is always false if frontend_==backend_ due to
             //  design in 'for' event processing loop.
             if (backend_in && frontend_out) {
-                rc = forward (backend_, frontend_, capture_, msg);
+                rc = forward (backend_, &stats.backend, frontend_, &stats.frontend,
+                    capture_, msg, stats.sampling ? &stats.replies : NULL);
                 CHECK_RC_EXIT_ON_FAILURE ();
                 reply_processed = true;
                 backend_in = frontend_out = false;
@@ -420,7 +750,8 @@ int zmq::proxy (
     class socket_base_t *frontend_,
     class socket_base_t *backend_,
     class socket_base_t *capture_,
-    class socket_base_t *control_)
+    class socket_base_t *control_,
+    class socket_base_t *control_relay_)
 {
     msg_t msg;
     int rc = msg.init ();
@@ -430,14 +761,23 @@ int zmq::proxy (
     //  The algorithm below assumes ratio of requests and replies processed
     //  under full load to be 1:1.
 
+    proxy_stats_t stats;
+    memset (&stats, 0, sizeof stats);
+    proxy_pending_replies_t pending;
+
     int more;
     size_t moresz;
     zmq_pollitem_t items [] = {
         { frontend_, 0, ZMQ_POLLIN, 0 },
         { backend_, 0, ZMQ_POLLIN, 0 },
-        { control_, 0, ZMQ_POLLIN, 0 }
+        { control_, 0, ZMQ_POLLIN, 0 },
+        { control_relay_, 0, ZMQ_POLLIN, 0 }
     };
-    int qt_poll_items = (control_ ? 3 : 2);
+    //  Without a control socket, the relay takes its place.
+    if (!control_)
+        items [2].socket = control_relay_;
+    const int relay_item = control_ ? 3 : 2;
+    const int qt_poll_items = 2 + (control_ ? 1 : 0) + (control_relay_ ? 1 : 0);
     zmq_pollitem_t itemsout [] = {
         { frontend_, 0, ZMQ_POLLOUT, 0 },
         { backend_, 0, ZMQ_POLLOUT, 0 }
@@ -466,6 +806,13 @@ int zmq::proxy (
             }
         }
 
+        //  Forward a reply of the other half of a threaded proxy if any
+        if (control_relay_ && items [relay_item].revents & ZMQ_POLLIN) {
+            rc = reply_relayed (control_, control_relay_, pending);
+            if (unlikely (rc < 0))
+                return close_and_return (&msg, -1);
+        }
+
         //  Process a control command if any
         if (control_ && items [2].revents & ZMQ_POLLIN) {
             rc = control_->recv (&msg, 0);
@@ -482,6 +829,11 @@ int zmq::proxy (
             if (unlikely (rc < 0))
                 return close_and_return (&msg, -1);
 
+            //  Pass the command on to the other half of a threaded proxy
+            rc = capture (control_relay_, msg);
+            if (unlikely (rc < 0))
+                return close_and_return (&msg, -1);
+
             if (msg.size () == 5 && memcmp (msg.data (), "PAUSE", 5) == 0)
                 state = paused;
             else
@@ -490,6 +842,21 @@ int zmq::proxy (
                 else
                     if (msg.size () == 9 && memcmp (msg.data (), "TERMINATE", 9) == 0)
                         state = terminated;
+                    else
+                    if (msg.size () == 10 && memcmp (msg.data (), "STATISTICS", 10) == 0) {
+                        rc = reply_command (control_, control_relay_,
+                            pending, false, stats);
+                        if (unlikely (rc < 0))
+                            return close_and_return (&msg, -1);
+                    } else
+                    if (msg.size () == 10 && memcmp (msg.data (), "HISTOGRAMS", 10) == 0) {
+                        rc = reply_command (control_, control_relay_,
+                            pending, true, stats);
+                        if (unlikely (rc < 0))
+                            return close_and_return (&msg, -1);
+                    } else
+                    if (msg.size () == 6 && memcmp (msg.data (), "SAMPLE", 6) == 0)
+                        start_sampling (stats);
                     else {
                         //  This is an API error, so we assert
                         puts ("E: invalid command sent to proxy");
@@ -500,7 +867,8 @@ int zmq::proxy (
         if (state == active
         && items [0].revents & ZMQ_POLLIN
         && (frontend_ == backend_ || itemsout [1].revents & ZMQ_POLLOUT)) {
-            rc = forward (frontend_, backend_, capture_, msg);
+            rc = forward (frontend_, &stats.frontend, backend_, &stats.backend,
+                capture_, msg, stats.sampling ? &stats.requests : NULL);
             if (unlikely (rc < 0))
                 return close_and_return (&msg, -1);
         }
@@ -509,7 +877,8 @@ int zmq::proxy (
         &&  frontend_ != backend_
         &&  items [1].revents & ZMQ_POLLIN
         &&  itemsout [0].revents & ZMQ_POLLOUT) {
-            rc = forward (backend_, frontend_, capture_, msg);
+            rc = forward (backend_, &stats.backend, frontend_, &stats.frontend,
+                capture_, msg, stats.sampling ? &stats.replies : NULL);
             if (unlikely (rc < 0))
                 return close_and_return (&msg, -1);
         }
@@ -519,3 +888,113 @@ int zmq::proxy (
 }
 
 #endif //  ZMQ_HAVE_POLLER
+
+namespace
+{
+    //  The half of a threaded proxy that runs in its own thread, and the
+    //  result and errno it stopped with.
+    struct proxy_half_t
+    {
+        zmq::socket_base_t *pair;
+        zmq::socket_base_t *backend;
+        zmq::socket_base_t *control;
+        int rc;
+        int err;
+    };
+
+    void proxy_half_routine (void *arg_)
+    {
+        proxy_half_t *half = (proxy_half_t*) arg_;
+        half->rc = zmq::proxy (half->pair, half->backend, NULL, half->control);
+        half->err = errno;
+
+        //  On failure, stop the calling thread's half too. It tells the
+        //  empty message apart from the replies to relayed commands.
+        if (half->rc != 0) {
+            zmq::msg_t msg;
+            int rc = msg.init ();
+            errno_assert (rc == 0);
+            rc = half->control->send (&msg, ZMQ_DONTWAIT);
+            if (rc != 0) {
+                rc = msg.close ();
+                errno_assert (rc == 0);
+            }
+        }
+    }
+}
+
+int zmq::proxy_threaded (
+    class socket_base_t *frontend_,
+    class socket_base_t *backend_,
+    class socket_base_t *capture_,
+    class socket_base_t *control_)
+{
+    if (frontend_ == backend_)
+        return proxy (frontend_, backend_, capture_, control_);
+
+    //  Each thread owns one of the user's sockets. Messages cross between
+    //  the threads over an inproc PAIR, i.e. a lock-free pipe, and control
+    //  commands are relayed over a second one.
+    enum {front_data, back_data, front_control, back_control, count};
+    ctx_t *ctx = frontend_->get_ctx ();
+    socket_base_t *pairs [count] = {NULL, NULL, NULL, NULL};
+    int rc = 0;
+    for (int i = 0; i != count && rc == 0; i++) {
+        pairs [i] = ctx->create_socket (ZMQ_PAIR);
+        if (!pairs [i]) {
+            rc = -1;
+            break;
+        }
+        const int linger = 0;
+        rc = pairs [i]->setsockopt (ZMQ_LINGER, &linger, sizeof linger);
+    }
+
+    char endpoint [64];
+    for (int i = 0; i != count && rc == 0; i += 2) {
+        snprintf (endpoint, sizeof endpoint, "inproc://zmq-proxy-%p",
+            (void*) pairs [i]);
+        rc = pairs [i]->bind (endpoint);
+        if (rc == 0)
+            rc = pairs [i + 1]->connect (endpoint);
+    }
+
+    if (rc == 0) {
+        proxy_half_t half = {pairs [back_data], backend_, pairs [back_control],
+            0, 0};
+        thread_t thread;
+        thread.start (proxy_half_routine, &half);
+
+        rc = proxy (frontend_, pairs [front_data], capture_, control_,
+            pairs [front_control]);
+
+        //  On failure the other half has not been told to stop yet.
+        if (rc != 0) {
+            const int err = errno;
+            msg_t msg;
+            int rc2 = msg.init_size (9);
+            errno_assert (rc2 == 0);
+            memcpy (msg.data (), "TERMINATE", 9);
+            rc2 = pairs [front_control]->send (&msg, ZMQ_DONTWAIT);
+            if (rc2 != 0) {
+                rc2 = msg.close ();
+                errno_assert (rc2 == 0);
+            }
+            errno = err;
+        }
+        thread.stop ();
+
+        //  If the other half failed, its error is what stopped this one.
+        if (half.rc != 0) {
+            rc = -1;
+            errno = half.err;
+        }
+    }
+
+    const int err = errno;
+    for (int i = 0; i != count; i++)
+        if (pairs [i])
+            pairs [i]->close ();
+    errno = err;
+    return rc;
+}
+
@@ -36,7 +36,16 @@ namespace zmq
         class socket_base_t *frontend_,
         class socket_base_t *backend_,
         class socket_base_t *capture_,
-        class socket_base_t *control_ = NULL); // backward compatibility without this argument
+        class socket_base_t *control_ = NULL, // backward compatibility without this argument
+        class socket_base_t *control_relay_ = NULL);
+
+    //  Same as proxy, but frontend and backend are served by two
+    //  threads, the calling one and a helper thread.
+    int proxy_threaded (
+        class socket_base_t *frontend_,
+        class socket_base_t *backend_,
+        class socket_base_t *capture_,
+        class socket_base_t *control_);
 }
 
 #endif
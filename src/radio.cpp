@@ -147,6 +147,11 @@ bool zmq::radio_t::xhas_out ()
     return dist.has_out ();
 }
 
+void zmq::radio_t::xstats (zmq_socket_stats_t *stats_)
+{
+    stats_->hwm_drops += dist.get_dropped ();
+}
+
 int zmq::radio_t::xrecv (msg_t *msg_)
 {
     //  Messages cannot be received from PUB socket.
@@ -65,6 +65,7 @@ namespace zmq
         void xread_activated (zmq::pipe_t *pipe_);
         void xwrite_activated (zmq::pipe_t *pipe_);
         void xpipe_terminated (zmq::pipe_t *pipe_);
+        void xstats (zmq_socket_stats_t *stats_);
 
     private:
         //  List of all subscriptions mapped to corresponding pipes.
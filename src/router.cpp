@@ -229,13 +229,19 @@ int zmq::router_t::xsend (msg_t *msg_)
                             errno = EHOSTUNREACH;
                         return -1;
                     }
+                    if (pipe_full)
+                        stats.hwm_drops++;
+                    else
+                        stats.unroutable_drops++;
                 }
             }
-            else
-            if (mandatory) {
-                more_out = false;
-                errno = EHOSTUNREACH;
-                return -1;
+            else {
+                if (mandatory) {
+                    more_out = false;
+                    errno = EHOSTUNREACH;
+                    return -1;
+                }
+                stats.unroutable_drops++;
             }
         }
 
@@ -34,9 +34,11 @@
 #include "err.hpp"
 #include "pipe.hpp"
 #include "likely.hpp"
+#include "trace.hpp"
 #include "tcp_connecter.hpp"
 #include "ipc_connecter.hpp"
 #include "tipc_connecter.hpp"
+#include "shm_connecter.hpp"
 #include "socks_connecter.hpp"
 #include "vmci_connecter.hpp"
 #include "pgm_sender.hpp"
@@ -153,6 +155,7 @@ int zmq::session_base_t::pull_msg (msg_t *msg_)
     }
 
     incomplete_in = msg_->flags () & msg_t::more ? true : false;
+    zmq_trace2 (session_pull_msg, this, msg_->payload_size ());
 
     return 0;
 }
@@ -161,6 +164,7 @@ int zmq::session_base_t::push_msg (msg_t *msg_)
 {
     if(msg_->flags() & msg_t::command)
         return 0;
+    zmq_trace2 (session_push_msg, this, msg_->payload_size ());
     if (pipe && pipe->write (msg_)) {
         int rc = msg_->init ();
         errno_assert (rc == 0);
@@ -397,8 +401,15 @@ void zmq::session_base_t::process_attach (i_engine *engine_)
         int hwms [2] = {conflate? -1 : options.rcvhwm,
             conflate? -1 : options.sndhwm};
         bool conflates [2] = {conflate, conflate};
-        int rc = pipepair (parents, pipes, hwms, conflates);
+        int rc = pipepair (parents, pipes, hwms, conflates,
+            options.conflate_topic);
         errno_assert (rc == 0);
+        if (!conflate) {
+            pipes [0]->set_hwms_bytes (options.sndhwm_bytes,
+                options.rcvhwm_bytes);
+            pipes [1]->set_hwms_bytes (options.rcvhwm_bytes,
+                options.sndhwm_bytes);
+        }
 
         //  Plug the local end of the pipe.
         pipes [0]->set_event_sink (this);
@@ -573,6 +584,15 @@ void zmq::session_base_t::start_connecting (bool wait_)
         return;
     }
 #endif
+#if defined ZMQ_HAVE_SHM
+    if (addr->protocol == "shm") {
+        shm_connecter_t *connecter = new (std::nothrow) shm_connecter_t (
+            io_thread, this, options, addr, wait_);
+        alloc_assert (connecter);
+        launch_child (connecter);
+        return;
+    }
+#endif
 #if defined ZMQ_HAVE_TIPC
     if (addr->protocol == "tipc") {
         tipc_connecter_t *connecter = new (std::nothrow) tipc_connecter_t (
@@ -0,0 +1,363 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "precompiled.hpp"
+#include "shm_connecter.hpp"
+
+#if defined ZMQ_HAVE_SHM
+
+#include <new>
+#include <string>
+
+#include <string.h>
+
+#include "shm_engine.hpp"
+#include "io_thread.hpp"
+#include "random.hpp"
+#include "err.hpp"
+#include "ip.hpp"
+#include "address.hpp"
+#include "ipc_address.hpp"
+#include "session_base.hpp"
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+zmq::shm_connecter_t::shm_connecter_t (class io_thread_t *io_thread_,
+      class session_base_t *session_, const options_t &options_,
+      const address_t *addr_, bool delayed_start_) :
+    own_t (io_thread_, options_),
+    io_object_t (io_thread_),
+    addr (addr_),
+    s (retired_fd),
+    handle_valid (false),
+    connected (false),
+    delayed_start (delayed_start_),
+    timer_started (false),
+    session (session_),
+    current_reconnect_ivl(options.reconnect_ivl)
+{
+    zmq_assert (addr);
+    zmq_assert (addr->protocol == "shm");
+    addr->to_string (endpoint);
+    socket = session-> get_socket();
+}
+
+zmq::shm_connecter_t::~shm_connecter_t ()
+{
+    zmq_assert (!timer_started);
+    zmq_assert (!handle_valid);
+    zmq_assert (s == retired_fd);
+}
+
+void zmq::shm_connecter_t::process_plug ()
+{
+    if (delayed_start)
+        add_reconnect_timer ();
+    else
+        start_connecting ();
+}
+
+void zmq::shm_connecter_t::process_term (int linger_)
+{
+    if (timer_started) {
+        cancel_timer (reconnect_timer_id);
+        timer_started = false;
+    }
+
+    if (handle_valid) {
+        rm_fd (handle);
+        handle_valid = false;
+    }
+
+    if (s != retired_fd)
+        close ();
+
+    own_t::process_term (linger_);
+}
+
+void zmq::shm_connecter_t::in_event ()
+{
+    //  Until the connection is established we are not polling for
+    //  incoming data, so we are called because of an error.
+    if (!connected) {
+        out_event ();
+        return;
+    }
+
+    shm_segment_t segment;
+    const int rc = receive_segment (segment);
+    if (rc != 0 && errno == EAGAIN)
+        return;
+
+    rm_fd (handle);
+    handle_valid = false;
+    connected = false;
+
+    //  Handle the error condition by attempt to reconnect.
+    if (rc != 0) {
+        close ();
+        add_reconnect_timer ();
+        return;
+    }
+
+    //  Create the engine object for this connection.
+    const fd_t fd = s;
+    s = retired_fd;
+    shm_engine_t *engine = new (std::nothrow)
+        shm_engine_t (fd, segment, false, options, endpoint);
+    alloc_assert (engine);
+
+    //  Attach the engine to the corresponding session object.
+    send_attach (session, engine);
+
+    //  Shut the connecter down.
+    terminate ();
+
+    socket->event_connected (endpoint, fd);
+}
+
+void zmq::shm_connecter_t::out_event ()
+{
+    //  Handle the error condition by attempt to reconnect.
+    if (connect () != 0) {
+        rm_fd (handle);
+        handle_valid = false;
+        close ();
+        add_reconnect_timer();
+        return;
+    }
+
+    //  The listener sends the shared memory segment right after
+    //  accepting the connection; wait for it.
+    connected = true;
+    reset_pollout (handle);
+    set_pollin (handle);
+}
+
+void zmq::shm_connecter_t::timer_event (int id_)
+{
+    zmq_assert (id_ == reconnect_timer_id);
+    timer_started = false;
+    start_connecting ();
+}
+
+void zmq::shm_connecter_t::start_connecting ()
+{
+    //  Open the connecting socket.
+    int rc = open ();
+
+    //  Connect may succeed in synchronous manner.
+    if (rc == 0) {
+        handle = add_fd (s);
+        handle_valid = true;
+        out_event ();
+    }
+
+    //  Connection establishment may be delayed. Poll for its completion.
+    else
+    if (rc == -1 && errno == EINPROGRESS) {
+        handle = add_fd (s);
+        handle_valid = true;
+        set_pollout (handle);
+        socket->event_connect_delayed (endpoint, zmq_errno());
+    }
+
+    //  Handle any other error condition by eventual reconnect.
+    else {
+        if (s != retired_fd)
+            close ();
+        add_reconnect_timer ();
+    }
+}
+
+void zmq::shm_connecter_t::add_reconnect_timer()
+{
+    int rc_ivl = get_new_reconnect_ivl();
+    add_timer (rc_ivl, reconnect_timer_id);
+    socket->event_connect_retried (endpoint, rc_ivl);
+    timer_started = true;
+}
+
+int zmq::shm_connecter_t::get_new_reconnect_ivl ()
+{
+    //  The new interval is the current interval + random value.
+    int this_interval = current_reconnect_ivl +
+        (generate_random () % options.reconnect_ivl);
+
+    //  Only change the current reconnect interval  if the maximum reconnect
+    //  interval was set and if it's larger than the reconnect interval.
+    if (options.reconnect_ivl_max > 0 &&
+        options.reconnect_ivl_max > options.reconnect_ivl) {
+
+        //  Calculate the next interval
+        current_reconnect_ivl = current_reconnect_ivl * 2;
+        if(current_reconnect_ivl >= options.reconnect_ivl_max) {
+            current_reconnect_ivl = options.reconnect_ivl_max;
+        }
+    }
+    return this_interval;
+}
+
+int zmq::shm_connecter_t::open ()
+{
+    zmq_assert (s == retired_fd);
+
+    ipc_address_t address;
+    int rc = shm_engine_t::resolve_address (addr->address, address);
+    if (rc != 0)
+        return -1;
+
+    //  Create the socket.
+    s = open_socket (AF_UNIX, SOCK_STREAM, 0);
+    if (s == -1)
+        return -1;
+
+    //  Set the non-blocking flag.
+    unblock_socket (s);
+
+    //  Connect to the remote peer.
+    rc = ::connect (s, address.addr (), address.addrlen ());
+
+    //  Connect was successful immediately.
+    if (rc == 0)
+        return 0;
+
+    //  Translate other error codes indicating asynchronous connect has been
+    //  launched to a uniform EINPROGRESS.
+    if (rc == -1 && errno == EINTR) {
+        errno = EINPROGRESS;
+        return -1;
+    }
+
+    //  Forward the error.
+    return -1;
+}
+
+int zmq::shm_connecter_t::close ()
+{
+    zmq_assert (s != retired_fd);
+    int rc = ::close (s);
+    errno_assert (rc == 0);
+    socket->event_closed (endpoint, s);
+    s = retired_fd;
+    return 0;
+}
+
+int zmq::shm_connecter_t::connect ()
+{
+    int err = 0;
+    socklen_t len = sizeof (err);
+    int rc = getsockopt (s, SOL_SOCKET, SO_ERROR, (char*) &err, &len);
+    if (rc == -1)
+        err = errno;
+    if (err != 0) {
+
+        //  Assert if the error was caused by 0MQ bug.
+        //  Networking problems are OK. No need to assert.
+        errno = err;
+        errno_assert (errno == ECONNREFUSED || errno == ECONNRESET ||
+            errno == ETIMEDOUT || errno == EHOSTUNREACH ||
+            errno == ENETUNREACH || errno == ENETDOWN);
+
+        return -1;
+    }
+
+    return 0;
+}
+
+int zmq::shm_connecter_t::receive_segment (shm_segment_t &segment_)
+{
+    unsigned char byte;
+    struct iovec iov;
+    iov.iov_base = &byte;
+    iov.iov_len = 1;
+
+    union {
+        struct cmsghdr align;
+        unsigned char buf [CMSG_SPACE ((1 + shm_wake_fds) * sizeof (int))];
+    } control;
+
+    struct msghdr msg;
+    memset (&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof control.buf;
+
+    const ssize_t nbytes = recvmsg (s, &msg, MSG_CMSG_CLOEXEC);
+    if (nbytes == -1)
+        return -1;
+    if (nbytes == 0) {
+        errno = ECONNRESET;
+        return -1;
+    }
+
+    //  We expect the segment followed by its eventfds. Anything else
+    //  means we are not talking to a shm listener; whatever descriptors
+    //  did arrive are closed.
+    int fds [1 + shm_wake_fds];
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+    if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET ||
+          cmsg->cmsg_type != SCM_RIGHTS) {
+        errno = EPROTO;
+        return -1;
+    }
+    const size_t nfds = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+    if (nfds != 1 + shm_wake_fds || (msg.msg_flags & MSG_CTRUNC)) {
+        for (size_t i = 0; i != nfds; i++) {
+            int fd;
+            memcpy (&fd, CMSG_DATA (cmsg) + i * sizeof (int), sizeof (int));
+            int rc = ::close (fd);
+            errno_assert (rc == 0);
+        }
+        errno = EPROTO;
+        return -1;
+    }
+
+    memcpy (fds, CMSG_DATA (cmsg), sizeof fds);
+    int rc = shm_engine_t::map_segment (fds [0], segment_);
+    const int err = errno;
+    int rc2 = ::close (fds [0]);
+    errno_assert (rc2 == 0);
+    for (int i = 0; i != shm_wake_fds; i++) {
+        if (rc == 0)
+            *shm_engine_t::wake_fd (segment_, i) = fds [1 + i];
+        else {
+            rc2 = ::close (fds [1 + i]);
+            errno_assert (rc2 == 0);
+        }
+    }
+    errno = err;
+    return rc;
+}
+
+#endif
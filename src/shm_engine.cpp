@@ -0,0 +1,367 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "precompiled.hpp"
+#include "shm_engine.hpp"
+
+#if defined ZMQ_HAVE_SHM
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "err.hpp"
+#include "random.hpp"
+#include "ipc_address.hpp"
+
+namespace
+{
+    //  Layout of the segment: this header, padded to a cache line, then
+    //  for each ring its control block followed by its data.
+    struct shm_header_t
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t capacity [2];
+    };
+
+    const uint32_t shm_magic = 0x5a4d5153;
+    const uint32_t shm_version = 1;
+    const size_t shm_header_size = 64;
+
+    //  Smallest and largest ring we are willing to create or map.
+    const uint32_t shm_min_capacity = 4096;
+    const uint32_t shm_max_capacity = 1u << 30;
+
+    size_t ring_offset (const uint32_t *capacity_, int index_)
+    {
+        size_t offset = shm_header_size;
+        for (int i = 0; i != index_; i++)
+            offset += sizeof (zmq::shm_ring_ctl_t) + capacity_ [i];
+        return offset;
+    }
+
+    uint32_t ring_capacity (size_t size_)
+    {
+        uint32_t capacity = shm_min_capacity;
+        while (capacity < size_ && capacity < shm_max_capacity)
+            capacity <<= 1;
+        return capacity;
+    }
+
+    bool valid_capacity (uint32_t capacity_)
+    {
+        return capacity_ >= shm_min_capacity &&
+            capacity_ <= shm_max_capacity &&
+            !(capacity_ & (capacity_ - 1));
+    }
+}
+
+int zmq::shm_engine_t::resolve_address (const std::string &name_,
+    ipc_address_t &address_)
+{
+    if (name_.empty () || name_.find ('/') != std::string::npos) {
+        errno = EINVAL;
+        return -1;
+    }
+    return address_.resolve (("@zmq-shm-" + name_).c_str ());
+}
+
+zmq::fd_t zmq::shm_engine_t::create_segment (size_t to_connecter_,
+    size_t to_listener_)
+{
+    //  The segment is only ever reached through its descriptor, so the
+    //  name is removed as soon as the object exists.
+    char name [64];
+    fd_t fd = retired_fd;
+    for (int i = 0; i != 16 && fd == retired_fd; i++) {
+        snprintf (name, sizeof name, "/zmq-shm-%d-%u",
+            (int) getpid (), generate_random ());
+        fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd == -1 && errno != EEXIST)
+            return retired_fd;
+    }
+    if (fd == retired_fd)
+        return retired_fd;
+    int rc = shm_unlink (name);
+    errno_assert (rc == 0);
+
+    uint32_t capacity [2];
+    capacity [0] = ring_capacity (to_connecter_);
+    capacity [1] = ring_capacity (to_listener_);
+    const size_t size = ring_offset (capacity, 2);
+
+    rc = ftruncate (fd, size);
+    if (rc == 0) {
+        void *base = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            fd, 0);
+        if (base != MAP_FAILED) {
+            //  Freshly truncated memory is zeroed, which leaves both
+            //  rings empty.
+            shm_header_t *header = (shm_header_t*) base;
+            header->capacity [0] = capacity [0];
+            header->capacity [1] = capacity [1];
+            header->version = shm_version;
+            header->magic = shm_magic;
+            rc = munmap (base, size);
+            errno_assert (rc == 0);
+            return fd;
+        }
+    }
+
+    const int err = errno;
+    rc = close (fd);
+    errno_assert (rc == 0);
+    errno = err;
+    return retired_fd;
+}
+
+int zmq::shm_engine_t::map_segment (fd_t fd_, shm_segment_t &segment_)
+{
+    struct stat st;
+    int rc = fstat (fd_, &st);
+    if (rc == -1)
+        return -1;
+    if (st.st_size < (off_t) shm_header_size) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    const size_t size = (size_t) st.st_size;
+    void *base = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+        fd_, 0);
+    if (base == MAP_FAILED)
+        return -1;
+
+    //  Take a private copy of the layout; the peer can still write to the
+    //  header after we have checked it.
+    shm_header_t header;
+    memcpy (&header, base, sizeof header);
+    if (header.magic != shm_magic || header.version != shm_version ||
+          !valid_capacity (header.capacity [0]) ||
+          !valid_capacity (header.capacity [1]) ||
+          ring_offset (header.capacity, 2) != size) {
+        rc = munmap (base, size);
+        errno_assert (rc == 0);
+        errno = EPROTO;
+        return -1;
+    }
+
+    segment_.base = base;
+    segment_.size = size;
+    segment_.capacity [0] = header.capacity [0];
+    segment_.capacity [1] = header.capacity [1];
+    for (int i = 0; i != shm_wake_fds; i++)
+        *wake_fd (segment_, i) = retired_fd;
+    return 0;
+}
+
+zmq::fd_t *zmq::shm_engine_t::wake_fd (shm_segment_t &segment_, int index_)
+{
+    zmq_assert (index_ >= 0 && index_ < shm_wake_fds);
+    return index_ < 2 ? &segment_.data_wake [index_] :
+        &segment_.space_wake [index_ - 2];
+}
+
+int zmq::shm_engine_t::create_wake_fds (shm_segment_t &segment_)
+{
+    for (int i = 0; i != shm_wake_fds; i++) {
+        const fd_t fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd == -1)
+            return -1;
+        *wake_fd (segment_, i) = fd;
+    }
+    return 0;
+}
+
+void zmq::shm_engine_t::release_segment (shm_segment_t &segment_)
+{
+    int rc = munmap (segment_.base, segment_.size);
+    errno_assert (rc == 0);
+    for (int i = 0; i != shm_wake_fds; i++) {
+        const fd_t fd = *wake_fd (segment_, i);
+        if (fd != retired_fd) {
+            rc = ::close (fd);
+            errno_assert (rc == 0);
+        }
+    }
+}
+
+zmq::shm_engine_t::shm_engine_t (fd_t fd_, const shm_segment_t &segment_,
+      bool listener_, const options_t &options_,
+      const std::string &endpoint_) :
+    stream_engine_t (fd_, options_, endpoint_),
+    segment (segment_),
+    rx_data_handle (NULL),
+    tx_space_handle (NULL),
+    output_stalled (false)
+{
+    const int tx_ring = listener_ ? 0 : 1;
+    const int rx_ring = listener_ ? 1 : 0;
+    tx.attach ((unsigned char*) segment.base +
+        ring_offset (segment.capacity, tx_ring), segment.capacity [tx_ring]);
+    rx.attach ((unsigned char*) segment.base +
+        ring_offset (segment.capacity, rx_ring), segment.capacity [rx_ring]);
+    rx_data = segment.data_wake [rx_ring];
+    tx_space = segment.space_wake [tx_ring];
+    tx_data = segment.data_wake [tx_ring];
+    rx_space = segment.space_wake [rx_ring];
+}
+
+zmq::shm_engine_t::~shm_engine_t ()
+{
+    release_segment (segment);
+}
+
+void zmq::shm_engine_t::add_fds ()
+{
+    rx_data_handle = add_fd (rx_data);
+    tx_space_handle = add_fd (tx_space);
+    set_pollin (rx_data_handle);
+}
+
+void zmq::shm_engine_t::unplug ()
+{
+    rm_fd (rx_data_handle);
+    rm_fd (tx_space_handle);
+    stream_engine_t::unplug ();
+}
+
+void zmq::shm_engine_t::in_event ()
+{
+    //  Resume a stalled writer as soon as the peer has made some space.
+    if (output_stalled) {
+        drain (tx_space);
+        if (tx.writable ()) {
+            output_stalled = false;
+            reset_pollin (tx_space_handle);
+            set_pollout (handle);
+        }
+    }
+
+    if (!input_stopped)
+        stream_engine_t::in_event ();
+}
+
+int zmq::shm_engine_t::read (void *data_, size_t size_)
+{
+    //  The eventfd stays signalled for as long as the ring holds data,
+    //  so it is only drained once the ring looks empty. Look again
+    //  afterwards so that data written meanwhile is not missed.
+    if (rx.readable () == 0) {
+        drain (rx_data);
+        if (rx.readable () == 0)
+            return check_peer ();
+        wake_up (rx_data);
+    }
+
+    const size_t n = rx.read (data_, size_);
+
+    if (rx.check_writer_waiting ())
+        wake_up (rx_space);
+
+    return (int) n;
+}
+
+int zmq::shm_engine_t::write (const void *data_, size_t size_)
+{
+    bool was_empty;
+    size_t n = tx.write (data_, size_, was_empty);
+    if (n == 0) {
+        //  The ring is full. Ask the peer for a wake-up, then look again
+        //  in case it made space before noticing our request.
+        tx.set_writer_waiting ();
+        n = tx.write (data_, size_, was_empty);
+        if (n == 0) {
+            output_stalled = true;
+            reset_pollout (handle);
+            set_pollin (tx_space_handle);
+            return 0;
+        }
+    }
+
+    if (was_empty)
+        wake_up (tx_data);
+
+    return (int) n;
+}
+
+void zmq::shm_engine_t::stop_input ()
+{
+    stream_engine_t::stop_input ();
+    reset_pollin (rx_data_handle);
+}
+
+void zmq::shm_engine_t::resume_input ()
+{
+    stream_engine_t::resume_input ();
+    set_pollin (rx_data_handle);
+}
+
+int zmq::shm_engine_t::check_peer ()
+{
+    //  The peer never writes to the socket, so it only becomes readable
+    //  when the peer goes away.
+    unsigned char byte;
+    while (true) {
+        const ssize_t rc = ::recv (s, &byte, 1, MSG_DONTWAIT);
+        if (rc == 0) {
+            errno = EPIPE;
+            return 0;
+        }
+        if (rc == 1) {
+            errno = EPROTO;
+            return -1;
+        }
+        if (errno != EINTR)
+            return -1;
+    }
+}
+
+void zmq::shm_engine_t::wake_up (fd_t fd_)
+{
+    //  A counter about to overflow already holds wake-ups.
+    const uint64_t one = 1;
+    while (::write (fd_, &one, sizeof one) == -1 && errno == EINTR)
+        ;
+}
+
+void zmq::shm_engine_t::drain (fd_t fd_)
+{
+    uint64_t count;
+    while (::read (fd_, &count, sizeof count) == -1 && errno == EINTR)
+        ;
+}
+
+#endif
@@ -0,0 +1,163 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_SHM_ENGINE_HPP_INCLUDED__
+#define __ZMQ_SHM_ENGINE_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_SHM
+
+#include <stddef.h>
+
+#include <string>
+
+#include "fd.hpp"
+#include "stream_engine.hpp"
+#include "shm_ring.hpp"
+
+namespace zmq
+{
+
+    class ipc_address_t;
+
+    //  Shared memory segment of a shm:// connection as mapped into this
+    //  process. Ring 0 carries data from the listener to the connecter,
+    //  ring 1 from the connecter to the listener. For each ring, the
+    //  producer signals the 'data_wake' eventfd when the consumer may be
+    //  sleeping on an empty ring, and the consumer signals 'space_wake'
+    //  when the producer has stalled on a full one.
+
+    struct shm_segment_t
+    {
+        void *base;
+        size_t size;
+        uint32_t capacity [2];
+        fd_t data_wake [2];
+        fd_t space_wake [2];
+    };
+
+    //  Number of eventfds of a segment, in the order they are passed
+    //  to the peer.
+    enum { shm_wake_fds = 4 };
+
+    //  Engine for shm:// connections. The ZMTP byte stream is carried by
+    //  two rings in a shared memory segment, one per direction, and the
+    //  peers wake each other up through the segment's eventfds. The UNIX
+    //  domain socket the segment was exchanged over stays open only to
+    //  report the peer going away.
+
+    class shm_engine_t : public stream_engine_t
+    {
+    public:
+
+        //  Resolves a shm:// endpoint name to the abstract UNIX domain
+        //  socket address the segment is exchanged over.
+        static int resolve_address (const std::string &name_,
+            ipc_address_t &address_);
+
+        //  Creates an anonymous segment large enough for rings of the
+        //  given sizes. Returns the segment's file descriptor or
+        //  retired_fd on failure.
+        static fd_t create_segment (size_t to_connecter_, size_t to_listener_);
+
+        //  Maps the segment behind 'fd_' and validates its layout.
+        //  Returns -1 with errno set if the segment is unusable.
+        static int map_segment (fd_t fd_, shm_segment_t &segment_);
+
+        //  Creates the eventfds of the segment.
+        static int create_wake_fds (shm_segment_t &segment_);
+
+        //  Returns the eventfds in the order they are passed to the peer.
+        static fd_t *wake_fd (shm_segment_t &segment_, int index_);
+
+        //  Unmaps the segment and closes its eventfds.
+        static void release_segment (shm_segment_t &segment_);
+
+        //  Takes ownership of the socket, of the mapped segment and of
+        //  its eventfds. 'listener_' selects which of the two rings we
+        //  write to.
+        shm_engine_t (fd_t fd_, const shm_segment_t &segment_,
+            bool listener_, const options_t &options_,
+            const std::string &endpoint_);
+        ~shm_engine_t ();
+
+        //  i_poll_events interface implementation.
+        void in_event ();
+
+    protected:
+
+        int read (void *data_, size_t size_);
+        int write (const void *data_, size_t size_);
+        void stop_input ();
+        void resume_input ();
+        void add_fds ();
+        void unplug ();
+
+    private:
+
+        //  Returns 0 if the peer has closed the connection, -1 with
+        //  errno set to EAGAIN if it has not and -1 on error.
+        int check_peer ();
+
+        //  Adds a wake-up to the eventfd, and consumes all of them.
+        static void wake_up (fd_t fd_);
+        static void drain (fd_t fd_);
+
+        //  Mapped segment.
+        shm_segment_t segment;
+
+        //  The eventfds we wait on: data in the ring we read from and
+        //  space in the ring we write to. Each has its own handle.
+        fd_t rx_data;
+        fd_t tx_space;
+        handle_t rx_data_handle;
+        handle_t tx_space_handle;
+
+        //  The eventfds the peer waits on.
+        fd_t tx_data;
+        fd_t rx_space;
+
+        //  Ring we write to and ring we read from.
+        shm_ring_t tx;
+        shm_ring_t rx;
+
+        //  True iff the last write found the ring full and we wait for
+        //  the peer to make some space.
+        bool output_stalled;
+
+        shm_engine_t (const shm_engine_t&);
+        const shm_engine_t &operator = (const shm_engine_t&);
+    };
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,281 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "precompiled.hpp"
+#include "shm_listener.hpp"
+
+#if defined ZMQ_HAVE_SHM
+
+#include <new>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "shm_engine.hpp"
+#include "ipc_address.hpp"
+#include "io_thread.hpp"
+#include "session_base.hpp"
+#include "config.hpp"
+#include "err.hpp"
+#include "ip.hpp"
+#include "random.hpp"
+#include "socket_base.hpp"
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+
+zmq::shm_listener_t::shm_listener_t (io_thread_t *io_thread_,
+      socket_base_t *socket_, const options_t &options_) :
+    own_t (io_thread_, options_),
+    io_object_t (io_thread_),
+    s (retired_fd),
+    socket (socket_)
+{
+}
+
+zmq::shm_listener_t::~shm_listener_t ()
+{
+    zmq_assert (s == retired_fd);
+}
+
+void zmq::shm_listener_t::process_plug ()
+{
+    //  Start polling for incoming connections.
+    handle = add_fd (s);
+    set_pollin (handle);
+}
+
+void zmq::shm_listener_t::process_term (int linger_)
+{
+    rm_fd (handle);
+    close ();
+    own_t::process_term (linger_);
+}
+
+void zmq::shm_listener_t::in_event ()
+{
+    fd_t fd = accept ();
+
+    //  If connection was reset by the peer in the meantime, just ignore it.
+    if (fd == retired_fd) {
+        socket->event_accept_failed (endpoint, zmq_errno());
+        return;
+    }
+
+    //  Hand the shared memory over to the peer before any data flows.
+    shm_segment_t segment;
+    if (send_segment (fd, segment) != 0) {
+        const int err = errno;
+        int rc = ::close (fd);
+        errno_assert (rc == 0);
+        errno = err;
+        socket->event_accept_failed (endpoint, zmq_errno());
+        return;
+    }
+
+    //  Create the engine object for this connection.
+    shm_engine_t *engine = new (std::nothrow)
+        shm_engine_t (fd, segment, true, options, endpoint);
+    alloc_assert (engine);
+
+    //  Choose I/O thread to run connecter in. Given that we are already
+    //  running in an I/O thread, there must be at least one available.
+    io_thread_t *io_thread = choose_io_thread (options.affinity);
+    zmq_assert (io_thread);
+
+    //  Create and launch a session object.
+    session_base_t *session = session_base_t::create (io_thread, false, socket,
+        options, NULL);
+    errno_assert (session);
+    session->inc_seqnum ();
+    launch_child (session);
+    send_attach (session, engine, false);
+    socket->event_accepted (endpoint, fd);
+}
+
+int zmq::shm_listener_t::get_address (std::string &addr_)
+{
+    if (s == retired_fd) {
+        addr_.clear ();
+        return -1;
+    }
+    addr_ = "shm://" + name;
+    return 0;
+}
+
+int zmq::shm_listener_t::set_address (const char *addr_)
+{
+    name.assign (addr_);
+
+    //  Allow wildcard name.
+    if (name == "*") {
+        char buf [32];
+        snprintf (buf, sizeof buf, "%d-%08x", (int) getpid (),
+            generate_random ());
+        name.assign (buf);
+    }
+
+    //  Initialise the address structure.
+    ipc_address_t address;
+    int rc = shm_engine_t::resolve_address (name, address);
+    if (rc != 0)
+        return -1;
+
+    endpoint = "shm://" + name;
+
+    //  Create a listening socket.
+    s = open_socket (AF_UNIX, SOCK_STREAM, 0);
+    if (s == -1)
+        return -1;
+
+    //  Bind the socket to the abstract address.
+    rc = bind (s, address.addr (), address.addrlen ());
+    if (rc != 0)
+        goto error;
+
+    //  Listen for incoming connections.
+    rc = listen (s, options.backlog);
+    if (rc != 0)
+        goto error;
+
+    socket->event_listening (endpoint, s);
+    return 0;
+
+error:
+    int err = errno;
+    close ();
+    errno = err;
+    return -1;
+}
+
+int zmq::shm_listener_t::close ()
+{
+    zmq_assert (s != retired_fd);
+    int rc = ::close (s);
+    errno_assert (rc == 0);
+
+    socket->event_closed (endpoint, s);
+    s = retired_fd;
+    return 0;
+}
+
+zmq::fd_t zmq::shm_listener_t::accept ()
+{
+    //  Accept one connection and deal with different failure modes.
+    //  The situation where connection cannot be accepted due to insufficient
+    //  resources is considered valid and treated by ignoring the connection.
+    zmq_assert (s != retired_fd);
+    fd_t sock = ::accept4 (s, NULL, NULL, SOCK_CLOEXEC);
+    if (sock == -1) {
+        errno_assert (errno == EAGAIN || errno == EWOULDBLOCK ||
+            errno == EINTR || errno == ECONNABORTED || errno == EPROTO ||
+            errno == ENFILE || errno == EMFILE || errno == ENOBUFS ||
+            errno == ENOMEM);
+        return retired_fd;
+    }
+
+    return sock;
+}
+
+int zmq::shm_listener_t::send_segment (fd_t fd_, shm_segment_t &segment_)
+{
+    //  Ring sizes default to shm_ring_size and follow the kernel buffer
+    //  options of the binding socket when these are set.
+    const size_t to_connecter = options.sndbuf > 0 ?
+        (size_t) options.sndbuf : (size_t) shm_ring_size;
+    const size_t to_listener = options.rcvbuf > 0 ?
+        (size_t) options.rcvbuf : (size_t) shm_ring_size;
+
+    const fd_t segment_fd =
+        shm_engine_t::create_segment (to_connecter, to_listener);
+    if (segment_fd == retired_fd)
+        return -1;
+
+    int rc = shm_engine_t::map_segment (segment_fd, segment_);
+    if (rc == 0) {
+        rc = shm_engine_t::create_wake_fds (segment_);
+        if (rc != 0) {
+            const int err = errno;
+            shm_engine_t::release_segment (segment_);
+            errno = err;
+        }
+    }
+    if (rc == 0) {
+        //  The segment and its eventfds travel as ancillary data of
+        //  a single byte.
+        int fds [1 + shm_wake_fds];
+        fds [0] = segment_fd;
+        for (int i = 0; i != shm_wake_fds; i++)
+            fds [1 + i] = *shm_engine_t::wake_fd (segment_, i);
+
+        unsigned char byte = 0;
+        struct iovec iov;
+        iov.iov_base = &byte;
+        iov.iov_len = 1;
+
+        union {
+            struct cmsghdr align;
+            unsigned char buf [CMSG_SPACE (sizeof fds)];
+        } control;
+        memset (&control, 0, sizeof control);
+
+        struct msghdr msg;
+        memset (&msg, 0, sizeof msg);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof control.buf;
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN (sizeof fds);
+        memcpy (CMSG_DATA (cmsg), fds, sizeof fds);
+
+        //  The connection is fresh, so the socket buffer is empty and
+        //  the message goes out in one go.
+        rc = (int) sendmsg (fd_, &msg, MSG_NOSIGNAL) == 1 ? 0 : -1;
+        if (rc != 0) {
+            const int err = errno;
+            shm_engine_t::release_segment (segment_);
+            errno = err;
+        }
+    }
+
+    const int err = errno;
+    int rc2 = ::close (segment_fd);
+    errno_assert (rc2 == 0);
+    errno = err;
+    return rc;
+}
+
+#endif
@@ -0,0 +1,193 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_SHM_RING_HPP_INCLUDED__
+#define __ZMQ_SHM_RING_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_SHM
+
+#include <stddef.h>
+#include <string.h>
+
+#include "stdint.hpp"
+#include "err.hpp"
+
+namespace zmq
+{
+
+    //  Control block of a ring living in a shared memory segment. The two
+    //  cursors run freely and are only ever advanced by their owner, the
+    //  producer owns 'head' and the consumer owns 'tail'. They sit on
+    //  separate cache lines so that the two processes do not bounce them.
+
+    struct shm_ring_ctl_t
+    {
+        uint32_t head;
+        unsigned char head_pad [60];
+        uint32_t tail;
+        uint32_t writer_waiting;
+        unsigned char tail_pad [56];
+    };
+
+    //  Process-local view of a single-producer/single-consumer byte ring
+    //  shared with a peer process. Only one side may write to the ring and
+    //  only the other side may read from it. Capacity must be a power
+    //  of two and is cached locally so that a misbehaving peer cannot make
+    //  us access memory outside of the mapped segment.
+
+    class shm_ring_t
+    {
+    public:
+
+        inline shm_ring_t () :
+            ctl (NULL),
+            data (NULL),
+            capacity (0)
+        {
+        }
+
+        inline void attach (void *base_, uint32_t capacity_)
+        {
+            zmq_assert (capacity_ > 0 && !(capacity_ & (capacity_ - 1)));
+            ctl = (shm_ring_ctl_t*) base_;
+            data = (unsigned char*) base_ + sizeof (shm_ring_ctl_t);
+            capacity = capacity_;
+        }
+
+        //  Number of bytes available to the consumer. Returns a value
+        //  larger than the capacity if the peer has corrupted the ring.
+        inline uint32_t readable () const
+        {
+            return __atomic_load_n (&ctl->head, __ATOMIC_SEQ_CST) -
+                __atomic_load_n (&ctl->tail, __ATOMIC_RELAXED);
+        }
+
+        //  Number of bytes the producer can write without overwriting
+        //  unread data.
+        inline uint32_t writable () const
+        {
+            const uint32_t used =
+                __atomic_load_n (&ctl->head, __ATOMIC_RELAXED) -
+                __atomic_load_n (&ctl->tail, __ATOMIC_SEQ_CST);
+            return used >= capacity ? 0 : capacity - used;
+        }
+
+        //  Copies as much of the data as fits into the ring and returns
+        //  the number of bytes written. 'was_empty_' is set if the consumer
+        //  had drained the ring before the write, i.e. it may be waiting
+        //  for a wake-up.
+        inline size_t write (const void *data_, size_t size_,
+            bool &was_empty_)
+        {
+            const uint32_t head =
+                __atomic_load_n (&ctl->head, __ATOMIC_RELAXED);
+            const uint32_t avail = writable ();
+            const uint32_t n = size_ < avail ? (uint32_t) size_ : avail;
+            was_empty_ = false;
+            if (n == 0)
+                return 0;
+            copy_in (head, data_, n);
+            __atomic_store_n (&ctl->head, head + n, __ATOMIC_SEQ_CST);
+            was_empty_ = __atomic_load_n (&ctl->tail, __ATOMIC_SEQ_CST) == head;
+            return n;
+        }
+
+        //  Copies up to 'size_' bytes out of the ring and returns the
+        //  number of bytes read. Nothing is read from a corrupted ring.
+        inline size_t read (void *data_, size_t size_)
+        {
+            const uint32_t tail =
+                __atomic_load_n (&ctl->tail, __ATOMIC_RELAXED);
+            uint32_t avail = readable ();
+            if (avail > capacity)
+                avail = 0;
+            const uint32_t n = size_ < avail ? (uint32_t) size_ : avail;
+            if (n == 0)
+                return 0;
+            copy_out (tail, data_, n);
+            __atomic_store_n (&ctl->tail, tail + n, __ATOMIC_SEQ_CST);
+            return n;
+        }
+
+        //  Producer announces it has stalled on a full ring.
+        inline void set_writer_waiting ()
+        {
+            __atomic_store_n (&ctl->writer_waiting, 1, __ATOMIC_SEQ_CST);
+        }
+
+        //  Consumer checks whether the producer needs a wake-up. The flag
+        //  is cleared so that only one wake-up is sent per stall.
+        inline bool check_writer_waiting ()
+        {
+            if (!__atomic_load_n (&ctl->writer_waiting, __ATOMIC_SEQ_CST))
+                return false;
+            return __atomic_exchange_n (&ctl->writer_waiting, 0,
+                __ATOMIC_SEQ_CST) != 0;
+        }
+
+        inline uint32_t get_capacity () const
+        {
+            return capacity;
+        }
+
+    private:
+
+        inline void copy_in (uint32_t pos_, const void *data_, uint32_t size_)
+        {
+            const uint32_t offset = pos_ & (capacity - 1);
+            const uint32_t first = capacity - offset < size_ ?
+                capacity - offset : size_;
+            memcpy (data + offset, data_, first);
+            memcpy (data, (const unsigned char*) data_ + first, size_ - first);
+        }
+
+        inline void copy_out (uint32_t pos_, void *data_, uint32_t size_)
+        {
+            const uint32_t offset = pos_ & (capacity - 1);
+            const uint32_t first = capacity - offset < size_ ?
+                capacity - offset : size_;
+            memcpy (data_, data + offset, first);
+            memcpy ((unsigned char*) data_ + first, data, size_ - first);
+        }
+
+        shm_ring_ctl_t *ctl;
+        unsigned char *data;
+        uint32_t capacity;
+
+        shm_ring_t (const shm_ring_t&);
+        const shm_ring_t &operator = (const shm_ring_t&);
+    };
+
+}
+
+#endif
+
+#endif
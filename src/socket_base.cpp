@@ -51,6 +51,8 @@
 #include "tcp_listener.hpp"
 #include "ipc_listener.hpp"
 #include "tipc_listener.hpp"
+#include "shm_listener.hpp"
+#include "shm_engine.hpp"
 #include "tcp_connecter.hpp"
 #include "io_thread.hpp"
 #include "session_base.hpp"
@@ -59,6 +61,7 @@
 #include "err.hpp"
 #include "ctx.hpp"
 #include "likely.hpp"
+#include "trace.hpp"
 #include "msg.hpp"
 #include "address.hpp"
 #include "ipc_address.hpp"
@@ -67,6 +70,8 @@
 #include "tipc_address.hpp"
 #include "mailbox.hpp"
 #include "mailbox_safe.hpp"
+#include "monitor_ring.hpp"
+#include "timestamps.hpp"
 
 #if defined ZMQ_HAVE_VMCI
 #include "vmci_address.hpp"
@@ -192,13 +197,20 @@ zmq::socket_base_t::socket_base_t (ctx_t *parent_, uint32_t tid_, int sid_, bool
     last_tsc (0),
     ticks (0),
     rcvmore (false),
+    group_entry (NULL),
+    thread_group (NULL),
+    generation (0),
     monitor_socket (NULL),
     monitor_events (0),
+    monitor_ring_records (NULL),
     thread_safe (thread_safe_),
     reaper_signaler (NULL),
     sync(),
-    monitor_sync()
+    monitor_sync(),
+    reconnects (0),
+    handshake_failures (0)
 {
+    memset (&stats, 0, sizeof stats);
     options.socket_id = sid_;
     options.ipv6 = (parent_->get (ZMQ_IPV6) != 0);
     options.linger = parent_->get (ZMQ_BLOCKY)? -1: 0;
@@ -209,8 +221,7 @@ zmq::socket_base_t::socket_base_t (ctx_t *parent_, uint32_t tid_, int sid_, bool
         zmq_assert (mailbox);
     }
     else {
-        mailbox_t *m = new (std::nothrow) mailbox_t();
-        zmq_assert (m);
+        mailbox_t *m = parent_->alloc_mailbox ();
 
         if (m->get_fd () != retired_fd)
             mailbox = m;
@@ -223,12 +234,23 @@ zmq::socket_base_t::socket_base_t (ctx_t *parent_, uint32_t tid_, int sid_, bool
 
 zmq::socket_base_t::~socket_base_t ()
 {
-    if (mailbox)
-        LIBZMQ_DELETE(mailbox);
+    if (mailbox) {
+        if (thread_safe) {
+            LIBZMQ_DELETE(mailbox);
+        }
+        else {
+            leave_thread_group ();
+            get_ctx ()->release_mailbox ((mailbox_t*) mailbox);
+            mailbox = NULL;
+        }
+    }
 
     if (reaper_signaler)
         LIBZMQ_DELETE(reaper_signaler);
 
+    if (monitor_ring_records)
+        LIBZMQ_DELETE(monitor_ring_records);
+
     scoped_lock_t lock(monitor_sync);
     stop_monitor ();
 
@@ -287,6 +309,9 @@ int zmq::socket_base_t::check_protocol (const std::string &protocol_)
     // TIPC transport is only available on Linux.
     &&  protocol_ != "tipc"
 #endif
+#if defined ZMQ_HAVE_SHM
+    &&  protocol_ != "shm"
+#endif
 #if defined ZMQ_HAVE_NORM
     &&  protocol_ != "norm"
 #endif
@@ -326,6 +351,7 @@ void zmq::socket_base_t::attach_pipe (pipe_t *pipe_, bool subscribe_to_all_)
     //  First, register the pipe so that we can terminate it later on.
     pipe_->set_event_sink (this);
     pipes.push_back (pipe_);
+    next_generation ();
 
     //  Let the derived socket type know about new pipe.
     xattach_pipe (pipe_, subscribe_to_all_);
@@ -435,6 +461,23 @@ int zmq::socket_base_t::getsockopt (int option_, void *optval_,
         return 0;
     }
 
+    if (option_ == ZMQ_SOCKET_STATS) {
+        if (*optvallen_ < sizeof (zmq_socket_stats_t)) {
+            errno = EINVAL;
+            return -1;
+        }
+        zmq_socket_stats_t *result = (zmq_socket_stats_t*) optval_;
+        *result = stats;
+        xstats (result);
+        {
+            scoped_lock_t lock (monitor_sync);
+            result->reconnects = reconnects;
+            result->handshake_failures = handshake_failures;
+        }
+        *optvallen_ = sizeof (zmq_socket_stats_t);
+        return 0;
+    }
+
     if (option_ == ZMQ_THREAD_SAFE) {
         if (*optvallen_ < sizeof (int)) {
             errno = EINVAL;
@@ -470,6 +513,79 @@ int zmq::socket_base_t::leave (const char* group_)
     return rc;
 }
 
+int zmq::socket_base_t::join_thread_group (thread_group_t *group_)
+{
+    //  Thread-safe sockets are not owned by a single thread.
+    if (thread_safe || thread_group) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (unlikely (ctx_terminated)) {
+        errno = ETERM;
+        return -1;
+    }
+
+    thread_group = group_;
+    group_entry = thread_group->attach (this);
+    ((mailbox_t*) mailbox)->set_group (group_entry);
+    return 0;
+}
+
+void zmq::socket_base_t::leave_thread_group ()
+{
+    if (!group_entry)
+        return;
+
+    ((mailbox_t*) mailbox)->set_group (NULL);
+    thread_group_t::detach (group_entry);
+    group_entry = NULL;
+    thread_group = NULL;
+}
+
+zmq::thread_group_t *zmq::socket_base_t::get_thread_group () const
+{
+    return thread_group;
+}
+
+uint64_t zmq::socket_base_t::get_generation () const
+{
+    return generation;
+}
+
+void zmq::socket_base_t::next_generation ()
+{
+    generation++;
+    for (std::vector <watcher_t>::iterator it = watchers.begin ();
+          it != watchers.end (); ++it)
+        if (it->armed) {
+            it->list->push_back (this);
+            it->armed = false;
+        }
+}
+
+void zmq::socket_base_t::add_watcher (std::vector <socket_base_t*> *list_)
+{
+    for (std::vector <watcher_t>::iterator it = watchers.begin ();
+          it != watchers.end (); ++it)
+        if (it->list == list_) {
+            it->armed = true;
+            return;
+        }
+    watcher_t watcher = {list_, true};
+    watchers.push_back (watcher);
+}
+
+void zmq::socket_base_t::remove_watcher (std::vector <socket_base_t*> *list_)
+{
+    for (std::vector <watcher_t>::iterator it = watchers.begin ();
+          it != watchers.end (); ++it)
+        if (it->list == list_) {
+            watchers.erase (it);
+            return;
+        }
+}
+
 int zmq::socket_base_t::add_signaler(signaler_t *s_)
 {
     scoped_optional_lock_t sync_lock(thread_safe ? &sync : NULL);
@@ -578,6 +694,10 @@ int zmq::socket_base_t::bind (const char *addr_)
         bool conflates [2] = {false, false};
         rc = pipepair (parents, new_pipes, hwms, conflates);
         errno_assert (rc == 0);
+        new_pipes [0]->set_hwms_bytes (options.rcvhwm_bytes,
+            options.sndhwm_bytes);
+        new_pipes [1]->set_hwms_bytes (options.sndhwm_bytes,
+            options.rcvhwm_bytes);
 
         //  Attach local end of the pipe to the socket object.
         attach_pipe (new_pipes [0], true);
@@ -641,6 +761,26 @@ int zmq::socket_base_t::bind (const char *addr_)
         return 0;
     }
 #endif
+#if defined ZMQ_HAVE_SHM
+    if (protocol == "shm") {
+        shm_listener_t *listener = new (std::nothrow) shm_listener_t (
+            io_thread, this, options);
+        alloc_assert (listener);
+        int rc = listener->set_address (address.c_str ());
+        if (rc != 0) {
+            LIBZMQ_DELETE(listener);
+            event_bind_failed (address, zmq_errno());
+            return -1;
+        }
+
+        // Save last endpoint URI
+        listener->get_address (last_endpoint);
+
+        add_endpoint (last_endpoint.c_str (), (own_t *) listener, NULL);
+        options.connected = true;
+        return 0;
+    }
+#endif
 #if defined ZMQ_HAVE_TIPC
     if (protocol == "tipc") {
          tipc_listener_t *listener = new (std::nothrow) tipc_listener_t (
@@ -743,10 +883,21 @@ int zmq::socket_base_t::connect (const char *addr_)
 
         int hwms [2] = {conflate? -1 : sndhwm, conflate? -1 : rcvhwm};
         bool conflates [2] = {conflate, conflate};
-        rc = pipepair (parents, new_pipes, hwms, conflates);
+        rc = pipepair (parents, new_pipes, hwms, conflates,
+            options.conflate_topic);
         if (!conflate) {
             new_pipes[0]->set_hwms_boost(peer.options.sndhwm, peer.options.rcvhwm);
             new_pipes[1]->set_hwms_boost(options.sndhwm, options.rcvhwm);
+
+            //  Byte limits of both peers add up, like the message limits.
+            //  If the peer is not bound yet, its limits are added once it
+            //  binds (see ctx_t::connect_inproc_sockets).
+            const int64_t sndhwm_bytes = pipe_t::combine_hwms_bytes (
+                options.sndhwm_bytes, peer.options.rcvhwm_bytes);
+            const int64_t rcvhwm_bytes = pipe_t::combine_hwms_bytes (
+                options.rcvhwm_bytes, peer.options.sndhwm_bytes);
+            new_pipes [0]->set_hwms_bytes (rcvhwm_bytes, sndhwm_bytes);
+            new_pipes [1]->set_hwms_bytes (sndhwm_bytes, rcvhwm_bytes);
         }
 
         errno_assert (rc == 0);
@@ -890,6 +1041,19 @@ int zmq::socket_base_t::connect (const char *addr_)
         }
     }
 #endif
+#if defined ZMQ_HAVE_SHM
+    else
+    if (protocol == "shm") {
+        //  Only validate the name here; the connecter resolves it again
+        //  on every connection attempt.
+        ipc_address_t shm_address;
+        int rc = shm_engine_t::resolve_address (address, shm_address);
+        if (rc != 0) {
+            LIBZMQ_DELETE(paddr);
+            return -1;
+        }
+    }
+#endif
 
 if (protocol  == "udp") {
     if (options.type != ZMQ_RADIO) {
@@ -971,8 +1135,15 @@ if (protocol  == "udp") {
         int hwms [2] = {conflate? -1 : options.sndhwm,
             conflate? -1 : options.rcvhwm};
         bool conflates [2] = {conflate, conflate};
-        rc = pipepair (parents, new_pipes, hwms, conflates);
+        rc = pipepair (parents, new_pipes, hwms, conflates,
+            options.conflate_topic);
         errno_assert (rc == 0);
+        if (!conflate) {
+            new_pipes [0]->set_hwms_bytes (options.rcvhwm_bytes,
+                options.sndhwm_bytes);
+            new_pipes [1]->set_hwms_bytes (options.sndhwm_bytes,
+                options.rcvhwm_bytes);
+        }
 
         //  Attach local end of the pipe to the socket object.
         attach_pipe (new_pipes [0], subscribe_to_all);
@@ -1093,6 +1264,7 @@ int zmq::socket_base_t::term_endpoint (const char *addr_)
 int zmq::socket_base_t::send (msg_t *msg_, int flags_)
 {
     scoped_optional_lock_t sync_lock(thread_safe ? &sync : NULL);
+    next_generation ();
 
     //  Check whether the library haven't been shut down yet.
     if (unlikely (ctx_terminated)) {
@@ -1121,14 +1293,22 @@ int zmq::socket_base_t::send (msg_t *msg_, int flags_)
 
     msg_->reset_metadata ();
 
+    if (unlikely (options.msg_timestamps))
+        stamps.stamp (msg_)->set_time (time_sent, clock_t::wall_ns ());
+
+    //  The message is moved into a pipe by xsend, so take its size first.
+    const size_t size = msg_->size ();
+
     //  Try to send the message using method in each socket class
     rc = xsend (msg_);
     if (rc == 0) {
+        count_out (size, flags_);
         return 0;
     }
     if (unlikely (errno != EAGAIN)) {
         return -1;
     }
+    stats.hwm_blocks++;
 
     //  In case of non-blocking send we'll simply propagate
     //  the error - including EAGAIN - up the stack.
@@ -1163,12 +1343,14 @@ int zmq::socket_base_t::send (msg_t *msg_, int flags_)
         }
     }
 
+    count_out (size, flags_);
     return 0;
 }
 
 int zmq::socket_base_t::recv (msg_t *msg_, int flags_)
 {
     scoped_optional_lock_t sync_lock(thread_safe ? &sync : NULL);
+    next_generation ();
 
     //  Check whether the library haven't been shut down yet.
     if (unlikely (ctx_terminated)) {
@@ -1270,9 +1452,25 @@ int zmq::socket_base_t::close ()
     if (thread_safe)
         ((mailbox_safe_t*)mailbox)->clear_signalers();
 
+    //  The reaper waits for commands on the mailbox's own file descriptor.
+    leave_thread_group ();
+
     //  Mark the socket as dead
     tag = 0xdeadbeef;
 
+    //  A socket with no pipes may have nothing to wait for. Start the
+    //  termination here and if it completes straight away, which is the
+    //  case unless the socket owns sessions or listeners or commands are
+    //  in flight towards it, deallocate the socket without a round-trip
+    //  to the reaper thread.
+    if (!thread_safe && pipes.empty ()) {
+        terminate ();
+        if (destroyed) {
+            destroy_socket (this);
+            own_t::process_destroy ();
+            return 0;
+        }
+    }
 
     //  Transfer the ownership of the socket from this application thread
     //  to the reaper thread which will take care of the rest of shutdown
@@ -1363,6 +1561,8 @@ int zmq::socket_base_t::process_commands (int timeout_, bool throttle_)
     }
 
     //  Process all available commands.
+    if (rc == 0)
+        next_generation ();
     while (rc == 0) {
         cmd.destination->process_command (cmd);
         rc = mailbox->recv (&cmd, 0);
@@ -1493,6 +1693,10 @@ void zmq::socket_base_t::xhiccuped (pipe_t *)
     zmq_assert (false);
 }
 
+void zmq::socket_base_t::xstats (zmq_socket_stats_t *)
+{
+}
+
 void zmq::socket_base_t::in_event ()
 {
     //  This function is invoked only once the socket is running in the context
@@ -1586,6 +1790,22 @@ void zmq::socket_base_t::extract_flags (msg_t *msg_)
 
     //  Remove MORE flag.
     rcvmore = msg_->flags () & msg_t::more ? true : false;
+
+    if (!rcvmore)
+        stats.msgs_in++;
+    stats.bytes_in += msg_->size ();
+
+    if (unlikely (options.msg_timestamps))
+        stamps.stamp (msg_)->set_time (time_received, clock_t::wall_ns ());
+    zmq_trace3 (socket_recv, this, msg_->size (), rcvmore);
+}
+
+void zmq::socket_base_t::count_out (size_t size_, int flags_)
+{
+    if (!(flags_ & ZMQ_SNDMORE))
+        stats.msgs_out++;
+    stats.bytes_out += size_;
+    zmq_trace3 (socket_send, this, size_, flags_);
 }
 
 int zmq::socket_base_t::monitor (const char *addr_, int events_)
@@ -1636,6 +1856,59 @@ int zmq::socket_base_t::monitor (const char *addr_, int events_)
     return rc;
 }
 
+int zmq::socket_base_t::monitor_ring (int events_, int capacity_,
+    int sample_rate_)
+{
+    scoped_optional_lock_t sync_lock(thread_safe ? &sync : NULL);
+
+    if (unlikely (ctx_terminated)) {
+        errno = ETERM;
+        return -1;
+    }
+
+    if (capacity_ <= 0 || sample_rate_ < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    //  The ring outlives any change of settings, as I/O threads may be
+    //  using it, so its capacity cannot change.
+    if (!monitor_ring_records)
+        monitor_ring_records =
+            new (std::nothrow) monitor_ring_t (capacity_, sample_rate_);
+    else
+    if (monitor_ring_records->get_capacity () < (uint32_t) capacity_) {
+        errno = EINVAL;
+        return -1;
+    }
+    else
+        monitor_ring_records->set_sample_rate (sample_rate_);
+    alloc_assert (monitor_ring_records);
+
+    //  Only the socket's thread writes the mask, so moving it by the
+    //  difference is the same as an atomic store.
+    monitor_ring_events.add (events_ - monitor_ring_events.get ());
+    return 0;
+}
+
+int zmq::socket_base_t::monitor_drain (zmq_monitor_record_t *records_,
+    int count_, uint64_t *dropped_)
+{
+    scoped_optional_lock_t sync_lock(thread_safe ? &sync : NULL);
+
+    if (unlikely (ctx_terminated)) {
+        errno = ETERM;
+        return -1;
+    }
+
+    if (!monitor_ring_records) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return monitor_ring_records->drain (records_, count_, dropped_);
+}
+
 void zmq::socket_base_t::event_connected (const std::string &addr_, zmq::fd_t fd_)
 {
     event(addr_, fd_, ZMQ_EVENT_CONNECTED);
@@ -1718,7 +1991,19 @@ void zmq::socket_base_t::event_handshake_succeeded (const std::string &addr_,
 
 void zmq::socket_base_t::event(const std::string &addr_, intptr_t value_, int type_)
 {
+    //  The read-modify-write orders the ring pointer read after the mask.
+    if (unlikely (monitor_ring_events.add (0) & type_))
+        monitor_ring_records->push (type_, value_, addr_);
+
     scoped_lock_t lock(monitor_sync);
+    if (type_ == ZMQ_EVENT_CONNECT_RETRIED)
+        reconnects++;
+    else
+    if (type_ & (ZMQ_EVENT_HANDSHAKE_FAILED_NO_DETAIL
+               | ZMQ_EVENT_HANDSHAKE_FAILED_ZMTP
+               | ZMQ_EVENT_HANDSHAKE_FAILED_ZAP
+               | ZMQ_EVENT_HANDSHAKE_FAILED_ENCRYPTION))
+        handshake_failures++;
     if (monitor_events & type_)
     {
         monitor_event (type_, value_, addr_);
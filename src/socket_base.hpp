@@ -32,6 +32,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <stdarg.h>
 
 #include "own.hpp"
@@ -45,6 +46,8 @@
 #include "stdint.hpp"
 #include "clock.hpp"
 #include "pipe.hpp"
+#include "thread_group.hpp"
+#include "timestamps.hpp"
 
 extern "C"
 {
@@ -57,6 +60,7 @@ namespace zmq
     class ctx_t;
     class msg_t;
     class pipe_t;
+    class monitor_ring_t;
 
     class socket_base_t :
         public own_t,
@@ -94,6 +98,26 @@ namespace zmq
         int remove_signaler (signaler_t *s);
         int close ();
 
+        //  Makes the socket wake up its owner thread through the thread
+        //  group instead of its own file descriptor.
+        int join_thread_group (thread_group_t *group_);
+
+        //  Returns the thread group the socket is a member of, if any.
+        thread_group_t *get_thread_group () const;
+
+        //  Returns a counter that changes whenever the events of the socket
+        //  may have changed without its file descriptor being signalled:
+        //  when it processes commands, is used to send or receive, or gets
+        //  a new pipe.
+        uint64_t get_generation () const;
+
+        //  Has the socket append itself to 'list_' when its generation next
+        //  changes, and then not again until rearmed by another call. Lets
+        //  a poller find the sockets used between waits without checking
+        //  each of them.
+        void add_watcher (std::vector <socket_base_t*> *list_);
+        void remove_watcher (std::vector <socket_base_t*> *list_);
+
         //  These functions are used by the polling mechanism to determine
         //  which events are to be reported from this socket.
         bool has_in ();
@@ -123,6 +147,12 @@ namespace zmq
 
         int monitor (const char *endpoint_, int events_);
 
+        //  Records monitor events into a lock-free ring instead of sending
+        //  them, and drains batches of them.
+        int monitor_ring (int events_, int capacity_, int sample_rate_);
+        int monitor_drain (zmq_monitor_record_t *records_, int count_,
+            uint64_t *dropped_);
+
         void event_connected (const std::string &addr_, zmq::fd_t fd_);
         void event_connect_delayed (const std::string &addr_, int err_);
         void event_connect_retried (const std::string &addr_, int interval_);
@@ -178,9 +208,21 @@ namespace zmq
         virtual int xjoin (const char *group_);
         virtual int xleave (const char *group_);
 
+        //  Adds the counters kept by the socket type itself, such as
+        //  messages dropped by a dist_t, to a ZMQ_SOCKET_STATS report.
+        //  The default implementation keeps none.
+        virtual void xstats (zmq_socket_stats_t *stats_);
+
         //  Delay actual destruction of the socket.
         void process_destroy ();
 
+        //  Counters reported by ZMQ_SOCKET_STATS. They are only updated by
+        //  the thread using the socket, so no atomics are needed.
+        zmq_socket_stats_t stats;
+
+        //  Metadata of the messages stamped on send and recv, see
+        //  ZMQ_MSG_TIMESTAMPS.
+        timestamp_pool_t stamps;
 
         // Next assigned name on a zmq_connect() call used by ROUTER and STREAM socket types
         std::string connect_rid;
@@ -212,9 +254,13 @@ namespace zmq
         void check_destroy ();
 
         //  Moves the flags from the message to local variables,
-        //  to be later retrieved by getsockopt.
+        //  to be later retrieved by getsockopt, and accounts for the
+        //  received message part.
         void extract_flags (msg_t *msg_);
 
+        //  Accounts for a message part that has been sent.
+        void count_out (size_t size_, int flags_);
+
         //  Used to check whether the object is a socket.
         uint32_t tag;
 
@@ -250,6 +296,9 @@ namespace zmq
 
         void update_pipe_options(int option_);
 
+        //  Switches the mailbox back to its own file descriptor.
+        void leave_thread_group ();
+
         //  Socket's mailbox object.
         i_mailbox *mailbox;
 
@@ -273,12 +322,37 @@ namespace zmq
         //  Improves efficiency of time measurement.
         clock_t clock;
 
+        //  Membership in a thread group, if any.
+        thread_group_t::entry_t *group_entry;
+        thread_group_t *thread_group;
+
+        //  See get_generation.
+        uint64_t generation;
+        void next_generation ();
+
+        //  Lists to append the socket to when the generation changes, and
+        //  whether each is to be appended to.
+        struct watcher_t
+        {
+            std::vector <socket_base_t*> *list;
+            bool armed;
+        };
+        std::vector <watcher_t> watchers;
+
         // Monitor socket;
         void *monitor_socket;
 
         // Bitmask of events being monitored
         int monitor_events;
 
+        //  Ring of binary monitor records, created by the first call to
+        //  monitor_ring and kept until the socket is destroyed so that I/O
+        //  threads can use it without locking. Events are recorded if they
+        //  are in 'monitor_ring_events', which is written after the ring
+        //  pointer so that any thread seeing the bit also sees the ring.
+        monitor_ring_t *monitor_ring_records;
+        atomic_counter_t monitor_ring_events;
+
         // Last socket endpoint resolved URI
         std::string last_endpoint;
 
@@ -294,6 +368,11 @@ namespace zmq
         // Mutex to synchronize access to the monitor Pair socket
         mutex_t monitor_sync;
 
+        //  Counters of events reported by I/O threads, guarded by
+        //  'monitor_sync' like the events themselves.
+        uint64_t reconnects;
+        uint64_t handshake_failures;
+
         socket_base_t (const socket_base_t&);
         const socket_base_t &operator = (const socket_base_t&);
     };
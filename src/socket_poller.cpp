@@ -29,8 +29,15 @@
 
 #include "precompiled.hpp"
 #include "socket_poller.hpp"
+#include "config.hpp"
 #include "err.hpp"
 
+#if defined ZMQ_USE_EPOLL
+//  Keys of the epoll set entries that are not items.
+static const uint64_t epoll_signaler_key = (uint64_t) -1;
+static const uint64_t epoll_group_key = (uint64_t) 1 << 32;
+#endif
+
 zmq::socket_poller_t::socket_poller_t () :
     tag (0xCAFEBABE),
     signaler (NULL),
@@ -39,11 +46,17 @@ zmq::socket_poller_t::socket_poller_t () :
     poll_size(0)
 #if defined ZMQ_POLL_BASED_ON_POLL
     ,
+    groups_index (0),
     pollfds (NULL)
 #elif defined ZMQ_POLL_BASED_ON_SELECT
     ,
     maxfd(0)
 #endif
+#if defined ZMQ_USE_EPOLL
+    ,
+    use_epoll (false),
+    epoll_fd (retired_fd)
+#endif
 {
 #if defined ZMQ_POLL_BASED_ON_SELECT
 #if defined ZMQ_HAVE_WINDOWS
@@ -73,7 +86,13 @@ zmq::socket_poller_t::~socket_poller_t ()
 
             if (it->socket->getsockopt (ZMQ_THREAD_SAFE, &thread_safe, &thread_safe_size) == 0 && thread_safe)
                 it->socket->remove_signaler (signaler);
+#if defined ZMQ_USE_EPOLL
+            else
+                it->socket->remove_watcher (&used);
+#endif
         }
+        if (it->group)
+            it->group->release ();
     }
 
     if (signaler != NULL) {
@@ -87,6 +106,11 @@ zmq::socket_poller_t::~socket_poller_t ()
         pollfds = NULL;
     }
 #endif
+
+#if defined ZMQ_USE_EPOLL
+    if (epoll_fd != retired_fd)
+        close (epoll_fd);
+#endif
 }
 
 bool zmq::socket_poller_t::check_tag ()
@@ -117,7 +141,12 @@ int zmq::socket_poller_t::add (socket_base_t *socket_, void* user_data_, short e
            return -1;
     }
 
-    item_t item = {socket_, 0, user_data_, events_
+    //  Keep the thread group alive for as long as we poll it.
+    thread_group_t *group = socket_->get_thread_group ();
+    if (group)
+        group->add_ref ();
+
+    item_t item = {socket_, 0, user_data_, events_, group, true, 0
 #if defined ZMQ_POLL_BASED_ON_POLL
                    ,-1
 #endif
@@ -137,7 +166,7 @@ int zmq::socket_poller_t::add_fd (fd_t fd_, void *user_data_, short events_)
         }
     }
 
-    item_t item = {NULL, fd_, user_data_, events_
+    item_t item = {NULL, fd_, user_data_, events_, NULL, false, 0
 #if defined ZMQ_POLL_BASED_ON_POLL
                    ,-1
 #endif
@@ -162,6 +191,16 @@ int zmq::socket_poller_t::modify (socket_base_t  *socket_, short events_)
         return -1;
     }
 
+#if defined ZMQ_USE_EPOLL
+    //  The socket stays registered as long as it is polled for something,
+    //  it just needs to be checked against the new events.
+    if (use_epoll && !need_rebuild && it->events && events_) {
+        it->events = events_;
+        make_hot (it - items.begin ());
+        return 0;
+    }
+#endif
+
     it->events = events_;
     need_rebuild = true;
 
@@ -204,6 +243,9 @@ int zmq::socket_poller_t::remove (socket_base_t *socket_)
         return -1;
     }
 
+    if (it->group)
+        it->group->release ();
+
     items.erase(it);
     need_rebuild = true;
 
@@ -212,6 +254,10 @@ int zmq::socket_poller_t::remove (socket_base_t *socket_)
 
     if (socket_->getsockopt (ZMQ_THREAD_SAFE, &thread_safe, &thread_safe_size) == 0 && thread_safe)
         socket_->remove_signaler (signaler);
+#if defined ZMQ_USE_EPOLL
+    else
+        socket_->remove_watcher (&used);
+#endif
 
     return 0;
 }
@@ -236,8 +282,62 @@ int zmq::socket_poller_t::remove_fd (fd_t fd_)
     return 0;
 }
 
+void zmq::socket_poller_t::rebuild_groups ()
+{
+    groups.clear ();
+    group_items.clear ();
+
+    for (size_t i = 0; i < items.size (); i++) {
+        item_t &item = items [i];
+        if (!item.group)
+            continue;
+
+        //  Wake-ups may have been consumed by earlier rebuilds' polls,
+        //  so check every grouped socket once.
+        item.hot = true;
+        group_items [item.socket] = i;
+        if (item.events &&
+              std::find (groups.begin (), groups.end (), item.group) ==
+              groups.end ())
+            groups.push_back (item.group);
+    }
+}
+
+void zmq::socket_poller_t::wake_grouped (thread_group_t *group_)
+{
+    ready.clear ();
+    group_->drain (ready);
+
+    for (size_t i = 0; i < ready.size (); i++) {
+        //  Sockets that are not polled by us (any more) are ignored.
+        group_items_t::iterator it = group_items.find (ready [i]);
+        if (it != group_items.end ())
+            make_hot (it->second);
+    }
+}
+
+void zmq::socket_poller_t::make_hot (size_t index_)
+{
+    if (items [index_].hot)
+        return;
+
+    items [index_].hot = true;
+#if defined ZMQ_USE_EPOLL
+    if (use_epoll)
+        hot_items.push_back (index_);
+#endif
+}
+
 int zmq::socket_poller_t::rebuild ()
 {
+    rebuild_groups ();
+
+#if defined ZMQ_USE_EPOLL
+    use_epoll = items.size () >= socket_poller_epoll_threshold;
+    if (use_epoll)
+        return rebuild_epoll ();
+#endif
+
 #if defined ZMQ_POLL_BASED_ON_POLL
 
     if (pollfds) {
@@ -251,6 +351,9 @@ int zmq::socket_poller_t::rebuild ()
 
     for (items_t::iterator it = items.begin (); it != items.end (); ++it) {
         if (it->events) {
+            if (it->group)
+                continue;
+
             if (it->socket) {
                 int thread_safe;
                 size_t thread_safe_size = sizeof(int);
@@ -272,6 +375,8 @@ int zmq::socket_poller_t::rebuild ()
         }
     }
 
+    poll_size += static_cast <int> (groups.size ());
+
     if (poll_size == 0)
         return 0;
 
@@ -286,8 +391,15 @@ int zmq::socket_poller_t::rebuild ()
         pollfds[0].events = POLLIN;
     }
 
+    groups_index = item_nbr;
+    for (groups_t::iterator it = groups.begin (); it != groups.end (); ++it) {
+        pollfds [item_nbr].fd = (*it)->get_fd ();
+        pollfds [item_nbr].events = POLLIN;
+        item_nbr++;
+    }
+
     for (items_t::iterator it = items.begin (); it != items.end (); ++it) {
-        if (it->events) {
+        if (it->events && !it->group) {
             if (it->socket) {
                 int thread_safe;
                 size_t thread_safe_size = sizeof(int);
@@ -332,7 +444,7 @@ int zmq::socket_poller_t::rebuild ()
     use_signaler = false;
 
     for (items_t::iterator it = items.begin (); it != items.end (); ++it) {
-        if (it->socket) {
+        if (it->socket && !it->group) {
             int thread_safe;
             size_t thread_safe_size = sizeof(int);
 
@@ -350,9 +462,17 @@ int zmq::socket_poller_t::rebuild ()
 
     maxfd = 0;
 
+    for (groups_t::iterator it = groups.begin (); it != groups.end (); ++it) {
+        fd_t group_fd = (*it)->get_fd ();
+        FD_SET (group_fd, &pollset_in);
+        if (maxfd < group_fd)
+            maxfd = group_fd;
+        poll_size++;
+    }
+
     //  Build the fd_sets for passing to select ().
     for (items_t::iterator it = items.begin (); it != items.end (); ++it) {
-        if (it->events) {
+        if (it->events && !it->group) {
             //  If the poll item is a 0MQ socket we are interested in input on the
             //  notification file descriptor retrieved by the ZMQ_FD socket option.
             if (it->socket) {
@@ -425,6 +545,11 @@ int zmq::socket_poller_t::wait (zmq::socket_poller_t::event_t *events_, int n_ev
 #endif
     }
 
+#if defined ZMQ_USE_EPOLL
+    if (use_epoll)
+        return wait_epoll (events_, n_events_, timeout_);
+#endif
+
     zmq::clock_t clock;
     uint64_t now = 0;
     uint64_t end = 0;
@@ -456,6 +581,11 @@ int zmq::socket_poller_t::wait (zmq::socket_poller_t::event_t *events_, int n_ev
         if (use_signaler && pollfds[0].revents & POLLIN)
             signaler->recv ();
 
+        //  Find out which of the grouped sockets were woken up.
+        for (size_t i = 0; i < groups.size (); i++)
+            if (pollfds [groups_index + i].revents & POLLIN)
+                wake_grouped (groups [i]);
+
         //  Check for the events.
         int found = 0;
         for (items_t::iterator it = items.begin (); it != items.end () && found < n_events_; ++it) {
@@ -468,12 +598,22 @@ int zmq::socket_poller_t::wait (zmq::socket_poller_t::event_t *events_, int n_ev
             //  The poll item is a 0MQ socket. Retrieve pending events
             //  using the ZMQ_EVENTS socket option.
             if (it->socket) {
+                //  Grouped sockets can't have new events unless woken up
+                //  or used by the application since they were checked.
+                if (it->group && !it->hot &&
+                      it->socket->get_generation () == it->generation)
+                    continue;
+
                 size_t events_size = sizeof (uint32_t);
                 uint32_t events;
                 if (it->socket->getsockopt (ZMQ_EVENTS, &events, &events_size) == -1) {
                     return -1;
                 }
 
+                it->generation = it->socket->get_generation ();
+                if (it->group && !(it->events & events))
+                    it->hot = false;
+
                 if (it->events & events) {
                     events_[found].socket = it->socket;
                     events_[found].user_data = it->user_data;
@@ -624,6 +764,11 @@ int zmq::socket_poller_t::wait (zmq::socket_poller_t::event_t *events_, int n_ev
         if (use_signaler && FD_ISSET (signaler->get_fd (), &inset))
             signaler->recv ();
 
+        //  Find out which of the grouped sockets were woken up.
+        for (size_t i = 0; i < groups.size (); i++)
+            if (FD_ISSET (groups [i]->get_fd (), &inset))
+                wake_grouped (groups [i]);
+
         //  Check for the events.
         int found = 0;
         for (items_t::iterator it = items.begin (); it != items.end () && found < n_events_; ++it) {
@@ -631,11 +776,21 @@ int zmq::socket_poller_t::wait (zmq::socket_poller_t::event_t *events_, int n_ev
             //  The poll item is a 0MQ socket. Retrieve pending events
             //  using the ZMQ_EVENTS socket option.
             if (it->socket) {
+                //  Grouped sockets can't have new events unless woken up
+                //  or used by the application since they were checked.
+                if (it->group && !it->hot &&
+                      it->socket->get_generation () == it->generation)
+                    continue;
+
                 size_t events_size = sizeof (uint32_t);
                 uint32_t events;
                 if (it->socket->getsockopt (ZMQ_EVENTS, &events, &events_size) == -1)
                     return -1;
 
+                it->generation = it->socket->get_generation ();
+                if (it->group && !(it->events & events))
+                    it->hot = false;
+
                 if (it->events & events) {
                     events_[found].socket = it->socket;
                     events_[found].user_data = it->user_data;
@@ -715,3 +870,263 @@ int zmq::socket_poller_t::wait (zmq::socket_poller_t::event_t *events_, int n_ev
     return -1;
 #endif
 }
+
+#if defined ZMQ_USE_EPOLL
+
+int zmq::socket_poller_t::epoll_register (fd_t fd_, uint32_t events_,
+    uint64_t key_)
+{
+    epoll_event ev;
+    memset (&ev, 0, sizeof ev);
+    ev.events = events_;
+    ev.data.u64 = key_;
+    return epoll_ctl (epoll_fd, EPOLL_CTL_ADD, fd_, &ev);
+}
+
+int zmq::socket_poller_t::rebuild_epoll ()
+{
+    if (epoll_fd != retired_fd)
+        close (epoll_fd);
+#ifdef ZMQ_USE_EPOLL_CLOEXEC
+    epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+#else
+    epoll_fd = epoll_create (1);
+#endif
+    errno_assert (epoll_fd != -1);
+
+    use_signaler = false;
+    poll_size = 0;
+    hot_items.clear ();
+    safe_items.clear ();
+    owned_items.clear ();
+    used.clear ();
+    for (items_t::iterator it = items.begin (); it != items.end (); ++it)
+        it->hot = false;
+
+    for (size_t i = 0; i < items.size (); i++) {
+        item_t &item = items [i];
+        if (!item.events)
+            continue;
+
+        //  Raw file descriptors are level-triggered, as with poll ().
+        if (!item.socket) {
+            uint32_t events = 0;
+            if (item.events & ZMQ_POLLIN)
+                events |= EPOLLIN;
+            if (item.events & ZMQ_POLLOUT)
+                events |= EPOLLOUT;
+            if (item.events & ZMQ_POLLPRI)
+                events |= EPOLLPRI;
+            if (epoll_register (item.fd, events, i) == -1)
+                return -1;
+            poll_size++;
+            continue;
+        }
+
+        //  Sockets are checked once, then each time they are woken up.
+        make_hot (i);
+
+        if (item.group) {
+            owned_items [item.socket] = i;
+            item.socket->add_watcher (&used);
+            continue;
+        }
+
+        int thread_safe;
+        size_t thread_safe_size = sizeof(int);
+        if (item.socket->getsockopt (ZMQ_THREAD_SAFE, &thread_safe, &thread_safe_size) == -1)
+            return -1;
+
+        if (thread_safe) {
+            safe_items.push_back (i);
+            if (!use_signaler) {
+                use_signaler = true;
+                if (epoll_register (signaler->get_fd (), EPOLLIN,
+                      epoll_signaler_key) == -1)
+                    return -1;
+                poll_size++;
+            }
+            continue;
+        }
+
+        //  ZMQ_FD is signalled when commands arrive for the socket, so
+        //  there's no point in being told again until new ones arrive.
+        owned_items [item.socket] = i;
+        item.socket->add_watcher (&used);
+        fd_t fd;
+        size_t fd_size = sizeof (fd_t);
+        if (item.socket->getsockopt (ZMQ_FD, &fd, &fd_size) == -1)
+            return -1;
+        if (epoll_register (fd, EPOLLIN | EPOLLET, i) == -1)
+            return -1;
+        poll_size++;
+    }
+
+    for (size_t i = 0; i < groups.size (); i++) {
+        if (epoll_register (groups [i]->get_fd (), EPOLLIN,
+              epoll_group_key + i) == -1)
+            return -1;
+        poll_size++;
+    }
+
+    epoll_events.resize (std::min (std::max (poll_size, 1),
+        (int) max_io_events));
+
+    need_rebuild = false;
+    return 0;
+}
+
+int zmq::socket_poller_t::wait_epoll (event_t *events_, int n_events_,
+    long timeout_)
+{
+    zmq::clock_t clock;
+    uint64_t now = 0;
+    uint64_t end = 0;
+
+    bool first_pass = true;
+
+    //  Commands the application processed by using a socket since the
+    //  last wait did not leave a signal for us.
+    for (size_t i = 0; i < used.size (); i++) {
+        owned_items_t::iterator it = owned_items.find (used [i]);
+        if (it != owned_items.end ())
+            make_hot (it->second);
+    }
+    used.clear ();
+
+    while (true) {
+        //  Compute the timeout for the subsequent poll.
+        int timeout;
+        if (first_pass)
+            timeout = 0;
+        else
+        if (timeout_ < 0)
+            timeout = -1;
+        else
+            timeout = end - now;
+
+        //  Wait for events.
+        int rc = epoll_wait (epoll_fd, &epoll_events [0],
+            (int) epoll_events.size (), timeout);
+        if (rc == -1 && errno == EINTR)
+            return -1;
+        errno_assert (rc >= 0);
+
+        results.clear ();
+
+        for (int i = 0; i < rc; i++) {
+            const uint64_t key = epoll_events [i].data.u64;
+            if (key == epoll_signaler_key) {
+                signaler->recv ();
+                for (size_t j = 0; j < safe_items.size (); j++)
+                    make_hot (safe_items [j]);
+            }
+            else
+            if (key >= epoll_group_key)
+                wake_grouped (groups [key - epoll_group_key]);
+            else
+            if (items [key].socket)
+                make_hot (key);
+            else {
+                const uint32_t revents = epoll_events [i].events;
+                short events = 0;
+
+                if (revents & EPOLLIN)
+                    events |= ZMQ_POLLIN;
+                if (revents & EPOLLOUT)
+                    events |= ZMQ_POLLOUT;
+                if (revents & EPOLLPRI)
+                    events |= ZMQ_POLLPRI;
+                if (revents & ~(EPOLLIN | EPOLLOUT | EPOLLPRI))
+                    events |= ZMQ_POLLERR;
+
+                results.push_back (result_t (key, events));
+            }
+        }
+
+        //  Check the sockets that may have events. Those that have none
+        //  are not checked again until they are woken up.
+        size_t kept = 0;
+        for (size_t i = 0; i < hot_items.size (); i++) {
+            const size_t index = hot_items [i];
+            item_t &item = items [index];
+
+            size_t events_size = sizeof (uint32_t);
+            uint32_t events;
+            if (item.socket->getsockopt (ZMQ_EVENTS, &events, &events_size) == -1) {
+                //  Have everything checked again on the next wait.
+                need_rebuild = true;
+                return -1;
+            }
+
+            //  Commands processed by the check itself are accounted for.
+            if (owned_items.count (item.socket))
+                item.socket->add_watcher (&used);
+
+            if (item.events & events) {
+                results.push_back (result_t (index, item.events & events));
+                hot_items [kept++] = index;
+            }
+            else
+                item.hot = false;
+        }
+        hot_items.resize (kept);
+        used.clear ();
+
+        if (!results.empty ()) {
+            //  Report the events in the order the items were added in.
+            std::sort (results.begin (), results.end ());
+
+            int found = 0;
+            for (; found < n_events_ && found < (int) results.size (); ++found) {
+                const item_t &item = items [results [found].first];
+                events_[found].socket = item.socket;
+                events_[found].fd = item.socket ? 0 : item.fd;
+                events_[found].user_data = item.user_data;
+                events_[found].events = results [found].second;
+            }
+            for (int i = found; i < n_events_; ++i) {
+                events_[i].socket = NULL;
+                events_[i].fd = 0;
+                events_[i].user_data = NULL;
+                events_[i].events = 0;
+            }
+            return found;
+        }
+
+        //  If timeout is zero, exit immediately whether there are events or not.
+        if (timeout_ == 0)
+            break;
+
+        //  At this point we are meant to wait for events but there are none.
+        //  If timeout is infinite we can just loop until we get some events.
+        if (timeout_ < 0) {
+            if (first_pass)
+                first_pass = false;
+            continue;
+        }
+
+        //  The timeout is finite and there are no events. In the first pass
+        //  we get a timestamp of when the polling have begun. (We assume that
+        //  first pass have taken negligible time). We also compute the time
+        //  when the polling should time out.
+        if (first_pass) {
+            now = clock.now_ms ();
+            end = now + timeout_;
+            if (now == end)
+                break;
+            first_pass = false;
+            continue;
+        }
+
+        //  Find out whether timeout have expired.
+        now = clock.now_ms ();
+        if (now >= end)
+            break;
+    }
+
+    errno = ETIMEDOUT;
+    return -1;
+}
+
+#endif
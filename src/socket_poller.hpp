@@ -36,6 +36,10 @@
 #include <poll.h>
 #endif
 
+#if defined ZMQ_USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #if defined ZMQ_HAVE_WINDOWS
 #include "windows.hpp"
 #else
@@ -43,10 +47,12 @@
 #endif
 
 #include <vector>
+#include <map>
 #include <algorithm>
 
 #include "socket_base.hpp"
 #include "signaler.hpp"
+#include "thread_group.hpp"
 
 namespace zmq
 {
@@ -82,6 +88,19 @@ namespace zmq
 
     private:
         int rebuild ();
+        void rebuild_groups ();
+
+        //  Marks the sockets woken up through the group to be checked.
+        void wake_grouped (thread_group_t *group_);
+
+        //  Marks the socket item to be checked on the next pass.
+        void make_hot (size_t index_);
+
+#if defined ZMQ_USE_EPOLL
+        int rebuild_epoll ();
+        int epoll_register (fd_t fd_, uint32_t events_, uint64_t key_);
+        int wait_epoll (event_t *events_, int n_events_, long timeout_);
+#endif
 
         //  Used to check whether the object is a socket_poller.
         uint32_t tag;
@@ -94,6 +113,13 @@ namespace zmq
             fd_t fd;
             void *user_data;
             short events;
+            //  Thread group of the socket, if any. Grouped sockets are
+            //  only checked while 'hot': after a wake-up and as long as
+            //  they have events.
+            thread_group_t *group;
+            bool hot;
+            //  Generation of the socket when it was last checked.
+            uint64_t generation;
 #if defined ZMQ_POLL_BASED_ON_POLL
             int  pollfd_index;
 #endif
@@ -112,6 +138,21 @@ namespace zmq
         //  Size of the pollset
         int poll_size;
 
+        //  Thread groups of the polled sockets, each polled through a
+        //  single file descriptor, and the index of each grouped socket.
+        typedef std::vector <thread_group_t*> groups_t;
+        groups_t groups;
+        typedef std::map <socket_base_t*, size_t> group_items_t;
+        group_items_t group_items;
+
+        //  Sockets taken off the ready lists of the groups.
+        std::vector <socket_base_t*> ready;
+
+#if defined ZMQ_POLL_BASED_ON_POLL
+        //  Index of the first group in pollfds.
+        int groups_index;
+#endif
+
 #if defined ZMQ_POLL_BASED_ON_POLL
         pollfd *pollfds;
 #elif defined ZMQ_POLL_BASED_ON_SELECT
@@ -121,6 +162,36 @@ namespace zmq
         zmq::fd_t maxfd;
 #endif
 
+#if defined ZMQ_USE_EPOLL
+        //  With many items, the poller keeps their file descriptors in an
+        //  epoll set, only rebuilt when items are added or removed. Sockets
+        //  are woken up edge-triggered and then checked on each wait for as
+        //  long as they have events, so the cost of a wait depends on the
+        //  number of ready items rather than on the number of items.
+        bool use_epoll;
+        fd_t epoll_fd;
+        std::vector <epoll_event> epoll_events;
+
+        //  Indices of the socket items to check on the next wait.
+        std::vector <size_t> hot_items;
+
+        //  Indices of the thread safe sockets, all woken up through the
+        //  signaler.
+        std::vector <size_t> safe_items;
+
+        //  Indices of the other sockets. The application may consume their
+        //  wake-ups by using them between waits, so each socket appends
+        //  itself to 'used' when that happens, to be checked again on the
+        //  next wait.
+        typedef std::map <socket_base_t*, size_t> owned_items_t;
+        owned_items_t owned_items;
+        std::vector <socket_base_t*> used;
+
+        //  Events found by a wait, with the index of their item.
+        typedef std::pair <size_t, short> result_t;
+        std::vector <result_t> results;
+#endif
+
         socket_poller_t (const socket_poller_t&);
         const socket_poller_t &operator = (const socket_poller_t&);
     };
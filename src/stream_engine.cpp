@@ -38,6 +38,7 @@
 
 #include <new>
 #include <sstream>
+#include <algorithm>
 
 #include "stream_engine.hpp"
 #include "io_thread.hpp"
@@ -55,24 +56,31 @@
 #include "curve_server.hpp"
 #include "raw_decoder.hpp"
 #include "raw_encoder.hpp"
+#include "compressor.hpp"
+#include "timestamps.hpp"
 #include "config.hpp"
 #include "err.hpp"
 #include "ip.hpp"
 #include "tcp.hpp"
 #include "likely.hpp"
+#include "trace.hpp"
 #include "wire.hpp"
 
 zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_,
                                        const std::string &endpoint_) :
     s (fd_),
-    as_server(false),
     handle((handle_t)NULL),
+    input_stopped (false),
+    as_server(false),
     inpos (NULL),
     insize (0),
     decoder (NULL),
     outpos (NULL),
     outsize (0),
     encoder (NULL),
+    out_batch_limit (options_.adaptive_batch ?
+        std::min (options_.out_batch_size, (int) adaptive_batch_min) :
+        options_.out_batch_size),
     metadata (NULL),
     handshaking (true),
     greeting_size (v2_greeting_size),
@@ -86,17 +94,36 @@ zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_,
     io_error (false),
     subscription_required (false),
     mechanism (NULL),
-    input_stopped (false),
+    compressor (NULL),
+    send_timestamps (false),
+    stamped_msg_pending (false),
+    tx_more (false),
+    rx_arrived (0),
+    rx_kernel (0),
+    rx_sent (0),
+    rx_written (0),
+    rx_stamped (false),
     output_stopped (false),
     has_handshake_timer (false),
-    has_ttl_timer (false),
-    has_timeout_timer (false),
-    has_heartbeat_timer (false),
+    has_autotune_timer (false),
+    autotune_bytes_sent (0),
+    autotune_bytes_received (0),
+    autotune_sndbuf (options_.sndbuf >= 0 ? -1 : 0),
+    autotune_rcvbuf (options_.rcvbuf >= 0 ? -1 : 0),
+    heartbeat (this, heartbeat_timer_id),
+    next_ping (0),
+    timeout_deadline (0),
+    ttl_deadline (0),
+    msgs_received (0),
+    timeout_mark (0),
+    ttl_mark (0),
     heartbeat_timeout (0),
     socket (NULL)
 {
     int rc = tx_msg.init ();
     errno_assert (rc == 0);
+    rc = stamped_msg.init ();
+    errno_assert (rc == 0);
 
     //  Put the socket into non-blocking mode.
     unblock_socket (s);
@@ -162,6 +189,8 @@ zmq::stream_engine_t::~stream_engine_t ()
 
     int rc = tx_msg.close ();
     errno_assert (rc == 0);
+    rc = stamped_msg.close ();
+    errno_assert (rc == 0);
 
     //  Drop reference to metadata and destroy it if we are
     //  the only user.
@@ -174,6 +203,9 @@ zmq::stream_engine_t::~stream_engine_t ()
     LIBZMQ_DELETE(encoder);
     LIBZMQ_DELETE(decoder);
     LIBZMQ_DELETE(mechanism);
+#ifdef ZMQ_HAVE_ZLIB
+    LIBZMQ_DELETE(compressor);
+#endif
 }
 
 void zmq::stream_engine_t::plug (io_thread_t *io_thread_,
@@ -191,14 +223,15 @@ void zmq::stream_engine_t::plug (io_thread_t *io_thread_,
     //  Connect to I/O threads poller object.
     io_object_t::plug (io_thread_);
     handle = add_fd (s);
+    add_fds ();
     io_error = false;
 
     if (options.raw_socket) {
         // no handshaking for raw sock, instantiate raw encoder and decoders
-        encoder = new (std::nothrow) raw_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) raw_encoder_t (options.out_batch_size);
         alloc_assert (encoder);
 
-        decoder = new (std::nothrow) raw_decoder_t (in_batch_size);
+        decoder = new (std::nothrow) raw_decoder_t (options.in_batch_size);
         alloc_assert (decoder);
 
         // disable handshaking for raw socket
@@ -238,6 +271,12 @@ void zmq::stream_engine_t::plug (io_thread_t *io_thread_,
         outpos [outsize++] = 0x7f;
     }
 
+    //  The first tick finds out whether this is a TCP connection at all.
+    if (options.tcp_autotune) {
+        add_timer (tcp_autotune_interval, autotune_timer_id);
+        has_autotune_timer = true;
+    }
+
     set_pollin (handle);
     set_pollout (handle);
     //  Flush all the data that may have been already received downstream.
@@ -255,20 +294,13 @@ void zmq::stream_engine_t::unplug ()
         has_handshake_timer = false;
     }
 
-    if (has_ttl_timer) {
-        cancel_timer (heartbeat_ttl_timer_id);
-        has_ttl_timer = false;
+    if (has_autotune_timer) {
+        cancel_timer (autotune_timer_id);
+        has_autotune_timer = false;
     }
 
-    if (has_timeout_timer) {
-        cancel_timer (heartbeat_timeout_timer_id);
-        has_timeout_timer = false;
-    }
+    disarm_heartbeat (&heartbeat);
 
-    if (has_heartbeat_timer) {
-        cancel_timer (heartbeat_ivl_timer_id);
-        has_heartbeat_timer = false;
-    }
     //  Cancel all fd subscriptions.
     if (!io_error)
         rm_fd (handle);
@@ -313,7 +345,10 @@ void zmq::stream_engine_t::in_event ()
         size_t bufsize = 0;
         decoder->get_buffer (&inpos, &bufsize);
 
-        const int rc = tcp_read (s, inpos, bufsize);
+        const int rc = read (inpos, bufsize);
+        zmq_trace2 (engine_in_event, this, rc);
+        if (unlikely (options.msg_timestamps))
+            rx_arrived = clock_t::wall_ns ();
 
         if (rc == 0) {
             // connection closed by peer
@@ -329,6 +364,7 @@ void zmq::stream_engine_t::in_event ()
 
         //  Adjust input size
         insize = static_cast <size_t> (rc);
+        autotune_bytes_received += insize;
         // Adjust buffer size to received bytes
         decoder->resize_buffer(insize);
     }
@@ -355,8 +391,7 @@ void zmq::stream_engine_t::in_event ()
             error(protocol_error);
             return;
         }
-        input_stopped = true;
-        reset_pollin (handle);
+        stop_input ();
     }
 
     session->flush ();
@@ -366,6 +401,9 @@ void zmq::stream_engine_t::out_event ()
 {
     zmq_assert (!io_error);
 
+    //  Size of the batch gathered by this call, if batching is adaptive.
+    size_t batch = 0;
+
     //  If write buffer is empty, try to read new data from the encoder.
     if (!outsize) {
 
@@ -378,14 +416,14 @@ void zmq::stream_engine_t::out_event ()
         }
 
         outpos = NULL;
-        outsize = encoder->encode (&outpos, 0);
+        outsize = encoder->encode (&outpos, out_batch_limit);
 
-        while (outsize < (size_t) out_batch_size) {
+        while (outsize < out_batch_limit) {
             if ((this->*next_msg) (&tx_msg) == -1)
                 break;
-            encoder->load_msg (&tx_msg);
             unsigned char *bufptr = outpos + outsize;
-            size_t n = encoder->encode (&bufptr, out_batch_size - outsize);
+            size_t n = encoder->encode_msg (&tx_msg, &bufptr,
+                out_batch_limit - outsize);
             zmq_assert (n > 0);
             if (outpos == NULL)
                 outpos = bufptr;
@@ -398,6 +436,9 @@ void zmq::stream_engine_t::out_event ()
             reset_pollout (handle);
             return;
         }
+
+        if (options.adaptive_batch && !handshaking)
+            batch = outsize;
     }
 
     //  If there are any data to write in write buffer, write as much as
@@ -405,7 +446,8 @@ void zmq::stream_engine_t::out_event ()
     //  arbitrarily large. However, we assume that underlying TCP layer has
     //  limited transmission buffer and thus the actual number of bytes
     //  written should be reasonably modest.
-    const int nbytes = tcp_write (s, outpos, outsize);
+    const int nbytes = write (outpos, outsize);
+    zmq_trace2 (engine_out_event, this, nbytes);
 
     //  IO error has occurred. We stop waiting for output events.
     //  The engine is not terminated until we detect input error;
@@ -417,6 +459,10 @@ void zmq::stream_engine_t::out_event ()
 
     outpos += nbytes;
     outsize -= nbytes;
+    autotune_bytes_sent += nbytes;
+
+    if (batch > 0)
+        adapt_out_batch (batch, batch >= out_batch_limit, nbytes);
 
     //  If we are still handshaking and there are no data
     //  to send, stop polling for output.
@@ -425,6 +471,23 @@ void zmq::stream_engine_t::out_event ()
             reset_pollout (handle);
 }
 
+void zmq::stream_engine_t::adapt_out_batch (size_t batch_, bool full_,
+    size_t written_)
+{
+    const size_t max_limit = options.out_batch_size;
+    const size_t min_limit = std::min (max_limit, (size_t) adaptive_batch_min);
+
+    //  Under sustained load the batch fills up and, as long as the socket
+    //  takes it all in one go, a larger batch saves system calls. When
+    //  the pipe runs nearly empty, a smaller batch bounds how long the
+    //  first message of the next burst waits for the rest to be encoded.
+    if (full_ && written_ == batch_)
+        out_batch_limit = std::min (out_batch_limit * 2, max_limit);
+    else
+    if (!full_ && batch_ < out_batch_limit / 4)
+        out_batch_limit = std::max (out_batch_limit / 2, min_limit);
+}
+
 void zmq::stream_engine_t::restart_output ()
 {
     if (unlikely (io_error))
@@ -442,6 +505,22 @@ void zmq::stream_engine_t::restart_output ()
     out_event ();
 }
 
+void zmq::stream_engine_t::stop_input ()
+{
+    input_stopped = true;
+    reset_pollin (handle);
+}
+
+void zmq::stream_engine_t::resume_input ()
+{
+    input_stopped = false;
+    set_pollin (handle);
+}
+
+void zmq::stream_engine_t::add_fds ()
+{
+}
+
 void zmq::stream_engine_t::restart_input ()
 {
     zmq_assert (input_stopped);
@@ -479,8 +558,7 @@ void zmq::stream_engine_t::restart_input ()
     if (rc == -1)
         error (protocol_error);
     else {
-        input_stopped = false;
-        set_pollin (handle);
+        resume_input ();
         session->flush ();
 
         //  Speculative read.
@@ -494,8 +572,8 @@ bool zmq::stream_engine_t::handshake ()
     zmq_assert (greeting_bytes_read < greeting_size);
     //  Receive the greeting.
     while (greeting_bytes_read < greeting_size) {
-        const int n = tcp_read (s, greeting_recv + greeting_bytes_read,
-                                greeting_size - greeting_bytes_read);
+        const int n = read (greeting_recv + greeting_bytes_read,
+                            greeting_size - greeting_bytes_read);
         if (n == 0) {
             errno = EPIPE;
             error (connection_error);
@@ -583,10 +661,10 @@ bool zmq::stream_engine_t::handshake ()
            return false;
         }
 
-        encoder = new (std::nothrow) v1_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) v1_encoder_t (options.out_batch_size);
         alloc_assert (encoder);
 
-        decoder = new (std::nothrow) v1_decoder_t (in_batch_size, options.maxmsgsize);
+        decoder = new (std::nothrow) v1_decoder_t (options.in_batch_size, options.maxmsgsize);
         alloc_assert (decoder);
 
         //  We have already sent the message header.
@@ -630,11 +708,11 @@ bool zmq::stream_engine_t::handshake ()
            return false;
         }
 
-        encoder = new (std::nothrow) v1_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) v1_encoder_t (options.out_batch_size);
         alloc_assert (encoder);
 
         decoder = new (std::nothrow) v1_decoder_t (
-            in_batch_size, options.maxmsgsize);
+            options.in_batch_size, options.maxmsgsize);
         alloc_assert (decoder);
     }
     else
@@ -645,19 +723,19 @@ bool zmq::stream_engine_t::handshake ()
            return false;
         }
 
-        encoder = new (std::nothrow) v2_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) v2_encoder_t (options.out_batch_size);
         alloc_assert (encoder);
 
         decoder = new (std::nothrow) v2_decoder_t (
-            in_batch_size, options.maxmsgsize);
+            options.in_batch_size, options.maxmsgsize);
         alloc_assert (decoder);
     }
     else {
-        encoder = new (std::nothrow) v2_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) v2_encoder_t (options.out_batch_size);
         alloc_assert (encoder);
 
         decoder = new (std::nothrow) v2_decoder_t (
-                in_batch_size, options.maxmsgsize);
+                options.in_batch_size, options.maxmsgsize);
         alloc_assert (decoder);
 
         if (options.mechanism == ZMQ_NULL
@@ -828,11 +906,20 @@ const char *zmq::stream_engine_t::get_endpoint () const
     return endpoint.c_str ();
 }
 
+//  Returns true if the property is present and has the given value.
+static bool has_property (const zmq::metadata_t::dict_t &properties_,
+    const char *name_, const char *value_)
+{
+    const zmq::metadata_t::dict_t::const_iterator it =
+        properties_.find (name_);
+    return it != properties_.end () && it->second == value_;
+}
+
 void zmq::stream_engine_t::mechanism_ready ()
 {
     if (options.heartbeat_interval > 0) {
-        add_timer(options.heartbeat_interval, heartbeat_ivl_timer_id);
-        has_heartbeat_timer = true;
+        next_ping = clock.now_ms () + options.heartbeat_interval;
+        schedule_heartbeat ();
     }
 
     if (options.recv_identity) {
@@ -864,6 +951,29 @@ void zmq::stream_engine_t::mechanism_ready ()
     const properties_t& zmtp_properties = mechanism->get_zmtp_properties ();
     properties.insert(zmtp_properties.begin (), zmtp_properties.end ());
 
+    //  Compress messages if both peers asked for it. The Compression
+    //  property is only exposed to the application when it is in effect.
+#ifdef ZMQ_HAVE_ZLIB
+    if (options.compression_level > 0
+    &&  has_property (properties, compression_property,
+          compression_algorithm)) {
+        compressor = new (std::nothrow) compressor_t (
+            options.compression_level, options.compression_threshold,
+            options.maxmsgsize);
+        alloc_assert (compressor);
+    }
+#endif
+    if (!compressor)
+        properties.erase (compression_property);
+
+    //  Precede our messages with their timestamps if the peer wants them
+    //  and we take them. The property is only exposed when in effect.
+    if (options.msg_timestamps
+    &&  has_property (properties, timestamps_property, timestamps_clock))
+        send_timestamps = true;
+    else
+        properties.erase (timestamps_property);
+
     zmq_assert (metadata == NULL);
     if (!properties.empty ())
     {
@@ -919,13 +1029,59 @@ int zmq::stream_engine_t::pull_and_encode (msg_t *msg_)
 {
     zmq_assert (mechanism != NULL);
 
+    if (unlikely (send_timestamps)) {
+        if (pull_timestamped (msg_) == -1)
+            return -1;
+    }
+    else
     if (session->pull_msg (msg_) == -1)
         return -1;
+#ifdef ZMQ_HAVE_ZLIB
+    if (compressor && !(msg_->flags () & msg_t::command)
+    &&  compressor->compress (msg_) == -1)
+        return -1;
+#endif
     if (mechanism->encode (msg_) == -1)
         return -1;
     return 0;
 }
 
+int zmq::stream_engine_t::pull_timestamped (msg_t *msg_)
+{
+    if (stamped_msg_pending) {
+        //  The TIMESTAMP command went out, now send its message.
+        int rc = msg_->move (stamped_msg);
+        errno_assert (rc == 0);
+        stamped_msg_pending = false;
+    }
+    else {
+        if (session->pull_msg (msg_) == -1)
+            return -1;
+
+        //  Hold back the first frame of each message and send the
+        //  TIMESTAMP command instead.
+        if (!tx_more && !(msg_->flags () & msg_t::command)) {
+            int rc = stamped_msg.move (*msg_);
+            errno_assert (rc == 0);
+            stamped_msg_pending = true;
+
+            rc = msg_->init_size (timestamp_command_size);
+            errno_assert (rc == 0);
+            msg_->set_flags (msg_t::command);
+            unsigned char *data = (unsigned char *) msg_->data ();
+            memcpy (data, timestamp_command, sizeof (timestamp_command) - 1);
+            data += sizeof (timestamp_command) - 1;
+            const metadata_t *metadata = stamped_msg.metadata ();
+            put_uint64 (data, metadata ? metadata->get_time (time_sent) : 0);
+            put_uint64 (data + 8, clock_t::wall_ns ());
+            return 0;
+        }
+    }
+
+    tx_more = msg_->flags () & msg_t::more ? true : false;
+    return 0;
+}
+
 int zmq::stream_engine_t::decode_and_push (msg_t *msg_)
 {
     zmq_assert (mechanism != NULL);
@@ -933,24 +1089,28 @@ int zmq::stream_engine_t::decode_and_push (msg_t *msg_)
     if (mechanism->decode (msg_) == -1)
         return -1;
 
-    if(has_timeout_timer) {
-        has_timeout_timer = false;
-        cancel_timer(heartbeat_timeout_timer_id);
-    }
-
-    if(has_ttl_timer) {
-        has_ttl_timer = false;
-        cancel_timer(heartbeat_ttl_timer_id);
-    }
+    //  Cancels the pending heartbeat timeout and TTL, if any.
+    msgs_received++;
 
     if(msg_->flags() & msg_t::command) {
         uint8_t cmd_id = *((uint8_t*)msg_->data());
         if(cmd_id == 4)
             process_heartbeat_message(msg_);
+        else
+        if (cmd_id == timestamp_command [0])
+            process_timestamp_command (msg_);
     }
+#ifdef ZMQ_HAVE_ZLIB
+    else
+    if (compressor && compressor->decompress (msg_) == -1)
+        return -1;
+#endif
 
     if (metadata)
         msg_->set_metadata (metadata);
+    if (unlikely (options.msg_timestamps || options.kernel_timestamps)
+    &&  !(msg_->flags () & msg_t::command))
+        add_timestamps (msg_);
     if (session->push_msg (msg_) == -1) {
         if (errno == EAGAIN)
             process_msg = &stream_engine_t::push_one_then_decode_and_push;
@@ -1033,24 +1193,74 @@ void zmq::stream_engine_t::timer_event (int id_)
         //  handshake timer expired before handshake completed, so engine fail
         error (timeout_error);
     }
-    else if(id_ == heartbeat_ivl_timer_id) {
-        next_msg = &stream_engine_t::produce_ping_message;
-        out_event();
-        add_timer(options.heartbeat_interval, heartbeat_ivl_timer_id);
-    }
-    else if(id_ == heartbeat_ttl_timer_id) {
-        has_ttl_timer = false;
-        error(timeout_error);
+    else if(id_ == heartbeat_timer_id) {
+        //  Drop the deadlines cancelled by messages received meanwhile.
+        if (timeout_deadline && msgs_received != timeout_mark)
+            timeout_deadline = 0;
+        if (ttl_deadline && msgs_received != ttl_mark)
+            ttl_deadline = 0;
+
+        const uint64_t now = clock.now_ms ();
+        if ((timeout_deadline && timeout_deadline <= now)
+        ||  (ttl_deadline && ttl_deadline <= now)) {
+            error (timeout_error);
+            return;
+        }
+
+        if (next_ping && next_ping <= now) {
+            next_ping = now + options.heartbeat_interval;
+            next_msg = &stream_engine_t::produce_ping_message;
+            out_event();
+        }
+        schedule_heartbeat ();
     }
-    else if(id_ == heartbeat_timeout_timer_id) {
-        has_timeout_timer = false;
-        error(timeout_error);
+    else if(id_ == autotune_timer_id) {
+        //  Stop if the connection doesn't provide a round trip time.
+        has_autotune_timer = false;
+        const int rc = autotune_tcp_buffers (s, tcp_autotune_interval,
+            autotune_bytes_sent, autotune_bytes_received,
+            &autotune_sndbuf, &autotune_rcvbuf);
+        autotune_bytes_sent = 0;
+        autotune_bytes_received = 0;
+        if (rc == 0) {
+            add_timer (tcp_autotune_interval, autotune_timer_id);
+            has_autotune_timer = true;
+        }
     }
     else
         // There are no other valid timer ids!
         assert(false);
 }
 
+void zmq::stream_engine_t::process_timestamp_command (msg_t *msg_)
+{
+    //  Ignore anything but a well formed TIMESTAMP command.
+    const unsigned char *data = (const unsigned char *) msg_->data ();
+    if (msg_->size () != timestamp_command_size
+    ||  memcmp (data, timestamp_command, sizeof (timestamp_command) - 1))
+        return;
+    data += sizeof (timestamp_command) - 1;
+    rx_sent = get_uint64 (data);
+    rx_written = get_uint64 (data + 8);
+    rx_stamped = true;
+}
+
+void zmq::stream_engine_t::add_timestamps (msg_t *msg_)
+{
+    metadata_t *stamped = stamps.stamp (msg_);
+    if (rx_stamped) {
+        stamped->set_time (time_sent, rx_sent);
+        stamped->set_time (time_written, rx_written);
+        if (!(msg_->flags () & msg_t::more))
+            rx_stamped = false;
+    }
+    if (options.msg_timestamps) {
+        stamped->set_time (time_arrived, rx_arrived);
+        stamped->set_time (time_decoded, clock_t::wall_ns ());
+    }
+    stamped->set_time (time_kernel, rx_kernel);
+}
+
 int zmq::stream_engine_t::produce_ping_message(msg_t * msg_)
 {
     int rc = 0;
@@ -1068,9 +1278,11 @@ int zmq::stream_engine_t::produce_ping_message(msg_t * msg_)
 
     rc = mechanism->encode (msg_);
     next_msg = &stream_engine_t::pull_and_encode;
-    if(!has_timeout_timer && heartbeat_timeout > 0) {
-        add_timer(heartbeat_timeout, heartbeat_timeout_timer_id);
-        has_timeout_timer = true;
+    if (heartbeat_timeout > 0
+    &&  (!timeout_deadline || msgs_received != timeout_mark)) {
+        timeout_deadline = clock.now_ms () + heartbeat_timeout;
+        timeout_mark = msgs_received;
+        schedule_heartbeat ();
     }
     return rc;
 }
@@ -1102,9 +1314,10 @@ int zmq::stream_engine_t::process_heartbeat_message(msg_t * msg_)
         // so we multiply it by 100 to get the timer interval in ms.
         remote_heartbeat_ttl *= 100;
 
-        if(!has_ttl_timer && remote_heartbeat_ttl > 0) {
-            add_timer(remote_heartbeat_ttl, heartbeat_ttl_timer_id);
-            has_ttl_timer = true;
+        if (remote_heartbeat_ttl > 0) {
+            ttl_deadline = clock.now_ms () + remote_heartbeat_ttl;
+            ttl_mark = msgs_received;
+            schedule_heartbeat ();
         }
 
         next_msg = &stream_engine_t::produce_pong_message;
@@ -1113,3 +1326,32 @@ int zmq::stream_engine_t::process_heartbeat_message(msg_t * msg_)
 
     return 0;
 }
+
+void zmq::stream_engine_t::schedule_heartbeat ()
+{
+    uint64_t deadline = next_ping;
+    if (timeout_deadline && (!deadline || timeout_deadline < deadline))
+        deadline = timeout_deadline;
+    if (ttl_deadline && (!deadline || ttl_deadline < deadline))
+        deadline = ttl_deadline;
+
+    if (!deadline) {
+        disarm_heartbeat (&heartbeat);
+        return;
+    }
+
+    const uint64_t now = clock.now_ms ();
+    arm_heartbeat (&heartbeat, deadline > now ? (int) (deadline - now) : 0);
+}
+
+int zmq::stream_engine_t::read (void *data_, size_t size_)
+{
+    if (unlikely (options.kernel_timestamps))
+        return tcp_read_timestamped (s, data_, size_, &rx_kernel);
+    return tcp_read (s, data_, size_);
+}
+
+int zmq::stream_engine_t::write (const void *data_, size_t size_)
+{
+    return tcp_write (s, data_, size_);
+}
@@ -40,6 +40,9 @@
 #include "options.hpp"
 #include "socket_base.hpp"
 #include "metadata.hpp"
+#include "timestamps.hpp"
+#include "clock.hpp"
+#include "heartbeat_scheduler.hpp"
 
 namespace zmq
 {
@@ -54,6 +57,7 @@ namespace zmq
     class msg_t;
     class session_base_t;
     class mechanism_t;
+    class compressor_t;
 
     //  This engine handles any socket with SOCK_STREAM semantics,
     //  e.g. TCP socket or an UNIX domain socket.
@@ -86,10 +90,34 @@ namespace zmq
         void out_event ();
         void timer_event (int id_);
 
-    private:
-        //  Unplug the engine from the session.
-        void unplug ();
+    protected:
+
+        //  Transfer data between the engine buffers and the underlying
+        //  transport. Semantics follow tcp_read and tcp_write; derived
+        //  engines may move the bytes over something other than 's'.
+        virtual int read (void *data_, size_t size_);
+        virtual int write (const void *data_, size_t size_);
+
+        //  Stops polling for input while the session cannot accept
+        //  any more messages, and resumes it.
+        virtual void stop_input ();
+        virtual void resume_input ();
+
+        //  Registers any descriptors besides the socket with the poller
+        //  when the engine is plugged, and unplugs the engine from the
+        //  session.
+        virtual void add_fds ();
+        virtual void unplug ();
+
+        //  Underlying socket.
+        fd_t s;
 
+        handle_t handle;
+
+        //  True iff the engine couldn't consume the last decoded message.
+        bool input_stopped;
+
+    private:
         //  Function to handle network disconnections.
         void error (error_reason_t reason);
 
@@ -112,6 +140,7 @@ namespace zmq
 
         int write_credential (msg_t *msg_);
         int pull_and_encode (msg_t *msg_);
+        int pull_timestamped (msg_t *msg_);
         int decode_and_push (msg_t *msg_);
         int push_one_then_decode_and_push (msg_t *msg_);
 
@@ -128,17 +157,19 @@ namespace zmq
         int produce_ping_message(msg_t * msg_);
         int process_heartbeat_message(msg_t * msg_);
         int produce_pong_message(msg_t * msg_);
+        void process_timestamp_command (msg_t *msg_);
 
-        //  Underlying socket.
-        fd_t s;
+        //  Attaches the timestamps of the message being received.
+        void add_timestamps (msg_t *msg_);
+
+        //  Arms the heartbeat entry for the nearest heartbeat deadline.
+        void schedule_heartbeat ();
 
         //  True iff this is server's engine.
         bool as_server;
 
         msg_t tx_msg;
 
-        handle_t handle;
-
         unsigned char *inpos;
         size_t insize;
         i_decoder *decoder;
@@ -147,6 +178,15 @@ namespace zmq
         size_t outsize;
         i_encoder *encoder;
 
+        //  Number of bytes out_event gathers into one write at most. Fixed
+        //  at ZMQ_OUT_BATCH_SIZE unless batching is adaptive.
+        size_t out_batch_limit;
+
+        //  Adjusts out_batch_limit after a batch of batch_ bytes was
+        //  gathered, full_ if more messages were waiting, and written_
+        //  bytes of it went out with the first write.
+        void adapt_out_batch (size_t batch_, bool full_, size_t written_);
+
         //  Metadata to be attached to received messages. May be NULL.
         metadata_t *metadata;
 
@@ -196,8 +236,30 @@ namespace zmq
 
         mechanism_t *mechanism;
 
-        //  True iff the engine couldn't consume the last decoded message.
-        bool input_stopped;
+        //  Transport compression, NULL unless negotiated with the peer.
+        compressor_t *compressor;
+
+        //  True if the peer asked for the timestamps of our messages.
+        bool send_timestamps;
+
+        //  Message held back while the TIMESTAMP command preceding it is
+        //  sent, and whether the last message sent was incomplete.
+        msg_t stamped_msg;
+        bool stamped_msg_pending;
+        bool tx_more;
+
+        //  Time of the last read from the socket, as seen by us and by the
+        //  kernel if it timestamps the socket, and the times from the
+        //  last TIMESTAMP command, which apply until the message after it
+        //  is complete.
+        uint64_t rx_arrived;
+        uint64_t rx_kernel;
+        uint64_t rx_sent;
+        uint64_t rx_written;
+        bool rx_stamped;
+
+        //  Metadata of the messages stamped on receipt.
+        timestamp_pool_t stamps;
 
         //  True iff the engine doesn't have any message to encode.
         bool output_stopped;
@@ -208,15 +270,30 @@ namespace zmq
         //  True is linger timer is running.
         bool has_handshake_timer;
 
-        //  Heartbeat stuff
-        enum {
-            heartbeat_ivl_timer_id = 0x80,
-            heartbeat_timeout_timer_id = 0x81,
-            heartbeat_ttl_timer_id = 0x82
-        };
-        bool has_ttl_timer;
-        bool has_timeout_timer;
-        bool has_heartbeat_timer;
+        //  TCP buffer autotuning, see ZMQ_TCP_AUTOTUNE. The bytes moved
+        //  since the last tick and the buffer sizes last set, negative
+        //  for a direction sized by ZMQ_SNDBUF or ZMQ_RCVBUF.
+        enum {autotune_timer_id = 0x100};
+        bool has_autotune_timer;
+        uint64_t autotune_bytes_sent;
+        uint64_t autotune_bytes_received;
+        int autotune_sndbuf;
+        int autotune_rcvbuf;
+
+        //  Heartbeat stuff. The deadlines, in milliseconds and zero if not
+        //  set, share a single entry in the I/O thread's heartbeat
+        //  scheduler. Any message received cancels the timeout and TTL
+        //  deadlines; instead of touching the scheduler, that is detected
+        //  on expiry by comparing the number of messages received.
+        enum {heartbeat_timer_id = 0x80};
+        heartbeat_scheduler_t::entry_t heartbeat;
+        clock_t clock;
+        uint64_t next_ping;
+        uint64_t timeout_deadline;
+        uint64_t ttl_deadline;
+        uint64_t msgs_received;
+        uint64_t timeout_mark;
+        uint64_t ttl_mark;
         int heartbeat_timeout;
 
         // Socket
@@ -0,0 +1,169 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_TBUFFER_HPP_INCLUDED__
+#define __ZMQ_TBUFFER_HPP_INCLUDED__
+
+#include <vector>
+
+#include "atomic_counter.hpp"
+#include "err.hpp"
+#include "msg.hpp"
+
+namespace zmq
+{
+
+    //  tbuffer is a single-producer single-consumer lock-free triple-buffer
+    //  implementation. Each of its three slots holds one (possibly
+    //  multipart) message.
+    //
+    //  The writer composes a message in the back slot and publishes it by
+    //  atomically exchanging the back slot with the middle one. The reader
+    //  takes the most recently published message by exchanging its front
+    //  slot with the middle one. Neither side ever waits for the other; a
+    //  published message that was not taken yet is simply replaced by the
+    //  next one, which is ok since writes are many and redundant.
+    //
+    //  The middle slot index is tagged with a flag telling whether it holds
+    //  a message that has not been taken by the reader yet.
+    //
+    //  Users that hand the buffer over to the reader through a queue can
+    //  count the reader's references to it; once there are none left, the
+    //  buffer holds no message and can be destroyed by the writer.
+
+    class tbuffer_t
+    {
+    public:
+
+        typedef std::vector <msg_t> frames_t;
+
+        inline tbuffer_t () :
+            middle (1),
+            back (0),
+            front (2),
+            refs (0)
+        {
+        }
+
+        inline ~tbuffer_t ()
+        {
+            for (int i = 0; i != 3; i++)
+                discard (slots [i]);
+        }
+
+        //  Frames of the message being composed by the writer.
+        inline frames_t &back_frames ()
+        {
+            return slots [back];
+        }
+
+        //  Publishes the back slot, dropping the previously published
+        //  message if the reader has not taken it yet. Returns true if there
+        //  was no such message, i.e. if the reader has yet to learn about
+        //  the new one.
+        inline bool publish ()
+        {
+            const atomic_counter_t::integer_t old =
+                middle.xchg (back | fresh_flag);
+            back = old & index_mask;
+            discard (slots [back]);
+            return !(old & fresh_flag);
+        }
+
+        //  Takes the most recently published message. Must only be called
+        //  when a message is known to be pending. The frames stay owned by
+        //  the buffer until the next call to take.
+        inline frames_t &take ()
+        {
+            const atomic_counter_t::integer_t old = middle.xchg (front);
+            zmq_assert (old & fresh_flag);
+            front = old & index_mask;
+            return slots [front];
+        }
+
+        //  Called by the writer when it queues the buffer for the reader.
+        inline void add_ref ()
+        {
+            refs.add (1);
+        }
+
+        //  Called by the reader once it is done with the message it took
+        //  after finding the buffer in the queue. It must not touch the
+        //  buffer afterwards.
+        inline void release ()
+        {
+            refs.sub (1);
+        }
+
+        //  Called by the writer. True iff the reader neither has the buffer
+        //  queued nor is reading from it.
+        inline bool idle ()
+        {
+            return refs.add (0) == 0;
+        }
+
+    private:
+
+        enum {
+            index_mask = 3,
+            fresh_flag = 4
+        };
+
+        inline static void discard (frames_t &frames_)
+        {
+            for (frames_t::iterator it = frames_.begin ();
+                  it != frames_.end (); ++it) {
+                const int rc = it->close ();
+                errno_assert (rc == 0);
+            }
+            frames_.clear ();
+        }
+
+        frames_t slots [3];
+
+        //  Index of the middle slot, tagged with fresh_flag.
+        atomic_counter_t middle;
+
+        //  Index of the slot owned by the writer.
+        atomic_counter_t::integer_t back;
+
+        //  Index of the slot owned by the reader.
+        atomic_counter_t::integer_t front;
+
+        //  Number of references the reader holds.
+        atomic_counter_t refs;
+
+        //  Disable copying of tbuffer.
+        tbuffer_t (const tbuffer_t&);
+        const tbuffer_t &operator = (const tbuffer_t&);
+    };
+
+}
+
+#endif
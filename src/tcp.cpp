@@ -28,7 +28,10 @@
 */
 
 #include "precompiled.hpp"
+#include <algorithm>
+
 #include "macros.hpp"
+#include "config.hpp"
 #include "ip.hpp"
 #include "tcp.hpp"
 #include "err.hpp"
@@ -191,6 +194,97 @@ int zmq::tune_tcp_maxrt (fd_t sockfd_, int timeout_)
     return 0;
 }
 
+int zmq::tune_tcp_notsent_lowat (fd_t sockfd_, int bytes_)
+{
+    if (bytes_ < 0)
+        return 0;
+
+#if defined (TCP_NOTSENT_LOWAT)
+    int rc = setsockopt (sockfd_, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &bytes_,
+        sizeof (bytes_));
+    tcp_assert_tuning_error (sockfd_, rc);
+#else
+    LIBZMQ_UNUSED (sockfd_);
+    int rc = 0;
+#endif
+    return rc;
+}
+
+#if defined ZMQ_HAVE_LINUX && defined TCP_INFO
+//  Returns the size to give a buffer that last had set_ bytes set, zero
+//  if none, or zero to keep its size. The target is twice the
+//  bandwidth-delay product, within the autotuning range. Until the buffer
+//  is set the kernel tunes it, so it is only grown past twice the kernel's
+//  own size. Once set, it grows when the target doubles and halves, one
+//  step per interval, while the target stays below a quarter of it.
+static int autotune_buffer_size (zmq::fd_t sockfd_, int option_,
+    uint64_t bytes_, int interval_, uint32_t rtt_us_, int set_)
+{
+    uint64_t size = 2 * bytes_ * rtt_us_ / (uint64_t (interval_) * 1000);
+    size = std::max (size, (uint64_t) zmq::tcp_autotune_min_buffer);
+    size = std::min (size, (uint64_t) zmq::tcp_autotune_max_buffer);
+
+    if (set_ > 0) {
+        if (size >= 2 * uint64_t (set_))
+            return int (size);
+        if (4 * size <= uint64_t (set_))
+            return std::max (int (size), set_ / 2);
+        return 0;
+    }
+
+    int current = 0;
+    socklen_t len = sizeof current;
+    const int rc = getsockopt (sockfd_, SOL_SOCKET, option_,
+        (char *) &current, &len);
+    if (rc != 0 || size < 2 * uint64_t (current))
+        return 0;
+    return int (size);
+}
+#endif
+
+int zmq::autotune_tcp_buffers (fd_t sockfd_, int interval_,
+    uint64_t bytes_sent_, uint64_t bytes_received_,
+    int *sndbuf_, int *rcvbuf_)
+{
+#if defined ZMQ_HAVE_LINUX && defined TCP_INFO
+    struct tcp_info info;
+    socklen_t len = sizeof info;
+    const int rc = getsockopt (sockfd_, IPPROTO_TCP, TCP_INFO, &info, &len);
+    if (rc != 0 || info.tcpi_rtt == 0)
+        return -1;
+
+    //  An idle direction counts as a low bandwidth-delay product, so the
+    //  buffers a burst grew are given back gradually.
+    if (*sndbuf_ >= 0) {
+        const int size = autotune_buffer_size (sockfd_, SO_SNDBUF,
+            bytes_sent_, interval_, info.tcpi_rtt, *sndbuf_);
+        if (size > 0 && set_tcp_send_buffer (sockfd_, size) == 0)
+            *sndbuf_ = size;
+    }
+
+    //  A receiver that doesn't send has only its own estimate of the
+    //  round trip time.
+    if (*rcvbuf_ >= 0) {
+        const uint32_t rtt = info.tcpi_rcv_rtt ? info.tcpi_rcv_rtt :
+            info.tcpi_rtt;
+        const int size = autotune_buffer_size (sockfd_, SO_RCVBUF,
+            bytes_received_, interval_, rtt, *rcvbuf_);
+        if (size > 0 && set_tcp_receive_buffer (sockfd_, size) == 0)
+            *rcvbuf_ = size;
+    }
+    return 0;
+#else
+    LIBZMQ_UNUSED (sockfd_);
+    LIBZMQ_UNUSED (interval_);
+    LIBZMQ_UNUSED (bytes_sent_);
+    LIBZMQ_UNUSED (bytes_received_);
+    LIBZMQ_UNUSED (sndbuf_);
+    LIBZMQ_UNUSED (rcvbuf_);
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
  int zmq::tcp_write (fd_t s_, const void *data_, size_t size_)
 {
 #ifdef ZMQ_HAVE_WINDOWS
@@ -252,6 +346,23 @@ int zmq::tune_tcp_maxrt (fd_t sockfd_, int timeout_)
 #endif
 }
 
+#if !defined ZMQ_HAVE_WINDOWS
+//  Several errors are OK. When speculative read is being done we may not
+//  be able to read a single byte from the socket. Also, SIGSTOP issued
+//  by a debugging tool can result in EINTR error.
+static void check_read (ssize_t rc_)
+{
+    if (rc_ == -1) {
+        errno_assert (errno != EBADF
+                   && errno != EFAULT
+                   && errno != ENOMEM
+                   && errno != ENOTSOCK);
+        if (errno == EWOULDBLOCK || errno == EINTR)
+            errno = EAGAIN;
+    }
+}
+#endif
+
 int zmq::tcp_read (fd_t s_, void *data_, size_t size_)
 {
 #ifdef ZMQ_HAVE_WINDOWS
@@ -282,24 +393,26 @@ int zmq::tcp_read (fd_t s_, void *data_, size_t size_)
 #else
 
     const ssize_t rc = recv (s_, data_, size_, 0);
-
-    //  Several errors are OK. When speculative read is being done we may not
-    //  be able to read a single byte from the socket. Also, SIGSTOP issued
-    //  by a debugging tool can result in EINTR error.
-    if (rc == -1) {
-        errno_assert (errno != EBADF
-                   && errno != EFAULT
-                   && errno != ENOMEM
-                   && errno != ENOTSOCK);
-        if (errno == EWOULDBLOCK || errno == EINTR)
-            errno = EAGAIN;
-    }
-
+    check_read (rc);
     return static_cast <int> (rc);
 
 #endif
 }
 
+int zmq::tcp_read_timestamped (fd_t s_, void *data_, size_t size_,
+    uint64_t *timestamp_)
+{
+#if defined ZMQ_HAVE_LINUX
+    const int rc = recv_timestamped (s_, data_, size_, NULL, NULL,
+        timestamp_);
+    check_read (rc);
+    return rc;
+#else
+    *timestamp_ = 0;
+    return tcp_read (s_, data_, size_);
+#endif
+}
+
 void zmq::tcp_assert_tuning_error (zmq::fd_t s_, int rc_)
 {
     if (rc_ == 0)
@@ -31,6 +31,7 @@
 #define __ZMQ_TCP_HPP_INCLUDED__
 
 #include "fd.hpp"
+#include "stdint.hpp"
 
 namespace zmq
 {
@@ -51,6 +52,20 @@ namespace zmq
     //  Tunes TCP max retransmit timeout
     int tune_tcp_maxrt (fd_t sockfd_, int timeout_);
 
+    //  Limits the unsent data the kernel queues for the socket, so that
+    //  it reports the socket writable only when the queue runs low.
+    int tune_tcp_notsent_lowat (fd_t sockfd_, int bytes_);
+
+    //  Resizes the socket buffers to the bandwidth-delay product given by
+    //  the round trip time and the bytes sent and received over the last
+    //  interval_ milliseconds. sndbuf_ and rcvbuf_ hold the sizes last set,
+    //  zero while the kernel tunes the buffer; directions where they are
+    //  negative are left alone.
+    //  Returns -1 if the round trip time is not available.
+    int autotune_tcp_buffers (fd_t sockfd_, int interval_,
+        uint64_t bytes_sent_, uint64_t bytes_received_,
+        int *sndbuf_, int *rcvbuf_);
+
     //  Writes data to the socket. Returns the number of bytes actually
     //  written (even zero is to be considered to be a success). In case
     //  of error or orderly shutdown by the other peer -1 is returned.
@@ -61,6 +76,12 @@ namespace zmq
     //  Zero indicates the peer has closed the connection.
     int tcp_read (fd_t s_, void *data_, size_t size_);
 
+    //  Same as tcp_read, but also stores in 'timestamp_' the time the
+    //  kernel received the last bytes read, in nanoseconds since the
+    //  epoch, or zero if unknown. See enable_rx_timestamps.
+    int tcp_read_timestamped (fd_t s_, void *data_, size_t size_,
+        uint64_t *timestamp_);
+
     //  Asserts that an internal error did not occur.  Does not assert
     //  on network errors such as reset or aborted connections.
     void tcp_assert_tuning_error (fd_t s_, int rc_);
@@ -30,6 +30,7 @@
 #include "precompiled.hpp"
 #include <string>
 #include <sstream>
+#include <algorithm>
 
 #include "macros.hpp"
 #include "tcp_address.hpp"
@@ -438,8 +439,10 @@ int zmq::tcp_address_t::resolve_interface (const char *interface_, bool ipv6_, b
     memset (&req, 0, sizeof (req) );
 
     //  Choose IPv4 or IPv6 protocol family. Note that IPv6 allows for
-    //  IPv4-in-IPv6 addresses.
-    req.ai_family = ipv6_? AF_INET6: AF_INET;
+    //  IPv4-in-IPv6 addresses. When collecting every address both
+    //  families are asked for, so that either can be tried.
+    const bool all = resolving_all && !is_src_;
+    req.ai_family = ipv6_? (all? AF_UNSPEC: AF_INET6): AF_INET;
 
     //  Arbitrary, not used in the output, but avoids duplicate results.
     req.ai_socktype = SOCK_STREAM;
@@ -509,8 +512,10 @@ int zmq::tcp_address_t::resolve_hostname (const char *hostname_, bool ipv6_, boo
     memset (&req, 0, sizeof (req) );
 
     //  Choose IPv4 or IPv6 protocol family. Note that IPv6 allows for
-    //  IPv4-in-IPv6 addresses.
-    req.ai_family = ipv6_? AF_INET6: AF_INET;
+    //  IPv4-in-IPv6 addresses. When collecting every address both
+    //  families are asked for, so that either can be tried.
+    const bool all = resolving_all && !is_src_;
+    req.ai_family = ipv6_? (all? AF_UNSPEC: AF_INET6): AF_INET;
 
     //  Need to choose one to avoid duplicate results from getaddrinfo() - this
     //  doesn't really matter, since it's not included in the addr-output.
@@ -561,20 +566,56 @@ int zmq::tcp_address_t::resolve_hostname (const char *hostname_, bool ipv6_, boo
     else
         memcpy (&address, res->ai_addr, res->ai_addrlen);
 
+    //  Keep the other results as well, alternating the address families
+    //  starting with the preferred one (RFC 8305, section 4).
+    if (all) {
+        std::vector <ip_sockaddr_t> preferred;
+        std::vector <ip_sockaddr_t> other;
+#if defined ZMQ_HAVE_OPENVMS && defined __ia64 && __INITIAL_POINTER_SIZE == 64
+        for (__addrinfo64 *it = res; it != NULL; it = it->ai_next) {
+#else
+        for (addrinfo *it = res; it != NULL; it = it->ai_next) {
+#endif
+            if (it->ai_family != AF_INET && it->ai_family != AF_INET6)
+                continue;
+            zmq_assert ((size_t) it->ai_addrlen <= sizeof (ip_sockaddr_t));
+            ip_sockaddr_t sa;
+            memset (&sa, 0, sizeof sa);
+            memcpy (&sa, it->ai_addr, it->ai_addrlen);
+            std::vector <ip_sockaddr_t> &list =
+                it->ai_family == res->ai_family? preferred: other;
+            bool duplicate = false;
+            for (size_t i = 0; i != list.size () && !duplicate; i++)
+                duplicate = memcmp (&list [i], &sa, sizeof sa) == 0;
+            if (!duplicate)
+                list.push_back (sa);
+        }
+        addresses.clear ();
+        const size_t rounds = std::max (preferred.size (), other.size ());
+        for (size_t i = 0; i != rounds; i++) {
+            if (i < preferred.size ())
+                addresses.push_back (preferred [i]);
+            if (i < other.size ())
+                addresses.push_back (other [i]);
+        }
+    }
+
     freeaddrinfo (res);
 
     return 0;
 }
 
 zmq::tcp_address_t::tcp_address_t () :
-    _has_src_addr (false)
+    _has_src_addr (false),
+    resolving_all (false)
 {
     memset (&address, 0, sizeof (address) );
     memset (&source_address, 0, sizeof (source_address) );
 }
 
 zmq::tcp_address_t::tcp_address_t (const sockaddr *sa, socklen_t sa_len) :
-    _has_src_addr (false)
+    _has_src_addr (false),
+    resolving_all (false)
 {
     zmq_assert (sa && sa_len > 0);
 
@@ -688,11 +729,53 @@ int zmq::tcp_address_t::resolve (const char *name_, bool local_, bool ipv6_, boo
         }
         else
             address.ipv4.sin_port = htons (port);
+
+        for (size_t i = 0; i != addresses.size (); i++)
+            if (addresses [i].generic.sa_family == AF_INET6) {
+                addresses [i].ipv6.sin6_port = htons (port);
+                addresses [i].ipv6.sin6_scope_id = zone_id;
+            }
+            else
+                addresses [i].ipv4.sin_port = htons (port);
     }
 
     return 0;
 }
 
+int zmq::tcp_address_t::resolve_all (const char *name_, bool ipv6_)
+{
+    addresses.clear ();
+    resolving_all = true;
+    const int rc = resolve (name_, false, ipv6_);
+    resolving_all = false;
+    if (rc != 0) {
+        addresses.clear ();
+        return -1;
+    }
+    if (addresses.empty ()) {
+        ip_sockaddr_t sa;
+        memcpy (&sa, &address, sizeof sa);
+        addresses.push_back (sa);
+    }
+    select_address (0);
+    return 0;
+}
+
+size_t zmq::tcp_address_t::address_count () const
+{
+    return addresses.empty ()? 1: addresses.size ();
+}
+
+void zmq::tcp_address_t::select_address (size_t index_)
+{
+    if (addresses.empty ()) {
+        zmq_assert (index_ == 0);
+        return;
+    }
+    zmq_assert (index_ < addresses.size ());
+    memcpy (&address, &addresses [index_], sizeof address);
+}
+
 int zmq::tcp_address_t::to_string (std::string &addr_)
 {
     if (address.generic.sa_family != AF_INET
@@ -30,6 +30,8 @@
 #ifndef __ZMQ_TCP_ADDRESS_HPP_INCLUDED__
 #define __ZMQ_TCP_ADDRESS_HPP_INCLUDED__
 
+#include <vector>
+
 #if !defined ZMQ_HAVE_WINDOWS
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -38,6 +40,14 @@
 namespace zmq
 {
 
+    //  Socket address of either IP family.
+    union ip_sockaddr_t
+    {
+        sockaddr generic;
+        sockaddr_in ipv4;
+        sockaddr_in6 ipv6;
+    };
+
     class tcp_address_t
     {
     public:
@@ -52,6 +62,19 @@ namespace zmq
         //  If 'ipv6' is true, the name may resolve to IPv6 address.
         int resolve (const char *name_, bool local_, bool ipv6_, bool is_src_ = false);
 
+        //  Resolves a remote address like resolve () does, but keeps every
+        //  address the host name maps to, of both families if 'ipv6_' is
+        //  set. The addresses are ordered for connection attempts, the
+        //  families alternating, and the first of them becomes current.
+        int resolve_all (const char *name_, bool ipv6_);
+
+        //  Number of addresses resolve_all () found, 1 after resolve ().
+        size_t address_count () const;
+
+        //  Makes the index_-th address found by resolve_all () current,
+        //  i.e. the one returned by addr ().
+        void select_address (size_t index_);
+
         //  The opposite to resolve()
         virtual int to_string (std::string &addr_);
 
@@ -89,6 +112,10 @@ namespace zmq
             sockaddr_in6 ipv6;
         } source_address;
         bool _has_src_addr;
+
+        //  All addresses found by resolve_all (), if it was used.
+        std::vector <ip_sockaddr_t> addresses;
+        bool resolving_all;
     };
 
     class tcp_address_mask_t : public tcp_address_t
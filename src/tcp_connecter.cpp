@@ -42,6 +42,8 @@
 #include "address.hpp"
 #include "tcp_address.hpp"
 #include "session_base.hpp"
+#include "ctx.hpp"
+#include "dns_resolver.hpp"
 
 #if !defined ZMQ_HAVE_WINDOWS
 #include <unistd.h>
@@ -63,12 +65,14 @@ zmq::tcp_connecter_t::tcp_connecter_t (class io_thread_t *io_thread_,
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
     addr (addr_),
-    s (retired_fd),
-    handle((handle_t)NULL),
-    handle_valid (false),
+    next_address (0),
     delayed_start (delayed_start_),
     connect_timer_started (false),
     reconnect_timer_started (false),
+    attempt_timer_started (false),
+    resolving (false),
+    resolve_ipv6 (options.ipv6),
+    retry_ipv4 (false),
     session (session_),
     current_reconnect_ivl (options.reconnect_ivl)
 {
@@ -82,8 +86,9 @@ zmq::tcp_connecter_t::~tcp_connecter_t ()
 {
     zmq_assert (!connect_timer_started);
     zmq_assert (!reconnect_timer_started);
-    zmq_assert (!handle_valid);
-    zmq_assert (s == retired_fd);
+    zmq_assert (!attempt_timer_started);
+    zmq_assert (!resolving);
+    zmq_assert (attempts.empty ());
 }
 
 void zmq::tcp_connecter_t::process_plug ()
@@ -106,17 +111,30 @@ void zmq::tcp_connecter_t::process_term (int linger_)
         reconnect_timer_started = false;
     }
 
-    if (handle_valid) {
-        rm_fd (handle);
-        handle_valid = false;
+    if (resolving) {
+        get_ctx ()->get_resolver ()->cancel (this);
+        resolving = false;
     }
 
-    if (s != retired_fd)
-        close ();
+    close_attempts ();
 
     own_t::process_term (linger_);
 }
 
+void zmq::tcp_connecter_t::process_resolved (tcp_address_t *address_,
+    int error_)
+{
+    //  The answer was already on its way when we were asked to terminate.
+    if (!resolving) {
+        LIBZMQ_DELETE (address_);
+        return;
+    }
+
+    resolving = false;
+    errno = error_;
+    connect_to (address_);
+}
+
 void zmq::tcp_connecter_t::in_event ()
 {
     //  We are not polling for incoming data, so we are actually called
@@ -127,36 +145,72 @@ void zmq::tcp_connecter_t::in_event ()
 
 void zmq::tcp_connecter_t::out_event ()
 {
-    if (connect_timer_started) {
-        cancel_timer (connect_timer_id);
-        connect_timer_started = false;
+    //  The event does not tell which of the attempts it is about, so
+    //  check on all of them.
+    fd_t fd = retired_fd;
+    bool failed = false;
+    for (attempts_t::iterator it = attempts.begin (); it != attempts.end ();) {
+        const int rc = check_connect (it->s);
+        if (rc == 0) {
+            ++it;
+            continue;
+        }
+        rm_fd (it->handle);
+        if (rc == 1 && fd == retired_fd) {
+            fd = it->s;
+            addr->resolved.tcp_addr->select_address (it->index);
+        }
+        else {
+            close (it->s);
+            failed = true;
+        }
+        it = attempts.erase (it);
     }
 
-    rm_fd (handle);
-    handle_valid = false;
+    if (fd != retired_fd) {
+        connected (fd);
+        return;
+    }
 
-    const fd_t fd = connect ();
+    //  Handle the error condition by trying the next address without
+    //  waiting for the attempt delay, eventually by reconnecting.
+    if (failed) {
+        if (attempt_timer_started) {
+            cancel_timer (attempt_timer_id);
+            attempt_timer_started = false;
+        }
+        start_attempts ();
+    }
+}
 
-    //  Handle the error condition by attempt to reconnect.
-    if (fd == retired_fd) {
-        close ();
-        add_reconnect_timer ();
-        return;
+void zmq::tcp_connecter_t::connected (fd_t fd_)
+{
+    if (connect_timer_started) {
+        cancel_timer (connect_timer_id);
+        connect_timer_started = false;
     }
 
-    int rc = tune_tcp_socket (fd);
-    rc = rc | tune_tcp_keepalives (fd, options.tcp_keepalive, options.tcp_keepalive_cnt,
+    //  The attempts to other addresses lost the race.
+    close_attempts ();
+
+    int rc = tune_tcp_socket (fd_);
+    rc = rc | tune_tcp_keepalives (fd_, options.tcp_keepalive, options.tcp_keepalive_cnt,
         options.tcp_keepalive_idle, options.tcp_keepalive_intvl);
-    rc = rc | tune_tcp_maxrt (fd, options.tcp_maxrt);
+    rc = rc | tune_tcp_maxrt (fd_, options.tcp_maxrt);
+    rc = rc | tune_tcp_notsent_lowat (fd_, options.tcp_notsent_lowat);
     if (rc != 0) {
-        close ();
+        close (fd_);
         add_reconnect_timer ();
         return;
     }
 
+    //  Without kernel support messages just go without the timestamp.
+    if (options.kernel_timestamps)
+        enable_rx_timestamps (fd_);
+
     //  Create the engine object for this connection.
     stream_engine_t *engine = new (std::nothrow)
-        stream_engine_t (fd, options, endpoint);
+        stream_engine_t (fd_, options, endpoint);
     alloc_assert (engine);
 
     //  Attach the engine to the corresponding session object.
@@ -165,57 +219,135 @@ void zmq::tcp_connecter_t::out_event ()
     //  Shut the connecter down.
     terminate ();
 
-    socket->event_connected (endpoint, (int) fd);
+    socket->event_connected (endpoint, (int) fd_);
 }
 
 void zmq::tcp_connecter_t::timer_event (int id_)
 {
-    zmq_assert (id_ == reconnect_timer_id || id_ == connect_timer_id);
+    zmq_assert (id_ == reconnect_timer_id || id_ == connect_timer_id ||
+        id_ == attempt_timer_id);
     if (id_ == connect_timer_id) {
         connect_timer_started = false;
-
-        rm_fd (handle);
-        handle_valid = false;
-
-        close ();
+        close_attempts ();
         add_reconnect_timer ();
     }
     else if (id_ == reconnect_timer_id) {
         reconnect_timer_started = false;
         start_connecting ();
     }
+    else if (id_ == attempt_timer_id) {
+        attempt_timer_started = false;
+        start_attempts ();
+    }
 }
 
 void zmq::tcp_connecter_t::start_connecting ()
 {
-    //  Open the connecting socket.
-    const int rc = open ();
-
-    //  Connect may succeed in synchronous manner.
-    if (rc == 0) {
-        handle = add_fd (s);
-        handle_valid = true;
-        out_event ();
+    //  Host names are looked up off the I/O thread. Unless the answer is
+    //  cached we carry on in process_resolved.
+    tcp_address_t *address = NULL;
+    const int rc = get_ctx ()->get_resolver ()->resolve (this, addr->address,
+        resolve_ipv6, &address);
+    if (rc == -1 && errno == EAGAIN) {
+        resolving = true;
+        return;
+    }
+    connect_to (address);
+}
+
+void zmq::tcp_connecter_t::connect_to (tcp_address_t *address_)
+{
+    //  Handle failed resolution by eventual reconnect.
+    if (address_ == NULL) {
+        add_reconnect_timer ();
+        return;
     }
 
-    //  Connection establishment may be delayed. Poll for its completion.
-    else
-    if (rc == -1 && errno == EINPROGRESS) {
-        handle = add_fd (s);
-        handle_valid = true;
-        set_pollout (handle);
-        socket->event_connect_delayed (endpoint, zmq_errno());
-
-        //  add userspace connect timeout
-        add_connect_timer ();
+    LIBZMQ_DELETE (addr->resolved.tcp_addr);
+    addr->resolved.tcp_addr = address_;
+
+    next_address = 0;
+    start_attempts ();
+}
+
+void zmq::tcp_connecter_t::start_attempts ()
+{
+    zmq_assert (!attempt_timer_started);
+    const size_t count = addr->resolved.tcp_addr->address_count ();
+
+    while (next_address < count) {
+        const size_t index = next_address++;
+
+        //  Open the connecting socket.
+        fd_t fd = retired_fd;
+        const int rc = open (index, fd);
+
+        //  Connect may succeed in synchronous manner.
+        if (rc == 0) {
+            addr->resolved.tcp_addr->select_address (index);
+            connected (fd);
+            return;
+        }
+
+        //  Connection establishment may be delayed. Poll for its
+        //  completion, giving it a head start over the next address.
+        if (rc == -1 && errno == EINPROGRESS) {
+            attempt_t attempt = {fd, add_fd (fd), index};
+            set_pollout (attempt.handle);
+            attempts.push_back (attempt);
+
+            if (attempts.size () == 1) {
+                socket->event_connect_delayed (endpoint, zmq_errno());
+
+                //  add userspace connect timeout
+                if (!connect_timer_started)
+                    add_connect_timer ();
+            }
+            if (next_address < count) {
+                add_timer (connect_attempt_delay, attempt_timer_id);
+                attempt_timer_started = true;
+            }
+            return;
+        }
+
+        //  Any other error condition moves on to the next address.
+        if (fd != retired_fd)
+            close (fd);
+    }
+
+    //  Out of addresses; the attempts still in progress may succeed.
+    if (!attempts.empty ())
+        return;
+
+    if (connect_timer_started) {
+        cancel_timer (connect_timer_id);
+        connect_timer_started = false;
+    }
+
+    //  IPv6 is not supported after all; look the name up again for IPv4.
+    if (retry_ipv4) {
+        retry_ipv4 = false;
+        start_connecting ();
     }
 
     //  Handle any other error condition by eventual reconnect.
-    else {
-        if (s != retired_fd)
-            close ();
+    else
         add_reconnect_timer ();
+}
+
+void zmq::tcp_connecter_t::close_attempts ()
+{
+    if (attempt_timer_started) {
+        cancel_timer (attempt_timer_id);
+        attempt_timer_started = false;
+    }
+
+    for (attempts_t::iterator it = attempts.begin (); it != attempts.end ();
+          ++it) {
+        rm_fd (it->handle);
+        close (it->s);
     }
+    attempts.clear ();
 }
 
 void zmq::tcp_connecter_t::add_connect_timer ()
@@ -250,77 +382,61 @@ int zmq::tcp_connecter_t::get_new_reconnect_ivl ()
     return interval;
 }
 
-int zmq::tcp_connecter_t::open ()
+int zmq::tcp_connecter_t::open (size_t index_, fd_t &s_)
 {
-    zmq_assert (s == retired_fd);
-
-    //  Resolve the address
-    if (addr->resolved.tcp_addr != NULL) {
-        LIBZMQ_DELETE(addr->resolved.tcp_addr);
-    }
-
-    addr->resolved.tcp_addr = new (std::nothrow) tcp_address_t ();
-    alloc_assert (addr->resolved.tcp_addr);
-    int rc = addr->resolved.tcp_addr->resolve (
-        addr->address.c_str (), false, options.ipv6);
-    if (rc != 0) {
-        LIBZMQ_DELETE(addr->resolved.tcp_addr);
-        return -1;
-    }
     zmq_assert (addr->resolved.tcp_addr != NULL);
     tcp_address_t * const tcp_addr = addr->resolved.tcp_addr;
+    tcp_addr->select_address (index_);
 
     //  Create the socket.
-    s = open_socket (tcp_addr->family (), SOCK_STREAM, IPPROTO_TCP);
+    s_ = open_socket (tcp_addr->family (), SOCK_STREAM, IPPROTO_TCP);
 
     //  IPv6 address family not supported, try automatic downgrade to IPv4.
-    if (s == zmq::retired_fd && tcp_addr->family () == AF_INET6
+    if (s_ == zmq::retired_fd && tcp_addr->family () == AF_INET6
     && errno == EAFNOSUPPORT
-    && options.ipv6) {
-        rc = addr->resolved.tcp_addr->resolve (
-            addr->address.c_str (), false, false);
-        if (rc != 0) {
-            LIBZMQ_DELETE(addr->resolved.tcp_addr);
-            return -1;
-        }
-        s = open_socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    && resolve_ipv6) {
+        resolve_ipv6 = false;
+        retry_ipv4 = true;
+        return -1;
     }
 
 #ifdef ZMQ_HAVE_WINDOWS
-    if (s == INVALID_SOCKET) {
+    if (s_ == INVALID_SOCKET) {
         errno = wsa_error_to_errno (WSAGetLastError ());
         return -1;
     }
 #else
-    if (s == -1)
+    if (s_ == -1)
         return -1;
 #endif
 
     //  On some systems, IPv4 mapping in IPv6 sockets is disabled by default.
     //  Switch it on in such cases.
     if (tcp_addr->family () == AF_INET6)
-        enable_ipv4_mapping (s);
+        enable_ipv4_mapping (s_);
 
     // Set the IP Type-Of-Service priority for this socket
     if (options.tos != 0)
-        set_ip_type_of_service (s, options.tos);
+        set_ip_type_of_service (s_, options.tos);
 
     // Bind the socket to a device if applicable
     if (!options.bound_device.empty ())
-        bind_to_device (s, options.bound_device);
+        bind_to_device (s_, options.bound_device);
 
     // Set the socket to non-blocking mode so that we get async connect().
-    unblock_socket (s);
+    unblock_socket (s_);
 
     //  Set the socket buffer limits for the underlying socket.
     if (options.sndbuf >= 0)
-        set_tcp_send_buffer (s, options.sndbuf);
+        set_tcp_send_buffer (s_, options.sndbuf);
     if (options.rcvbuf >= 0)
-        set_tcp_receive_buffer (s, options.rcvbuf);
+        set_tcp_receive_buffer (s_, options.rcvbuf);
 
     // Set the IP Type-Of-Service for the underlying socket
     if (options.tos != 0)
-        set_ip_type_of_service (s, options.tos);
+        set_ip_type_of_service (s_, options.tos);
+
+    int rc;
 
     // Set a source address for conversations
     if (tcp_addr->has_src_addr ()) {
@@ -328,21 +444,21 @@ int zmq::tcp_connecter_t::open ()
         //  using the same source port on the client.
         int flag = 1;
 #ifdef ZMQ_HAVE_WINDOWS
-        rc = setsockopt (s, SOL_SOCKET, SO_REUSEADDR, (const char*) &flag,
+        rc = setsockopt (s_, SOL_SOCKET, SO_REUSEADDR, (const char*) &flag,
                 sizeof (int));
         wsa_assert (rc != SOCKET_ERROR);
 #else
-        rc = setsockopt (s, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof (int));
+        rc = setsockopt (s_, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof (int));
         errno_assert (rc == 0);
 #endif
 
-        rc = ::bind (s, tcp_addr->src_addr (), tcp_addr->src_addrlen ());
+        rc = ::bind (s_, tcp_addr->src_addr (), tcp_addr->src_addrlen ());
         if (rc == -1)
             return -1;
     }
 
     //  Connect to the remote peer.
-    rc = ::connect (s, tcp_addr->addr (), tcp_addr->addrlen ());
+    rc = ::connect (s_, tcp_addr->addr (), tcp_addr->addrlen ());
 
     //  Connect was successful immediately.
     if (rc == 0)
@@ -363,9 +479,9 @@ int zmq::tcp_connecter_t::open ()
     return -1;
 }
 
-zmq::fd_t zmq::tcp_connecter_t::connect ()
+int zmq::tcp_connecter_t::check_connect (fd_t s_)
 {
-    //  Async connect has finished. Check whether an error occurred
+    //  Check whether an error occurred
     int err = 0;
 #ifdef ZMQ_HAVE_HPUX
     int len = sizeof err;
@@ -373,7 +489,7 @@ zmq::fd_t zmq::tcp_connecter_t::connect ()
     socklen_t len = sizeof err;
 #endif
 
-    const int rc = getsockopt (s, SOL_SOCKET, SO_ERROR, (char*) &err, &len);
+    const int rc = getsockopt (s_, SOL_SOCKET, SO_ERROR, (char*) &err, &len);
 
     //  Assert if the error was caused by 0MQ bug.
     //  Networking problems are OK. No need to assert.
@@ -387,7 +503,7 @@ zmq::fd_t zmq::tcp_connecter_t::connect ()
         {
             wsa_assert_no (err);
         }
-        return retired_fd;
+        return -1;
     }
 #else
     //  Following code should handle both Berkeley-derived socket
@@ -401,26 +517,32 @@ zmq::fd_t zmq::tcp_connecter_t::connect ()
             errno != ENOPROTOOPT &&
             errno != ENOTSOCK &&
             errno != ENOBUFS);
-        return retired_fd;
+        return -1;
     }
 #endif
 
-    //  Return the newly connected socket.
-    const fd_t result = s;
-    s = retired_fd;
-    return result;
+    //  No error but no peer either: the connect is still in progress.
+    struct sockaddr_storage peer;
+#ifdef ZMQ_HAVE_HPUX
+    int peer_len = sizeof peer;
+#else
+    socklen_t peer_len = sizeof peer;
+#endif
+    if (getpeername (s_, (struct sockaddr *) &peer, &peer_len) != 0)
+        return 0;
+
+    return 1;
 }
 
-void zmq::tcp_connecter_t::close ()
+void zmq::tcp_connecter_t::close (fd_t s_)
 {
-    zmq_assert (s != retired_fd);
+    zmq_assert (s_ != retired_fd);
 #ifdef ZMQ_HAVE_WINDOWS
-    const int rc = closesocket (s);
+    const int rc = closesocket (s_);
     wsa_assert (rc != SOCKET_ERROR);
 #else
-    const int rc = ::close (s);
+    const int rc = ::close (s_);
     errno_assert (rc == 0);
 #endif
-    socket->event_closed (endpoint, (int) s);
-    s = retired_fd;
+    socket->event_closed (endpoint, (int) s_);
 }
@@ -30,6 +30,8 @@
 #ifndef __TCP_CONNECTER_HPP_INCLUDED__
 #define __TCP_CONNECTER_HPP_INCLUDED__
 
+#include <vector>
+
 #include "fd.hpp"
 #include "own.hpp"
 #include "stdint.hpp"
@@ -40,6 +42,7 @@ namespace zmq
 
     class io_thread_t;
     class session_base_t;
+    class tcp_address_t;
     struct address_t;
 
     class tcp_connecter_t : public own_t, public io_object_t
@@ -56,11 +59,12 @@ namespace zmq
     private:
 
         //  ID of the timer used to delay the reconnection.
-        enum {reconnect_timer_id = 1, connect_timer_id};
+        enum {reconnect_timer_id = 1, connect_timer_id, attempt_timer_id};
 
         //  Handlers for incoming commands.
         void process_plug ();
         void process_term (int linger_);
+        void process_resolved (tcp_address_t *address_, int error_);
 
         //  Handlers for I/O events.
         void in_event ();
@@ -68,8 +72,26 @@ namespace zmq
         void timer_event (int id_);
 
         //  Internal function to start the actual connection establishment.
+        //  Resolves the address first, which may complete asynchronously.
         void start_connecting ();
 
+        //  Connects to the freshly resolved address. NULL means the
+        //  lookup failed.
+        void connect_to (tcp_address_t *address_);
+
+        //  Starts connecting to the next resolved address. Addresses are
+        //  raced: if an attempt does not complete within a short delay
+        //  or fails, the next address is tried while the earlier
+        //  attempts stay in progress.
+        void start_attempts ();
+
+        //  Hands the connected socket over to a new engine and closes
+        //  the attempts that lost the race.
+        void connected (fd_t fd_);
+
+        //  Closes all attempts in progress.
+        void close_attempts ();
+
         //  Internal function to add a connect timer
         void add_connect_timer();
 
@@ -81,30 +103,34 @@ namespace zmq
         //  Returns the currently used interval
         int get_new_reconnect_ivl ();
 
-        //  Open TCP connecting socket. Returns -1 in case of error,
-        //  0 if connect was successful immediately. Returns -1 with
-        //  EAGAIN errno if async connect was launched.
-        int open ();
+        //  Open TCP connecting socket 's_' to the index_-th resolved
+        //  address. Returns -1 in case of error, 0 if connect was
+        //  successful immediately. Returns -1 with EINPROGRESS errno if
+        //  async connect was launched.
+        int open (size_t index_, fd_t &s_);
 
         //  Close the connecting socket.
-        void close ();
+        void close (fd_t s_);
 
-        //  Get the file descriptor of newly created connection. Returns
-        //  retired_fd if the connection was unsuccessful.
-        fd_t connect ();
+        //  Checks on the asynchronous connect of 's_'. Returns 1 if it has
+        //  completed, 0 if it is still in progress and -1 if it failed.
+        int check_connect (fd_t s_);
 
         //  Address to connect to. Owned by session_base_t.
         address_t *addr;
 
-        //  Underlying socket.
-        fd_t s;
-
-        //  Handle corresponding to the listening socket.
-        handle_t handle;
+        //  Connection attempt in progress, one per address being raced.
+        struct attempt_t
+        {
+            fd_t s;
+            handle_t handle;
+            size_t index;
+        };
+        typedef std::vector <attempt_t> attempts_t;
+        attempts_t attempts;
 
-        //  If true file descriptor is registered with the poller and 'handle'
-        //  contains valid value.
-        bool handle_valid;
+        //  Index of the next resolved address to try.
+        size_t next_address;
 
         //  If true, connecter is waiting a while before trying to connect.
         const bool delayed_start;
@@ -112,6 +138,16 @@ namespace zmq
         //  True iff a timer has been started.
         bool connect_timer_started;
         bool reconnect_timer_started;
+        bool attempt_timer_started;
+
+        //  True iff we wait for the resolver to look the address up.
+        bool resolving;
+
+        //  Whether the address may resolve to IPv6. Cleared if the system
+        //  turns out not to support IPv6 sockets, in which case
+        //  'retry_ipv4' asks for the name to be looked up again.
+        bool resolve_ipv6;
+        bool retry_ipv4;
 
         //  Reference to the session we belong to.
         zmq::session_base_t *session;
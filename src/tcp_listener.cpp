@@ -101,11 +101,16 @@ void zmq::tcp_listener_t::in_event ()
     rc = rc | tune_tcp_keepalives (fd, options.tcp_keepalive, options.tcp_keepalive_cnt,
         options.tcp_keepalive_idle, options.tcp_keepalive_intvl);
     rc = rc | tune_tcp_maxrt (fd, options.tcp_maxrt);
+    rc = rc | tune_tcp_notsent_lowat (fd, options.tcp_notsent_lowat);
     if (rc != 0) {
         socket->event_accept_failed (endpoint, zmq_errno());
         return;
     }
 
+    //  Without kernel support messages just go without the timestamp.
+    if (options.kernel_timestamps)
+        enable_rx_timestamps (fd);
+
     //  Create the engine object for this connection.
     stream_engine_t *engine = new (std::nothrow)
         stream_engine_t (fd, options, endpoint);
@@ -0,0 +1,143 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "precompiled.hpp"
+#include <new>
+
+#include "thread_group.hpp"
+#include "err.hpp"
+
+zmq::thread_group_t::thread_group_t () :
+    tag (0xcafe7e11),
+    refs (1)
+{
+}
+
+zmq::thread_group_t::~thread_group_t ()
+{
+    //  Members hold references, so whatever is left on the ready list
+    //  belongs to sockets that are gone already.
+    entry_t *entry = head.xchg (NULL);
+    while (entry) {
+        entry_t *next = entry->next;
+        if (!entry->refs.sub (1))
+            delete entry;
+        entry = next;
+    }
+
+    tag = 0xdeadbeef;
+}
+
+bool zmq::thread_group_t::check_tag ()
+{
+    return tag == 0xcafe7e11;
+}
+
+void zmq::thread_group_t::add_ref ()
+{
+    refs.add (1);
+}
+
+void zmq::thread_group_t::release ()
+{
+    if (!refs.sub (1))
+        delete this;
+}
+
+zmq::thread_group_t::entry_t *zmq::thread_group_t::attach (
+    socket_base_t *socket_)
+{
+    entry_t *entry = new (std::nothrow) entry_t (this, socket_);
+    alloc_assert (entry);
+    add_ref ();
+    return entry;
+}
+
+void zmq::thread_group_t::detach (entry_t *entry_)
+{
+    //  The caller guarantees that the entry is not pushed any more. If it
+    //  is still queued, the ready list disposes of it when drained.
+    thread_group_t *group = entry_->group;
+    if (!entry_->refs.sub (1))
+        delete entry_;
+    group->release ();
+}
+
+void zmq::thread_group_t::push (entry_t *entry_)
+{
+    //  Already on the ready list.
+    if (entry_->queued.xchg (1))
+        return;
+
+    entry_->refs.add (1);
+
+    thread_group_t *group = entry_->group;
+    entry_t *old = NULL;
+    while (true) {
+        entry_->next = old;
+        entry_t *prev = group->head.cas (old, entry_);
+        if (prev == old)
+            break;
+        old = prev;
+    }
+
+    //  Wake up the owner only if the list was empty; otherwise the
+    //  signal is already pending.
+    if (!old)
+        group->signaler.send ();
+}
+
+zmq::fd_t zmq::thread_group_t::get_fd () const
+{
+    return signaler.get_fd ();
+}
+
+void zmq::thread_group_t::drain (std::vector <socket_base_t*> &ready_)
+{
+    //  Consume the signal before taking the list. A push racing with us
+    //  either lands on the list we take or sends a fresh signal.
+    while (signaler.recv_failable () == 0)
+        ;
+
+    entry_t *entry = head.xchg (NULL);
+    while (entry) {
+        entry_t *next = entry->next;
+
+        //  From now on the entry can be queued again.
+        entry->queued.xchg (0);
+
+        //  Skip the entries whose socket has left the group.
+        if (entry->refs.sub (1))
+            ready_.push_back (entry->socket);
+        else
+            delete entry;
+
+        entry = next;
+    }
+}
@@ -0,0 +1,138 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_THREAD_GROUP_HPP_INCLUDED__
+#define __ZMQ_THREAD_GROUP_HPP_INCLUDED__
+
+#include <vector>
+
+#include "fd.hpp"
+#include "signaler.hpp"
+#include "atomic_ptr.hpp"
+#include "atomic_counter.hpp"
+
+namespace zmq
+{
+
+    class socket_base_t;
+
+    //  Sockets owned by a single application thread can join a thread
+    //  group. Instead of signalling its own file descriptor, the mailbox
+    //  of a member socket pushes the socket onto the group's lock-free
+    //  ready list and the group's signaler is only poked when the list
+    //  goes from empty to non-empty. A poller waiting for thousands of
+    //  grouped sockets thus sleeps on a single file descriptor and learns
+    //  exactly which sockets were woken up.
+    //
+    //  The group is reference counted: the application, every member
+    //  socket and every poller watching a member hold a reference.
+
+    class thread_group_t
+    {
+    public:
+
+        class entry_t
+        {
+        private:
+
+            friend class thread_group_t;
+
+            inline entry_t (thread_group_t *group_, socket_base_t *socket_) :
+                group (group_),
+                socket (socket_),
+                next (NULL),
+                queued (0),
+                refs (1)
+            {
+            }
+
+            thread_group_t *group;
+            socket_base_t *socket;
+
+            //  Next entry on the ready list.
+            entry_t *next;
+
+            //  1 while the entry is on the ready list.
+            atomic_counter_t queued;
+
+            //  The member socket holds one reference and the ready list
+            //  another one while the entry is queued on it.
+            atomic_counter_t refs;
+
+            entry_t (const entry_t&);
+            const entry_t &operator = (const entry_t&);
+        };
+
+        thread_group_t ();
+
+        //  Return false if object is not a thread group.
+        bool check_tag ();
+
+        void add_ref ();
+        void release ();
+
+        //  Creates the entry of a new member socket. The entry holds a
+        //  reference to the group until it is detached.
+        entry_t *attach (socket_base_t *socket_);
+        static void detach (entry_t *entry_);
+
+        //  Queues the member on the ready list. May be called from any
+        //  thread while the entry is attached.
+        static void push (entry_t *entry_);
+
+        //  File descriptor that becomes readable when the ready list
+        //  is not empty.
+        fd_t get_fd () const;
+
+        //  Moves the sockets on the ready list to ready_ and consumes
+        //  the signal. To be called by the owner thread only.
+        void drain (std::vector <socket_base_t*> &ready_);
+
+    private:
+
+        ~thread_group_t ();
+
+        //  Used to check whether the object is a thread group.
+        uint32_t tag;
+
+        atomic_counter_t refs;
+
+        //  Head of the ready list. Writers push entries with CAS, the
+        //  owner takes the whole list at once, so there is no ABA issue.
+        atomic_ptr_t <entry_t> head;
+
+        signaler_t signaler;
+
+        thread_group_t (const thread_group_t&);
+        const thread_group_t &operator = (const thread_group_t&);
+    };
+
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "precompiled.hpp"
+#include <new>
+
+#include "timestamps.hpp"
+#include "metadata.hpp"
+#include "msg.hpp"
+#include "err.hpp"
+#include "macros.hpp"
+
+const char *const zmq::timestamp_properties [timestamp_count] = {
+    ZMQ_MSG_PROPERTY_TIME_SENT,
+    ZMQ_MSG_PROPERTY_TIME_WRITTEN,
+    ZMQ_MSG_PROPERTY_TIME_ARRIVED,
+    ZMQ_MSG_PROPERTY_TIME_DECODED,
+    ZMQ_MSG_PROPERTY_TIME_RECEIVED,
+    ZMQ_MSG_PROPERTY_TIME_KERNEL
+};
+
+zmq::timestamp_pool_t::timestamp_pool_t () :
+    next (0)
+{
+}
+
+zmq::timestamp_pool_t::~timestamp_pool_t ()
+{
+    //  Entries still attached to messages go away with the last of them.
+    for (size_t i = 0; i != entries.size (); i++)
+        if (entries [i]->drop_ref ())
+            LIBZMQ_DELETE (entries [i]);
+}
+
+zmq::metadata_t *zmq::timestamp_pool_t::stamp (msg_t *msg_)
+{
+    metadata_t *current = msg_->metadata ();
+    metadata_t *stamped = get ();
+
+    if (current && current->is_stamped ()) {
+        stamped->reset (current->base ());
+        for (int i = 0; i != timestamp_count; i++)
+            stamped->set_time ((timestamp_t) i,
+                current->get_time ((timestamp_t) i));
+    }
+    else
+        stamped->reset (current);
+
+    msg_->reset_metadata ();
+    msg_->set_metadata (stamped);
+    return stamped;
+}
+
+zmq::metadata_t *zmq::timestamp_pool_t::get ()
+{
+    for (size_t i = 0; i != entries.size (); i++) {
+        metadata_t *entry = entries [next];
+        next = (next + 1) % entries.size ();
+        if (entry->has_single_ref ())
+            return entry;
+    }
+
+    metadata_t *entry = new (std::nothrow) metadata_t ();
+    alloc_assert (entry);
+    entries.push_back (entry);
+    next = 0;
+    return entry;
+}
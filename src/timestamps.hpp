@@ -0,0 +1,107 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_TIMESTAMPS_HPP_INCLUDED__
+#define __ZMQ_TIMESTAMPS_HPP_INCLUDED__
+
+#include <stddef.h>
+#include <vector>
+
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    class msg_t;
+    class metadata_t;
+
+    //  ZMTP metadata property a peer sets in its READY (or INITIATE)
+    //  command when it wants to learn when the messages it receives were
+    //  sent, and the clock it expects the times from.
+    static const char timestamps_property [] = "Timestamps";
+    static const char timestamps_clock [] = "realtime";
+
+    //  Once both peers asked for timestamps, each message is preceded by
+    //  a TIMESTAMP command holding the times it entered zmq_send and was
+    //  encoded by the sending engine, as 64-bit nanoseconds since the
+    //  epoch in network byte order.
+    static const char timestamp_command [] = "\x09TIMESTAMP";
+    static const size_t timestamp_command_size =
+        sizeof (timestamp_command) - 1 + 2 * sizeof (uint64_t);
+
+    //  The times a stamped message carries, in nanoseconds since the
+    //  epoch, and the message properties they are exposed as.
+    enum timestamp_t
+    {
+        time_sent,
+        time_written,
+        time_arrived,
+        time_decoded,
+        time_received,
+        time_kernel,
+        timestamp_count
+    };
+    extern const char *const timestamp_properties [timestamp_count];
+
+    //  Recycles the metadata of stamped messages, so that stamping does
+    //  not allocate once the pool has grown to the number of stamped
+    //  messages in flight. The pool holds a reference to each entry and
+    //  an entry nobody else refers to any more is free for reuse. A pool
+    //  is used by one thread at a time.
+    class timestamp_pool_t
+    {
+    public:
+
+        timestamp_pool_t ();
+        ~timestamp_pool_t ();
+
+        //  Replaces the metadata of the message with stamped metadata
+        //  from the pool that keeps its properties and times, and returns
+        //  it for further times to be set.
+        metadata_t *stamp (msg_t *msg_);
+
+    private:
+
+        //  Returns a free entry, allocating one if there is none.
+        metadata_t *get ();
+
+        std::vector <metadata_t *> entries;
+
+        //  Where the search for a free entry starts. Messages are mostly
+        //  released in the order they were stamped, so the entry after
+        //  the one handed out last is usually free.
+        size_t next;
+
+        timestamp_pool_t (const timestamp_pool_t&);
+        const timestamp_pool_t &operator = (const timestamp_pool_t&);
+    };
+
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+    Copyright (c) 2007-2016 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_TRACE_HPP_INCLUDED__
+#define __ZMQ_TRACE_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+//  Static tracepoints along the message path. In builds with tracing
+//  enabled they are USDT probes of the 'libzmq' provider, which perf,
+//  bpftrace and SystemTap can attach to in a running process; until a
+//  tracer attaches, each probe is a single nop. Otherwise the macros
+//  expand to nothing.
+//
+//  The first argument of every probe is the address of the socket, pipe,
+//  engine, session or mailbox firing it, which identifies the object
+//  across events. Timestamps are taken by the tracer.
+//
+//    socket_send (socket, size, flags)     message accepted by send
+//    socket_recv (socket, size, more)      message returned by recv
+//    pipe_write (pipe, size, more)         message written to a pipe
+//    pipe_read (pipe, size, more)          message read from a pipe
+//    session_push_msg (session, size)      engine handed a message over
+//    session_pull_msg (session, size)      engine took a message to send
+//    engine_in_event (engine, bytes)       bytes read from the network
+//    engine_out_event (engine, bytes)      bytes written to the network
+//    mailbox_send (mailbox, command)       command sent to an object
+
+#if defined ZMQ_HAVE_TRACING
+
+#include <sys/sdt.h>
+
+#define zmq_trace2(name_, a_, b_) \
+    DTRACE_PROBE2 (libzmq, name_, a_, b_)
+#define zmq_trace3(name_, a_, b_, c_) \
+    DTRACE_PROBE3 (libzmq, name_, a_, b_, c_)
+
+#else
+
+#define zmq_trace2(name_, a_, b_)
+#define zmq_trace3(name_, a_, b_, c_)
+
+#endif
+
+#endif
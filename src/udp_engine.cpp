@@ -42,6 +42,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "v2_protocol.hpp"
 #include "err.hpp"
 #include "ip.hpp"
+#include "timestamps.hpp"
 
 zmq::udp_engine_t::udp_engine_t(const options_t &options_) :
     plugged (false),
@@ -85,6 +86,10 @@ int zmq::udp_engine_t::init (address_t *address_, bool send_, bool recv_)
 
     unblock_socket (fd);
 
+    //  Without kernel support messages just go without the timestamp.
+    if (recv_enabled && options.kernel_timestamps)
+        enable_rx_timestamps (fd);
+
     return 0;
 }
 
@@ -312,6 +317,8 @@ void zmq::udp_engine_t::in_event()
 {
   struct sockaddr_in in_address;
   socklen_t in_addrlen = sizeof(sockaddr_in);
+  //  Kernel receive time of the datagram, if known.
+  uint64_t timestamp = 0;
 #ifdef ZMQ_HAVE_WINDOWS
     int nbytes = recvfrom(fd, (char*) in_buffer, MAX_UDP_MSG, 0, (sockaddr*) &in_address, &in_addrlen);
     const int last_error = WSAGetLastError();
@@ -322,8 +329,15 @@ void zmq::udp_engine_t::in_event()
             last_error == WSAEWOULDBLOCK);
         return;
     }
+#else
+#if defined ZMQ_HAVE_LINUX
+    int nbytes = options.kernel_timestamps ?
+        recv_timestamped (fd, in_buffer, MAX_UDP_MSG, &in_address,
+            &in_addrlen, &timestamp) :
+        recvfrom(fd, in_buffer, MAX_UDP_MSG, 0, (sockaddr*) &in_address, &in_addrlen);
 #else
     int nbytes = recvfrom(fd, in_buffer, MAX_UDP_MSG, 0, (sockaddr*) &in_address, &in_addrlen);
+#endif
     if (nbytes == -1) {
         errno_assert(errno != EBADF
             && errno != EFAULT
@@ -377,8 +391,22 @@ void zmq::udp_engine_t::in_event()
     rc = msg.init_size (body_size);
     errno_assert (rc == 0);
     memcpy (msg.data (), in_buffer + body_offset, body_size);
+    if (timestamp)
+        stamps.stamp (&msg)->set_time (time_kernel, timestamp);
     rc = session->push_msg (&msg);
-    errno_assert (rc == 0);
+    errno_assert (rc == 0 || (rc == -1 && errno == EAGAIN));
+
+    //  Pipe is full, the datagram is dropped. Have the session drop
+    //  what it holds of it too.
+    if (rc != 0) {
+        rc = msg.close ();
+        errno_assert (rc == 0);
+
+        session->reset ();
+        reset_pollin (handle);
+        return;
+    }
+
     rc = msg.close ();
     errno_assert (rc == 0);
     session->flush ();
@@ -7,6 +7,7 @@
 #include "address.hpp"
 #include "udp_address.hpp"
 #include "msg.hpp"
+#include "timestamps.hpp"
 
 #define MAX_UDP_MSG 8192
 
@@ -67,6 +68,10 @@ namespace zmq
             unsigned char in_buffer[MAX_UDP_MSG];
             bool send_enabled;
             bool recv_enabled;
+
+            //  Metadata of the datagrams stamped with their kernel receive
+            //  time.
+            timestamp_pool_t stamps;
     };
 }
 
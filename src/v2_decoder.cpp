@@ -57,6 +57,43 @@ zmq::v2_decoder_t::~v2_decoder_t ()
     errno_assert (rc == 0);
 }
 
+int zmq::v2_decoder_t::fast_decode (const unsigned char *data_, size_t size_,
+    size_t &bytes_used_)
+{
+    //  Only applies at a frame boundary, i.e. when the flags byte is yet
+    //  to be read. The one-byte step can't be partially done.
+    if (!is_next_step (&v2_decoder_t::flags_ready) || size_ < 2)
+        return 0;
+
+    //  The frame must be short, fit into a VSM and be complete within
+    //  the buffer. Oversized frames are left to the state machine so that
+    //  it reports the error.
+    const unsigned char flags = data_ [0];
+    const size_t msg_size = data_ [1];
+    if ((flags & v2_protocol_t::large_flag)
+    ||  msg_size > msg_t::max_vsm_size
+    ||  msg_size > size_ - 2)
+        return 0;
+    if (maxmsgsize >= 0 && msg_size > static_cast <uint64_t> (maxmsgsize))
+        return 0;
+
+    int rc = in_progress.close ();
+    errno_assert (rc == 0);
+    rc = in_progress.init_size (msg_size);
+    errno_assert (rc == 0);
+    memcpy (in_progress.data (), data_ + 2, msg_size);
+
+    unsigned char fast_flags = 0;
+    if (flags & v2_protocol_t::more_flag)
+        fast_flags |= msg_t::more;
+    if (flags & v2_protocol_t::command_flag)
+        fast_flags |= msg_t::command;
+    in_progress.set_flags (fast_flags);
+
+    bytes_used_ = 2 + msg_size;
+    return 1;
+}
+
 int zmq::v2_decoder_t::flags_ready (unsigned char const*)
 {
     msg_flags = 0;
@@ -50,6 +50,11 @@ namespace zmq
         //  i_decoder interface.
         virtual msg_t *msg () { return &in_progress; }
 
+        //  Decodes a small frame that is entirely within the buffer
+        //  without going through the state machine.
+        int fast_decode (const unsigned char *data_, size_t size_,
+            size_t &bytes_used_);
+
     private:
 
         int flags_ready (unsigned char const*);
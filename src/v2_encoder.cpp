@@ -44,6 +44,25 @@ zmq::v2_encoder_t::~v2_encoder_t ()
 {
 }
 
+size_t zmq::v2_encoder_t::fast_encode (msg_t *msg_, unsigned char *data_,
+    size_t size_)
+{
+    const size_t size = msg_->size ();
+    if (size > 255 || size + 2 > size_)
+        return 0;
+
+    unsigned char protocol_flags = 0;
+    if (msg_->flags () & msg_t::more)
+        protocol_flags |= v2_protocol_t::more_flag;
+    if (msg_->flags () & msg_t::command)
+        protocol_flags |= v2_protocol_t::command_flag;
+
+    data_ [0] = protocol_flags;
+    data_ [1] = static_cast <uint8_t> (size);
+    memcpy (data_ + 2, msg_->data (), size);
+    return size + 2;
+}
+
 void zmq::v2_encoder_t::message_ready ()
 {
     //  Encode flags.
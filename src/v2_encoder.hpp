@@ -43,6 +43,10 @@ namespace zmq
         v2_encoder_t (size_t bufsize_);
         virtual ~v2_encoder_t ();
 
+        //  Writes a short frame into the buffer without going through
+        //  the state machine, if it fits there as a whole.
+        size_t fast_encode (msg_t *msg_, unsigned char *data_, size_t size_);
+
     private:
 
         void size_ready ();
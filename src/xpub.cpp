@@ -44,7 +44,8 @@ zmq::xpub_t::xpub_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
     lossy (true),
     manual (false),
     pending_pipes (),
-    welcome_msg ()
+    welcome_msg (),
+    lvc_size (0)
 {
     last_pipe = NULL;
     options.type = ZMQ_XPUB;
@@ -54,6 +55,9 @@ zmq::xpub_t::xpub_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
 zmq::xpub_t::~xpub_t ()
 {
     welcome_msg.close ();
+
+    lvc_size = 0;
+    trim_last_values ();
 }
 
 void zmq::xpub_t::xattach_pipe (pipe_t *pipe_, bool subscribe_to_all_)
@@ -111,10 +115,14 @@ void zmq::xpub_t::xread_activated (pipe_t *pipe_)
             else
             {
                 bool unique;
-                if (*data == 0)
+                if (*data == 0) {
                     unique = subscriptions.rm (data + 1, size - 1, pipe_);
-                else
+                    forget_replays (pipe_, data + 1, size - 1);
+                }
+                else {
+                    replay_last_values (pipe_, data + 1, size - 1);
                     unique = subscriptions.add (data + 1, size - 1, pipe_);
+                }
 
                 //  If the (un)subscription is not a duplicate store it so that it can be
                 //  passed to the user on next recv call unless verbose mode is enabled
@@ -144,6 +152,7 @@ void zmq::xpub_t::xread_activated (pipe_t *pipe_)
 void zmq::xpub_t::xwrite_activated (pipe_t *pipe_)
 {
     dist.activated (pipe_);
+    serve_replays ();
 }
 
 int zmq::xpub_t::xsetsockopt (int option_, const void *optval_,
@@ -175,13 +184,18 @@ int zmq::xpub_t::xsetsockopt (int option_, const void *optval_,
     }
     else
     if (option_ == ZMQ_SUBSCRIBE && manual) {
-        if (last_pipe != NULL)
+        if (last_pipe != NULL) {
+            replay_last_values (last_pipe, (unsigned char *) optval_,
+                optvallen_);
             subscriptions.add ((unsigned char *) optval_, optvallen_, last_pipe);
+        }
     }
     else
     if (option_ == ZMQ_UNSUBSCRIBE && manual) {
-        if (last_pipe != NULL)
+        if (last_pipe != NULL) {
             subscriptions.rm ((unsigned char *) optval_, optvallen_, last_pipe);
+            forget_replays (last_pipe, (unsigned char *) optval_, optvallen_);
+        }
     }
     else
     if (option_ == ZMQ_XPUB_WELCOME_MSG) {
@@ -197,6 +211,15 @@ int zmq::xpub_t::xsetsockopt (int option_, const void *optval_,
         else
             welcome_msg.init ();
     }
+    else
+    if (option_ == ZMQ_XPUB_LAST_VALUE_CACHE) {
+        if (optvallen_ != sizeof (int) || *static_cast <const int*> (optval_) < 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        lvc_size = *static_cast <const int*> (optval_);
+        trim_last_values ();
+    }
     else {
         errno = EINVAL;
         return -1;
@@ -231,6 +254,14 @@ void zmq::xpub_t::xpipe_terminated (pipe_t *pipe_)
         subscriptions.rm (pipe_, send_unsubscription, this, !verbose_unsubs);
     }
 
+    //  Forget replays the pipe still waits for.
+    for (replays_t::iterator it = pending_replays.begin ();
+          it != pending_replays.end ();)
+        if (it->pipe == pipe_)
+            it = pending_replays.erase (it);
+        else
+            ++it;
+
     dist.pipe_terminated (pipe_);
 }
 
@@ -256,6 +287,18 @@ int zmq::xpub_t::xsend (msg_t *msg_)
 
     int rc = -1;            //  Assume we fail
     if (lossy || dist.check_hwm ()) {
+        //  Take a copy for the last value cache before the distributor
+        //  consumes the message. A message is cached only if its first
+        //  frame was published while the cache was enabled.
+        msg_t copy;
+        const bool cache = lvc_size > 0 && (!more || !lvc_frames.empty ());
+        if (cache) {
+            int copy_rc = copy.init ();
+            errno_assert (copy_rc == 0);
+            copy_rc = copy.copy (*msg_);
+            errno_assert (copy_rc == 0);
+        }
+
         if (dist.send_to_matching (msg_) == 0) {
             //  If we are at the end of multi-part message we can mark
             //  all the pipes as non-matching.
@@ -263,6 +306,19 @@ int zmq::xpub_t::xsend (msg_t *msg_)
                 dist.unmatch ();
             more = msg_more;
             rc = 0;         //  Yay, sent successfully
+
+            if (cache)
+                cache_frame (copy, msg_more);
+
+            //  Now that the message is complete, serve the subscriptions
+            //  that arrived in the middle of it.
+            if (!more && !pending_replays.empty ())
+                serve_replays ();
+        }
+        else
+        if (cache) {
+            const int copy_rc = copy.close ();
+            errno_assert (copy_rc == 0);
         }
     }
     else
@@ -270,11 +326,173 @@ int zmq::xpub_t::xsend (msg_t *msg_)
     return rc;
 }
 
+void zmq::xpub_t::cache_frame (const msg_t &msg_, bool more_)
+{
+    lvc_frames.push_back (msg_);
+    if (more_)
+        return;
+
+    msg_t &first = lvc_frames.front ();
+    const blob_t topic ((unsigned char *) first.data (), first.size ());
+    last_values_t::iterator it = last_values.find (topic);
+    if (it != last_values.end ()) {
+        //  Replace the previous value of the topic.
+        for (frames_t::iterator frame = it->second.frames.begin ();
+              frame != it->second.frames.end (); ++frame) {
+            const int rc = frame->close ();
+            errno_assert (rc == 0);
+        }
+        it->second.frames.clear ();
+        last_values_lru.erase (it->second.lru);
+    }
+    else {
+        it = last_values.insert (
+            last_values_t::value_type (topic, last_value_t ())).first;
+    }
+
+    it->second.frames.swap (lvc_frames);
+    it->second.lru = last_values_lru.insert (last_values_lru.end (), &it->first);
+    trim_last_values ();
+}
+
+void zmq::xpub_t::replay_last_values (pipe_t *pipe_,
+    const unsigned char *data_, size_t size_)
+{
+    //  Inverted matching has no notion of values to replay.
+    if (last_values.empty () || options.invert_matching)
+        return;
+
+    //  A pipe already matching the topics has been sent their values.
+    if (is_subscribed (pipe_, (unsigned char *) data_, size_))
+        return;
+
+    replay_t replay;
+    replay.pipe = pipe_;
+    replay.prefix.assign (data_, size_);
+    replay.next = replay.prefix;
+    pending_replays.push_back (replay);
+    serve_replays ();
+}
+
+void zmq::xpub_t::serve_replays ()
+{
+    //  Replayed messages must not be interleaved with the one being
+    //  published.
+    if (more)
+        return;
+
+    for (replays_t::iterator it = pending_replays.begin ();
+          it != pending_replays.end ();)
+        if (replay (*it))
+            it = pending_replays.erase (it);
+        else
+            ++it;
+}
+
+void zmq::xpub_t::forget_replays (pipe_t *pipe_,
+    const unsigned char *data_, size_t size_)
+{
+    const blob_t prefix (data_, size_);
+    for (replays_t::iterator it = pending_replays.begin ();
+          it != pending_replays.end ();)
+        if (it->pipe == pipe_ && it->prefix == prefix)
+            it = pending_replays.erase (it);
+        else
+            ++it;
+}
+
+bool zmq::xpub_t::replay (replay_t &replay_)
+{
+    //  Cached topics are ordered, so the ones the subscription is a prefix
+    //  of are adjacent.
+    for (last_values_t::iterator it = last_values.lower_bound (replay_.next);
+          it != last_values.end () &&
+          it->first.compare (0, replay_.prefix.size (), replay_.prefix) == 0;
+          ++it) {
+        //  A full pipe goes on with this topic once it is activated again.
+        if (!dist.is_active (replay_.pipe)) {
+            replay_.next = it->first;
+            return false;
+        }
+
+        //  The pipe either takes the whole message or refuses its first
+        //  frame, in which case the distributor deactivates it and drops
+        //  the remaining frames.
+        dist.match (replay_.pipe);
+        for (frames_t::iterator frame = it->second.frames.begin ();
+              frame != it->second.frames.end (); ++frame) {
+            msg_t copy;
+            int rc = copy.init ();
+            errno_assert (rc == 0);
+            rc = copy.copy (*frame);
+            errno_assert (rc == 0);
+            rc = dist.send_to_matching (&copy);
+            errno_assert (rc == 0);
+        }
+        dist.unmatch ();
+
+        if (!dist.is_active (replay_.pipe)) {
+            replay_.next = it->first;
+            return false;
+        }
+    }
+    return true;
+}
+
+//  Tells whether the pipe passed as 'arg_' is among the matching ones.
+static void find_pipe (zmq::pipe_t *pipe_, void *arg_)
+{
+    std::pair <zmq::pipe_t *, bool> *search =
+        (std::pair <zmq::pipe_t *, bool> *) arg_;
+    if (pipe_ == search->first)
+        search->second = true;
+}
+
+bool zmq::xpub_t::is_subscribed (pipe_t *pipe_, unsigned char *data_,
+    size_t size_)
+{
+    //  The pipe matches the prefix iff it is subscribed to the prefix or
+    //  to a shorter one, and then it matches all the longer topics too.
+    std::pair <pipe_t *, bool> search (pipe_, false);
+    subscriptions.match (data_, size_, find_pipe, &search);
+    return search.second;
+}
+
+void zmq::xpub_t::trim_last_values ()
+{
+    if (lvc_size == 0) {
+        for (frames_t::iterator frame = lvc_frames.begin ();
+              frame != lvc_frames.end (); ++frame) {
+            const int rc = frame->close ();
+            errno_assert (rc == 0);
+        }
+        lvc_frames.clear ();
+    }
+
+    while (last_values.size () > lvc_size) {
+        last_values_t::iterator it =
+            last_values.find (*last_values_lru.front ());
+        zmq_assert (it != last_values.end ());
+        for (frames_t::iterator frame = it->second.frames.begin ();
+              frame != it->second.frames.end (); ++frame) {
+            const int rc = frame->close ();
+            errno_assert (rc == 0);
+        }
+        last_values_lru.pop_front ();
+        last_values.erase (it);
+    }
+}
+
 bool zmq::xpub_t::xhas_out ()
 {
     return dist.has_out ();
 }
 
+void zmq::xpub_t::xstats (zmq_socket_stats_t *stats_)
+{
+    stats_->hwm_drops += dist.get_dropped ();
+}
+
 int zmq::xpub_t::xrecv (msg_t *msg_)
 {
     //  If there is at least one
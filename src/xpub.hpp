@@ -31,7 +31,10 @@
 #define __ZMQ_XPUB_HPP_INCLUDED__
 
 #include <deque>
+#include <list>
+#include <map>
 #include <string>
+#include <vector>
 
 #include "socket_base.hpp"
 #include "session_base.hpp"
@@ -65,6 +68,7 @@ namespace zmq
         void xwrite_activated (zmq::pipe_t *pipe_);
         int xsetsockopt (int option_, const void *optval_, size_t optvallen_);
         void xpipe_terminated (zmq::pipe_t *pipe_);
+        void xstats (zmq_socket_stats_t *stats_);
 
     private:
 
@@ -76,6 +80,28 @@ namespace zmq
         //  Function to be applied to each matching pipes.
         static void mark_as_matching (zmq::pipe_t *pipe_, void *arg_);
 
+        //  Stores a frame that was just published in the last value cache.
+        void cache_frame (const msg_t &msg_, bool more_);
+
+        //  Sends the cached messages matching the subscription to the pipe,
+        //  unless the pipe was subscribed to them already.
+        void replay_last_values (pipe_t *pipe_, const unsigned char *data_,
+            size_t size_);
+
+        //  Carries on with the replays that could not be completed so far,
+        //  and drops those of a pipe that unsubscribed.
+        void serve_replays ();
+        void forget_replays (pipe_t *pipe_, const unsigned char *data_,
+            size_t size_);
+
+        //  Returns true if the pipe matches all topics starting with the
+        //  given prefix already.
+        bool is_subscribed (pipe_t *pipe_, unsigned char *data_,
+            size_t size_);
+
+        //  Drops cached topics until there are at most lvc_size of them.
+        void trim_last_values ();
+
         //  List of all subscriptions mapped to corresponding pipes.
         mtrie_t subscriptions;
 
@@ -118,6 +144,39 @@ namespace zmq
         std::deque <metadata_t*> pending_metadata;
         std::deque <unsigned char> pending_flags;
 
+        //  Last value cache: the last message published on each topic,
+        //  replayed to the pipes subscribing to it. At most lvc_size topics
+        //  are cached, least recently published ones being evicted first.
+        typedef std::vector <msg_t> frames_t;
+        struct last_value_t
+        {
+            frames_t frames;
+            std::list <const blob_t *>::iterator lru;
+        };
+        typedef std::map <blob_t, last_value_t> last_values_t;
+        last_values_t last_values;
+        std::list <const blob_t *> last_values_lru;
+        size_t lvc_size;
+
+        //  Frames of the message being published, if it is to be cached.
+        frames_t lvc_frames;
+
+        //  Replays that could not be completed yet, because they were
+        //  requested in the middle of a multi-part message or the pipe
+        //  filled up. Each goes on with the topic 'next' once possible.
+        struct replay_t
+        {
+            pipe_t *pipe;
+            blob_t prefix;
+            blob_t next;
+        };
+        typedef std::list <replay_t> replays_t;
+        replays_t pending_replays;
+
+        //  Sends the cached messages of the replay's topics, one whole
+        //  message at a time. Returns false if the pipe filled up first.
+        bool replay (replay_t &replay_);
+
         xpub_t (const xpub_t&);
         const xpub_t &operator = (const xpub_t&);
     };
@@ -30,27 +30,53 @@
 #ifndef __ZMQ_YPIPE_CONFLATE_HPP_INCLUDED__
 #define __ZMQ_YPIPE_CONFLATE_HPP_INCLUDED__
 
+
+#include <algorithm>
+#include <map>
+
 #include "platform.hpp"
-#include "dbuffer.hpp"
+#include "blob.hpp"
+#include "config.hpp"
+#include "err.hpp"
+#include "macros.hpp"
+#include "msg.hpp"
+#include "tbuffer.hpp"
+#include "ypipe.hpp"
 #include "ypipe_base.hpp"
 
 namespace zmq
 {
 
-    //  Adapter for dbuffer, to plug it in instead of a queue for the sake
+    //  Adapter for tbuffer, to plug it in instead of a queue for the sake
     //  of implementing the conflate socket option, which, if set, makes
     //  the receiving side to discard all incoming messages but the last one.
+    //  If by_topic is set, the last message is kept for each topic, the
+    //  topic being the content of the first frame. Multipart messages are
+    //  conflated as a whole.
     //
-    //  reader_awake flag is needed here to mimic ypipe delicate behaviour
-    //  around the reader being asleep (see 'c' pointer being NULL in ypipe.hpp)
+    //  Each topic has its own triple buffer. Whenever a buffer goes from
+    //  having no pending message to having one, the writer queues it on
+    //  an ordinary ypipe, which gives us the usual reader asleep behaviour
+    //  and delivers topics in the order they were updated. Delimiters and
+    //  credentials bypass conflation of the data by using buffers of their
+    //  own. Buffers of topics whose last message has been read are freed
+    //  from time to time, so that a stream of ever new topics does not grow
+    //  the pipe without bounds.
+
+    template <typename T> class ypipe_conflate_t;
 
-    template <typename T> class ypipe_conflate_t : public ypipe_base_t <T>
+    template <> class ypipe_conflate_t <msg_t> : public ypipe_base_t <msg_t>
     {
     public:
 
         //  Initialises the pipe.
-        inline ypipe_conflate_t ()
-            : reader_awake(false)
+        inline ypipe_conflate_t (bool by_topic_ = false) :
+            by_topic (by_topic_),
+            sweep_at (conflate_topic_sweep),
+            staging (NULL),
+            current_buffer (NULL),
+            current (NULL),
+            pos (0)
         {
         }
 
@@ -58,6 +84,9 @@ namespace zmq
         //  just to keep ICC and code checking tools from complaining.
         inline virtual ~ypipe_conflate_t ()
         {
+            for (topics_t::iterator it = topics.begin ();
+                  it != topics.end (); ++it)
+                LIBZMQ_DELETE (it->second);
         }
 
         //  Following function (write) deliberately copies uninitialised data
@@ -68,64 +97,163 @@ namespace zmq
 #pragma message save
 #pragma message disable(UNINIT)
 #endif
-        inline void write (const T &value_, bool incomplete_)
+        inline void write (const msg_t &value_, bool incomplete_)
         {
-            (void)incomplete_;
+            if (!staging)
+                staging = select (value_);
+            staging->back_frames ().push_back (value_);
 
-            dbuffer.write (value_);
+            //  Publish the message once it is complete. The buffer has to
+            //  be queued only if it had no pending message; otherwise the
+            //  reader is going to find the new one in its place.
+            if (!incomplete_) {
+                if (staging->publish ()) {
+                    staging->add_ref ();
+                    updated.write (staging, false);
+                }
+                staging = NULL;
+            }
         }
 
 #ifdef ZMQ_HAVE_OPENVMS
 #pragma message restore
 #endif
 
-        // There are no incomplete items for conflate ypipe
-        inline bool unwrite (T *)
+        //  Pop an incomplete item from the pipe. Returns true if such
+        //  item exists, false otherwise.
+        inline bool unwrite (msg_t *value_)
         {
-            return false;
+            if (!staging)
+                return false;
+
+            tbuffer_t::frames_t &frames = staging->back_frames ();
+            *value_ = frames.back ();
+            frames.pop_back ();
+            if (frames.empty ())
+                staging = NULL;
+            return true;
         }
 
-        //  Flush is no-op for conflate ypipe. Reader asleep behaviour
-        //  is as of the usual ypipe.
-        //  Returns false if the reader thread is sleeping. In that case,
-        //  caller is obliged to wake the reader up before using the pipe again.
+        //  Flush all the completed items into the pipe. Returns false if
+        //  the reader thread is sleeping. In that case, caller is obliged to
+        //  wake the reader up before using the pipe again.
         inline bool flush ()
         {
-            return reader_awake;
+            return updated.flush ();
         }
 
         //  Check whether item is available for reading.
         inline bool check_read ()
         {
-            bool res = dbuffer.check_read ();
-            if (!res)
-                reader_awake = false;
+            if (current) {
+                if (pos < current->size ())
+                    return true;
+                current->clear ();
+                current = NULL;
+                current_buffer->release ();
+                current_buffer = NULL;
+            }
 
-            return res;
+            if (!updated.read (&current_buffer))
+                return false;
+
+            current = &current_buffer->take ();
+            pos = 0;
+            return true;
         }
 
         //  Reads an item from the pipe. Returns false if there is no value.
         //  available.
-        inline bool read (T *value_)
+        inline bool read (msg_t *value_)
         {
             if (!check_read ())
                 return false;
 
-            return dbuffer.read (value_);
+            *value_ = (*current) [pos];
+            (*current) [pos++].init ();     // avoid double free
+            return true;
         }
 
         //  Applies the function fn to the first elemenent in the pipe
         //  and returns the value returned by the fn.
         //  The pipe mustn't be empty or the function crashes.
-        inline bool probe (bool (*fn)(const T &))
+        inline bool probe (bool (*fn)(const msg_t &))
         {
-            return dbuffer.probe (fn);
+            return (*fn) ((*current) [pos]);
         }
 
     protected:
 
-        dbuffer_t <T> dbuffer;
-        bool reader_awake;
+        //  Returns the buffer the message starting with the given frame
+        //  is to be conflated in.
+        inline tbuffer_t *select (const msg_t &first_)
+        {
+            if (first_.is_delimiter ())
+                return &delimiter;
+            if (first_.is_credential ())
+                return &credential;
+            if (!by_topic)
+                return &latest;
+
+            msg_t &msg = const_cast <msg_t &> (first_);
+            const blob_t topic (
+                static_cast <const unsigned char *> (msg.data ()), msg.size ());
+            topics_t::iterator it = topics.find (topic);
+            if (it == topics.end ()) {
+                if (topics.size () >= sweep_at)
+                    sweep ();
+                tbuffer_t *buffer = new (std::nothrow) tbuffer_t ();
+                alloc_assert (buffer);
+                it = topics.insert (topics_t::value_type (topic, buffer)).first;
+            }
+            return it->second;
+        }
+
+        //  Frees the buffers of the topics the reader is done with. Runs
+        //  whenever the number of topics has doubled since the last sweep,
+        //  which keeps its cost constant per message.
+        inline void sweep ()
+        {
+            topics_t::iterator it = topics.begin ();
+            while (it != topics.end ()) {
+                if (it->second->idle ()) {
+                    LIBZMQ_DELETE (it->second);
+                    topics.erase (it++);
+                }
+                else
+                    ++it;
+            }
+            sweep_at = std::max ((size_t) conflate_topic_sweep,
+                2 * topics.size ());
+        }
+
+        const bool by_topic;
+
+        //  Buffers for the data, the delimiter and the credentials.
+        tbuffer_t latest;
+        tbuffer_t delimiter;
+        tbuffer_t credential;
+
+        //  Per-topic buffers, used if by_topic is set. Only accessed by
+        //  the writer.
+        typedef std::map <blob_t, tbuffer_t *> topics_t;
+        topics_t topics;
+
+        //  Number of topics that triggers the next sweep.
+        size_t sweep_at;
+
+        //  Buffers that got a pending message, in order of arrival.
+        ypipe_t <tbuffer_t *, message_pipe_granularity> updated;
+
+        //  Buffer the writer is composing a message in, NULL between
+        //  messages.
+        tbuffer_t *staging;
+
+        //  Buffer the reader took the message being read from, the message
+        //  itself and the index of the next frame to read.
+        tbuffer_t *current_buffer;
+        tbuffer_t::frames_t *current;
+        size_t pos;
 
         //  Disable copying of ypipe object.
         ypipe_conflate_t (const ypipe_conflate_t&);
@@ -85,6 +85,7 @@ struct iovec {
 #include "metadata.hpp"
 #include "signaler.hpp"
 #include "socket_poller.hpp"
+#include "thread_group.hpp"
 #include "timers.hpp"
 
 #if defined ZMQ_HAVE_OPENPGM
@@ -302,6 +303,34 @@ int zmq_socket_monitor (void *s_, const char *addr_, int events_)
     return result;
 }
 
+int zmq_socket_monitor_ring (void *s_, int events_, int capacity_,
+    int sample_rate_)
+{
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    zmq::socket_base_t *s = (zmq::socket_base_t *) s_;
+    int result = s->monitor_ring (events_, capacity_, sample_rate_);
+    return result;
+}
+
+int zmq_socket_monitor_drain (void *s_, zmq_monitor_record_t *records_,
+    int count_, uint64_t *dropped_)
+{
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    if (!records_ && count_ > 0) {
+        errno = EFAULT;
+        return -1;
+    }
+    zmq::socket_base_t *s = (zmq::socket_base_t *) s_;
+    int result = s->monitor_drain (records_, count_, dropped_);
+    return result;
+}
+
 int zmq_join (void *s_, const char* group_)
 {
     if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
@@ -1373,6 +1402,46 @@ int zmq_poller_wait_all (void *poller_, zmq_poller_event_t *events, int n_events
     return rc;
 }
 
+//  Thread groups
+
+void *zmq_thread_group_new (void)
+{
+    zmq::thread_group_t *group = new (std::nothrow) zmq::thread_group_t;
+    alloc_assert (group);
+    return group;
+}
+
+int zmq_thread_group_destroy (void **group_p_)
+{
+    void *group;
+    if (!group_p_ || !(group = *group_p_) ||
+            !((zmq::thread_group_t*) group)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+
+    //  Member sockets and pollers keep the group alive until they are gone.
+    ((zmq::thread_group_t*) group)->release ();
+    *group_p_ = NULL;
+    return 0;
+}
+
+int zmq_thread_group_add (void *group_, void *s_)
+{
+    if (!group_ || !((zmq::thread_group_t*) group_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    zmq::socket_base_t *s = (zmq::socket_base_t*) s_;
+
+    return s->join_thread_group ((zmq::thread_group_t*) group_);
+}
+
 //  Timers
 
 void *zmq_timers_new (void)
@@ -1481,6 +1550,20 @@ int zmq_proxy_steerable (void *frontend_, void *backend_, void *capture_, void *
         (zmq::socket_base_t*) control_);
 }
 
+int zmq_proxy_threaded (void *frontend_, void *backend_, void *capture_,
+    void *control_)
+{
+    if (!frontend_ || !backend_) {
+        errno = EFAULT;
+        return -1;
+    }
+    return zmq::proxy_threaded (
+        (zmq::socket_base_t*) frontend_,
+        (zmq::socket_base_t*) backend_,
+        (zmq::socket_base_t*) capture_,
+        (zmq::socket_base_t*) control_);
+}
+
 //  The deprecated device functionality
 
 int zmq_device (int /* type */, void *frontend_, void *backend_)
@@ -1502,6 +1585,10 @@ int zmq_has (const char *capability)
     if (strcmp (capability, "pgm") == 0)
         return true;
 #endif
+#if defined (ZMQ_HAVE_SHM)
+    if (strcmp (capability, "shm") == 0)
+        return true;
+#endif
 #if defined (ZMQ_HAVE_TIPC)
     if (strcmp (capability, "tipc") == 0)
         return true;
@@ -1522,6 +1609,10 @@ int zmq_has (const char *capability)
     if (strcmp (capability, "vmci") == 0)
         return true;
 #endif
+#if defined (ZMQ_HAVE_ZLIB)
+    if (strcmp (capability, "compression") == 0)
+        return true;
+#endif
 #if defined (ZMQ_BUILD_DRAFT_API)
     if (strcmp (capability, "draft") == 0)
         return true;
@@ -0,0 +1,152 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+#define MESSAGES 5000
+
+static void set_int (void *socket_, int option_, int value_)
+{
+    int rc = zmq_setsockopt (socket_, option_, &value_, sizeof (value_));
+    assert (rc == 0);
+}
+
+static int get_int (void *socket_, int option_)
+{
+    int value;
+    size_t size = sizeof (value);
+    int rc = zmq_getsockopt (socket_, option_, &value, &size);
+    assert (rc == 0);
+    return value;
+}
+
+static void test_options (void *ctx_)
+{
+    void *socket = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (socket);
+
+    assert (get_int (socket, ZMQ_OUT_BATCH_SIZE) == 8192);
+    assert (get_int (socket, ZMQ_IN_BATCH_SIZE) == 8192);
+    assert (get_int (socket, ZMQ_ADAPTIVE_BATCH) == 0);
+
+    set_int (socket, ZMQ_OUT_BATCH_SIZE, 65536);
+    assert (get_int (socket, ZMQ_OUT_BATCH_SIZE) == 65536);
+    set_int (socket, ZMQ_ADAPTIVE_BATCH, 1);
+    assert (get_int (socket, ZMQ_ADAPTIVE_BATCH) == 1);
+
+    int value = 0;
+    int rc = zmq_setsockopt (socket, ZMQ_IN_BATCH_SIZE, &value,
+        sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    value = 1048577;
+    rc = zmq_setsockopt (socket, ZMQ_OUT_BATCH_SIZE, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_setsockopt (socket, ZMQ_IN_BATCH_SIZE, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    set_int (socket, ZMQ_IN_BATCH_SIZE, 1048576);
+    assert (get_int (socket, ZMQ_IN_BATCH_SIZE) == 1048576);
+    value = 2;
+    rc = zmq_setsockopt (socket, ZMQ_ADAPTIVE_BATCH, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_close (socket);
+    assert (rc == 0);
+}
+
+//  Sends bursts of messages of all sizes, so that the adaptive batch
+//  grows and shrinks, and checks they arrive intact.
+static void test_transfer (void *ctx_, int out_batch_, int in_batch_,
+    bool adaptive_)
+{
+    void *push = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (push);
+    void *pull = zmq_socket (ctx_, ZMQ_PULL);
+    assert (pull);
+
+    set_int (push, ZMQ_OUT_BATCH_SIZE, out_batch_);
+    set_int (push, ZMQ_ADAPTIVE_BATCH, adaptive_);
+    set_int (pull, ZMQ_IN_BATCH_SIZE, in_batch_);
+
+    int rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof (endpoint);
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+    rc = zmq_connect (push, endpoint);
+    assert (rc == 0);
+
+    unsigned char *buffer = (unsigned char *) malloc (20000);
+    assert (buffer);
+    int sent = 0;
+    int received = 0;
+    while (received < MESSAGES) {
+        //  Alternate between bursts and single messages.
+        int burst = (sent / 100) % 2 ? 100 : 1;
+        for (int i = 0; i < burst && sent < MESSAGES; i++, sent++) {
+            size_t size = (sent * 7919) % 20000;
+            memset (buffer, sent & 0xff, size);
+            rc = zmq_send (push, buffer, size, 0);
+            assert (rc == (int) size);
+        }
+        while (received < sent) {
+            size_t size = (received * 7919) % 20000;
+            rc = zmq_recv (pull, buffer, 20000, 0);
+            assert (rc == (int) size);
+            for (size_t j = 0; j < size; j++)
+                assert (buffer [j] == (received & 0xff));
+            received++;
+        }
+    }
+    free (buffer);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_options (ctx);
+    test_transfer (ctx, 8192, 8192, false);
+    test_transfer (ctx, 256, 64, false);
+    test_transfer (ctx, 262144, 1024, true);
+    test_transfer (ctx, 512, 100000, true);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+static void
+connect_pair (void *ctx, int server_level, int client_level,
+              void **server, void **client)
+{
+    size_t len = MAX_SOCKET_STRING;
+    char my_endpoint [MAX_SOCKET_STRING];
+
+    *server = zmq_socket (ctx, ZMQ_DEALER);
+    assert (*server);
+    int rc = zmq_setsockopt (*server, ZMQ_COMPRESSION_LEVEL,
+        &server_level, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (*server, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    rc = zmq_getsockopt (*server, ZMQ_LAST_ENDPOINT, my_endpoint, &len);
+    assert (rc == 0);
+
+    *client = zmq_socket (ctx, ZMQ_DEALER);
+    assert (*client);
+    rc = zmq_setsockopt (*client, ZMQ_COMPRESSION_LEVEL,
+        &client_level, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_connect (*client, my_endpoint);
+    assert (rc == 0);
+}
+
+static char payload [65536];
+
+static void
+send_payload (void *from, size_t size, int flags)
+{
+    assert (size <= sizeof payload);
+    for (size_t i = 0; i < size; i++)
+        payload [i] = "8=FIX.4.2|9=178|35=D|" [i % 21];
+
+    int rc = zmq_send (from, payload, size, flags);
+    assert (rc == (int) size);
+}
+
+//  Receives a payload sent by send_payload and checks it arrived intact.
+//  Returns true iff the message was received over a compressed connection.
+static bool
+recv_payload (void *to, size_t size, bool more)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, to, 0);
+    assert (rc == (int) size);
+    for (size_t i = 0; i < size; i++)
+        assert (((char *) zmq_msg_data (&msg)) [i]
+            == "8=FIX.4.2|9=178|35=D|" [i % 21]);
+    assert (zmq_msg_more (&msg) == (more ? 1 : 0));
+    const char *value = zmq_msg_gets (&msg, "Compression");
+    const bool compressed = value && streq (value, "deflate");
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+    return compressed;
+}
+
+static void
+test_options (void *ctx)
+{
+    void *sock = zmq_socket (ctx, ZMQ_DEALER);
+    assert (sock);
+
+    int value;
+    size_t len = sizeof (int);
+    int rc = zmq_getsockopt (sock, ZMQ_COMPRESSION_LEVEL, &value, &len);
+    assert (rc == 0 && value == 0);
+    rc = zmq_getsockopt (sock, ZMQ_COMPRESSION_THRESHOLD, &value, &len);
+    assert (rc == 0 && value == 128);
+
+    value = 10;
+    rc = zmq_setsockopt (sock, ZMQ_COMPRESSION_LEVEL, &value, sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+    value = -1;
+    rc = zmq_setsockopt (sock, ZMQ_COMPRESSION_THRESHOLD, &value, sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+
+    value = 0;
+    rc = zmq_setsockopt (sock, ZMQ_COMPRESSION_THRESHOLD, &value, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_getsockopt (sock, ZMQ_COMPRESSION_THRESHOLD, &value, &len);
+    assert (rc == 0 && value == 0);
+
+    close_zero_linger (sock);
+}
+
+static void
+test_negotiated (void *ctx)
+{
+    void *server, *client;
+    connect_pair (ctx, 6, 1, &server, &client);
+
+    //  Messages above and below the threshold, in both directions,
+    //  including multipart messages.
+    const size_t sizes [] = {0, 1, 127, 128, 1000, 65536};
+    for (size_t i = 0; i < sizeof sizes / sizeof sizes [0]; i++) {
+        send_payload (client, sizes [i], 0);
+        assert (recv_payload (server, sizes [i], false));
+        send_payload (server, sizes [i], 0);
+        assert (recv_payload (client, sizes [i], false));
+    }
+    for (int i = 0; i < 100; i++) {
+        send_payload (client, 4000, ZMQ_SNDMORE);
+        send_payload (client, 50, 0);
+        assert (recv_payload (server, 4000, true));
+        assert (recv_payload (server, 50, false));
+    }
+
+    close_zero_linger (client);
+    close_zero_linger (server);
+}
+
+static void
+test_one_sided (void *ctx)
+{
+    //  Compression is only used if both peers ask for it
+    void *server, *client;
+    connect_pair (ctx, 0, 9, &server, &client);
+
+    send_payload (client, 1000, 0);
+    assert (!recv_payload (server, 1000, false));
+    send_payload (server, 1000, 0);
+    assert (!recv_payload (client, 1000, false));
+
+    close_zero_linger (client);
+    close_zero_linger (server);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    if (!zmq_has ("compression")) {
+        printf ("Compression not available, skipping test\n");
+        return 0;
+    }
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_options (ctx);
+    test_negotiated (ctx);
+    test_one_sided (ctx);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -73,6 +73,32 @@ int main (int, char *[])
     assert (rc > 0);
     assert (payload_recved == message_count - 1);
 
+    //  Multipart messages are conflated as a whole.
+    for (int j = 0; j < message_count; ++j) {
+        rc = zmq_send (s_out, "part", 4, ZMQ_SNDMORE);
+        assert (rc == 4);
+        rc = zmq_send (s_out, (void*)&j, sizeof(int), 0);
+        assert (rc == sizeof (int));
+    }
+    msleep (SETTLE_TIME);
+
+    char part [4];
+    rc = zmq_recv (s_in, part, sizeof (part), 0);
+    assert (rc == 4);
+    assert (memcmp (part, "part", 4) == 0);
+    int more;
+    size_t more_size = sizeof (more);
+    rc = zmq_getsockopt (s_in, ZMQ_RCVMORE, &more, &more_size);
+    assert (rc == 0 && more);
+    rc = zmq_recv (s_in, (void*)&payload_recved, sizeof(int), 0);
+    assert (rc == sizeof (int));
+    assert (payload_recved == message_count - 1);
+    rc = zmq_getsockopt (s_in, ZMQ_RCVMORE, &more, &more_size);
+    assert (rc == 0 && !more);
+
+    rc = zmq_recv (s_in, part, sizeof (part), ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+
     rc = zmq_close (s_in);
     assert (rc == 0);
 
@@ -0,0 +1,174 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+static void send_update (void *socket_, const char *topic_, int value_)
+{
+    int rc = zmq_send (socket_, topic_, strlen (topic_), ZMQ_SNDMORE);
+    assert (rc == (int) strlen (topic_));
+    rc = zmq_send (socket_, &value_, sizeof (value_), 0);
+    assert (rc == sizeof (value_));
+}
+
+static void recv_update (void *socket_, const char *topic_, int value_)
+{
+    char topic [16];
+    int rc = zmq_recv (socket_, topic, sizeof (topic), 0);
+    assert (rc == (int) strlen (topic_));
+    assert (memcmp (topic, topic_, rc) == 0);
+
+    int value;
+    rc = zmq_recv (socket_, &value, sizeof (value), 0);
+    assert (rc == sizeof (value));
+    assert (value == value_);
+
+    int more;
+    size_t more_size = sizeof (more);
+    rc = zmq_getsockopt (socket_, ZMQ_RCVMORE, &more, &more_size);
+    assert (rc == 0);
+    assert (!more);
+}
+
+static void recv_nothing (void *socket_)
+{
+    char buffer [16];
+    int rc = zmq_recv (socket_, buffer, sizeof (buffer), ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    size_t len = MAX_SOCKET_STRING;
+    char my_endpoint [MAX_SOCKET_STRING];
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *s_in = zmq_socket (ctx, ZMQ_PULL);
+    assert (s_in);
+
+    int option;
+    size_t option_size = sizeof (option);
+    int rc = zmq_getsockopt (s_in, ZMQ_CONFLATE_TOPIC, &option, &option_size);
+    assert (rc == 0);
+    assert (option == 0);
+
+    option = 2;
+    rc = zmq_setsockopt (s_in, ZMQ_CONFLATE_TOPIC, &option, sizeof (option));
+    assert (rc == -1 && errno == EINVAL);
+
+    option = 1;
+    rc = zmq_setsockopt (s_in, ZMQ_CONFLATE, &option, sizeof (option));
+    assert (rc == 0);
+    rc = zmq_setsockopt (s_in, ZMQ_CONFLATE_TOPIC, &option, sizeof (option));
+    assert (rc == 0);
+    rc = zmq_getsockopt (s_in, ZMQ_CONFLATE_TOPIC, &option, &option_size);
+    assert (rc == 0);
+    assert (option == 1);
+
+    rc = zmq_bind (s_in, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    rc = zmq_getsockopt (s_in, ZMQ_LAST_ENDPOINT, my_endpoint, &len);
+    assert (rc == 0);
+
+    void *s_out = zmq_socket (ctx, ZMQ_PUSH);
+    assert (s_out);
+    rc = zmq_connect (s_out, my_endpoint);
+    assert (rc == 0);
+
+    //  Interleaved updates of three topics; only the last one of each
+    //  topic is kept, in the order the topics were first updated.
+    const int update_count = 20;
+    for (int j = 0; j < update_count; ++j) {
+        send_update (s_out, "alpha", j);
+        send_update (s_out, "beta", 100 + j);
+        send_update (s_out, "gamma", 200 + j);
+    }
+    msleep (SETTLE_TIME);
+
+    recv_update (s_in, "alpha", update_count - 1);
+    recv_update (s_in, "beta", 100 + update_count - 1);
+    recv_update (s_in, "gamma", 200 + update_count - 1);
+    recv_nothing (s_in);
+
+    //  Topics that were read already are delivered again once updated.
+    send_update (s_out, "gamma", 300);
+    send_update (s_out, "beta", 400);
+    send_update (s_out, "gamma", 301);
+    msleep (SETTLE_TIME);
+
+    recv_update (s_in, "gamma", 301);
+    recv_update (s_in, "beta", 400);
+    recv_nothing (s_in);
+
+    //  Waves of new topics make the pipe drop the topics it has delivered;
+    //  the ones still pending survive and dropped ones come back when
+    //  updated again.
+    char topic [16];
+    for (int wave = 0; wave != 4; wave++) {
+        for (int j = 0; j != 200; j++) {
+            sprintf (topic, "t%d", wave * 200 + j);
+            send_update (s_out, topic, j);
+        }
+        msleep (SETTLE_TIME);
+        for (int j = 0; j != 200; j++) {
+            sprintf (topic, "t%d", wave * 200 + j);
+            recv_update (s_in, topic, j);
+        }
+        recv_nothing (s_in);
+    }
+    send_update (s_out, "t0", 500);
+    msleep (SETTLE_TIME);
+    recv_update (s_in, "t0", 500);
+    recv_nothing (s_in);
+
+    //  Single-part messages are their own topic.
+    rc = zmq_send (s_out, "delta", 5, 0);
+    assert (rc == 5);
+    rc = zmq_send (s_out, "delta", 5, 0);
+    assert (rc == 5);
+    msleep (SETTLE_TIME);
+
+    char buffer [16];
+    rc = zmq_recv (s_in, buffer, sizeof (buffer), 0);
+    assert (rc == 5);
+    assert (memcmp (buffer, "delta", 5) == 0);
+    recv_nothing (s_in);
+
+    rc = zmq_close (s_in);
+    assert (rc == 0);
+    rc = zmq_close (s_out);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+#if !defined (ZMQ_HAVE_WINDOWS)
+#include <netdb.h>
+
+//  Returns true if 'name' resolves to both an IPv6 and an IPv4 address.
+static bool
+is_dual_stack_name (const char *name)
+{
+    if (!is_ipv6_available ())
+        return false;
+
+    struct addrinfo hint, *res;
+    memset (&hint, 0, sizeof hint);
+    hint.ai_family = AF_UNSPEC;
+    hint.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo (name, NULL, &hint, &res) != 0)
+        return false;
+
+    bool ipv4 = false, ipv6 = false;
+    for (struct addrinfo *it = res; it; it = it->ai_next) {
+        ipv4 = ipv4 || it->ai_family == AF_INET;
+        ipv6 = ipv6 || it->ai_family == AF_INET6;
+    }
+    freeaddrinfo (res);
+    return ipv4 && ipv6;
+}
+
+//  Binds to a single address of 'localhost' and connects by name. The
+//  other address refuses the connection, which must not cost the client
+//  a reconnect interval.
+static void
+test_one_address_listening (void *ctx, const char *bind_address, int ipv6)
+{
+    void *server = zmq_socket (ctx, ZMQ_PULL);
+    assert (server);
+    int rc = zmq_setsockopt (server, ZMQ_IPV6, &ipv6, sizeof ipv6);
+    assert (rc == 0);
+    rc = zmq_bind (server, bind_address);
+    assert (rc == 0);
+    char my_endpoint [MAX_SOCKET_STRING];
+    size_t len = sizeof my_endpoint;
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, my_endpoint, &len);
+    assert (rc == 0);
+    char by_name [MAX_SOCKET_STRING];
+    snprintf (by_name, sizeof by_name, "tcp://localhost%s",
+        strrchr (my_endpoint, ':'));
+
+    void *client = zmq_socket (ctx, ZMQ_PUSH);
+    assert (client);
+    int on = 1;
+    rc = zmq_setsockopt (client, ZMQ_IPV6, &on, sizeof on);
+    assert (rc == 0);
+    int reconnect_ivl = 60000;
+    rc = zmq_setsockopt (client, ZMQ_RECONNECT_IVL, &reconnect_ivl,
+        sizeof reconnect_ivl);
+    assert (rc == 0);
+    rc = zmq_connect (client, by_name);
+    assert (rc == 0);
+
+    int timeout = 5000;
+    rc = zmq_setsockopt (server, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    s_send_seq (client, "raced", SEQ_END);
+    s_recv_seq (server, "raced", SEQ_END);
+
+    close_zero_linger (client);
+    close_zero_linger (server);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    if (!is_dual_stack_name ("localhost")) {
+        printf ("localhost is not dual-stack, skipping test\n");
+        return 0;
+    }
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_one_address_listening (ctx, "tcp://127.0.0.1:*", 0);
+    test_one_address_listening (ctx, "tcp://[::1]:*", 1);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
+
+#else
+
+int main (void)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,260 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+static void
+test_cache_ttl_option ()
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    int rc = zmq_ctx_get (ctx, ZMQ_DNS_CACHE_TTL);
+    assert (rc == 60000);
+
+    rc = zmq_ctx_set (ctx, ZMQ_DNS_CACHE_TTL, 0);
+    assert (rc == 0);
+    rc = zmq_ctx_get (ctx, ZMQ_DNS_CACHE_TTL);
+    assert (rc == 0);
+
+    rc = zmq_ctx_set (ctx, ZMQ_DNS_CACHE_TTL, -1);
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+static void
+test_connect_by_name (int ttl)
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    int rc = zmq_ctx_set (ctx, ZMQ_DNS_CACHE_TTL, ttl);
+    assert (rc == 0);
+
+    void *server = zmq_socket (ctx, ZMQ_PULL);
+    assert (server);
+    rc = zmq_bind (server, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char my_endpoint [MAX_SOCKET_STRING];
+    size_t len = sizeof my_endpoint;
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, my_endpoint, &len);
+    assert (rc == 0);
+    const char *port = strrchr (my_endpoint, ':');
+    assert (port);
+
+    char by_name [MAX_SOCKET_STRING];
+    snprintf (by_name, sizeof by_name, "tcp://localhost%s", port);
+
+    //  The second client finds the answer of the first one in the cache
+    //  if caching is on, and looks the name up again otherwise.
+    for (int i = 0; i != 2; i++) {
+        void *client = zmq_socket (ctx, ZMQ_PUSH);
+        assert (client);
+        rc = zmq_connect (client, by_name);
+        assert (rc == 0);
+        s_send_seq (client, "resolved", SEQ_END);
+        s_recv_seq (server, "resolved", SEQ_END);
+        close_zero_linger (client);
+    }
+
+    close_zero_linger (server);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+#if defined ZMQ_HAVE_LINUX
+//  The resolver's stub file, see ZMQ_DNS_STUB_FILE in dns_resolver.cpp.
+static const char *stub_file = "test_dns_resolver.hosts";
+
+static void write_stub (const char *line_)
+{
+    FILE *file = fopen (stub_file, "w");
+    assert (file);
+    fputs (line_, file);
+    fclose (file);
+}
+
+static void set_int (void *socket_, int option_, int value_)
+{
+    int rc = zmq_setsockopt (socket_, option_, &value_, sizeof value_);
+    assert (rc == 0);
+}
+
+//  Connects to stub.test while it names 127.0.0.1, then again once it names
+//  127.0.0.2, with a PULL socket on the same port of each. The second
+//  connect reaches 127.0.0.1 if served from the cache, and 127.0.0.2 if the
+//  name was looked up again because the answer expired.
+static void test_cache_expiry (int ttl, bool expired)
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    int rc = zmq_ctx_set (ctx, ZMQ_DNS_CACHE_TTL, ttl);
+    assert (rc == 0);
+
+    void *first = zmq_socket (ctx, ZMQ_PULL);
+    assert (first);
+    set_int (first, ZMQ_RCVTIMEO, 5000);
+    rc = zmq_bind (first, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [MAX_SOCKET_STRING];
+    size_t len = sizeof endpoint;
+    rc = zmq_getsockopt (first, ZMQ_LAST_ENDPOINT, endpoint, &len);
+    assert (rc == 0);
+    const char *port = strrchr (endpoint, ':');
+    assert (port);
+
+    void *second = zmq_socket (ctx, ZMQ_PULL);
+    assert (second);
+    set_int (second, ZMQ_RCVTIMEO, 5000);
+    snprintf (endpoint, sizeof endpoint, "tcp://127.0.0.2%s", port);
+    rc = zmq_bind (second, endpoint);
+    assert (rc == 0);
+
+    snprintf (endpoint, sizeof endpoint, "tcp://stub.test%s", port);
+    write_stub ("stub.test 127.0.0.1\n");
+    void *client = zmq_socket (ctx, ZMQ_PUSH);
+    assert (client);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+    s_send_seq (client, "first", SEQ_END);
+    s_recv_seq (first, "first", SEQ_END);
+    close_zero_linger (client);
+
+    write_stub ("stub.test 127.0.0.2\n");
+    if (expired)
+        msleep (2 * ttl);
+    client = zmq_socket (ctx, ZMQ_PUSH);
+    assert (client);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+    s_send_seq (client, "again", SEQ_END);
+    s_recv_seq (expired ? second : first, "again", SEQ_END);
+    close_zero_linger (client);
+
+    close_zero_linger (second);
+    close_zero_linger (first);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+//  While a lookup is blocked, the I/O thread it was started from keeps
+//  moving data for the other connections.
+static void test_slow_lookup ()
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *server = zmq_socket (ctx, ZMQ_PULL);
+    assert (server);
+    set_int (server, ZMQ_RCVTIMEO, 5000);
+    int rc = zmq_bind (server, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [MAX_SOCKET_STRING];
+    size_t len = sizeof endpoint;
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, endpoint, &len);
+    assert (rc == 0);
+
+    void *fast = zmq_socket (ctx, ZMQ_PUSH);
+    assert (fast);
+    rc = zmq_connect (fast, endpoint);
+    assert (rc == 0);
+    s_send_seq (fast, "fast", SEQ_END);
+    s_recv_seq (server, "fast", SEQ_END);
+
+    const char *port = strrchr (endpoint, ':');
+    assert (port);
+    char by_name [MAX_SOCKET_STRING];
+    snprintf (by_name, sizeof by_name, "tcp://slow.test%s", port);
+    write_stub ("slow.test 127.0.0.1 3000\n");
+    void *slow = zmq_socket (ctx, ZMQ_PUSH);
+    assert (slow);
+    rc = zmq_connect (slow, by_name);
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+
+    void *stopwatch = zmq_stopwatch_start ();
+    for (int i = 0; i != 10; i++) {
+        s_send_seq (fast, "fast", SEQ_END);
+        s_recv_seq (server, "fast", SEQ_END);
+    }
+    assert (zmq_stopwatch_stop (stopwatch) < 1000000);
+
+    //  The lookup completes in the end.
+    s_send_seq (slow, "slow", SEQ_END);
+    s_recv_seq (server, "slow", SEQ_END);
+
+    close_zero_linger (slow);
+    close_zero_linger (fast);
+    close_zero_linger (server);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+static void
+test_close_while_resolving ()
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Sockets may go away while their lookups are queued or running,
+    //  and the context while the last one is.
+    write_stub ("slow.test 127.0.0.1 200\n");
+    for (int i = 0; i != 10; i++) {
+        void *client = zmq_socket (ctx, ZMQ_DEALER);
+        assert (client);
+        int rc = zmq_connect (client, "tcp://slow.test:5560");
+        assert (rc == 0);
+        close_zero_linger (client);
+    }
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+#endif
+
+int main (void)
+{
+    setup_test_environment ();
+
+    test_cache_ttl_option ();
+    test_connect_by_name (60000);
+    test_connect_by_name (0);
+#if defined ZMQ_HAVE_LINUX
+    int rc = setenv ("ZMQ_DNS_STUB_FILE", stub_file, 1);
+    assert (rc == 0);
+    test_cache_expiry (60000, false);
+    test_cache_expiry (200, true);
+    test_slow_lookup ();
+    test_close_while_resolving ();
+    unlink (stub_file);
+#endif
+
+    return 0;
+}
@@ -0,0 +1,223 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Sends messages of the given size until the pipe is full and returns
+//  how many got through.
+static int fill (void *socket_, size_t size_)
+{
+    //  A short timeout rather than ZMQ_DONTWAIT lets the socket process
+    //  the reader's progress reports before giving up.
+    int timeout = 100;
+    int rc = zmq_setsockopt (socket_, ZMQ_SNDTIMEO, &timeout,
+        sizeof (timeout));
+    assert (rc == 0);
+
+    void *data = calloc (1, size_);
+    assert (data);
+    int count = 0;
+    while (zmq_send (socket_, data, size_, 0) == (int) size_)
+        count++;
+    assert (errno == EAGAIN);
+    free (data);
+    return count;
+}
+
+static void drain (void *socket_, int count_)
+{
+    for (int i = 0; i < count_; i++) {
+        int rc = zmq_recv (socket_, NULL, 0, 0);
+        assert (rc >= 0);
+    }
+}
+
+static void set_hwms (void *socket_, int64_t sndhwm_bytes_,
+    int64_t rcvhwm_bytes_)
+{
+    //  Message count limits are lifted so that only bytes count.
+    int hwm = 0;
+    int rc = zmq_setsockopt (socket_, ZMQ_SNDHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_setsockopt (socket_, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_setsockopt (socket_, ZMQ_SNDHWM_BYTES, &sndhwm_bytes_,
+        sizeof (sndhwm_bytes_));
+    assert (rc == 0);
+    rc = zmq_setsockopt (socket_, ZMQ_RCVHWM_BYTES, &rcvhwm_bytes_,
+        sizeof (rcvhwm_bytes_));
+    assert (rc == 0);
+}
+
+static void test_options (void *ctx_)
+{
+    void *socket = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (socket);
+
+    int64_t value = -1;
+    size_t size = sizeof (value);
+    int rc = zmq_getsockopt (socket, ZMQ_SNDHWM_BYTES, &value, &size);
+    assert (rc == 0);
+    assert (value == 0);
+
+    value = -1;
+    rc = zmq_setsockopt (socket, ZMQ_RCVHWM_BYTES, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+
+    value = 5000;
+    rc = zmq_setsockopt (socket, ZMQ_RCVHWM_BYTES, &value, sizeof (value));
+    assert (rc == 0);
+    value = 0;
+    rc = zmq_getsockopt (socket, ZMQ_RCVHWM_BYTES, &value, &size);
+    assert (rc == 0);
+    assert (value == 5000);
+
+    rc = zmq_close (socket);
+    assert (rc == 0);
+}
+
+static void test_inproc (void *ctx_, bool bind_first_)
+{
+    void *push = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (push);
+    void *pull = zmq_socket (ctx_, ZMQ_PULL);
+    assert (pull);
+
+    //  Limits of both peers add up to 10000 bytes.
+    set_hwms (push, 4000, 0);
+    set_hwms (pull, 0, 6000);
+
+    int rc;
+    if (bind_first_) {
+        rc = zmq_bind (pull, "inproc://hwm-bytes");
+        assert (rc == 0);
+        rc = zmq_connect (push, "inproc://hwm-bytes");
+        assert (rc == 0);
+    }
+    else {
+        rc = zmq_connect (push, "inproc://hwm-bytes-pending");
+        assert (rc == 0);
+        rc = zmq_bind (pull, "inproc://hwm-bytes-pending");
+        assert (rc == 0);
+    }
+
+    assert (fill (push, 1000) == 10);
+
+    //  Reading frees the space again.
+    drain (pull, 10);
+    assert (fill (push, 1000) == 10);
+    drain (pull, 10);
+
+    //  A message bigger than the limit still passes on an empty pipe.
+    assert (fill (push, 50000) == 1);
+    drain (pull, 1);
+
+    //  The limit never splits a multipart message.
+    char part [3000];
+    memset (part, 0, sizeof (part));
+    for (int i = 0; i < 4; i++) {
+        rc = zmq_send (push, part, sizeof (part), ZMQ_SNDMORE);
+        assert (rc == (int) sizeof (part));
+    }
+    rc = zmq_send (push, part, sizeof (part), 0);
+    assert (rc == (int) sizeof (part));
+    for (int i = 0; i < 5; i++) {
+        rc = zmq_recv (pull, part, sizeof (part), 0);
+        assert (rc == (int) sizeof (part));
+    }
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+static void test_memory_budget ()
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    int rc = zmq_ctx_set (ctx, ZMQ_MEMORY_BUDGET, 1);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_MEMORY_BUDGET) == 1);
+
+    void *sockets [4];
+    for (int i = 0; i < 4; i++) {
+        sockets [i] = zmq_socket (ctx, i % 2 ? ZMQ_PULL : ZMQ_PUSH);
+        assert (sockets [i]);
+        set_hwms (sockets [i], 0, 0);
+    }
+    rc = zmq_bind (sockets [1], "inproc://budget-a");
+    assert (rc == 0);
+    rc = zmq_connect (sockets [0], "inproc://budget-a");
+    assert (rc == 0);
+    rc = zmq_bind (sockets [3], "inproc://budget-b");
+    assert (rc == 0);
+    rc = zmq_connect (sockets [2], "inproc://budget-b");
+    assert (rc == 0);
+
+    //  The first pipe takes up the whole budget of one megabyte, after
+    //  which the second one only accepts a single message.
+    assert (fill (sockets [0], 65536) == 16);
+    assert (fill (sockets [2], 65536) == 1);
+
+    //  Once the first pipe is drained, the budget is available again.
+    //  The second pipe resumes as soon as its own reader makes progress.
+    drain (sockets [1], 16);
+    drain (sockets [3], 1);
+    assert (fill (sockets [2], 65536) == 16);
+    assert (fill (sockets [0], 65536) == 1);
+    drain (sockets [1], 1);
+    drain (sockets [3], 16);
+
+    for (int i = 0; i < 4; i++) {
+        rc = zmq_close (sockets [i]);
+        assert (rc == 0);
+    }
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_options (ctx);
+    test_inproc (ctx, true);
+    test_inproc (ctx, false);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    test_memory_budget ();
+
+    return 0;
+}
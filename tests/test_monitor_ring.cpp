@@ -0,0 +1,180 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+#define RECORD_BATCH 64
+
+static int drain_event (void *socket_, int event_, zmq_monitor_record_t *found_)
+{
+    //  Wait until a record for the event shows up
+    for (int attempt = 0; attempt < 100; attempt++) {
+        zmq_monitor_record_t records [RECORD_BATCH];
+        int count = zmq_socket_monitor_drain (socket_, records, RECORD_BATCH,
+                                              NULL);
+        assert (count >= 0);
+        for (int i = 0; i < count; i++)
+            if (records [i].event == (uint32_t) event_) {
+                *found_ = records [i];
+                return 0;
+            }
+        msleep (10);
+    }
+    return -1;
+}
+
+void test_connection_events (void *ctx_)
+{
+    size_t len = MAX_SOCKET_STRING;
+    char my_endpoint [MAX_SOCKET_STRING];
+
+    void *server = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (server);
+    void *client = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (client);
+
+    //  Nothing to drain before the ring is set up
+    zmq_monitor_record_t record;
+    int rc = zmq_socket_monitor_drain (server, &record, 1, NULL);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_socket_monitor_ring (server, ZMQ_EVENT_ALL, 0, 1);
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_socket_monitor_ring (server, ZMQ_EVENT_ALL, 16, 1);
+    assert (rc == 0);
+    rc = zmq_socket_monitor_ring (client, ZMQ_EVENT_ALL, 16, 1);
+    assert (rc == 0);
+
+    rc = zmq_bind (server, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, my_endpoint, &len);
+    assert (rc == 0);
+    rc = zmq_connect (client, my_endpoint);
+    assert (rc == 0);
+    bounce (server, client);
+
+    rc = drain_event (server, ZMQ_EVENT_ACCEPTED, &record);
+    assert (rc == 0);
+    assert (record.value > 0);
+    assert (record.timestamp > 0);
+    assert (record.sampled == 1);
+    assert (strncmp (record.address, "tcp://127.0.0.1:", 16) == 0);
+
+    rc = drain_event (client, ZMQ_EVENT_CONNECTED, &record);
+    assert (rc == 0);
+    assert (strcmp (record.address, my_endpoint) == 0);
+
+    //  Disabled events are not recorded
+    rc = zmq_socket_monitor_ring (server, 0, 16, 1);
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+    zmq_monitor_record_t records [RECORD_BATCH];
+    rc = zmq_socket_monitor_drain (server, records, RECORD_BATCH, NULL);
+    assert (rc >= 0);
+    rc = zmq_close (client);
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+    rc = zmq_socket_monitor_drain (server, &record, 1, NULL);
+    assert (rc == 0);
+
+    //  The ring cannot grow
+    rc = zmq_socket_monitor_ring (server, ZMQ_EVENT_ALL, 17, 1);
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_close (server);
+    assert (rc == 0);
+}
+
+void test_full_ring (void *ctx_)
+{
+    size_t len = MAX_SOCKET_STRING;
+    char my_endpoint [MAX_SOCKET_STRING];
+
+    //  Find a port nobody listens on
+    void *probe = zmq_socket (ctx_, ZMQ_PULL);
+    assert (probe);
+    int rc = zmq_bind (probe, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    rc = zmq_getsockopt (probe, ZMQ_LAST_ENDPOINT, my_endpoint, &len);
+    assert (rc == 0);
+    rc = zmq_close (probe);
+    assert (rc == 0);
+
+    //  A reconnect storm into a ring of two records
+    void *client = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (client);
+    int ivl = 1;
+    rc = zmq_setsockopt (client, ZMQ_RECONNECT_IVL, &ivl, sizeof ivl);
+    assert (rc == 0);
+    rc = zmq_socket_monitor_ring (client, ZMQ_EVENT_CONNECT_RETRIED, 2, 1);
+    assert (rc == 0);
+    rc = zmq_connect (client, my_endpoint);
+    assert (rc == 0);
+
+    zmq_monitor_record_t records [RECORD_BATCH];
+    uint64_t dropped = 0;
+    for (int attempt = 0; attempt < 100 && dropped == 0; attempt++) {
+        msleep (10);
+        rc = zmq_socket_monitor_drain (client, records, 1, &dropped);
+        assert (rc <= 1);
+    }
+    assert (dropped > 0);
+
+    //  Sampling keeps one in every 'sample_rate' records
+    rc = zmq_socket_monitor_drain (client, records, RECORD_BATCH, NULL);
+    assert (rc <= 2);
+    rc = zmq_socket_monitor_ring (client, ZMQ_EVENT_CONNECT_RETRIED, 2, 4);
+    assert (rc == 0);
+    rc = zmq_socket_monitor_drain (client, records, RECORD_BATCH, NULL);
+    assert (rc <= 2);
+    for (int attempt = 0; attempt < 100 && rc == 0; attempt++) {
+        msleep (10);
+        rc = zmq_socket_monitor_drain (client, records, RECORD_BATCH, NULL);
+    }
+    assert (rc > 0);
+    assert (records [rc - 1].event == ZMQ_EVENT_CONNECT_RETRIED);
+    assert (records [rc - 1].sampled == 4);
+
+    rc = zmq_close (client);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_connection_events (ctx);
+    test_full_ring (ctx);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
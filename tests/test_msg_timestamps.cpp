@@ -0,0 +1,321 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+static void set_int (void *socket_, int option_, int value_)
+{
+    int rc = zmq_setsockopt (socket_, option_, &value_, sizeof (value_));
+    assert (rc == 0);
+}
+
+//  Returns the time held in the property, or 0 if the message has none.
+static uint64_t stamp (zmq_msg_t *msg_, const char *property_)
+{
+    const char *value = zmq_msg_gets (msg_, property_);
+    if (!value)
+        return 0;
+    return strtoull (value, NULL, 10);
+}
+
+static void test_options (void *ctx_)
+{
+    void *socket = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (socket);
+
+    int value;
+    size_t size = sizeof (value);
+    int rc = zmq_getsockopt (socket, ZMQ_MSG_TIMESTAMPS, &value, &size);
+    assert (rc == 0 && value == 0);
+    set_int (socket, ZMQ_MSG_TIMESTAMPS, 1);
+    rc = zmq_getsockopt (socket, ZMQ_MSG_TIMESTAMPS, &value, &size);
+    assert (rc == 0 && value == 1);
+    value = 2;
+    rc = zmq_setsockopt (socket, ZMQ_MSG_TIMESTAMPS, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_getsockopt (socket, ZMQ_KERNEL_TIMESTAMPS, &value, &size);
+    assert (rc == 0 && value == 0);
+    set_int (socket, ZMQ_KERNEL_TIMESTAMPS, 1);
+    rc = zmq_getsockopt (socket, ZMQ_KERNEL_TIMESTAMPS, &value, &size);
+    assert (rc == 0 && value == 1);
+
+    rc = zmq_close (socket);
+    assert (rc == 0);
+}
+
+//  Sends a two part message and checks the stamps of both parts. Over
+//  inproc there is no engine, so only the socket stamps are present.
+static void test_transfer (void *ctx_, const char *endpoint_,
+    bool push_stamps_, bool pull_stamps_)
+{
+    void *push = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (push);
+    void *pull = zmq_socket (ctx_, ZMQ_PULL);
+    assert (pull);
+    set_int (push, ZMQ_MSG_TIMESTAMPS, push_stamps_);
+    set_int (pull, ZMQ_MSG_TIMESTAMPS, pull_stamps_);
+
+    int rc = zmq_bind (pull, endpoint_);
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof (endpoint);
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+    rc = zmq_connect (push, endpoint);
+    assert (rc == 0);
+
+    const bool tcp = strncmp (endpoint_, "tcp", 3) == 0;
+    const bool both = push_stamps_ && pull_stamps_;
+    for (int i = 0; i < 3; i++) {
+        //  Stamps are in nanoseconds since the epoch.
+        const uint64_t before = (uint64_t) time (NULL) * 1000000000;
+        rc = s_sendmore (push, "header");
+        assert (rc == 6);
+        rc = s_send (push, "body");
+        assert (rc == 4);
+
+        for (int part = 0; part < 2; part++) {
+            zmq_msg_t msg;
+            rc = zmq_msg_init (&msg);
+            assert (rc == 0);
+            rc = zmq_msg_recv (&msg, pull, 0);
+            assert (rc >= 0);
+            assert (zmq_msg_more (&msg) == (part == 0));
+
+            const uint64_t sent = stamp (&msg, ZMQ_MSG_PROPERTY_TIME_SENT);
+            const uint64_t written =
+                stamp (&msg, ZMQ_MSG_PROPERTY_TIME_WRITTEN);
+            const uint64_t arrived =
+                stamp (&msg, ZMQ_MSG_PROPERTY_TIME_ARRIVED);
+            const uint64_t decoded =
+                stamp (&msg, ZMQ_MSG_PROPERTY_TIME_DECODED);
+            const uint64_t received =
+                stamp (&msg, ZMQ_MSG_PROPERTY_TIME_RECEIVED);
+
+            if (!pull_stamps_) {
+                //  Only a sender's stamp can reach the application, and
+                //  only over inproc where the message itself is passed.
+                assert (!written && !arrived && !decoded && !received);
+                assert (!!sent == (push_stamps_ && !tcp));
+            }
+            else
+            if (tcp) {
+                assert (arrived && decoded && received);
+                assert (!!sent == both && !!written == both);
+                if (both)
+                    assert (before <= sent && sent <= written &&
+                        written <= arrived);
+                assert (arrived <= decoded && decoded <= received);
+            }
+            else {
+                assert (!written && !arrived && !decoded && received);
+                assert (!!sent == push_stamps_);
+                if (sent)
+                    assert (before <= sent && sent <= received);
+            }
+
+            rc = zmq_msg_close (&msg);
+            assert (rc == 0);
+        }
+    }
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+//  Stamped messages share recycled metadata. Messages the application
+//  still holds keep their own stamps and connection properties while
+//  later messages are stamped.
+static void test_held (void *ctx_)
+{
+    void *push = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (push);
+    void *pull = zmq_socket (ctx_, ZMQ_PULL);
+    assert (pull);
+    set_int (push, ZMQ_MSG_TIMESTAMPS, 1);
+    set_int (pull, ZMQ_MSG_TIMESTAMPS, 1);
+
+    int rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof (endpoint);
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+    rc = zmq_connect (push, endpoint);
+    assert (rc == 0);
+
+    const int held_count = 10;
+    zmq_msg_t held [held_count];
+    uint64_t sent [held_count];
+    uint64_t received [held_count];
+    for (int i = 0; i < held_count; i++) {
+        rc = s_send (push, "held");
+        assert (rc == 4);
+        rc = zmq_msg_init (&held [i]);
+        assert (rc == 0);
+        rc = zmq_msg_recv (&held [i], pull, 0);
+        assert (rc == 4);
+        sent [i] = stamp (&held [i], ZMQ_MSG_PROPERTY_TIME_SENT);
+        received [i] = stamp (&held [i], ZMQ_MSG_PROPERTY_TIME_RECEIVED);
+        assert (sent [i] && received [i]);
+        msleep (1);
+    }
+
+    for (int i = 0; i < 3 * held_count; i++) {
+        rc = s_send (push, "passing");
+        assert (rc == 7);
+        zmq_msg_t msg;
+        rc = zmq_msg_init (&msg);
+        assert (rc == 0);
+        rc = zmq_msg_recv (&msg, pull, 0);
+        assert (rc == 7);
+        assert (stamp (&msg, ZMQ_MSG_PROPERTY_TIME_RECEIVED)
+            > received [held_count - 1]);
+        rc = zmq_msg_close (&msg);
+        assert (rc == 0);
+    }
+
+    for (int i = 0; i < held_count; i++) {
+        assert (stamp (&held [i], ZMQ_MSG_PROPERTY_TIME_SENT) == sent [i]);
+        assert (stamp (&held [i], ZMQ_MSG_PROPERTY_TIME_RECEIVED)
+            == received [i]);
+        if (i > 0)
+            assert (received [i] > received [i - 1]);
+        assert (zmq_msg_gets (&held [i], ZMQ_MSG_PROPERTY_PEER_ADDRESS));
+        assert (zmq_msg_gets (&held [i], ZMQ_MSG_PROPERTY_SOCKET_TYPE));
+        rc = zmq_msg_close (&held [i]);
+        assert (rc == 0);
+    }
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+//  Checks the kernel receive timestamp over TCP, and over UDP if the
+//  draft RADIO and DISH sockets are built. Only Linux provides them.
+static void test_kernel (void *ctx_, bool udp_)
+{
+    void *sender = zmq_socket (ctx_, udp_ ? ZMQ_RADIO : ZMQ_PUSH);
+    assert (sender);
+    void *receiver = zmq_socket (ctx_, udp_ ? ZMQ_DISH : ZMQ_PULL);
+    assert (receiver);
+    set_int (receiver, ZMQ_KERNEL_TIMESTAMPS, 1);
+    set_int (receiver, ZMQ_MSG_TIMESTAMPS, 1);
+
+    char endpoint [256];
+    int rc;
+    if (udp_) {
+        rc = zmq_join (receiver, "stamps");
+        assert (rc == 0);
+        rc = zmq_bind (receiver, "udp://127.0.0.1:5566");
+        assert (rc == 0);
+        strcpy (endpoint, "udp://127.0.0.1:5566");
+    }
+    else {
+        rc = zmq_bind (receiver, "tcp://127.0.0.1:*");
+        assert (rc == 0);
+        size_t endpoint_size = sizeof (endpoint);
+        rc = zmq_getsockopt (receiver, ZMQ_LAST_ENDPOINT, endpoint,
+            &endpoint_size);
+        assert (rc == 0);
+    }
+    rc = zmq_connect (sender, endpoint);
+    assert (rc == 0);
+
+    //  UDP is lossy, so keep sending until something arrives.
+    int timeout = 100;
+    rc = zmq_setsockopt (receiver, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    for (int attempt = 0; ; attempt++) {
+        assert (attempt < 50);
+        rc = zmq_msg_init_size (&msg, 4);
+        assert (rc == 0);
+        memcpy (zmq_msg_data (&msg), "data", 4);
+        if (udp_) {
+            rc = zmq_msg_set_group (&msg, "stamps");
+            assert (rc == 0);
+        }
+        rc = zmq_msg_send (&msg, sender, 0);
+        assert (rc == 4);
+        rc = zmq_msg_recv (&msg, receiver, 0);
+        if (rc == 4)
+            break;
+        assert (rc == -1 && errno == EAGAIN);
+    }
+
+    const uint64_t kernel = stamp (&msg, ZMQ_MSG_PROPERTY_TIME_KERNEL);
+    const uint64_t received = stamp (&msg, ZMQ_MSG_PROPERTY_TIME_RECEIVED);
+    assert (received);
+#if defined ZMQ_HAVE_LINUX
+    assert (kernel && kernel <= received);
+    if (!udp_)
+        assert (kernel <= stamp (&msg, ZMQ_MSG_PROPERTY_TIME_DECODED));
+#else
+    (void) kernel;
+#endif
+
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+    rc = zmq_close (sender);
+    assert (rc == 0);
+    rc = zmq_close (receiver);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_options (ctx);
+    test_transfer (ctx, "tcp://127.0.0.1:*", true, true);
+    test_transfer (ctx, "tcp://127.0.0.1:*", false, true);
+    test_transfer (ctx, "tcp://127.0.0.1:*", true, false);
+    test_transfer (ctx, "inproc://stamps-both", true, true);
+    test_transfer (ctx, "inproc://stamps-sender", true, false);
+    test_transfer (ctx, "inproc://stamps-receiver", false, true);
+    test_held (ctx);
+    test_kernel (ctx, false);
+    test_kernel (ctx, true);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,182 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+static void
+bind_connect (void *ctx, const char *endpoint, int ring_size, int rcvhwm,
+              void **server, void **client)
+{
+    *server = zmq_socket (ctx, ZMQ_PAIR);
+    assert (*server);
+    int rc;
+    if (ring_size > 0) {
+        rc = zmq_setsockopt (*server, ZMQ_SNDBUF, &ring_size, sizeof (int));
+        assert (rc == 0);
+        rc = zmq_setsockopt (*server, ZMQ_RCVBUF, &ring_size, sizeof (int));
+        assert (rc == 0);
+    }
+    rc = zmq_setsockopt (*server, ZMQ_RCVHWM, &rcvhwm, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (*server, endpoint);
+    assert (rc == 0);
+
+    char my_endpoint [MAX_SOCKET_STRING];
+    size_t len = sizeof my_endpoint;
+    rc = zmq_getsockopt (*server, ZMQ_LAST_ENDPOINT, my_endpoint, &len);
+    assert (rc == 0);
+    assert (strncmp (my_endpoint, "shm://", 6) == 0);
+
+    *client = zmq_socket (ctx, ZMQ_PAIR);
+    assert (*client);
+    rc = zmq_setsockopt (*client, ZMQ_RCVHWM, &rcvhwm, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_connect (*client, my_endpoint);
+    assert (rc == 0);
+}
+
+static void
+close_pair (void *server, void *client)
+{
+    int rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+}
+
+static void
+send_pattern (void *socket, size_t size, unsigned int seed)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init_size (&msg, size);
+    assert (rc == 0);
+    unsigned char *data = (unsigned char *) zmq_msg_data (&msg);
+    for (size_t i = 0; i < size; i++)
+        data [i] = (unsigned char) (seed + i * 7);
+    rc = zmq_msg_send (&msg, socket, 0);
+    assert (rc == (int) size);
+}
+
+static void
+recv_pattern (void *socket, size_t size, unsigned int seed)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, socket, 0);
+    assert (rc == (int) size);
+    const unsigned char *data = (const unsigned char *) zmq_msg_data (&msg);
+    for (size_t i = 0; i < size; i++)
+        assert (data [i] == (unsigned char) (seed + i * 7));
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+}
+
+static void
+test_bounce (void *ctx)
+{
+    void *server, *client;
+    bind_connect (ctx, "shm://test_pair_shm", 0, 1000, &server, &client);
+    bounce (server, client);
+    close_pair (server, client);
+}
+
+static void
+test_large_messages (void *ctx)
+{
+    //  Messages much larger than the rings have to go through in pieces.
+    void *server, *client;
+    bind_connect (ctx, "shm://*", 4096, 1000, &server, &client);
+
+    const size_t sizes [] = {0, 1, 4095, 4096, 4097, 100000, 1048576};
+    for (size_t i = 0; i < sizeof sizes / sizeof sizes [0]; i++) {
+        send_pattern (client, sizes [i], (unsigned int) i);
+        recv_pattern (server, sizes [i], (unsigned int) i);
+        send_pattern (server, sizes [i], (unsigned int) i + 1);
+        recv_pattern (client, sizes [i], (unsigned int) i + 1);
+    }
+    close_pair (server, client);
+}
+
+static void
+test_backpressure (void *ctx)
+{
+    //  Both sides queue more than the rings and the receiving pipes can
+    //  hold before anybody reads, so writers stall on full rings while
+    //  readers have throttled their input.
+    void *server, *client;
+    bind_connect (ctx, "shm://*", 4096, 10, &server, &client);
+
+    const int count = 500;
+    for (int i = 0; i < count; i++) {
+        send_pattern (client, 1000 + i, i);
+        send_pattern (server, 2000 + i, i);
+    }
+    for (int i = 0; i < count; i++) {
+        recv_pattern (server, 1000 + i, i);
+        recv_pattern (client, 2000 + i, i);
+    }
+    close_pair (server, client);
+}
+
+static void
+test_invalid_address (void *ctx)
+{
+    void *socket = zmq_socket (ctx, ZMQ_PAIR);
+    assert (socket);
+    int rc = zmq_bind (socket, "shm://a/b");
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_connect (socket, "shm://a/b");
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_close (socket);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    if (!zmq_has ("shm")) {
+        printf ("shm transport not available, skipping test\n");
+        return 0;
+    }
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_bounce (ctx);
+    test_large_messages (ctx);
+    test_backpressure (ctx);
+    test_invalid_address (ctx);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
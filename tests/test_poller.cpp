@@ -29,6 +29,158 @@
 
 #include "testutil.hpp"
 
+#define MANY_PAIRS 100
+
+static void send_string (void *socket_, const char *string_)
+{
+    int rc = s_send (socket_, string_);
+    assert (rc == (int) strlen (string_));
+}
+
+static void recv_string (void *socket_, const char *string_)
+{
+    char *received = s_recv (socket_);
+    assert (received);
+    assert (streq (received, string_));
+    free (received);
+}
+
+//  Enough items for the poller to switch to its epoll based implementation
+//  where available; results must be the same either way.
+static void test_many_items (void *ctx_)
+{
+    void *servers [MANY_PAIRS];
+    void *clients [MANY_PAIRS];
+    char endpoint [32];
+    int rc;
+
+    void *poller = zmq_poller_new ();
+    assert (poller);
+
+    for (int i = 0; i < MANY_PAIRS; i++) {
+        sprintf (endpoint, "inproc://many-%d", i);
+        servers [i] = zmq_socket (ctx_, ZMQ_PAIR);
+        assert (servers [i]);
+        rc = zmq_bind (servers [i], endpoint);
+        assert (rc == 0);
+        clients [i] = zmq_socket (ctx_, ZMQ_PAIR);
+        assert (clients [i]);
+        rc = zmq_connect (clients [i], endpoint);
+        assert (rc == 0);
+        rc = zmq_poller_add (poller, servers [i], &servers [i], ZMQ_POLLIN);
+        assert (rc == 0);
+    }
+
+    zmq_poller_event_t events [MANY_PAIRS];
+    rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 0);
+    assert (rc == -1 && errno == ETIMEDOUT);
+
+    //  Ready sockets are reported in the order they were added in, and
+    //  for as long as they have messages.
+    send_string (clients [70], "seventy");
+    send_string (clients [10], "ten");
+    rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 1000);
+    assert (rc == 2);
+    assert (events [0].socket == servers [10]);
+    assert (events [0].user_data == &servers [10]);
+    assert (events [0].events == ZMQ_POLLIN);
+    assert (events [1].socket == servers [70]);
+
+    recv_string (servers [70], "seventy");
+    rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 0);
+    assert (rc == 1);
+    assert (events [0].socket == servers [10]);
+    recv_string (servers [10], "ten");
+    rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 0);
+    assert (rc == -1 && errno == ETIMEDOUT);
+
+    //  Changing the events of a socket has it checked again.
+    rc = zmq_poller_modify (poller, servers [5], ZMQ_POLLOUT);
+    assert (rc == 0);
+    rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 0);
+    assert (rc == 1);
+    assert (events [0].socket == servers [5]);
+    assert (events [0].events == ZMQ_POLLOUT);
+    rc = zmq_poller_modify (poller, servers [5], ZMQ_POLLIN);
+    assert (rc == 0);
+    rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 0);
+    assert (rc == -1 && errno == ETIMEDOUT);
+
+#if !defined _WIN32
+    //  Raw file descriptors stay level-triggered.
+    int fds [2];
+    rc = pipe (fds);
+    assert (rc == 0);
+    rc = zmq_poller_add_fd (poller, fds [0], NULL, ZMQ_POLLIN);
+    assert (rc == 0);
+    rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 0);
+    assert (rc == -1 && errno == ETIMEDOUT);
+    char byte = 'x';
+    rc = (int) write (fds [1], &byte, 1);
+    assert (rc == 1);
+    for (int pass = 0; pass != 2; pass++) {
+        rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 1000);
+        assert (rc == 1);
+        assert (events [0].socket == NULL);
+        assert (events [0].fd == fds [0]);
+        assert (events [0].events == ZMQ_POLLIN);
+    }
+    rc = (int) read (fds [0], &byte, 1);
+    assert (rc == 1);
+    rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 0);
+    assert (rc == -1 && errno == ETIMEDOUT);
+    rc = zmq_poller_remove_fd (poller, fds [0]);
+    assert (rc == 0);
+    close (fds [0]);
+    close (fds [1]);
+#endif
+
+    //  A wake-up consumed by the application using the socket itself is
+    //  not lost.
+    rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 0);
+    assert (rc == -1 && errno == ETIMEDOUT);
+    send_string (clients [40], "forty");
+    msleep (SETTLE_TIME);
+    int events_value;
+    size_t events_size = sizeof (events_value);
+    rc = zmq_getsockopt (servers [40], ZMQ_EVENTS, &events_value,
+        &events_size);
+    assert (rc == 0);
+    assert (events_value & ZMQ_POLLIN);
+    send_string (servers [40], "reply");
+    rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 0);
+    assert (rc == 1);
+    assert (events [0].socket == servers [40]);
+    recv_string (servers [40], "forty");
+    recv_string (clients [40], "reply");
+    rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 0);
+    assert (rc == -1 && errno == ETIMEDOUT);
+
+    //  Messages that arrived while waiting are seen.
+    send_string (clients [99], "last");
+    rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 1000);
+    assert (rc == 1);
+    assert (events [0].socket == servers [99]);
+
+    //  Dropping below the threshold keeps the pending events.
+    for (int i = 0; i < MANY_PAIRS - 1; i++) {
+        rc = zmq_poller_remove (poller, servers [i]);
+        assert (rc == 0);
+    }
+    rc = zmq_poller_wait_all (poller, events, MANY_PAIRS, 0);
+    assert (rc == 1);
+    assert (events [0].socket == servers [99]);
+    recv_string (servers [99], "last");
+
+    rc = zmq_poller_destroy (&poller);
+    assert (rc == 0);
+
+    for (int i = 0; i < MANY_PAIRS; i++) {
+        close_zero_linger (servers [i]);
+        close_zero_linger (clients [i]);
+    }
+}
+
 int main (void)
 {
     size_t len = MAX_SOCKET_STRING;
@@ -179,6 +331,9 @@ int main (void)
 
     rc = zmq_poller_destroy (&poller);
     assert(rc == 0);
+
+    test_many_items (ctx);
+
     rc = zmq_ctx_term (ctx);
     assert (rc == 0);
 
@@ -0,0 +1,194 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Pushes messages through a PULL/PUSH steerable proxy and checks the
+//  counters returned by STATISTICS and the histograms returned by
+//  HISTOGRAMS after SAMPLE.
+
+#define MESSAGE_COUNT 100
+#define HISTOGRAM_BUCKETS 32
+
+typedef struct
+{
+    void *frontend;
+    void *backend;
+    void *control;
+    int rc;
+} proxy_args_t;
+
+static void proxy_task (void *arg_)
+{
+    proxy_args_t *args = (proxy_args_t *) arg_;
+    args->rc =
+      zmq_proxy_steerable (args->frontend, args->backend, NULL, args->control);
+}
+
+static void send_command (void *control_, const char *command_)
+{
+    int rc = zmq_send (control_, command_, strlen (command_), 0);
+    assert (rc == (int) strlen (command_));
+}
+
+//  Receives 'frames_' frames of 'frame_size_' bytes into 'data_'
+static void recv_reply (void *control_, void *data_, size_t frame_size_,
+                        int frames_)
+{
+    for (int i = 0; i != frames_; i++) {
+        int rc = zmq_recv (control_, (char *) data_ + i * frame_size_,
+                           frame_size_, 0);
+        assert (rc == (int) frame_size_);
+        int more;
+        size_t more_size = sizeof more;
+        rc = zmq_getsockopt (control_, ZMQ_RCVMORE, &more, &more_size);
+        assert (rc == 0);
+        assert (more == (i < frames_ - 1));
+    }
+}
+
+static uint64_t histogram_total (const uint64_t *histogram_)
+{
+    uint64_t total = 0;
+    for (int i = 0; i != HISTOGRAM_BUCKETS; i++)
+        total += histogram_ [i];
+    return total;
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    proxy_args_t args;
+    args.frontend = zmq_socket (ctx, ZMQ_PULL);
+    assert (args.frontend);
+    int rc = zmq_bind (args.frontend, "inproc://frontend");
+    assert (rc == 0);
+    args.backend = zmq_socket (ctx, ZMQ_PUSH);
+    assert (args.backend);
+    rc = zmq_bind (args.backend, "inproc://backend");
+    assert (rc == 0);
+    args.control = zmq_socket (ctx, ZMQ_PAIR);
+    assert (args.control);
+    rc = zmq_bind (args.control, "inproc://control");
+    assert (rc == 0);
+    args.rc = -1;
+
+    void *control = zmq_socket (ctx, ZMQ_PAIR);
+    assert (control);
+    rc = zmq_connect (control, "inproc://control");
+    assert (rc == 0);
+    void *sender = zmq_socket (ctx, ZMQ_PUSH);
+    assert (sender);
+    rc = zmq_connect (sender, "inproc://frontend");
+    assert (rc == 0);
+    void *receiver = zmq_socket (ctx, ZMQ_PULL);
+    assert (receiver);
+    rc = zmq_connect (receiver, "inproc://backend");
+    assert (rc == 0);
+
+    void *thread = zmq_threadstart (&proxy_task, &args);
+
+    //  Nothing forwarded yet
+    uint64_t counters [8];
+    send_command (control, "STATISTICS");
+    recv_reply (control, counters, sizeof (uint64_t), 8);
+    for (int i = 0; i != 8; i++)
+        assert (counters [i] == 0);
+
+    send_command (control, "SAMPLE");
+
+    //  Single part messages of 10 bytes and one two part message of
+    //  3 + 4 bytes, which counts as one message of 7 bytes
+    char buf [16];
+    for (int i = 0; i < MESSAGE_COUNT; i++) {
+        rc = zmq_send (sender, "0123456789", 10, 0);
+        assert (rc == 10);
+    }
+    rc = zmq_send (sender, "abc", 3, ZMQ_SNDMORE);
+    assert (rc == 3);
+    rc = zmq_send (sender, "defg", 4, 0);
+    assert (rc == 4);
+    for (int i = 0; i < MESSAGE_COUNT; i++) {
+        rc = zmq_recv (receiver, buf, sizeof buf, 0);
+        assert (rc == 10);
+    }
+    rc = zmq_recv (receiver, buf, sizeof buf, 0);
+    assert (rc == 3);
+    rc = zmq_recv (receiver, buf, sizeof buf, 0);
+    assert (rc == 4);
+
+    send_command (control, "STATISTICS");
+    recv_reply (control, counters, sizeof (uint64_t), 8);
+    const uint64_t msgs = MESSAGE_COUNT + 1;
+    const uint64_t bytes = MESSAGE_COUNT * 10 + 7;
+    //  Frontend: in, in bytes, out, out bytes; then backend
+    assert (counters [0] == msgs && counters [1] == bytes);
+    assert (counters [2] == 0 && counters [3] == 0);
+    assert (counters [4] == 0 && counters [5] == 0);
+    assert (counters [6] == msgs && counters [7] == bytes);
+
+    uint64_t histograms [4][HISTOGRAM_BUCKETS];
+    send_command (control, "HISTOGRAMS");
+    recv_reply (control, histograms, sizeof histograms [0], 4);
+    //  Every request was timed; the queue depths add up to the same total
+    assert (histogram_total (histograms [0]) == msgs);
+    assert (histograms [1][0] == 0);
+    uint64_t depth_total = 0;
+    for (int i = 1; i != HISTOGRAM_BUCKETS; i++)
+        depth_total += histograms [1][i] * (1 << (i - 1));
+    assert (depth_total <= msgs);
+    assert (histogram_total (histograms [1]) > 0);
+    //  Nothing went the other way
+    assert (histogram_total (histograms [2]) == 0);
+    assert (histogram_total (histograms [3]) == 0);
+
+    send_command (control, "TERMINATE");
+    zmq_threadclose (thread);
+    assert (args.rc == 0);
+
+    rc = zmq_close (sender);
+    assert (rc == 0);
+    rc = zmq_close (receiver);
+    assert (rc == 0);
+    rc = zmq_close (control);
+    assert (rc == 0);
+    rc = zmq_close (args.frontend);
+    assert (rc == 0);
+    rc = zmq_close (args.backend);
+    assert (rc == 0);
+    rc = zmq_close (args.control);
+    assert (rc == 0);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
@@ -0,0 +1,270 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Runs a ROUTER/DEALER queue through zmq_proxy_threaded and checks that
+//  requests and replies cross both internal threads, that the control
+//  commands are honoured and that TERMINATE makes the proxy return 0.
+
+#define REQUEST_COUNT 1000
+
+typedef struct
+{
+    void *frontend;
+    void *backend;
+    void *control;
+    int rc;
+    int err;
+} proxy_args_t;
+
+static void proxy_task (void *arg_)
+{
+    proxy_args_t *args = (proxy_args_t *) arg_;
+    args->rc =
+      zmq_proxy_threaded (args->frontend, args->backend, NULL, args->control);
+    args->err = errno;
+}
+
+//  A failure in the internal thread, here a ROUTER_MANDATORY backend that
+//  cannot route a request, stops the whole proxy with its error.
+static void test_backend_failure (void *ctx_)
+{
+    proxy_args_t args;
+    args.frontend = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (args.frontend);
+    int rc = zmq_bind (args.frontend, "inproc://failure-frontend");
+    assert (rc == 0);
+    args.backend = zmq_socket (ctx_, ZMQ_ROUTER);
+    assert (args.backend);
+    int mandatory = 1;
+    rc = zmq_setsockopt (args.backend, ZMQ_ROUTER_MANDATORY, &mandatory,
+                         sizeof mandatory);
+    assert (rc == 0);
+    rc = zmq_bind (args.backend, "inproc://failure-backend");
+    assert (rc == 0);
+    args.control = NULL;
+    args.rc = 0;
+
+    void *client = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (client);
+    rc = zmq_connect (client, "inproc://failure-frontend");
+    assert (rc == 0);
+
+    //  A mandatory ROUTER is only writable with a peer.
+    void *worker = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (worker);
+    rc = zmq_connect (worker, "inproc://failure-backend");
+    assert (rc == 0);
+
+    void *thread = zmq_threadstart (&proxy_task, &args);
+
+    rc = zmq_send (client, "nobody", 6, ZMQ_SNDMORE);
+    assert (rc == 6);
+    rc = zmq_send (client, "request", 7, 0);
+    assert (rc == 7);
+
+    zmq_threadclose (thread);
+    assert (args.rc == -1 && args.err == EHOSTUNREACH);
+
+    rc = zmq_close (worker);
+    assert (rc == 0);
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (args.frontend);
+    assert (rc == 0);
+    rc = zmq_close (args.backend);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    size_t len = MAX_SOCKET_STRING;
+    char frontend_endpoint[MAX_SOCKET_STRING];
+    char backend_endpoint[MAX_SOCKET_STRING];
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Null sockets are rejected
+    int rc = zmq_proxy_threaded (NULL, NULL, NULL, NULL);
+    assert (rc == -1 && errno == EFAULT);
+
+    proxy_args_t args;
+    args.frontend = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (args.frontend);
+    rc = zmq_bind (args.frontend, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    rc = zmq_getsockopt (args.frontend, ZMQ_LAST_ENDPOINT, frontend_endpoint,
+                         &len);
+    assert (rc == 0);
+
+    args.backend = zmq_socket (ctx, ZMQ_DEALER);
+    assert (args.backend);
+    rc = zmq_bind (args.backend, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    len = MAX_SOCKET_STRING;
+    rc = zmq_getsockopt (args.backend, ZMQ_LAST_ENDPOINT, backend_endpoint,
+                         &len);
+    assert (rc == 0);
+
+    args.control = zmq_socket (ctx, ZMQ_PAIR);
+    assert (args.control);
+    rc = zmq_bind (args.control, "inproc://control");
+    assert (rc == 0);
+    args.rc = -1;
+
+    void *control = zmq_socket (ctx, ZMQ_PAIR);
+    assert (control);
+    rc = zmq_connect (control, "inproc://control");
+    assert (rc == 0);
+
+    void *client = zmq_socket (ctx, ZMQ_DEALER);
+    assert (client);
+    rc = zmq_connect (client, frontend_endpoint);
+    assert (rc == 0);
+
+    void *worker = zmq_socket (ctx, ZMQ_DEALER);
+    assert (worker);
+    rc = zmq_connect (worker, backend_endpoint);
+    assert (rc == 0);
+
+    void *thread = zmq_threadstart (&proxy_task, &args);
+
+    //  Pipeline a batch of requests, let the worker echo them, then
+    //  collect every reply in order
+    char buf[32];
+    for (int i = 0; i < REQUEST_COUNT; i++) {
+        sprintf (buf, "request %d", i);
+        rc = zmq_send (client, buf, strlen (buf), 0);
+        assert (rc == (int) strlen (buf));
+    }
+    for (int i = 0; i < REQUEST_COUNT; i++) {
+        zmq_msg_t msg;
+        rc = zmq_msg_init (&msg);
+        assert (rc == 0);
+        //  Routing id, then body
+        rc = zmq_msg_recv (&msg, worker, 0);
+        assert (rc > 0);
+        assert (zmq_msg_more (&msg));
+        rc = zmq_msg_send (&msg, worker, ZMQ_SNDMORE);
+        assert (rc > 0);
+        rc = zmq_msg_recv (&msg, worker, 0);
+        assert (rc > 0);
+        assert (!zmq_msg_more (&msg));
+        rc = zmq_msg_send (&msg, worker, 0);
+        assert (rc > 0);
+        rc = zmq_msg_close (&msg);
+        assert (rc == 0);
+    }
+    for (int i = 0; i < REQUEST_COUNT; i++) {
+        char expected[32];
+        sprintf (expected, "request %d", i);
+        rc = zmq_recv (client, buf, sizeof buf, 0);
+        assert (rc == (int) strlen (expected));
+        assert (memcmp (buf, expected, rc) == 0);
+    }
+
+    //  Counters come from the real frontend and backend, although they
+    //  are owned by different threads. Requests carry a routing id frame
+    //  but still count as one message each.
+    uint64_t counters [8];
+    rc = zmq_send (control, "STATISTICS", 10, 0);
+    assert (rc == 10);
+    for (int i = 0; i != 8; i++) {
+        rc = zmq_recv (control, &counters [i], sizeof counters [i], 0);
+        assert (rc == sizeof counters [i]);
+    }
+    for (int i = 0; i != 8; i += 2)
+        assert (counters [i] == REQUEST_COUNT);
+
+    //  Commands can be pipelined; each is answered in turn once the
+    //  other half has reported
+    const char *commands [] = {"STATISTICS", "HISTOGRAMS", "STATISTICS"};
+    const int frames [] = {8, 4, 8};
+    const size_t frame_sizes [] = {8, 256, 8};
+    for (int i = 0; i != 3; i++) {
+        rc = zmq_send (control, commands [i], 10, 0);
+        assert (rc == 10);
+    }
+    for (int i = 0; i != 3; i++) {
+        uint64_t frame [32];
+        for (int j = 0; j != frames [i]; j++) {
+            rc = zmq_recv (control, frame, sizeof frame, 0);
+            assert (rc == (int) frame_sizes [i]);
+            int more;
+            size_t more_size = sizeof more;
+            rc = zmq_getsockopt (control, ZMQ_RCVMORE, &more, &more_size);
+            assert (rc == 0);
+            assert (more == (j < frames [i] - 1));
+        }
+    }
+
+    //  While paused nothing crosses the proxy; RESUME releases the request
+    rc = zmq_send (control, "PAUSE", 5, 0);
+    assert (rc == 5);
+    msleep (SETTLE_TIME);
+    rc = zmq_send (client, "paused", 6, 0);
+    assert (rc == 6);
+    msleep (SETTLE_TIME);
+    rc = zmq_recv (worker, buf, sizeof buf, ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = zmq_send (control, "RESUME", 6, 0);
+    assert (rc == 6);
+    rc = zmq_recv (worker, buf, sizeof buf, 0);
+    assert (rc > 0);
+    rc = zmq_recv (worker, buf, sizeof buf, 0);
+    assert (rc == 6);
+    assert (memcmp (buf, "paused", 6) == 0);
+
+    rc = zmq_send (control, "TERMINATE", 9, 0);
+    assert (rc == 9);
+    zmq_threadclose (thread);
+    assert (args.rc == 0);
+
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (worker);
+    assert (rc == 0);
+    rc = zmq_close (control);
+    assert (rc == 0);
+    rc = zmq_close (args.frontend);
+    assert (rc == 0);
+    rc = zmq_close (args.backend);
+    assert (rc == 0);
+    rc = zmq_close (args.control);
+    assert (rc == 0);
+
+    test_backend_failure (ctx);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
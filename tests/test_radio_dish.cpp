@@ -81,6 +81,104 @@ int msg_recv_cmp (zmq_msg_t *msg_, void *s_, const char* group_, const char* bod
     return recv_rc;
 }
 
+//  Datagrams arriving while the dish pipe is full are dropped; the dish
+//  keeps receiving once it has room again.
+static void test_udp_full_pipe (void *ctx_)
+{
+    void *radio = zmq_socket (ctx_, ZMQ_RADIO);
+    assert (radio);
+    void *dish = zmq_socket (ctx_, ZMQ_DISH);
+    assert (dish);
+
+    int hwm = 1;
+    int rc = zmq_setsockopt (dish, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_join (dish, "Movies");
+    assert (rc == 0);
+    rc = zmq_bind (dish, "udp://127.0.0.1:5556");
+    assert (rc == 0);
+    rc = zmq_connect (radio, "udp://127.0.0.1:5556");
+    assert (rc == 0);
+
+    msleep (SETTLE_TIME);
+
+    zmq_msg_t msg;
+    for (int i = 0; i < 100; i++) {
+        rc = msg_send (&msg, radio, "Movies", "Godfather");
+        assert (rc == 9);
+    }
+    msleep (SETTLE_TIME);
+
+    //  Drain whatever made it into the pipe.
+    int timeout = 250;
+    rc = zmq_setsockopt (dish, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    int received = 0;
+    while (msg_recv_cmp (&msg, dish, "Movies", "Godfather") == 9)
+        received++;
+    assert (received > 0 && received < 100);
+
+    //  New datagrams get through again.
+    rc = msg_send (&msg, radio, "Movies", "Alien");
+    assert (rc == 5);
+    rc = msg_recv_cmp (&msg, dish, "Movies", "Alien");
+    assert (rc == 5);
+
+    rc = zmq_close (dish);
+    assert (rc == 0);
+    rc = zmq_close (radio);
+    assert (rc == 0);
+}
+
+//  Over TCP a full dish pipe holds the connection back instead; every
+//  message arrives once the dish reads again.
+static void test_tcp_full_pipe (void *ctx_)
+{
+    void *radio = zmq_socket (ctx_, ZMQ_RADIO);
+    assert (radio);
+    void *dish = zmq_socket (ctx_, ZMQ_DISH);
+    assert (dish);
+
+    int hwm = 1;
+    int rc = zmq_setsockopt (dish, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_join (dish, "Movies");
+    assert (rc == 0);
+    rc = zmq_bind (radio, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [MAX_SOCKET_STRING];
+    size_t len = sizeof (endpoint);
+    rc = zmq_getsockopt (radio, ZMQ_LAST_ENDPOINT, endpoint, &len);
+    assert (rc == 0);
+    rc = zmq_connect (dish, endpoint);
+    assert (rc == 0);
+
+    msleep (SETTLE_TIME);
+
+    zmq_msg_t msg;
+    char body [16];
+    for (int i = 0; i < 100; i++) {
+        sprintf (body, "%d", i);
+        rc = msg_send (&msg, radio, "Movies", body);
+        assert (rc == (int) strlen (body));
+    }
+    msleep (SETTLE_TIME);
+
+    int timeout = 1000;
+    rc = zmq_setsockopt (dish, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    for (int i = 0; i < 100; i++) {
+        sprintf (body, "%d", i);
+        rc = msg_recv_cmp (&msg, dish, "Movies", body);
+        assert (rc == (int) strlen (body));
+    }
+
+    rc = zmq_close (dish);
+    assert (rc == 0);
+    rc = zmq_close (radio);
+    assert (rc == 0);
+}
+
 int main (void)
 {
     size_t len = MAX_SOCKET_STRING;
@@ -184,6 +282,9 @@ int main (void)
     rc = zmq_close (radio);
     assert (rc == 0);
 
+    test_udp_full_pipe (ctx);
+    test_tcp_full_pipe (ctx);
+
     rc = zmq_ctx_term (ctx);
     assert (rc == 0);
 
@@ -29,6 +29,105 @@
 
 #include "testutil.hpp"
 
+//  Moves one message from 'from_' to 'to_', frame by frame.
+static void relay (void *from_, void *to_)
+{
+    int more = 1;
+    while (more) {
+        zmq_msg_t msg;
+        int rc = zmq_msg_init (&msg);
+        assert (rc == 0);
+        rc = zmq_msg_recv (&msg, from_, 0);
+        assert (rc >= 0);
+        more = zmq_msg_more (&msg);
+        rc = zmq_msg_send (&msg, to_, more ? ZMQ_SNDMORE : 0);
+        assert (rc >= 0);
+    }
+}
+
+//  Sends frames of 'sizes_', the i-th one filled with 'a' + i.
+static void send_frames (void *socket_, const size_t *sizes_, int count_)
+{
+    char data [64];
+    for (int i = 0; i != count_; i++) {
+        memset (data, 'a' + i, sizes_ [i]);
+        const int rc = zmq_send (socket_, data, sizes_ [i],
+            i < count_ - 1 ? ZMQ_SNDMORE : 0);
+        assert (rc == (int) sizes_ [i]);
+    }
+}
+
+static void recv_frames (void *socket_, const size_t *sizes_, int count_)
+{
+    char data [64];
+    char expected [64];
+    for (int i = 0; i != count_; i++) {
+        const int rc = zmq_recv (socket_, data, sizeof data, 0);
+        assert (rc == (int) sizes_ [i]);
+        memset (expected, 'a' + i, sizes_ [i]);
+        assert (memcmp (data, expected, sizes_ [i]) == 0);
+        int more;
+        size_t more_size = sizeof more;
+        const int rc2 = zmq_getsockopt (socket_, ZMQ_RCVMORE, &more,
+            &more_size);
+        assert (rc2 == 0);
+        assert (more == (i < count_ - 1));
+    }
+}
+
+//  A deep envelope of small frames, more than the pipes pack into one
+//  entry, crosses a broker both ways unchanged.
+static void test_deep_envelope (void *ctx_)
+{
+    void *frontend = zmq_socket (ctx_, ZMQ_ROUTER);
+    assert (frontend);
+    int rc = zmq_bind (frontend, "inproc://envelope-frontend");
+    assert (rc == 0);
+    void *backend = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (backend);
+    rc = zmq_bind (backend, "inproc://envelope-backend");
+    assert (rc == 0);
+
+    void *client = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (client);
+    rc = zmq_setsockopt (client, ZMQ_IDENTITY, "client", 6);
+    assert (rc == 0);
+    rc = zmq_connect (client, "inproc://envelope-frontend");
+    assert (rc == 0);
+    void *worker = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (worker);
+    rc = zmq_connect (worker, "inproc://envelope-backend");
+    assert (rc == 0);
+
+    //  Routing ids of earlier hops, a frame that only just fits an entry,
+    //  one too large for packing, the delimiter and a body.
+    const size_t sizes [] = {5, 5, 5, 5, 5, 5, 0, 32, 33, 0, 40};
+    const int count = sizeof sizes / sizeof sizes [0];
+    send_frames (client, sizes, count);
+    relay (frontend, backend);
+
+    //  The worker sees the client's routing id first.
+    char id [16];
+    rc = zmq_recv (worker, id, sizeof id, 0);
+    assert (rc == 6 && memcmp (id, "client", 6) == 0);
+    recv_frames (worker, sizes, count);
+
+    rc = zmq_send (worker, "client", 6, ZMQ_SNDMORE);
+    assert (rc == 6);
+    send_frames (worker, sizes, count);
+    relay (backend, frontend);
+    recv_frames (client, sizes, count);
+
+    rc = zmq_close (worker);
+    assert (rc == 0);
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (backend);
+    assert (rc == 0);
+    rc = zmq_close (frontend);
+    assert (rc == 0);
+}
+
 int main (void)
 {
     setup_test_environment();
@@ -146,6 +245,9 @@ int main (void)
     assert (rc == 0);
     rc = zmq_close (dealer);
     assert (rc == 0);
+
+    test_deep_envelope (ctx);
+
     rc = zmq_ctx_term (ctx);
     assert (rc == 0);
 
@@ -0,0 +1,220 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+static zmq_socket_stats_t get_stats (void *socket_)
+{
+    zmq_socket_stats_t stats;
+    size_t size = sizeof stats;
+    int rc = zmq_getsockopt (socket_, ZMQ_SOCKET_STATS, &stats, &size);
+    assert (rc == 0);
+    assert (size == sizeof stats);
+    return stats;
+}
+
+void test_message_counters (void *ctx_)
+{
+    void *push = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (push);
+    void *pull = zmq_socket (ctx_, ZMQ_PULL);
+    assert (pull);
+
+    //  A send with no peer cannot be queued
+    int rc = zmq_send (push, "x", 1, ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+    zmq_socket_stats_t stats = get_stats (push);
+    assert (stats.hwm_blocks == 1);
+    assert (stats.msgs_out == 0);
+
+    rc = zmq_bind (pull, "inproc://counters");
+    assert (rc == 0);
+    rc = zmq_connect (push, "inproc://counters");
+    assert (rc == 0);
+
+    //  A single part message and a two part message
+    rc = zmq_send (push, "hello", 5, 0);
+    assert (rc == 5);
+    rc = zmq_send (push, "abc", 3, ZMQ_SNDMORE);
+    assert (rc == 3);
+    rc = zmq_send (push, "defg", 4, 0);
+    assert (rc == 4);
+
+    char buf [8];
+    for (int i = 0; i < 3; i++) {
+        rc = zmq_recv (pull, buf, sizeof buf, 0);
+        assert (rc > 0);
+    }
+
+    stats = get_stats (push);
+    assert (stats.msgs_out == 2);
+    assert (stats.bytes_out == 12);
+    stats = get_stats (pull);
+    assert (stats.msgs_in == 2);
+    assert (stats.bytes_in == 12);
+    assert (stats.msgs_out == 0);
+
+    //  Too small a buffer is rejected
+    size_t size = sizeof stats - 1;
+    rc = zmq_getsockopt (pull, ZMQ_SOCKET_STATS, &stats, &size);
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+void test_drops (void *ctx_)
+{
+    //  PUB drops what a slow subscriber cannot queue
+    void *pub = zmq_socket (ctx_, ZMQ_PUB);
+    assert (pub);
+    int hwm = 1;
+    int rc = zmq_setsockopt (pub, ZMQ_SNDHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_bind (pub, "inproc://drops");
+    assert (rc == 0);
+    void *sub = zmq_socket (ctx_, ZMQ_SUB);
+    assert (sub);
+    rc = zmq_setsockopt (sub, ZMQ_RCVHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "", 0);
+    assert (rc == 0);
+    rc = zmq_connect (sub, "inproc://drops");
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+
+    for (int i = 0; i < 10; i++) {
+        rc = zmq_send (pub, "x", 1, 0);
+        assert (rc == 1);
+    }
+    zmq_socket_stats_t stats = get_stats (pub);
+    assert (stats.msgs_out == 10);
+    assert (stats.hwm_drops > 0);
+
+    //  ROUTER drops messages for unknown identities
+    void *router = zmq_socket (ctx_, ZMQ_ROUTER);
+    assert (router);
+    rc = zmq_send (router, "nobody", 6, ZMQ_SNDMORE);
+    assert (rc == 6);
+    rc = zmq_send (router, "lost", 4, 0);
+    assert (rc == 4);
+    stats = get_stats (router);
+    assert (stats.unroutable_drops == 1);
+    assert (stats.hwm_drops == 0);
+
+    rc = zmq_close (pub);
+    assert (rc == 0);
+    rc = zmq_close (sub);
+    assert (rc == 0);
+    rc = zmq_close (router);
+    assert (rc == 0);
+}
+
+void test_connection_counters (void *ctx_)
+{
+    size_t len = MAX_SOCKET_STRING;
+    char my_endpoint [MAX_SOCKET_STRING];
+
+    //  Find a port nobody listens on
+    void *probe = zmq_socket (ctx_, ZMQ_PULL);
+    assert (probe);
+    int rc = zmq_bind (probe, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    rc = zmq_getsockopt (probe, ZMQ_LAST_ENDPOINT, my_endpoint, &len);
+    assert (rc == 0);
+    rc = zmq_close (probe);
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (push);
+    int ivl = 10;
+    rc = zmq_setsockopt (push, ZMQ_RECONNECT_IVL, &ivl, sizeof ivl);
+    assert (rc == 0);
+    rc = zmq_connect (push, my_endpoint);
+    assert (rc == 0);
+
+    //  A peer that hangs up before the greeting fails the handshake
+    void *pull = zmq_socket (ctx_, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    len = MAX_SOCKET_STRING;
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, my_endpoint, &len);
+    assert (rc == 0);
+    void *raw = zmq_socket (ctx_, ZMQ_STREAM);
+    assert (raw);
+    rc = zmq_connect (raw, my_endpoint);
+    assert (rc == 0);
+    char buf [256];
+    rc = zmq_recv (raw, buf, sizeof buf, 0);
+    assert (rc > 0);
+    rc = zmq_recv (raw, buf, sizeof buf, 0);
+    assert (rc == 0);
+    int linger = 0;
+    rc = zmq_setsockopt (raw, ZMQ_LINGER, &linger, sizeof linger);
+    assert (rc == 0);
+    rc = zmq_close (raw);
+    assert (rc == 0);
+
+    zmq_socket_stats_t stats = get_stats (push);
+    for (int i = 0; i < 100 && stats.reconnects == 0; i++) {
+        msleep (10);
+        stats = get_stats (push);
+    }
+    assert (stats.reconnects > 0);
+
+    stats = get_stats (pull);
+    for (int i = 0; i < 100 && stats.handshake_failures == 0; i++) {
+        msleep (10);
+        stats = get_stats (pull);
+    }
+    assert (stats.handshake_failures == 1);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_message_counters (ctx);
+    test_drops (ctx);
+    test_connection_counters (ctx);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
@@ -0,0 +1,200 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+static void set_int (void *socket_, int option_, int value_)
+{
+    int rc = zmq_setsockopt (socket_, option_, &value_, sizeof (value_));
+    assert (rc == 0);
+}
+
+static void test_options (void *ctx_)
+{
+    void *socket = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (socket);
+
+    int value;
+    size_t size = sizeof (value);
+    int rc = zmq_getsockopt (socket, ZMQ_TCP_AUTOTUNE, &value, &size);
+    assert (rc == 0 && value == 0);
+    set_int (socket, ZMQ_TCP_AUTOTUNE, 1);
+    rc = zmq_getsockopt (socket, ZMQ_TCP_AUTOTUNE, &value, &size);
+    assert (rc == 0 && value == 1);
+    value = 2;
+    rc = zmq_setsockopt (socket, ZMQ_TCP_AUTOTUNE, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_getsockopt (socket, ZMQ_TCP_NOTSENT_LOWAT, &value, &size);
+    assert (rc == 0 && value == -1);
+    set_int (socket, ZMQ_TCP_NOTSENT_LOWAT, 16384);
+    rc = zmq_getsockopt (socket, ZMQ_TCP_NOTSENT_LOWAT, &value, &size);
+    assert (rc == 0 && value == 16384);
+    value = -2;
+    rc = zmq_setsockopt (socket, ZMQ_TCP_NOTSENT_LOWAT, &value,
+        sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_close (socket);
+    assert (rc == 0);
+}
+
+#if defined ZMQ_HAVE_LINUX
+//  Returns the descriptor of the test's TCP connection to port_, which the
+//  library doesn't expose.
+static int connection_fd (unsigned short port_)
+{
+    for (int fd = 0; fd < 1024; fd++) {
+        int type;
+        socklen_t len = sizeof (type);
+        if (getsockopt (fd, SOL_SOCKET, SO_TYPE, &type, &len) != 0
+        ||  type != SOCK_STREAM)
+            continue;
+        struct sockaddr_in peer;
+        len = sizeof (peer);
+        if (getpeername (fd, (struct sockaddr *) &peer, &len) == 0
+        &&  peer.sin_family == AF_INET && ntohs (peer.sin_port) == port_)
+            return fd;
+    }
+    assert (false);
+    return -1;
+}
+
+static int buffer_size (int fd_, int option_)
+{
+    int value;
+    socklen_t len = sizeof (value);
+    int rc = getsockopt (fd_, SOL_SOCKET, option_, &value, &len);
+    assert (rc == 0);
+    return value;
+}
+#endif
+
+//  Moves messages both ways across a few autotuning ticks. With a buffer
+//  size set on one side, that side's buffers are left alone; otherwise
+//  buffers the test shrinks behind the library's back are grown again.
+static void test_transfer (void *ctx_, const char *endpoint_, int bufsize_)
+{
+    void *server = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (server);
+    void *client = zmq_socket (ctx_, ZMQ_DEALER);
+    assert (client);
+    set_int (server, ZMQ_TCP_AUTOTUNE, 1);
+    set_int (client, ZMQ_TCP_AUTOTUNE, 1);
+    set_int (server, ZMQ_TCP_NOTSENT_LOWAT, 16384);
+    if (bufsize_ >= 0) {
+        set_int (client, ZMQ_SNDBUF, bufsize_);
+        set_int (client, ZMQ_RCVBUF, bufsize_);
+    }
+
+    int rc = zmq_bind (server, endpoint_);
+    assert (rc == 0);
+    char endpoint [256];
+    size_t size = sizeof (endpoint);
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, endpoint, &size);
+    assert (rc == 0);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+
+    char data [4096];
+    memset (data, 'x', sizeof (data));
+    rc = zmq_send (client, data, sizeof (data), 0);
+    assert (rc == (int) sizeof (data));
+    rc = zmq_recv (server, data, sizeof (data), 0);
+    assert (rc == (int) sizeof (data));
+
+#if defined ZMQ_HAVE_LINUX
+    //  Linux reports twice the size set, for its bookkeeping.
+    const bool tcp = strncmp (endpoint, "tcp://", 6) == 0;
+    int fd = -1;
+    if (tcp) {
+        const char *port = strrchr (endpoint, ':') + 1;
+        fd = connection_fd ((unsigned short) atoi (port));
+        if (bufsize_ >= 0) {
+            assert (buffer_size (fd, SO_SNDBUF) == 2 * bufsize_);
+            assert (buffer_size (fd, SO_RCVBUF) == 2 * bufsize_);
+        }
+        else {
+            const int small = 4096;
+            rc = setsockopt (fd, SOL_SOCKET, SO_SNDBUF, &small, sizeof (small));
+            assert (rc == 0);
+            rc = setsockopt (fd, SOL_SOCKET, SO_RCVBUF, &small, sizeof (small));
+            assert (rc == 0);
+        }
+    }
+#endif
+
+    for (int tick = 0; tick < 3; tick++) {
+        for (int i = 0; i < 100; i++) {
+            rc = zmq_send (client, data, sizeof (data), 0);
+            assert (rc == (int) sizeof (data));
+            rc = zmq_recv (server, data, sizeof (data), 0);
+            assert (rc == (int) sizeof (data));
+            rc = zmq_send (server, data, sizeof (data), 0);
+            assert (rc == (int) sizeof (data));
+            rc = zmq_recv (client, data, sizeof (data), 0);
+            assert (rc == (int) sizeof (data));
+        }
+        msleep (600);
+    }
+
+#if defined ZMQ_HAVE_LINUX
+    if (tcp) {
+        const int expected = bufsize_ >= 0 ? 2 * bufsize_ : 2 * 65536;
+        assert (buffer_size (fd, SO_SNDBUF) == expected);
+        assert (buffer_size (fd, SO_RCVBUF) == expected);
+    }
+#endif
+
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_options (ctx);
+    test_transfer (ctx, "tcp://127.0.0.1:*", -1);
+    test_transfer (ctx, "tcp://127.0.0.1:*", 4096);
+#if !defined _WIN32
+    //  There is no round trip time to tune by; the engine just stops.
+    test_transfer (ctx, "ipc://*", -1);
+#endif
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
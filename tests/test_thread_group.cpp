@@ -0,0 +1,185 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+#define PAIRS 50
+
+static void send_string (void *socket_, const char *string_)
+{
+    int rc = s_send (socket_, string_);
+    assert (rc == (int) strlen (string_));
+}
+
+static void recv_string (void *socket_, const char *string_)
+{
+    char *received = s_recv (socket_);
+    assert (received);
+    assert (streq (received, string_));
+    free (received);
+}
+
+static void *client_to_wake;
+
+static void delayed_send (void *)
+{
+    msleep (100);
+    int rc = zmq_send (client_to_wake, "late", 4, 0);
+    assert (rc == 4);
+}
+
+static void expect_ready (void *poller_, void **servers_, int first_,
+    int second_)
+{
+    zmq_poller_event_t events [PAIRS];
+    int rc = zmq_poller_wait_all (poller_, events, PAIRS, 1000);
+    assert (rc == (second_ < 0 ? 1 : 2));
+
+    //  Events are reported in the order the sockets were added.
+    assert (events [0].socket == servers_ [first_]);
+    assert (events [0].events == ZMQ_POLLIN);
+    assert (events [0].user_data == (void*) &servers_ [first_]);
+    if (second_ >= 0) {
+        assert (events [1].socket == servers_ [second_]);
+        assert (events [1].events == ZMQ_POLLIN);
+    }
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *group = zmq_thread_group_new ();
+    assert (group);
+
+    void *poller = zmq_poller_new ();
+    assert (poller);
+
+    void *servers [PAIRS];
+    void *clients [PAIRS];
+    char endpoint [32];
+    int rc;
+
+    for (int i = 0; i < PAIRS; i++) {
+        sprintf (endpoint, "inproc://group-%d", i);
+        servers [i] = zmq_socket (ctx, ZMQ_PAIR);
+        assert (servers [i]);
+        rc = zmq_bind (servers [i], endpoint);
+        assert (rc == 0);
+        clients [i] = zmq_socket (ctx, ZMQ_PAIR);
+        assert (clients [i]);
+        rc = zmq_connect (clients [i], endpoint);
+        assert (rc == 0);
+
+        //  The sockets join once their peer has connected, so that the
+        //  pending wake-up is moved over to the group.
+        rc = zmq_thread_group_add (group, servers [i]);
+        assert (rc == 0);
+
+        rc = zmq_poller_add (poller, servers [i], &servers [i], ZMQ_POLLIN);
+        assert (rc == 0);
+    }
+
+    //  A socket can be a member of one group only.
+    rc = zmq_thread_group_add (group, servers [0]);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Thread-safe sockets are not owned by a single thread.
+    void *client = zmq_socket (ctx, ZMQ_CLIENT);
+    assert (client);
+    rc = zmq_thread_group_add (group, client);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_close (client);
+    assert (rc == 0);
+
+    zmq_poller_event_t event;
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == ETIMEDOUT);
+
+    //  Only the sockets that got a message are reported.
+    send_string (clients [7], "seven");
+    expect_ready (poller, servers, 7, -1);
+    recv_string (servers [7], "seven");
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == ETIMEDOUT);
+
+    send_string (clients [42], "forty-two");
+    send_string (clients [3], "three");
+    expect_ready (poller, servers, 3, 42);
+
+    //  A socket stays ready for as long as it has messages.
+    recv_string (servers [42], "forty-two");
+    expect_ready (poller, servers, 3, -1);
+    recv_string (servers [3], "three");
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == ETIMEDOUT);
+
+    //  Blocking calls on a grouped socket still wake up.
+    client_to_wake = clients [11];
+    void *thread = zmq_threadstart (&delayed_send, NULL);
+    recv_string (servers [11], "late");
+    zmq_threadclose (thread);
+
+    //  zmq_poll works with grouped sockets too.
+    send_string (clients [20], "twenty");
+    zmq_pollitem_t items [] = {
+        {servers [19], 0, ZMQ_POLLIN, 0},
+        {servers [20], 0, ZMQ_POLLIN, 0}
+    };
+    rc = zmq_poll (items, 2, 1000);
+    assert (rc == 1);
+    assert (items [0].revents == 0);
+    assert (items [1].revents == ZMQ_POLLIN);
+    recv_string (servers [20], "twenty");
+
+    //  The group lives on until its members are gone.
+    rc = zmq_thread_group_destroy (&group);
+    assert (rc == 0);
+    assert (group == NULL);
+
+    send_string (clients [0], "zero");
+    expect_ready (poller, servers, 0, -1);
+    recv_string (servers [0], "zero");
+
+    rc = zmq_poller_destroy (&poller);
+    assert (rc == 0);
+
+    for (int i = 0; i < PAIRS; i++) {
+        close_zero_linger (servers [i]);
+        close_zero_linger (clients [i]);
+    }
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,232 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+static void publish (void *pub_, const char *topic_, const char *value_)
+{
+    int rc = zmq_send (pub_, topic_, strlen (topic_), ZMQ_SNDMORE);
+    assert (rc == (int) strlen (topic_));
+    rc = zmq_send (pub_, value_, strlen (value_), 0);
+    assert (rc == (int) strlen (value_));
+}
+
+static void expect (void *sub_, const char *topic_, const char *value_)
+{
+    char buffer [32];
+    int rc = zmq_recv (sub_, buffer, sizeof (buffer), 0);
+    assert (rc == (int) strlen (topic_));
+    assert (memcmp (buffer, topic_, rc) == 0);
+    rc = zmq_recv (sub_, buffer, sizeof (buffer), 0);
+    assert (rc == (int) strlen (value_));
+    assert (memcmp (buffer, value_, rc) == 0);
+}
+
+static void expect_nothing (void *sub_)
+{
+    char buffer [32];
+    int rc = zmq_recv (sub_, buffer, sizeof (buffer), ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+}
+
+//  Connects a new subscriber and lets the publisher process the
+//  subscription.
+static void *subscribe (void *ctx_, void *pub_, const char *endpoint_,
+    const char *topic_)
+{
+    void *sub = zmq_socket (ctx_, ZMQ_SUB);
+    assert (sub);
+    int rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, topic_, strlen (topic_));
+    assert (rc == 0);
+    rc = zmq_connect (sub, endpoint_);
+    assert (rc == 0);
+
+    char buffer [32];
+    rc = zmq_recv (pub_, buffer, sizeof (buffer), 0);
+    assert (rc == (int) strlen (topic_) + 1);
+    assert (buffer [0] == 1);
+    return sub;
+}
+
+//  A replay that fills the pipe goes on where it stopped once the
+//  subscriber catches up, one whole message at a time.
+static void test_full_pipe (void *ctx_)
+{
+    void *pub = zmq_socket (ctx_, ZMQ_XPUB);
+    assert (pub);
+    int option = 10;
+    int rc = zmq_setsockopt (pub, ZMQ_XPUB_LAST_VALUE_CACHE, &option,
+        sizeof (option));
+    assert (rc == 0);
+    option = 1;
+    rc = zmq_setsockopt (pub, ZMQ_XPUB_VERBOSE, &option, sizeof (option));
+    assert (rc == 0);
+    rc = zmq_setsockopt (pub, ZMQ_SNDHWM, &option, sizeof (option));
+    assert (rc == 0);
+    rc = zmq_bind (pub, "inproc://lvc-full");
+    assert (rc == 0);
+
+    char topic [16];
+    char value [16];
+    for (int i = 0; i != 10; i++) {
+        sprintf (topic, "t%d", i);
+        sprintf (value, "v%d", i);
+        publish (pub, topic, value);
+    }
+
+    void *sub = zmq_socket (ctx_, ZMQ_SUB);
+    assert (sub);
+    rc = zmq_setsockopt (sub, ZMQ_RCVHWM, &option, sizeof (option));
+    assert (rc == 0);
+    rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "t", 1);
+    assert (rc == 0);
+    rc = zmq_connect (sub, "inproc://lvc-full");
+    assert (rc == 0);
+    char buffer [32];
+    rc = zmq_recv (pub, buffer, sizeof (buffer), 0);
+    assert (rc == 2);
+
+    for (int i = 0; i != 10; i++) {
+        //  Let the publisher learn that the pipe has drained.
+        int events;
+        size_t events_size = sizeof (events);
+        zmq_pollitem_t item = {sub, 0, ZMQ_POLLIN, 0};
+        while (zmq_poll (&item, 1, 0) == 0) {
+            rc = zmq_getsockopt (pub, ZMQ_EVENTS, &events, &events_size);
+            assert (rc == 0);
+            msleep (10);
+        }
+        sprintf (topic, "t%d", i);
+        sprintf (value, "v%d", i);
+        expect (sub, topic, value);
+    }
+    msleep (SETTLE_TIME);
+    expect_nothing (sub);
+
+    close_zero_linger (sub);
+    close_zero_linger (pub);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    size_t len = MAX_SOCKET_STRING;
+    char my_endpoint [MAX_SOCKET_STRING];
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *pub = zmq_socket (ctx, ZMQ_XPUB);
+    assert (pub);
+
+    int size = -1;
+    int rc = zmq_setsockopt (pub, ZMQ_XPUB_LAST_VALUE_CACHE, &size,
+        sizeof (size));
+    assert (rc == -1 && errno == EINVAL);
+
+    size = 2;
+    rc = zmq_setsockopt (pub, ZMQ_XPUB_LAST_VALUE_CACHE, &size,
+        sizeof (size));
+    assert (rc == 0);
+
+    //  Pass duplicate subscriptions on so that each subscriber can be
+    //  waited for.
+    int verbose = 1;
+    rc = zmq_setsockopt (pub, ZMQ_XPUB_VERBOSE, &verbose, sizeof (verbose));
+    assert (rc == 0);
+
+    rc = zmq_bind (pub, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    rc = zmq_getsockopt (pub, ZMQ_LAST_ENDPOINT, my_endpoint, &len);
+    assert (rc == 0);
+
+    //  Nobody is subscribed yet, but the last values are kept.
+    publish (pub, "ticker.a", "1");
+    publish (pub, "ticker.b", "2");
+    publish (pub, "ticker.a", "3");
+
+    //  A late joiner gets the last value of the topics it subscribes to.
+    void *sub1 = subscribe (ctx, pub, my_endpoint, "ticker.a");
+    expect (sub1, "ticker.a", "3");
+    msleep (SETTLE_TIME);
+    expect_nothing (sub1);
+
+    //  Prefix subscriptions get all the matching topics.
+    void *sub2 = subscribe (ctx, pub, my_endpoint, "ticker.");
+    expect (sub2, "ticker.a", "3");
+    expect (sub2, "ticker.b", "2");
+    msleep (SETTLE_TIME);
+    expect_nothing (sub2);
+
+    //  Subscribing again to topics the pipe matches already, be it through
+    //  the same or a shorter prefix, replays nothing.
+    rc = zmq_setsockopt (sub2, ZMQ_SUBSCRIBE, "ticker.", 7);
+    assert (rc == 0);
+    rc = zmq_setsockopt (sub2, ZMQ_SUBSCRIBE, "ticker.a", 8);
+    assert (rc == 0);
+    char buffer [32];
+    rc = zmq_recv (pub, buffer, sizeof (buffer), 0);
+    assert (rc == 8);
+    rc = zmq_recv (pub, buffer, sizeof (buffer), 0);
+    assert (rc == 9);
+    msleep (SETTLE_TIME);
+    expect_nothing (sub2);
+
+    //  Live updates keep flowing to existing subscribers. The cache holds
+    //  two topics, so the least recently published one is evicted.
+    publish (pub, "ticker.c", "4");
+    expect (sub2, "ticker.c", "4");
+    void *sub3 = subscribe (ctx, pub, my_endpoint, "ticker.");
+    expect (sub3, "ticker.a", "3");
+    expect (sub3, "ticker.c", "4");
+    msleep (SETTLE_TIME);
+    expect_nothing (sub3);
+
+    //  Disabling the cache drops its content.
+    size = 0;
+    rc = zmq_setsockopt (pub, ZMQ_XPUB_LAST_VALUE_CACHE, &size,
+        sizeof (size));
+    assert (rc == 0);
+    void *sub4 = subscribe (ctx, pub, my_endpoint, "ticker.");
+    msleep (SETTLE_TIME);
+    expect_nothing (sub4);
+
+    close_zero_linger (sub1);
+    close_zero_linger (sub2);
+    close_zero_linger (sub3);
+    close_zero_linger (sub4);
+    close_zero_linger (pub);
+
+    test_full_pipe (ctx);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
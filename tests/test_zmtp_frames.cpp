@@ -0,0 +1,437 @@
+/*
+    Copyright (c) 2007-2017 Contributors as noted in the AUTHORS file
+
+    This file is part of libzmq, the ZeroMQ core engine in C++.
+
+    libzmq is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License (LGPL) as published
+    by the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    As a special exception, the Contributors give you permission to link
+    this library with independent modules to produce an executable,
+    regardless of the license terms of these independent modules, and to
+    copy and distribute the resulting executable under terms of your choice,
+    provided that you also meet, for each linked independent module, the
+    terms and conditions of the license of that module. An independent
+    module is a module which is not derived from or based on this library.
+    If you modify this library, you must extend this exception to your
+    version of the library.
+
+    libzmq is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+typedef unsigned char byte;
+
+//  Greeting of a ZMTP/3.0 peer using the NULL mechanism.
+static const byte greeting [64] = {
+    0xFF, 0, 0, 0, 0, 0, 0, 0, 1, 0x7F, 3, 0, 'N', 'U', 'L', 'L'
+};
+
+//  READY command of a PUSH socket.
+static const byte ready_push [28] = {
+    4, 26, 5, 'R', 'E', 'A', 'D', 'Y', 11, 'S', 'o', 'c', 'k', 'e', 't',
+    '-', 'T', 'y', 'p', 'e', 0, 0, 0, 4, 'P', 'U', 'S', 'H'
+};
+
+//  READY command of a PULL socket.
+static const byte ready_pull [28] = {
+    4, 26, 5, 'R', 'E', 'A', 'D', 'Y', 11, 'S', 'o', 'c', 'k', 'e', 't',
+    '-', 'T', 'y', 'p', 'e', 0, 0, 0, 4, 'P', 'U', 'L', 'L'
+};
+
+//  Writes raw bytes to the peer of the ZMQ_STREAM socket.
+static void send_raw (void *stream_, zmq_msg_t *id_, const void *data_,
+    size_t size_)
+{
+    zmq_msg_t id;
+    int rc = zmq_msg_init (&id);
+    assert (rc == 0);
+    rc = zmq_msg_copy (&id, id_);
+    assert (rc == 0);
+    rc = zmq_msg_send (&id, stream_, ZMQ_SNDMORE);
+    assert (rc > 0);
+    rc = zmq_send (stream_, data_, size_, 0);
+    assert (rc == (int) size_);
+}
+
+//  Reads one chunk of raw bytes from the ZMQ_STREAM socket. An empty
+//  chunk means the peer disconnected.
+static int recv_raw (void *stream_, byte *data_, size_t size_)
+{
+    zmq_msg_t id;
+    int rc = zmq_msg_init (&id);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&id, stream_, 0);
+    if (rc == -1) {
+        assert (errno == EAGAIN);
+        return -1;
+    }
+    assert (zmq_msg_more (&id));
+    rc = zmq_msg_close (&id);
+    assert (rc == 0);
+    rc = zmq_recv (stream_, data_, size_, 0);
+    assert (rc >= 0 && rc <= (int) size_);
+    return rc;
+}
+
+//  Connects a ZMQ_STREAM socket to the endpoint and completes the
+//  handshake with the given READY command, so that frames can be written
+//  and read by hand.
+static void *connect_raw (void *ctx_, const char *endpoint_, zmq_msg_t *id_,
+    const byte *ready_ = ready_push)
+{
+    void *stream = zmq_socket (ctx_, ZMQ_STREAM);
+    assert (stream);
+    int zero = 0;
+    int rc = zmq_setsockopt (stream, ZMQ_LINGER, &zero, sizeof (zero));
+    assert (rc == 0);
+    int timeout = 5000;
+    rc = zmq_setsockopt (stream, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    rc = zmq_connect (stream, endpoint_);
+    assert (rc == 0);
+
+    //  The connection is announced with its routing id and no data.
+    rc = zmq_msg_init (id_);
+    assert (rc == 0);
+    rc = zmq_msg_recv (id_, stream, 0);
+    assert (rc > 0);
+    byte buffer [64];
+    rc = zmq_recv (stream, buffer, sizeof (buffer), 0);
+    assert (rc == 0);
+
+    //  Wait for the peer's greeting and READY command before sending
+    //  ours. A peer only takes messages once it has sent its own READY.
+    send_raw (stream, id_, greeting, sizeof (greeting));
+    byte handshake [256];
+    size_t size = 0;
+    while (size < 66 || size < 66 + (size_t) handshake [65]) {
+        rc = recv_raw (stream, handshake + size, sizeof (handshake) - size);
+        assert (rc > 0);
+        size += rc;
+    }
+    assert (handshake [64] == 4);
+    assert (size == 66 + (size_t) handshake [65]);
+    send_raw (stream, id_, ready_, sizeof (ready_push));
+    return stream;
+}
+
+//  Fills the buffer with a pattern that depends on the frame.
+static void fill (byte *data_, size_t size_, int seed_)
+{
+    for (size_t i = 0; i < size_; i++)
+        data_ [i] = (byte) (seed_ + i * 7);
+}
+
+//  Appends a frame of the given size to the buffer and returns the number
+//  of bytes it takes. Frames of up to 255 bytes have a one-byte size,
+//  larger ones have an eight-byte size and the large flag set.
+static size_t put_frame (byte *buffer_, size_t size_, bool more_, int seed_)
+{
+    size_t pos = 0;
+    const byte more_flag = more_ ? 1 : 0;
+    if (size_ <= 255) {
+        buffer_ [pos++] = more_flag;
+        buffer_ [pos++] = (byte) size_;
+    }
+    else {
+        buffer_ [pos++] = more_flag | 2;
+        for (int i = 7; i >= 0; i--)
+            buffer_ [pos++] = (byte) (size_ >> (i * 8));
+    }
+    fill (buffer_ + pos, size_, seed_);
+    return pos + size_;
+}
+
+//  Receives a frame and checks it is the one put_frame wrote.
+static void recv_frame (void *socket_, size_t size_, bool more_, int seed_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, socket_, 0);
+    assert (rc == (int) size_);
+    assert (zmq_msg_more (&msg) == (more_ ? 1 : 0));
+    byte expected [512];
+    assert (size_ <= sizeof (expected));
+    fill (expected, size_, seed_);
+    assert (memcmp (zmq_msg_data (&msg), expected, size_) == 0);
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+}
+
+static void *bind_pull (void *ctx_, char *endpoint_, int64_t maxmsgsize_)
+{
+    void *pull = zmq_socket (ctx_, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_setsockopt (pull, ZMQ_MAXMSGSIZE, &maxmsgsize_,
+        sizeof (maxmsgsize_));
+    assert (rc == 0);
+    int timeout = 5000;
+    rc = zmq_setsockopt (pull, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    size_t len = MAX_SOCKET_STRING;
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, endpoint_, &len);
+    assert (rc == 0);
+    return pull;
+}
+
+static void close_raw (void *stream_, zmq_msg_t *id_)
+{
+    int rc = zmq_msg_close (id_);
+    assert (rc == 0);
+    rc = zmq_close (stream_);
+    assert (rc == 0);
+}
+
+//  Frames on both sides of the one-byte size limit, and of the largest
+//  body a message holds inline, decoded from a single read.
+static void test_decode_sizes (void *ctx_)
+{
+    char endpoint [MAX_SOCKET_STRING];
+    void *pull = bind_pull (ctx_, endpoint, -1);
+    zmq_msg_t id;
+    void *stream = connect_raw (ctx_, endpoint, &id);
+
+    const size_t sizes [] = { 0, 1, 33, 34, 64, 254, 255, 256, 257, 300 };
+    const int count = sizeof (sizes) / sizeof (sizes [0]);
+    byte buffer [4096];
+    size_t pos = 0;
+    for (int i = 0; i < count; i++)
+        pos += put_frame (buffer + pos, sizes [i], false, i);
+    send_raw (stream, &id, buffer, pos);
+    for (int i = 0; i < count; i++)
+        recv_frame (pull, sizes [i], false, i);
+
+    close_raw (stream, &id);
+    int rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+//  Multipart messages keep their more flags, whatever the frame size.
+static void test_decode_more (void *ctx_)
+{
+    char endpoint [MAX_SOCKET_STRING];
+    void *pull = bind_pull (ctx_, endpoint, -1);
+    zmq_msg_t id;
+    void *stream = connect_raw (ctx_, endpoint, &id);
+
+    const size_t sizes [] = { 5, 255, 256, 0, 33, 3 };
+    const int count = sizeof (sizes) / sizeof (sizes [0]);
+    byte buffer [4096];
+    size_t pos = 0;
+    for (int i = 0; i < count; i++)
+        pos += put_frame (buffer + pos, sizes [i], i != 2 && i != count - 1,
+            i);
+    send_raw (stream, &id, buffer, pos);
+    for (int i = 0; i < count; i++)
+        recv_frame (pull, sizes [i], i != 2 && i != count - 1, i);
+
+    close_raw (stream, &id);
+    int rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+//  Frames split across reads at every part of the frame: after the flags,
+//  within the eight-byte size, between size and body and within the body.
+static void test_decode_split (void *ctx_)
+{
+    char endpoint [MAX_SOCKET_STRING];
+    void *pull = bind_pull (ctx_, endpoint, -1);
+    zmq_msg_t id;
+    void *stream = connect_raw (ctx_, endpoint, &id);
+
+    const size_t sizes [] = { 10, 255, 256, 20 };
+    const int count = sizeof (sizes) / sizeof (sizes [0]);
+    byte buffer [4096];
+    size_t pos = 0;
+    for (int i = 0; i < count; i++)
+        pos += put_frame (buffer + pos, sizes [i], i < 2, i);
+
+    //  Offsets into the frames of 12, 257, 265 and 22 bytes.
+    const size_t splits [] = { 1, 2, 7, 12 + 1, 12 + 100, 12 + 257 + 1,
+        12 + 257 + 5, 12 + 257 + 9, 12 + 257 + 265 + 2, pos };
+    size_t sent = 0;
+    for (size_t i = 0; i < sizeof (splits) / sizeof (splits [0]); i++) {
+        send_raw (stream, &id, buffer + sent, splits [i] - sent);
+        sent = splits [i];
+        msleep (50);
+    }
+    for (int i = 0; i < count; i++)
+        recv_frame (pull, sizes [i], i < 2, i);
+
+    close_raw (stream, &id);
+    int rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+//  A frame larger than ZMQ_MAXMSGSIZE drops the connection, whether it is
+//  small enough to be decoded in one go or not. The limit applies to the
+//  READY command too, so it can't be below its size.
+static void test_decode_maxmsgsize (void *ctx_, size_t limit_)
+{
+    char endpoint [MAX_SOCKET_STRING];
+    void *pull = bind_pull (ctx_, endpoint, limit_);
+    zmq_msg_t id;
+    void *stream = connect_raw (ctx_, endpoint, &id);
+
+    byte buffer [4096];
+    size_t pos = put_frame (buffer, limit_, false, 1);
+    send_raw (stream, &id, buffer, pos);
+    recv_frame (pull, limit_, false, 1);
+
+    pos = put_frame (buffer, limit_ + 1, false, 2);
+    pos += put_frame (buffer + pos, 1, false, 3);
+    send_raw (stream, &id, buffer, pos);
+
+    //  Expect the disconnect.
+    int rc;
+    while ((rc = recv_raw (stream, buffer, sizeof (buffer))) > 0)
+        ;
+    assert (rc == 0);
+
+    //  Neither the oversized frame nor the one after it got through.
+    int timeout = 100;
+    rc = zmq_setsockopt (pull, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    rc = zmq_recv (pull, buffer, sizeof (buffer), 0);
+    assert (rc == -1 && errno == EAGAIN);
+
+    close_raw (stream, &id);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+//  Frames on both sides of the one-byte size limit and of the largest
+//  body a message holds inline. Sent a number of times over, they cross
+//  the end of the encoder's batch buffer at varying offsets.
+static const size_t encode_sizes [] = { 255, 256, 1, 33, 34, 0, 254, 257, 100 };
+static const int encode_count =
+    20 * sizeof (encode_sizes) / sizeof (encode_sizes [0]);
+
+static size_t encode_size (int i_)
+{
+    return encode_sizes [i_ % (sizeof (encode_sizes) / sizeof (size_t))];
+}
+
+static bool encode_more (int i_)
+{
+    return i_ % 3 != 2;
+}
+
+static void send_frames (void *socket_)
+{
+    byte data [512];
+    for (int i = 0; i < encode_count; i++) {
+        fill (data, encode_size (i), i);
+        int rc = zmq_send (socket_, data, encode_size (i),
+            encode_more (i) ? ZMQ_SNDMORE : 0);
+        assert (rc == (int) encode_size (i));
+    }
+}
+
+//  The bytes on the wire are the frames put_frame writes, also where
+//  frames cross the end of a batch.
+static void test_encode_wire (void *ctx_)
+{
+    void *push = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (push);
+    int rc = zmq_bind (push, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [MAX_SOCKET_STRING];
+    size_t len = MAX_SOCKET_STRING;
+    rc = zmq_getsockopt (push, ZMQ_LAST_ENDPOINT, endpoint, &len);
+    assert (rc == 0);
+    zmq_msg_t id;
+    void *stream = connect_raw (ctx_, endpoint, &id, ready_pull);
+
+    send_frames (push);
+
+    static byte expected [65536];
+    size_t expected_size = 0;
+    for (int i = 0; i < encode_count; i++)
+        expected_size += put_frame (expected + expected_size,
+            encode_size (i), encode_more (i), i);
+    assert (expected_size > 8192);
+
+    static byte received [65536];
+    size_t received_size = 0;
+    while (received_size < expected_size) {
+        rc = recv_raw (stream, received + received_size,
+            sizeof (received) - received_size);
+        assert (rc > 0);
+        received_size += rc;
+    }
+    assert (received_size == expected_size);
+    assert (memcmp (received, expected, expected_size) == 0);
+
+    close_raw (stream, &id);
+    rc = zmq_close (push);
+    assert (rc == 0);
+}
+
+//  Frames encoded by one socket decode intact on the other, with the
+//  default batch size or, with a batch size given, a batch barely larger
+//  than a frame.
+static void test_encode_round_trip (void *ctx_, int out_batch_size_)
+{
+    char endpoint [MAX_SOCKET_STRING];
+    void *pull = bind_pull (ctx_, endpoint, -1);
+    void *push = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (push);
+#ifdef ZMQ_BUILD_DRAFT_API
+    if (out_batch_size_ > 0) {
+        int rc = zmq_setsockopt (push, ZMQ_OUT_BATCH_SIZE, &out_batch_size_,
+            sizeof (out_batch_size_));
+        assert (rc == 0);
+    }
+#else
+    assert (out_batch_size_ == 0);
+#endif
+    int rc = zmq_connect (push, endpoint);
+    assert (rc == 0);
+
+    send_frames (push);
+    for (int i = 0; i < encode_count; i++)
+        recv_frame (pull, encode_size (i), encode_more (i), i);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_decode_sizes (ctx);
+    test_decode_more (ctx);
+    test_decode_split (ctx);
+    test_decode_maxmsgsize (ctx, 32);
+    test_decode_maxmsgsize (ctx, 255);
+    test_encode_wire (ctx);
+    test_encode_round_trip (ctx, 0);
+#ifdef ZMQ_BUILD_DRAFT_API
+    test_encode_round_trip (ctx, 300);
+#endif
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}